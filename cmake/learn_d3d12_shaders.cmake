@@ -0,0 +1,97 @@
+# Offline HLSL compilation with DXC.
+#
+# Every .hlsl under SHADER_DIR is scanned for the entry points VSMain, PSMain, CSMain,
+# ASMain and MSMain. Each entry point is compiled to DXIL and emitted as a C header
+# holding a byte array, and an index (shader_bytecode_index.inc) lists them all so the
+# executable can look bytecode up by "<relative path>", "<entry point>" without touching
+# the file system at startup. Includes are tracked through a depfile, so editing a shared
+# include only recompiles the shaders that use it.
+
+set(LEARN_D3D12_SHADER_MODEL "6_0" CACHE STRING "Shader model used for graphics and compute stages, for example 6_0 or 6_6.")
+
+find_program(
+  DXC_EXECUTABLE dxc
+  HINTS
+    "$ENV{DXC_PATH}"
+    "$ENV{VULKAN_SDK}/bin"
+    "$ENV{WindowsSdkVerBinPath}/x64"
+)
+
+function(learn_d3d12_compile_shaders target shader_dir output_dir)
+  if(NOT DXC_EXECUTABLE)
+    message(FATAL_ERROR "dxc was not found. Install the DirectX Shader Compiler or set DXC_EXECUTABLE.")
+  endif()
+
+  file(GLOB_RECURSE shader_files CONFIGURE_DEPENDS "${shader_dir}/*.hlsl")
+  set(outputs "")
+  set(index_content "// Generated by learn_d3d12_compile_shaders. Do not edit.\n")
+  set(index_entries "")
+
+  foreach(shader_file IN LISTS shader_files)
+    file(RELATIVE_PATH relative_path "${shader_dir}" "${shader_file}")
+    get_filename_component(relative_dir "${relative_path}" DIRECTORY)
+    get_filename_component(shader_name "${relative_path}" NAME_WE)
+    string(MAKE_C_IDENTIFIER "${relative_dir}_${shader_name}" variable_stem)
+
+    # Entry points are function definitions: optional attributes, a return type and the
+    # name at the start of a line, with no ';' after it, so comments, calls and prototypes
+    # do not count.
+    file(STRINGS "${shader_file}" entry_lines REGEX "^[ \t]*(\\[[^]]*\\][ \t]*)*[A-Za-z_][A-Za-z0-9_]*(<[^>]*>)?[ \t]+(VS|PS|CS|AS|MS)Main[ \t]*\\([^;]*$")
+    set(entry_points "")
+    foreach(line IN LISTS entry_lines)
+      string(REGEX REPLACE "^.*[ \t]((VS|PS|CS|AS|MS)Main)[ \t]*\\(.*$" "\\1" entry_point "${line}")
+      list(APPEND entry_points ${entry_point})
+    endforeach()
+    list(REMOVE_DUPLICATES entry_points)
+
+    foreach(entry_point IN LISTS entry_points)
+      string(SUBSTRING "${entry_point}" 0 2 stage)
+      string(TOLOWER "${stage}" stage)
+      if(stage STREQUAL "as" OR stage STREQUAL "ms")
+        set(profile "${stage}_6_5")
+      else()
+        set(profile "${stage}_${LEARN_D3D12_SHADER_MODEL}")
+      endif()
+
+      set(variable_name "shader_${variable_stem}_${entry_point}")
+      set(output "${output_dir}/${variable_name}.h")
+      set(depfile "${output_dir}/${variable_name}.d")
+      add_custom_command(
+        OUTPUT "${output}"
+        COMMAND "${DXC_EXECUTABLE}"
+          -nologo
+          -T ${profile}
+          -E ${entry_point}
+          -I "${shader_dir}"
+          "$<IF:$<CONFIG:Debug>,-Zi;-Od;-Qembed_debug,-O3>"
+          -Vn ${variable_name}
+          -Fh "${output}"
+          "${shader_file}"
+        COMMAND "${CMAKE_COMMAND}"
+          -DSHADER=${shader_file}
+          -DSHADER_ROOT=${shader_dir}
+          -DOUTPUT=${output}
+          -DDEPFILE=${depfile}
+          -P "${PROJECT_SOURCE_DIR}/cmake/scan_shader_includes.cmake"
+        MAIN_DEPENDENCY "${shader_file}"
+        DEPENDS "${PROJECT_SOURCE_DIR}/cmake/scan_shader_includes.cmake"
+        DEPFILE "${depfile}"
+        COMMAND_EXPAND_LISTS
+        COMMENT "Compiling ${relative_path} (${entry_point}, ${profile})"
+        VERBATIM
+      )
+      list(APPEND outputs "${output}")
+      string(APPEND index_content "#include \"${variable_name}.h\"\n")
+      string(APPEND index_entries "    {\"${relative_path}\", \"${entry_point}\", ${variable_name}, sizeof(${variable_name})},\n")
+    endforeach()
+  endforeach()
+
+  string(APPEND index_content "\n#define LEARN_D3D12_SHADER_BYTECODE_ENTRIES \\\n")
+  string(REPLACE "},\n" "}, \\\n" index_entries "${index_entries}")
+  string(APPEND index_content "${index_entries}\n")
+  # file(GENERATE) only touches the index when its content changes.
+  file(GENERATE OUTPUT "${output_dir}/shader_bytecode_index.inc" CONTENT "${index_content}")
+
+  add_custom_target(${target} DEPENDS ${outputs})
+  set_target_properties(${target} PROPERTIES FOLDER shaders)
+endfunction()
@@ -0,0 +1,38 @@
+# Writes a make-style depfile listing every file a shader includes, recursively.
+# Invoked at build time by learn_d3d12_compile_shaders:
+#   cmake -DSHADER=<source> -DSHADER_ROOT=<dir> -DOUTPUT=<compiled header> -DDEPFILE=<path> -P scan_shader_includes.cmake
+
+function(_learn_d3d12_scan_includes file visited_var)
+  set(visited ${${visited_var}})
+  if(NOT EXISTS "${file}")
+    return()
+  endif()
+  list(FIND visited "${file}" index)
+  if(NOT index EQUAL -1)
+    return()
+  endif()
+  list(APPEND visited "${file}")
+  get_filename_component(file_dir "${file}" DIRECTORY)
+  file(STRINGS "${file}" include_lines REGEX "^[ \t]*#[ \t]*include[ \t]*[\"<][^\">]+[\">]")
+  foreach(line IN LISTS include_lines)
+    string(REGEX REPLACE "^[ \t]*#[ \t]*include[ \t]*[\"<]([^\">]+)[\">].*$" "\\1" include_name "${line}")
+    if(EXISTS "${file_dir}/${include_name}")
+      get_filename_component(include_path "${file_dir}/${include_name}" ABSOLUTE)
+    else()
+      get_filename_component(include_path "${SHADER_ROOT}/${include_name}" ABSOLUTE)
+    endif()
+    _learn_d3d12_scan_includes("${include_path}" visited)
+  endforeach()
+  set(${visited_var} ${visited} PARENT_SCOPE)
+endfunction()
+
+set(dependencies "")
+_learn_d3d12_scan_includes("${SHADER}" dependencies)
+
+set(content "${OUTPUT}:")
+foreach(dependency IN LISTS dependencies)
+  string(REPLACE " " "\\ " dependency "${dependency}")
+  string(APPEND content " \\\n  ${dependency}")
+endforeach()
+string(APPEND content "\n")
+file(WRITE "${DEPFILE}" "${content}")
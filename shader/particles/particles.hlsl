@@ -0,0 +1,153 @@
+// Particle streams are stored as structure of arrays inside one raw buffer.
+// Stream n starts at byte n * capacity * 4, in the same order as ParticleSystem.
+#define STREAM_POSITION_X 0
+#define STREAM_POSITION_Y 1
+#define STREAM_POSITION_Z 2
+#define STREAM_VELOCITY_X 3
+#define STREAM_VELOCITY_Y 4
+#define STREAM_VELOCITY_Z 5
+#define STREAM_LIFETIME 6
+#define STREAM_COLOR 7
+
+cbuffer ParticleConstants : register(b0)
+{
+    uint particle_capacity;
+    uint generation;
+    float delta_time;
+    float aspect_ratio;
+    float particle_size;
+    float gravity;
+    float floor_height;
+    float restitution;
+    float spawn_speed;
+    float spawn_spread;
+    float min_lifetime;
+    float max_lifetime;
+};
+
+ByteAddressBuffer particles : register(t0);
+RWByteAddressBuffer particles_rw : register(u0);
+
+uint stream_address(uint stream, uint index)
+{
+    return (stream * particle_capacity + index) * 4;
+}
+
+// Must match hash_u32 in particle_system.cpp so both simulation paths agree.
+uint hash_u32(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float hash_to_unit_float(uint hash)
+{
+    return float(hash >> 8) * (1.0f / 16777216.0f);
+}
+
+float load_rw(uint stream, uint index)
+{
+    return asfloat(particles_rw.Load(stream_address(stream, index)));
+}
+
+void store_rw(uint stream, uint index, float value)
+{
+    particles_rw.Store(stream_address(stream, index), asuint(value));
+}
+
+[numthreads(256, 1, 1)]
+void CSMain(uint3 dispatch_id : SV_DispatchThreadID)
+{
+    uint i = dispatch_id.x;
+    if (i >= particle_capacity)
+    {
+        return;
+    }
+
+    float3 velocity = float3(load_rw(STREAM_VELOCITY_X, i), load_rw(STREAM_VELOCITY_Y, i), load_rw(STREAM_VELOCITY_Z, i));
+    float3 position = float3(load_rw(STREAM_POSITION_X, i), load_rw(STREAM_POSITION_Y, i), load_rw(STREAM_POSITION_Z, i));
+    velocity.y += gravity * delta_time;
+    position += velocity * delta_time;
+    if (position.y < floor_height)
+    {
+        position.y = floor_height;
+        velocity.y *= -restitution;
+    }
+
+    float lifetime = load_rw(STREAM_LIFETIME, i) - delta_time;
+    if (lifetime <= 0.0f)
+    {
+        uint hash_x = hash_u32(i * 0x9E3779B9u + generation * 0x85EBCA6Bu);
+        uint hash_y = hash_u32(hash_x);
+        uint hash_z = hash_u32(hash_y);
+        uint hash_lifetime = hash_u32(hash_z);
+        uint hash_color = hash_u32(hash_lifetime);
+        position = float3(0.0f, floor_height, 0.0f);
+        velocity.x = (hash_to_unit_float(hash_x) * 2.0f - 1.0f) * spawn_spread;
+        velocity.y = spawn_speed * (0.5f + 0.5f * hash_to_unit_float(hash_y));
+        velocity.z = (hash_to_unit_float(hash_z) * 2.0f - 1.0f) * spawn_spread;
+        lifetime = min_lifetime + hash_to_unit_float(hash_lifetime) * (max_lifetime - min_lifetime);
+        particles_rw.Store(stream_address(STREAM_COLOR, i), hash_color | 0xFF000000u);
+    }
+
+    store_rw(STREAM_POSITION_X, i, position.x);
+    store_rw(STREAM_POSITION_Y, i, position.y);
+    store_rw(STREAM_POSITION_Z, i, position.z);
+    store_rw(STREAM_VELOCITY_X, i, velocity.x);
+    store_rw(STREAM_VELOCITY_Y, i, velocity.y);
+    store_rw(STREAM_VELOCITY_Z, i, velocity.z);
+    store_rw(STREAM_LIFETIME, i, lifetime);
+}
+
+struct PSInput
+{
+    float4 position : SV_POSITION;
+    float4 color : COLOR;
+    float2 uv : TEXCOORD0;
+};
+
+static const float2 kQuadCorners[6] = {
+    float2(-1.0f, -1.0f),
+    float2(-1.0f, 1.0f),
+    float2(1.0f, 1.0f),
+    float2(-1.0f, -1.0f),
+    float2(1.0f, 1.0f),
+    float2(1.0f, -1.0f),
+};
+
+static const float3 kCameraPosition = float3(0.0f, -0.5f, -4.0f);
+static const float kFocalLength = 1.5f;
+
+PSInput VSMain(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
+{
+    float3 position = float3(
+        asfloat(particles.Load(stream_address(STREAM_POSITION_X, instance_id))),
+        asfloat(particles.Load(stream_address(STREAM_POSITION_Y, instance_id))),
+        asfloat(particles.Load(stream_address(STREAM_POSITION_Z, instance_id))));
+    float lifetime = asfloat(particles.Load(stream_address(STREAM_LIFETIME, instance_id)));
+    uint color = particles.Load(stream_address(STREAM_COLOR, instance_id));
+
+    float2 corner = kQuadCorners[vertex_id];
+    float3 view_position = position - kCameraPosition;
+    view_position.xy += corner * particle_size;
+
+    PSInput result;
+    result.position = float4(view_position.x * kFocalLength / aspect_ratio, view_position.y * kFocalLength, 0.5f * view_position.z, view_position.z);
+    result.color = float4(
+        float(color & 0xFF) / 255.0f,
+        float((color >> 8) & 0xFF) / 255.0f,
+        float((color >> 16) & 0xFF) / 255.0f,
+        saturate(lifetime));
+    result.uv = corner;
+    return result;
+}
+
+float4 PSMain(PSInput input) : SV_TARGET
+{
+    float falloff = saturate(1.0f - dot(input.uv, input.uv));
+    return float4(input.color.rgb, input.color.a * falloff);
+}
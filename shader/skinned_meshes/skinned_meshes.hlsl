@@ -0,0 +1,38 @@
+// Vertices arrive already skinned by the CPU, in world space relative to the mesh.
+cbuffer MeshConstants : register(b0)
+{
+    float offset_x;
+    float offset_z;
+    float aspect_ratio;
+};
+
+struct PSInput
+{
+    float4 position : SV_POSITION;
+    float3 normal : NORMAL;
+};
+
+static const float3 kCameraPosition = float3(0.0f, 0.6f, -4.0f);
+static const float kFocalLength = 1.5f;
+static const float kNearPlane = 0.1f;
+static const float kFarPlane = 100.0f;
+static const float3 kLightDirection = float3(0.4f, 0.8f, -0.45f);
+
+PSInput VSMain(float3 position : POSITION, float3 normal : NORMAL)
+{
+    float3 view_position = position + float3(offset_x, -0.5f, offset_z) - kCameraPosition;
+
+    PSInput result;
+    // A perspective projection with real depth, since the tubes occlude each other.
+    float depth_scale = kFarPlane / (kFarPlane - kNearPlane);
+    result.position = float4(view_position.x * kFocalLength / aspect_ratio, view_position.y * kFocalLength, (view_position.z - kNearPlane) * depth_scale, view_position.z);
+    result.normal = normal;
+    return result;
+}
+
+float4 PSMain(PSInput input) : SV_TARGET
+{
+    float lambert = saturate(dot(normalize(input.normal), normalize(kLightDirection)));
+    float3 albedo = float3(0.9f, 0.55f, 0.3f);
+    return float4(albedo * (0.2f + 0.8f * lambert), 1.0f);
+}
@@ -0,0 +1,50 @@
+// Every instance's transform and color is rebuilt by the CPU each frame.
+struct InstanceData
+{
+    row_major float3x4 world;
+    uint color;
+};
+
+cbuffer DrawConstants : register(b0)
+{
+    uint instance_offset;
+    float aspect_ratio;
+    float camera_distance;
+};
+
+StructuredBuffer<InstanceData> instances : register(t0);
+
+struct PSInput
+{
+    float4 position : SV_POSITION;
+    float3 normal : NORMAL;
+    float3 color : COLOR;
+};
+
+static const float kFocalLength = 1.5f;
+static const float kNearPlane = 0.05f;
+static const float kFarPlane = 100.0f;
+static const float3 kLightDirection = float3(0.4f, 0.8f, -0.45f);
+
+PSInput VSMain(float3 position : POSITION, float3 normal : NORMAL, uint instance_id : SV_InstanceID)
+{
+    // SV_InstanceID starts at zero for every draw, whatever StartInstanceLocation is.
+    InstanceData instance = instances[instance_offset + instance_id];
+    float3 world_position = mul(instance.world, float4(position, 1.0f));
+    // The instances may be scaled but never sheared, so the world matrix also turns normals.
+    float3 world_normal = mul((float3x3)instance.world, normal);
+    float3 view_position = world_position + float3(0.0f, 0.0f, camera_distance);
+
+    PSInput result;
+    float depth_scale = kFarPlane / (kFarPlane - kNearPlane);
+    result.position = float4(view_position.x * kFocalLength / aspect_ratio, view_position.y * kFocalLength, (view_position.z - kNearPlane) * depth_scale, view_position.z);
+    result.normal = world_normal;
+    result.color = float3(instance.color & 0xff, (instance.color >> 8) & 0xff, (instance.color >> 16) & 0xff) / 255.0f;
+    return result;
+}
+
+float4 PSMain(PSInput input) : SV_TARGET
+{
+    float lambert = saturate(dot(normalize(input.normal), normalize(kLightDirection)));
+    return float4(input.color * (0.2f + 0.8f * lambert), 1.0f);
+}
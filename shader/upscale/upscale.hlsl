@@ -0,0 +1,31 @@
+// Stretches the rendered corner of the dynamic resolution scene target over the back buffer.
+cbuffer UpscaleConstants : register(b0)
+{
+    float2 uv_scale;
+    float2 uv_max;
+};
+
+Texture2D scene : register(t0);
+SamplerState linear_clamp : register(s0);
+
+struct PSInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+// One triangle covering the screen: vertex ids 0, 1, 2 map to uv (0, 0), (2, 0), (0, 2).
+PSInput VSMain(uint vertex_id : SV_VertexID)
+{
+    float2 uv = float2((vertex_id << 1) & 2, vertex_id & 2);
+
+    PSInput result;
+    result.position = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    result.uv = uv * uv_scale;
+    return result;
+}
+
+float4 PSMain(PSInput input) : SV_TARGET
+{
+    return scene.SampleLevel(linear_clamp, min(input.uv, uv_max), 0);
+}
@@ -0,0 +1,314 @@
+#include "cpu_skinning.h"
+#include "../simd/cpu_features.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        // Vertices per task; a multiple of the lane count.
+        constexpr uint32_t kChunkVertexCount = 4096;
+        constexpr float kWeightScale = 1.0f / 255.0f;
+
+        struct SkinningChunk
+        {
+            uint32_t job;
+            uint32_t begin;
+            uint32_t end;
+        };
+    }  // namespace
+
+    SkinnedMesh::SkinnedMesh(uint32_t vertex_count)
+        : _vertex_count(vertex_count)
+        , _capacity((vertex_count + kLaneCount - 1) / kLaneCount * kLaneCount)
+        , _position_x(_capacity, 0.0f)
+        , _position_y(_capacity, 0.0f)
+        , _position_z(_capacity, 0.0f)
+        , _normal_x(_capacity, 0.0f)
+        , _normal_y(_capacity, 1.0f)
+        , _normal_z(_capacity, 0.0f)
+        , _bone_indices(_capacity, 0)
+        , _bone_weights(_capacity, 255)
+    {
+    }
+
+    void SkinnedMesh::set_vertex(uint32_t index, const float position[3], const float normal[3], const uint8_t bones[4], const float weights[4])
+    {
+        _position_x[index] = position[0];
+        _position_y[index] = position[1];
+        _position_z[index] = position[2];
+        _normal_x[index] = normal[0];
+        _normal_y[index] = normal[1];
+        _normal_z[index] = normal[2];
+
+        // Quantize, then give the rounding error to the largest weight so the sum is exactly 255.
+        float sum = weights[0] + weights[1] + weights[2] + weights[3];
+        float scale = sum > 0.0f ? 255.0f / sum : 0.0f;
+        int quantized[4];
+        int quantized_sum = 0;
+        uint32_t largest = 0;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            quantized[i] = static_cast<int>(std::lround(std::max(weights[i], 0.0f) * scale));
+            quantized_sum += quantized[i];
+            largest = quantized[i] > quantized[largest] ? i : largest;
+        }
+        quantized[largest] = std::clamp(quantized[largest] + 255 - quantized_sum, 0, 255);
+
+        uint32_t packed_bones = 0;
+        uint32_t packed_weights = 0;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            packed_bones |= static_cast<uint32_t>(bones[i]) << (8 * i);
+            packed_weights |= static_cast<uint32_t>(quantized[i]) << (8 * i);
+        }
+        _bone_indices[index] = packed_bones;
+        _bone_weights[index] = packed_weights;
+    }
+
+    void skin_meshes(const SkinningJob* jobs, uint32_t job_count, TaskPool* pool, bool allow_simd, std::pmr::memory_resource* scratch)
+    {
+        std::pmr::vector<SkinningChunk> chunks(scratch ? scratch : std::pmr::get_default_resource());
+        uint32_t chunk_count = 0;
+        for (uint32_t j = 0; j < job_count; j++)
+        {
+            chunk_count += (jobs[j].mesh->get_vertex_count() + kChunkVertexCount - 1) / kChunkVertexCount;
+        }
+        chunks.reserve(chunk_count);
+        for (uint32_t j = 0; j < job_count; j++)
+        {
+            const uint32_t vertex_count = jobs[j].mesh->get_vertex_count();
+            for (uint32_t begin = 0; begin < vertex_count; begin += kChunkVertexCount)
+            {
+                chunks.push_back({j, begin, std::min(begin + kChunkVertexCount, vertex_count)});
+            }
+        }
+
+        bool use_avx2 = allow_simd && is_skinning_avx2_available();
+        auto kernel = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t c = begin; c < end; c++)
+            {
+                const SkinningChunk& chunk = chunks[c];
+                if (use_avx2)
+                {
+                    skin_range_avx2(jobs[chunk.job], chunk.begin, chunk.end);
+                }
+                else
+                {
+                    skin_range_scalar(jobs[chunk.job], chunk.begin, chunk.end);
+                }
+            }
+        };
+        if (pool)
+        {
+            pool->parallel_for(static_cast<uint32_t>(chunks.size()), 1, kernel);
+        }
+        else
+        {
+            kernel(0, static_cast<uint32_t>(chunks.size()));
+        }
+    }
+
+    void skin_range_scalar(const SkinningJob& job, uint32_t begin, uint32_t end)
+    {
+        const SkinnedMesh& mesh = *job.mesh;
+        const float* position_x = mesh.get_position_x();
+        const float* position_y = mesh.get_position_y();
+        const float* position_z = mesh.get_position_z();
+        const float* normal_x = mesh.get_normal_x();
+        const float* normal_y = mesh.get_normal_y();
+        const float* normal_z = mesh.get_normal_z();
+        const uint32_t* bone_indices = mesh.get_bone_indices();
+        const uint32_t* bone_weights = mesh.get_bone_weights();
+        for (uint32_t i = begin; i < end; i++)
+        {
+            // Blend the four bone matrices, then transform once.
+            float m[3][4] = {};
+            for (uint32_t k = 0; k < 4; k++)
+            {
+                const float weight = static_cast<float>((bone_weights[i] >> (8 * k)) & 0xFF) * kWeightScale;
+                const Float3x4& bone = job.palette[(bone_indices[i] >> (8 * k)) & 0xFF];
+                for (uint32_t r = 0; r < 3; r++)
+                {
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        m[r][c] += weight * bone.m[r][c];
+                    }
+                }
+            }
+
+            SkinnedVertex vertex;
+            float normal[3];
+            for (uint32_t r = 0; r < 3; r++)
+            {
+                vertex.position[r] = m[r][0] * position_x[i] + m[r][1] * position_y[i] + m[r][2] * position_z[i] + m[r][3];
+                normal[r] = m[r][0] * normal_x[i] + m[r][1] * normal_y[i] + m[r][2] * normal_z[i];
+            }
+            const float inverse_length = 1.0f / std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (uint32_t r = 0; r < 3; r++)
+            {
+                vertex.normal[r] = normal[r] * inverse_length;
+            }
+            job.destination[i] = vertex;
+        }
+    }
+
+    void skin_range_avx2(const SkinningJob& job, uint32_t begin, uint32_t end)
+    {
+#if LEARN_D3D12_X86
+        // Kept in a lambda so only this body is compiled for AVX2.
+        auto kernel = [&job](uint32_t first, uint32_t last) LEARN_D3D12_TARGET_AVX2 {
+            const SkinnedMesh& mesh = *job.mesh;
+            const float* palette = &job.palette[0].m[0][0];
+            const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+            const __m256i matrix_stride = _mm256_set1_epi32(12);
+            const __m256 weight_scale = _mm256_set1_ps(kWeightScale);
+            alignas(32) float results[6][SkinnedMesh::kLaneCount];
+            for (uint32_t i = first; i < last; i += SkinnedMesh::kLaneCount)
+            {
+                const __m256i bones = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mesh.get_bone_indices() + i));
+                const __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mesh.get_bone_weights() + i));
+
+                // Blend the four bone matrices, gathering one of the 12 floats per lane at a time.
+                __m256 m[12];
+                for (uint32_t k = 0; k < 4; k++)
+                {
+                    const __m256i bone = _mm256_and_si256(_mm256_srli_epi32(bones, 8 * k), byte_mask);
+                    const __m256 weight = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(weights, 8 * k), byte_mask)), weight_scale);
+                    const __m256i offset = _mm256_mullo_epi32(bone, matrix_stride);
+                    for (uint32_t e = 0; e < 12; e++)
+                    {
+                        const __m256 element = _mm256_i32gather_ps(palette + e, offset, 4);
+                        m[e] = k == 0 ? _mm256_mul_ps(weight, element) : _mm256_fmadd_ps(weight, element, m[e]);
+                    }
+                }
+
+                const __m256 position_x = _mm256_loadu_ps(mesh.get_position_x() + i);
+                const __m256 position_y = _mm256_loadu_ps(mesh.get_position_y() + i);
+                const __m256 position_z = _mm256_loadu_ps(mesh.get_position_z() + i);
+                const __m256 normal_x = _mm256_loadu_ps(mesh.get_normal_x() + i);
+                const __m256 normal_y = _mm256_loadu_ps(mesh.get_normal_y() + i);
+                const __m256 normal_z = _mm256_loadu_ps(mesh.get_normal_z() + i);
+                __m256 normal[3];
+                for (uint32_t r = 0; r < 3; r++)
+                {
+                    __m256 position = _mm256_fmadd_ps(m[r * 4], position_x, m[r * 4 + 3]);
+                    position = _mm256_fmadd_ps(m[r * 4 + 1], position_y, position);
+                    _mm256_store_ps(results[r], _mm256_fmadd_ps(m[r * 4 + 2], position_z, position));
+                    normal[r] = _mm256_fmadd_ps(m[r * 4 + 2], normal_z, _mm256_fmadd_ps(m[r * 4 + 1], normal_y, _mm256_mul_ps(m[r * 4], normal_x)));
+                }
+                const __m256 length_squared = _mm256_fmadd_ps(normal[2], normal[2], _mm256_fmadd_ps(normal[1], normal[1], _mm256_mul_ps(normal[0], normal[0])));
+                const __m256 inverse_length = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(length_squared));
+                for (uint32_t r = 0; r < 3; r++)
+                {
+                    _mm256_store_ps(results[3 + r], _mm256_mul_ps(normal[r], inverse_length));
+                }
+
+                // Interleave into whole vertices; the padding lanes past the vertex count are dropped.
+                const uint32_t lane_count = std::min(SkinnedMesh::kLaneCount, mesh.get_vertex_count() - i);
+                for (uint32_t lane = 0; lane < lane_count; lane++)
+                {
+                    job.destination[i + lane] = {
+                        {results[0][lane], results[1][lane], results[2][lane]},
+                        {results[3][lane], results[4][lane], results[5][lane]},
+                    };
+                }
+            }
+        };
+
+        // Ranges produced by skin_meshes() are lane aligned; anything else falls back to scalar at the edges.
+        // A range ending at the vertex count runs into the padding instead of a scalar tail.
+        uint32_t vector_begin = (begin + SkinnedMesh::kLaneCount - 1) / SkinnedMesh::kLaneCount * SkinnedMesh::kLaneCount;
+        uint32_t vector_end = end == job.mesh->get_vertex_count() ? job.mesh->get_capacity() : end / SkinnedMesh::kLaneCount * SkinnedMesh::kLaneCount;
+        if (vector_begin >= vector_end)
+        {
+            skin_range_scalar(job, begin, end);
+            return;
+        }
+        skin_range_scalar(job, begin, vector_begin);
+        kernel(vector_begin, vector_end);
+        skin_range_scalar(job, std::min(vector_end, end), end);
+#else
+        skin_range_scalar(job, begin, end);
+#endif
+    }
+
+    bool is_skinning_avx2_available()
+    {
+        return cpu_supports_avx2();
+    }
+
+    SkinnedMesh make_skinned_tube(uint32_t ring_count, uint32_t ring_vertex_count, uint32_t bone_count, float length, float radius, std::vector<uint32_t>* indices)
+    {
+        ring_count = std::max(ring_count, 2u);
+        ring_vertex_count = std::max(ring_vertex_count, 3u);
+        bone_count = std::clamp(bone_count, 1u, SkinnedMesh::kMaxBones);
+        const float bone_length = length / static_cast<float>(bone_count);
+        SkinnedMesh mesh(ring_count * ring_vertex_count);
+        for (uint32_t ring = 0; ring < ring_count; ring++)
+        {
+            const float y = length * static_cast<float>(ring) / static_cast<float>(ring_count - 1);
+            // The four bones whose centres are nearest, weighted by a tent around each centre.
+            const int nearest = static_cast<int>(y / bone_length - 0.5f);
+            uint8_t bones[4];
+            float weights[4];
+            for (int k = 0; k < 4; k++)
+            {
+                const int bone = std::clamp(nearest - 1 + k, 0, static_cast<int>(bone_count) - 1);
+                const float centre = (static_cast<float>(bone) + 0.5f) * bone_length;
+                bones[k] = static_cast<uint8_t>(bone);
+                weights[k] = std::max(0.0f, 1.5f - std::fabs(y - centre) / bone_length);
+            }
+            for (uint32_t v = 0; v < ring_vertex_count; v++)
+            {
+                const float angle = 6.2831853f * static_cast<float>(v) / static_cast<float>(ring_vertex_count);
+                const float normal[3] = {std::cos(angle), 0.0f, std::sin(angle)};
+                const float position[3] = {normal[0] * radius, y, normal[2] * radius};
+                mesh.set_vertex(ring * ring_vertex_count + v, position, normal, bones, weights);
+            }
+        }
+
+        if (indices)
+        {
+            for (uint32_t ring = 0; ring + 1 < ring_count; ring++)
+            {
+                for (uint32_t v = 0; v < ring_vertex_count; v++)
+                {
+                    const uint32_t a = ring * ring_vertex_count + v;
+                    const uint32_t b = ring * ring_vertex_count + (v + 1) % ring_vertex_count;
+                    const uint32_t c = a + ring_vertex_count;
+                    const uint32_t d = b + ring_vertex_count;
+                    indices->insert(indices->end(), {a, c, b, b, c, d});
+                }
+            }
+        }
+        return mesh;
+    }
+
+    void animate_tube_palette(float time, float phase, uint32_t bone_count, float length, Float3x4* palette)
+    {
+        // Each bone bends around z relative to its parent. The skinning matrix moves a bind
+        // pose vertex into bone space (subtract the bone's rest height), rotates it by the
+        // accumulated angle and places it at the animated joint.
+        const float bone_length = length / static_cast<float>(bone_count);
+        float angle = 0.0f;
+        float joint_x = 0.0f;
+        float joint_y = 0.0f;
+        for (uint32_t bone = 0; bone < bone_count; bone++)
+        {
+            angle += 0.25f * std::sin(time * 2.0f + phase + static_cast<float>(bone) * 0.6f);
+            const float c = std::cos(angle);
+            const float s = std::sin(angle);
+            const float rest_y = static_cast<float>(bone) * bone_length;
+            palette[bone] = {{
+                {c, -s, 0.0f, joint_x + s * rest_y},
+                {s, c, 0.0f, joint_y - c * rest_y},
+                {0.0f, 0.0f, 1.0f, 0.0f},
+            }};
+            joint_x -= s * bone_length;
+            joint_y += c * bone_length;
+        }
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../scene/transform_hierarchy.h"
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    // Vertex layout the skinning kernels write, matching the SkinnedMesh input layout.
+    struct SkinnedVertex
+    {
+        float position[3];
+        float normal[3];
+    };
+
+    // Bind pose of a mesh skinned by up to four bones per vertex, stored as structure of
+    // arrays. Bone indices and weights are packed four per uint32, one byte each; weights
+    // are unorm8 and always sum to 255, so they decode to exactly 1. The capacity is
+    // rounded up to kLaneCount so the AVX2 kernel never needs a scalar tail.
+    class SkinnedMesh
+    {
+    public:
+        static constexpr uint32_t kLaneCount = 8;
+        static constexpr uint32_t kMaxBones = 256;
+
+        explicit SkinnedMesh(uint32_t vertex_count);
+
+        uint32_t get_vertex_count() const { return _vertex_count; }
+        uint32_t get_capacity() const { return _capacity; }
+
+        // Weights are normalized and quantized here.
+        void set_vertex(uint32_t index, const float position[3], const float normal[3], const uint8_t bones[4], const float weights[4]);
+
+        const float* get_position_x() const { return _position_x.data(); }
+        const float* get_position_y() const { return _position_y.data(); }
+        const float* get_position_z() const { return _position_z.data(); }
+        const float* get_normal_x() const { return _normal_x.data(); }
+        const float* get_normal_y() const { return _normal_y.data(); }
+        const float* get_normal_z() const { return _normal_z.data(); }
+        const uint32_t* get_bone_indices() const { return _bone_indices.data(); }
+        const uint32_t* get_bone_weights() const { return _bone_weights.data(); }
+
+    private:
+        uint32_t _vertex_count;
+        uint32_t _capacity;
+        std::vector<float> _position_x;
+        std::vector<float> _position_y;
+        std::vector<float> _position_z;
+        std::vector<float> _normal_x;
+        std::vector<float> _normal_y;
+        std::vector<float> _normal_z;
+        std::vector<uint32_t> _bone_indices;
+        std::vector<uint32_t> _bone_weights;
+    };
+
+    // One mesh to skin: `palette` holds a bind-to-pose matrix per bone, as the 3x4 rows a
+    // shader would read, and `destination` has room for the mesh's vertex count.
+    struct SkinningJob
+    {
+        const SkinnedMesh* mesh;
+        const Float3x4* palette;
+        SkinnedVertex* destination;
+    };
+
+    // Skins every job, splitting meshes into chunks spread across `pool` when one is given.
+    // Output is written once per vertex in order, so `destination` may be write-combined
+    // upload memory. The chunk list comes from `scratch`, such as a FrameArena, when given.
+    void skin_meshes(const SkinningJob* jobs, uint32_t job_count, TaskPool* pool = nullptr, bool allow_simd = true, std::pmr::memory_resource* scratch = nullptr);
+    void skin_range_scalar(const SkinningJob& job, uint32_t begin, uint32_t end);
+    void skin_range_avx2(const SkinningJob& job, uint32_t begin, uint32_t end);
+    bool is_skinning_avx2_available();
+
+    // A tube along +y of `ring_count` rings of `ring_vertex_count` vertices, skinned to a
+    // chain of `bone_count` bones; each vertex takes the four nearest bones. Appends the
+    // triangle list indices to `indices` when given.
+    SkinnedMesh make_skinned_tube(uint32_t ring_count, uint32_t ring_vertex_count, uint32_t bone_count, float length, float radius, std::vector<uint32_t>* indices = nullptr);
+    // Palette of a tube made by make_skinned_tube, curling the chain by a wave travelling
+    // along it at `time`.
+    void animate_tube_palette(float time, float phase, uint32_t bone_count, float length, Float3x4* palette);
+}  // namespace learn_d3d12
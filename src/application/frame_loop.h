@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../metrics/metrics_registry.h"
+#include "../profiling/startup_tracer.h"
+
+namespace learn_d3d12
+{
+    // One iteration of the main loop, shared by the application backends. It is a template
+    // so LearnD3d12Bench can drive it with a renderer that needs no device or window.
+    template<typename Renderer>
+    void run_frame(Renderer& renderer)
+    {
+        auto& metrics = MetricsRegistry::get_instance();
+        ScopedMetricTimer frame_timer(metrics.get_frame_time());
+        renderer.get_render_commands().execute_pending();
+        renderer.on_update();
+        renderer.on_render();
+        metrics.get_frame_count().add();
+        if (StartupTracer::get_instance().mark_first_frame())
+        {
+            StartupTracer::get_instance().log_report();
+        }
+    }
+}  // namespace learn_d3d12
@@ -1,6 +1,8 @@
 #include "glfw_application.h"
 #include "../logging/log_macros.h"
+#include "../profiling/startup_tracer.h"
 #include "../renderer/d3d12_renderer.h"
+#include "frame_loop.h"
 #define GLFW_INCLUDE_NONE
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3.h>
@@ -20,6 +22,8 @@ namespace learn_d3d12
 
     int GlfwApplication::exec(std::shared_ptr<D3d12Renderer> renderer)
     {
+        auto& startup_tracer = StartupTracer::get_instance();
+        uint32_t window_phase = startup_tracer.begin_phase("window_create");
         glfwSetErrorCallback(glfw_error_callback);
         // glfw: initialize and configure
         // ------------------------------
@@ -35,6 +39,7 @@ namespace learn_d3d12
             renderer->get_name(),
             nullptr,
             nullptr);
+        startup_tracer.end_phase(window_phase);
         if (!_window)
         {
             glfwTerminate();
@@ -44,13 +49,14 @@ namespace learn_d3d12
 
         glfwSetWindowUserPointer(_window, renderer.get());
 
+        uint32_t init_phase = startup_tracer.begin_phase("renderer_init");
         renderer->on_init(glfwGetWin32Window(_window));
+        startup_tracer.end_phase(init_phase);
 
         while (!glfwWindowShouldClose(_window))
         {
             glfwPollEvents();
-            renderer->on_update();
-            renderer->on_render();
+            run_frame(*renderer);
         }
 
         renderer->on_destroy();
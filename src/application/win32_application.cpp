@@ -1,5 +1,7 @@
 #include "win32_application.h"
+#include "../profiling/startup_tracer.h"
 #include "../renderer/d3d12_renderer.h"
+#include "frame_loop.h"
 #include <winuser.h>
 
 namespace learn_d3d12
@@ -18,8 +20,8 @@ namespace learn_d3d12
             case WM_PAINT:
                 if (renderer)
                 {
-                    renderer->on_update();
-                    renderer->on_render();
+                    // The window is never validated, so WM_PAINT arrives once per loop iteration.
+                    run_frame(*renderer);
                 }
                 return 0;
             case WM_DESTROY:
@@ -32,6 +34,8 @@ namespace learn_d3d12
 
     int Win32Application::exec(std::shared_ptr<D3d12Renderer> renderer)
     {
+        auto& startup_tracer = StartupTracer::get_instance();
+        uint32_t window_phase = startup_tracer.begin_phase("window_create");
         HINSTANCE instance = GetModuleHandle(nullptr);
         // Initialize the window class
         WNDCLASSEX window_class = {};
@@ -60,8 +64,11 @@ namespace learn_d3d12
             nullptr,  // We aren't using menuus.
             instance,
             renderer.get());
+        startup_tracer.end_phase(window_phase);
 
+        uint32_t init_phase = startup_tracer.begin_phase("renderer_init");
         renderer->on_init(_hwnd);
+        startup_tracer.end_phase(init_phase);
 
         ShowWindow(_hwnd, SW_SHOWDEFAULT);
 
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace learn_d3d12
+{
+    // Binary layout of the frame captures written by CaptureWriter and read by CaptureReader.
+    //
+    // A file is a CaptureFileHeader followed by chunks, each a CaptureChunkHeader and its
+    // payload. Chunks before the first kBeginFrame create the objects the frames use and
+    // are replayed once; every frame is the chunks between a kBeginFrame and its kEndFrame.
+    // Objects are named by ids unique within the file. D3D12 enums are stored with their
+    // D3D12 values, so captures can be written, parsed and checked without D3D12. Values
+    // are little endian and payloads are not aligned; read them with read_capture_payload.
+    constexpr uint32_t kCaptureMagic = 0x50434C44;  // "LDCP"
+    constexpr uint32_t kCaptureVersion = 1;
+    constexpr uint32_t kCaptureSemanticNameSize = 32;
+    // Only buffers in this heap (D3D12_HEAP_TYPE_UPLOAD) are mapped and receive uploads.
+    constexpr uint32_t kCaptureUploadHeapType = 2;
+
+    struct CaptureFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t frame_count;
+        uint32_t reserved;
+    };
+
+    enum class CaptureQueue : uint32_t
+    {
+        kDirect = 0,
+        kCompute = 1,
+        kCopy = 2,
+    };
+
+    constexpr uint32_t kCaptureQueueCount = 3;
+
+    enum class CaptureChunkType : uint32_t
+    {
+        kCreateRootSignature = 1,     // CaptureRootSignatureChunk, serialized root signature
+        kCreateGraphicsPipeline = 2,  // CaptureGraphicsPipelineChunk, input elements, VS, PS
+        kCreateComputePipeline = 3,   // CaptureComputePipelineChunk, CS
+        kCreateBuffer = 4,            // CaptureBufferChunk
+        kCreateRenderTarget = 5,      // CaptureRenderTargetChunk
+        kUploadBuffer = 6,            // CaptureUploadChunk, bytes written through a mapping
+        kCommandList = 7,             // CaptureCommandListChunk, commands
+        kQueueWait = 8,               // CaptureQueueWaitChunk
+        kBeginFrame = 9,              // CaptureFrameChunk
+        kEndFrame = 10,               // CaptureFrameChunk
+    };
+
+    struct CaptureChunkHeader
+    {
+        CaptureChunkType type;
+        uint32_t size;  // Payload bytes after this header.
+    };
+
+    struct CaptureRootSignatureChunk
+    {
+        uint32_t id;
+    };
+
+    struct CaptureInputElement
+    {
+        char semantic_name[kCaptureSemanticNameSize];
+        uint32_t semantic_index;
+        uint32_t format;
+        uint32_t input_slot;
+        uint32_t aligned_byte_offset;
+    };
+
+    // The subset of D3D12_GRAPHICS_PIPELINE_STATE_DESC the renderers change from the defaults.
+    struct CaptureGraphicsPipelineChunk
+    {
+        uint32_t id;
+        uint32_t root_signature_id;
+        uint32_t primitive_topology_type;
+        uint32_t render_target_format;
+        uint32_t cull_mode;
+        uint32_t blend_enable;
+        uint32_t src_blend;
+        uint32_t dest_blend;
+        uint32_t blend_op;
+        uint32_t input_element_count;
+        uint32_t vertex_shader_size;
+        uint32_t pixel_shader_size;
+    };
+
+    struct CaptureComputePipelineChunk
+    {
+        uint32_t id;
+        uint32_t root_signature_id;
+        uint32_t compute_shader_size;
+    };
+
+    struct CaptureBufferChunk
+    {
+        uint32_t id;
+        uint32_t heap_type;
+        uint32_t initial_state;
+        uint32_t flags;
+        uint64_t size;
+    };
+
+    // A swap chain buffer; replay creates an offscreen texture starting in the present state.
+    struct CaptureRenderTargetChunk
+    {
+        uint32_t id;
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+    };
+
+    struct CaptureUploadChunk
+    {
+        uint32_t buffer_id;
+        uint32_t reserved;
+        uint64_t offset;
+    };
+
+    struct CaptureCommandListChunk
+    {
+        CaptureQueue queue;
+    };
+
+    // `queue` waits on the GPU until `wait_queue` has finished the command list it was given
+    // `submissions_ago` submissions before its latest one. Counting back from the latest
+    // submission keeps waits valid when frames are replayed in a loop.
+    struct CaptureQueueWaitChunk
+    {
+        CaptureQueue queue;
+        CaptureQueue wait_queue;
+        uint64_t submissions_ago;
+    };
+
+    struct CaptureFrameChunk
+    {
+        uint32_t frame_index;
+        uint32_t reserved;
+        uint64_t time_ns;  // Since the capture was opened.
+    };
+
+    // Commands inside a kCommandList chunk: a CaptureCommandHeader, then its payload.
+    enum class CaptureCommandType : uint32_t
+    {
+        kSetPipelineState = 1,                  // CaptureObjectCommand
+        kSetGraphicsRootSignature = 2,          // CaptureObjectCommand
+        kSetComputeRootSignature = 3,           // CaptureObjectCommand
+        kSetGraphicsRoot32BitConstants = 4,     // CaptureRootConstantsCommand, values
+        kSetComputeRoot32BitConstants = 5,      // CaptureRootConstantsCommand, values
+        kSetGraphicsRootShaderResourceView = 6, // CaptureRootDescriptorCommand
+        kSetComputeRootUnorderedAccessView = 7, // CaptureRootDescriptorCommand
+        kSetViewport = 8,                       // CaptureViewportCommand
+        kSetScissorRect = 9,                    // CaptureScissorRectCommand
+        kResourceBarrier = 10,                  // CaptureBarrierCommand
+        kSetRenderTarget = 11,                  // CaptureObjectCommand
+        kClearRenderTarget = 12,                // CaptureClearCommand
+        kSetPrimitiveTopology = 13,             // CaptureObjectCommand holding the topology
+        kSetVertexBuffer = 14,                  // CaptureVertexBufferCommand
+        kDrawInstanced = 15,                    // CaptureDrawCommand
+        kDispatch = 16,                         // CaptureDispatchCommand
+        kCopyBufferRegion = 17,                 // CaptureCopyBufferCommand
+    };
+
+    struct CaptureCommandHeader
+    {
+        CaptureCommandType type;
+        uint32_t size;  // Payload bytes after this header.
+    };
+
+    struct CaptureObjectCommand
+    {
+        uint32_t id;
+    };
+
+    struct CaptureRootConstantsCommand
+    {
+        uint32_t root_parameter;
+        uint32_t dest_offset;
+        uint32_t count;
+    };
+
+    struct CaptureRootDescriptorCommand
+    {
+        uint32_t root_parameter;
+        uint32_t buffer_id;
+        uint64_t offset;
+    };
+
+    struct CaptureViewportCommand
+    {
+        float top_left_x;
+        float top_left_y;
+        float width;
+        float height;
+        float min_depth;
+        float max_depth;
+    };
+
+    struct CaptureScissorRectCommand
+    {
+        int32_t left;
+        int32_t top;
+        int32_t right;
+        int32_t bottom;
+    };
+
+    struct CaptureBarrierCommand
+    {
+        uint32_t resource_id;
+        uint32_t state_before;
+        uint32_t state_after;
+    };
+
+    struct CaptureClearCommand
+    {
+        uint32_t render_target_id;
+        float color[4];
+    };
+
+    struct CaptureVertexBufferCommand
+    {
+        uint32_t slot;
+        uint32_t buffer_id;
+        uint32_t size;
+        uint32_t stride;
+        uint64_t offset;
+    };
+
+    struct CaptureDrawCommand
+    {
+        uint32_t vertex_count_per_instance;
+        uint32_t instance_count;
+        uint32_t start_vertex_location;
+        uint32_t start_instance_location;
+    };
+
+    struct CaptureDispatchCommand
+    {
+        uint32_t thread_group_count_x;
+        uint32_t thread_group_count_y;
+        uint32_t thread_group_count_z;
+    };
+
+    struct CaptureCopyBufferCommand
+    {
+        uint32_t dest_buffer_id;
+        uint32_t source_buffer_id;
+        uint64_t dest_offset;
+        uint64_t source_offset;
+        uint64_t size;
+    };
+
+    // Payloads sit at arbitrary offsets in the file, so they are copied out rather than cast.
+    template<typename Payload>
+    Payload read_capture_payload(const void* payload)
+    {
+        Payload value;
+        std::memcpy(&value, payload, sizeof(Payload));
+        return value;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,403 @@
+#include "capture_reader.h"
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        // Payload size of every command type, 0 for unknown types. Root constants carry
+        // their values after the struct.
+        uint32_t get_command_payload_size(CaptureCommandType type)
+        {
+            switch (type)
+            {
+                case CaptureCommandType::kSetPipelineState:
+                case CaptureCommandType::kSetGraphicsRootSignature:
+                case CaptureCommandType::kSetComputeRootSignature:
+                case CaptureCommandType::kSetRenderTarget:
+                case CaptureCommandType::kSetPrimitiveTopology:
+                    return sizeof(CaptureObjectCommand);
+                case CaptureCommandType::kSetGraphicsRoot32BitConstants:
+                case CaptureCommandType::kSetComputeRoot32BitConstants:
+                    return sizeof(CaptureRootConstantsCommand);
+                case CaptureCommandType::kSetGraphicsRootShaderResourceView:
+                case CaptureCommandType::kSetComputeRootUnorderedAccessView:
+                    return sizeof(CaptureRootDescriptorCommand);
+                case CaptureCommandType::kSetViewport:
+                    return sizeof(CaptureViewportCommand);
+                case CaptureCommandType::kSetScissorRect:
+                    return sizeof(CaptureScissorRectCommand);
+                case CaptureCommandType::kResourceBarrier:
+                    return sizeof(CaptureBarrierCommand);
+                case CaptureCommandType::kClearRenderTarget:
+                    return sizeof(CaptureClearCommand);
+                case CaptureCommandType::kSetVertexBuffer:
+                    return sizeof(CaptureVertexBufferCommand);
+                case CaptureCommandType::kDrawInstanced:
+                    return sizeof(CaptureDrawCommand);
+                case CaptureCommandType::kDispatch:
+                    return sizeof(CaptureDispatchCommand);
+                case CaptureCommandType::kCopyBufferRegion:
+                    return sizeof(CaptureCopyBufferCommand);
+                default:
+                    return 0;
+            }
+        }
+
+        bool is_valid_queue(CaptureQueue queue)
+        {
+            return static_cast<uint32_t>(queue) < kCaptureQueueCount;
+        }
+    }  // namespace
+
+    bool CaptureReader::open(const std::string& path, std::string& error)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!parse(data.data(), data.size(), error))
+        {
+            error = path + ": " + error;
+            return false;
+        }
+        return true;
+    }
+
+    bool CaptureReader::parse(const void* data, size_t size, std::string& error)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        _data.assign(bytes, bytes + size);
+        _frames.clear();
+        _setup_end = 0;
+
+        if (_data.size() < sizeof(CaptureFileHeader))
+        {
+            error = "file is too small for a capture header";
+            return false;
+        }
+        _header = read_capture_payload<CaptureFileHeader>(_data.data());
+        if (_header.magic != kCaptureMagic)
+        {
+            error = "not a capture file";
+            return false;
+        }
+        if (_header.version != kCaptureVersion)
+        {
+            error = "unsupported capture version " + std::to_string(_header.version);
+            return false;
+        }
+
+        // Walk every chunk once so that replay can trust sizes without checks.
+        // Chunks between two frames are replayed with the later one.
+        size_t offset = sizeof(CaptureFileHeader);
+        size_t frame_begin = 0;
+        bool in_frame = false;
+        bool frame_seen = false;
+        // Sizes of the upload heap buffers, so that uploads can be replayed with a plain copy.
+        std::unordered_map<uint32_t, uint64_t> upload_buffer_sizes;
+        uint64_t begin_ns = 0;
+        while (offset < _data.size())
+        {
+            auto location = [offset]() { return "chunk at offset " + std::to_string(offset) + ": "; };
+            if (_data.size() - offset < sizeof(CaptureChunkHeader))
+            {
+                error = location() + "truncated chunk header";
+                return false;
+            }
+            auto chunk = read_capture_payload<CaptureChunkHeader>(_data.data() + offset);
+            const size_t payload_offset = offset + sizeof(CaptureChunkHeader);
+            if (_data.size() - payload_offset < chunk.size)
+            {
+                error = location() + "truncated payload";
+                return false;
+            }
+            const uint8_t* payload = _data.data() + payload_offset;
+            if (!_validate_chunk(chunk, payload, error))
+            {
+                error = location() + error;
+                return false;
+            }
+
+            if (chunk.type == CaptureChunkType::kCreateBuffer)
+            {
+                auto desc = read_capture_payload<CaptureBufferChunk>(payload);
+                if (desc.heap_type == kCaptureUploadHeapType)
+                {
+                    upload_buffer_sizes[desc.id] = desc.size;
+                }
+            }
+            if (chunk.type == CaptureChunkType::kUploadBuffer)
+            {
+                auto upload = read_capture_payload<CaptureUploadChunk>(payload);
+                const uint64_t size = chunk.size - sizeof(CaptureUploadChunk);
+                auto buffer = upload_buffer_sizes.find(upload.buffer_id);
+                if (buffer == upload_buffer_sizes.end())
+                {
+                    error = location() + "upload into buffer " + std::to_string(upload.buffer_id) + ", which is not an upload heap buffer";
+                    return false;
+                }
+                if (upload.offset > buffer->second || size > buffer->second - upload.offset)
+                {
+                    error = location() + "upload outside buffer " + std::to_string(upload.buffer_id);
+                    return false;
+                }
+            }
+
+            const bool is_create = chunk.type <= CaptureChunkType::kCreateRenderTarget;
+            if (is_create && (in_frame || !_frames.empty()))
+            {
+                error = location() + "objects must be created before the first frame";
+                return false;
+            }
+            if (chunk.type == CaptureChunkType::kBeginFrame)
+            {
+                if (in_frame)
+                {
+                    error = location() + "frame begins inside another frame";
+                    return false;
+                }
+                if (!frame_seen)
+                {
+                    _setup_end = offset;
+                    frame_begin = offset;
+                }
+                frame_seen = true;
+                in_frame = true;
+                begin_ns = read_capture_payload<CaptureFrameChunk>(payload).time_ns;
+            }
+            offset = payload_offset + chunk.size;
+            if (chunk.type == CaptureChunkType::kEndFrame)
+            {
+                if (!in_frame)
+                {
+                    error = location() + "frame ends without beginning";
+                    return false;
+                }
+                in_frame = false;
+                _frames.push_back({frame_begin, offset, begin_ns, read_capture_payload<CaptureFrameChunk>(payload).time_ns});
+                frame_begin = offset;
+            }
+        }
+        if (!frame_seen)
+        {
+            // A capture without frames still has setup work worth replaying. When a frame
+            // began but never ended, setup stops where that frame begins.
+            _setup_end = offset;
+        }
+        // A capture whose writer was not closed has a zero count; trailing chunks of an
+        // unfinished frame are ignored.
+        if (_header.frame_count != 0 && _header.frame_count != _frames.size())
+        {
+            error = "header announces " + std::to_string(_header.frame_count) + " frames but " + std::to_string(_frames.size()) + " were found";
+            return false;
+        }
+        return true;
+    }
+
+    void CaptureReader::replay_setup(ReplayDevice& device) const
+    {
+        _replay_range(sizeof(CaptureFileHeader), _setup_end, device);
+    }
+
+    void CaptureReader::replay_frame(uint32_t frame_index, ReplayDevice& device) const
+    {
+        _replay_range(_frames[frame_index].begin, _frames[frame_index].end, device);
+    }
+
+    bool CaptureReader::_validate_chunk(const CaptureChunkHeader& chunk, const uint8_t* payload, std::string& error) const
+    {
+        auto expect_size = [&](uint64_t expected) {
+            if (chunk.size != expected)
+            {
+                error = "payload of " + std::to_string(chunk.size) + " bytes, expected " + std::to_string(expected);
+                return false;
+            }
+            return true;
+        };
+        auto expect_at_least = [&](uint64_t expected) {
+            if (chunk.size < expected)
+            {
+                error = "payload of " + std::to_string(chunk.size) + " bytes, expected at least " + std::to_string(expected);
+                return false;
+            }
+            return true;
+        };
+
+        switch (chunk.type)
+        {
+            case CaptureChunkType::kCreateRootSignature:
+                return expect_at_least(sizeof(CaptureRootSignatureChunk));
+            case CaptureChunkType::kCreateGraphicsPipeline: {
+                if (!expect_at_least(sizeof(CaptureGraphicsPipelineChunk)))
+                {
+                    return false;
+                }
+                auto desc = read_capture_payload<CaptureGraphicsPipelineChunk>(payload);
+                return expect_size(sizeof(desc) + uint64_t(sizeof(CaptureInputElement)) * desc.input_element_count + desc.vertex_shader_size + desc.pixel_shader_size);
+            }
+            case CaptureChunkType::kCreateComputePipeline: {
+                if (!expect_at_least(sizeof(CaptureComputePipelineChunk)))
+                {
+                    return false;
+                }
+                auto desc = read_capture_payload<CaptureComputePipelineChunk>(payload);
+                return expect_size(sizeof(desc) + uint64_t(desc.compute_shader_size));
+            }
+            case CaptureChunkType::kCreateBuffer:
+                return expect_size(sizeof(CaptureBufferChunk));
+            case CaptureChunkType::kCreateRenderTarget:
+                return expect_size(sizeof(CaptureRenderTargetChunk));
+            case CaptureChunkType::kUploadBuffer:
+                return expect_at_least(sizeof(CaptureUploadChunk));
+            case CaptureChunkType::kCommandList: {
+                if (!expect_at_least(sizeof(CaptureCommandListChunk)))
+                {
+                    return false;
+                }
+                if (!is_valid_queue(read_capture_payload<CaptureCommandListChunk>(payload).queue))
+                {
+                    error = "unknown queue";
+                    return false;
+                }
+                return _validate_commands(payload + sizeof(CaptureCommandListChunk), chunk.size - sizeof(CaptureCommandListChunk), error);
+            }
+            case CaptureChunkType::kQueueWait: {
+                if (!expect_size(sizeof(CaptureQueueWaitChunk)))
+                {
+                    return false;
+                }
+                auto wait = read_capture_payload<CaptureQueueWaitChunk>(payload);
+                if (!is_valid_queue(wait.queue) || !is_valid_queue(wait.wait_queue))
+                {
+                    error = "unknown queue";
+                    return false;
+                }
+                return true;
+            }
+            case CaptureChunkType::kBeginFrame:
+            case CaptureChunkType::kEndFrame:
+                return expect_size(sizeof(CaptureFrameChunk));
+            default:
+                error = "unknown chunk type " + std::to_string(static_cast<uint32_t>(chunk.type));
+                return false;
+        }
+    }
+
+    bool CaptureReader::_validate_commands(const uint8_t* commands, size_t size, std::string& error) const
+    {
+        size_t offset = 0;
+        while (offset < size)
+        {
+            if (size - offset < sizeof(CaptureCommandHeader))
+            {
+                error = "truncated command header";
+                return false;
+            }
+            auto command = read_capture_payload<CaptureCommandHeader>(commands + offset);
+            offset += sizeof(CaptureCommandHeader);
+            uint64_t expected = get_command_payload_size(command.type);
+            if (expected == 0)
+            {
+                error = "unknown command type " + std::to_string(static_cast<uint32_t>(command.type));
+                return false;
+            }
+            if (size - offset < command.size || command.size < expected)
+            {
+                error = "truncated command";
+                return false;
+            }
+            if (command.type == CaptureCommandType::kSetGraphicsRoot32BitConstants || command.type == CaptureCommandType::kSetComputeRoot32BitConstants)
+            {
+                expected += sizeof(uint32_t) * uint64_t(read_capture_payload<CaptureRootConstantsCommand>(commands + offset).count);
+            }
+            if (command.size != expected)
+            {
+                error = "command of " + std::to_string(command.size) + " bytes, expected " + std::to_string(expected);
+                return false;
+            }
+            offset += command.size;
+        }
+        return true;
+    }
+
+    void CaptureReader::_replay_range(size_t begin, size_t end, ReplayDevice& device) const
+    {
+        size_t offset = begin;
+        while (offset < end)
+        {
+            auto chunk = read_capture_payload<CaptureChunkHeader>(_data.data() + offset);
+            const uint8_t* payload = _data.data() + offset + sizeof(CaptureChunkHeader);
+            offset += sizeof(CaptureChunkHeader) + chunk.size;
+            switch (chunk.type)
+            {
+                case CaptureChunkType::kCreateRootSignature: {
+                    auto desc = read_capture_payload<CaptureRootSignatureChunk>(payload);
+                    device.create_root_signature(desc.id, payload + sizeof(desc), chunk.size - static_cast<uint32_t>(sizeof(desc)));
+                    break;
+                }
+                case CaptureChunkType::kCreateGraphicsPipeline: {
+                    CaptureGraphicsPipeline pipeline;
+                    pipeline.desc = read_capture_payload<CaptureGraphicsPipelineChunk>(payload);
+                    const uint8_t* cursor = payload + sizeof(CaptureGraphicsPipelineChunk);
+                    pipeline.input_elements.resize(pipeline.desc.input_element_count);
+                    for (auto& element : pipeline.input_elements)
+                    {
+                        element = read_capture_payload<CaptureInputElement>(cursor);
+                        element.semantic_name[kCaptureSemanticNameSize - 1] = '\0';
+                        cursor += sizeof(CaptureInputElement);
+                    }
+                    pipeline.vertex_shader = cursor;
+                    pipeline.pixel_shader = cursor + pipeline.desc.vertex_shader_size;
+                    device.create_graphics_pipeline(pipeline);
+                    break;
+                }
+                case CaptureChunkType::kCreateComputePipeline: {
+                    auto desc = read_capture_payload<CaptureComputePipelineChunk>(payload);
+                    device.create_compute_pipeline(desc, payload + sizeof(desc));
+                    break;
+                }
+                case CaptureChunkType::kCreateBuffer:
+                    device.create_buffer(read_capture_payload<CaptureBufferChunk>(payload));
+                    break;
+                case CaptureChunkType::kCreateRenderTarget:
+                    device.create_render_target(read_capture_payload<CaptureRenderTargetChunk>(payload));
+                    break;
+                case CaptureChunkType::kUploadBuffer: {
+                    auto upload = read_capture_payload<CaptureUploadChunk>(payload);
+                    device.upload_buffer(upload, payload + sizeof(upload), chunk.size - sizeof(upload));
+                    break;
+                }
+                case CaptureChunkType::kCommandList: {
+                    device.begin_command_list(read_capture_payload<CaptureCommandListChunk>(payload).queue);
+                    const uint8_t* commands = payload + sizeof(CaptureCommandListChunk);
+                    const size_t commands_size = chunk.size - sizeof(CaptureCommandListChunk);
+                    size_t command_offset = 0;
+                    while (command_offset < commands_size)
+                    {
+                        auto command = read_capture_payload<CaptureCommandHeader>(commands + command_offset);
+                        command_offset += sizeof(CaptureCommandHeader);
+                        device.record_command(command.type, commands + command_offset, command.size);
+                        command_offset += command.size;
+                    }
+                    device.end_command_list();
+                    break;
+                }
+                case CaptureChunkType::kQueueWait:
+                    device.wait_for_queue(read_capture_payload<CaptureQueueWaitChunk>(payload));
+                    break;
+                case CaptureChunkType::kBeginFrame:
+                    device.begin_frame(read_capture_payload<CaptureFrameChunk>(payload).frame_index);
+                    break;
+                case CaptureChunkType::kEndFrame:
+                    device.end_frame(read_capture_payload<CaptureFrameChunk>(payload).frame_index);
+                    break;
+            }
+        }
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "capture_format.h"
+#include <string>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // A graphics pipeline chunk with its arrays located inside the capture.
+    struct CaptureGraphicsPipeline
+    {
+        CaptureGraphicsPipelineChunk desc;
+        std::vector<CaptureInputElement> input_elements;
+        const void* vertex_shader;
+        const void* pixel_shader;
+    };
+
+    // Receives what a capture replays. CaptureReader has validated every chunk and command
+    // size before calling in, so payloads are at least as large as their structs, and every
+    // upload lies inside an upload heap buffer created earlier.
+    class ReplayDevice
+    {
+    public:
+        virtual ~ReplayDevice() = default;
+
+        virtual void create_root_signature(uint32_t id, const void* serialized, uint32_t size) = 0;
+        virtual void create_graphics_pipeline(const CaptureGraphicsPipeline& pipeline) = 0;
+        virtual void create_compute_pipeline(const CaptureComputePipelineChunk& desc, const void* compute_shader) = 0;
+        virtual void create_buffer(const CaptureBufferChunk& desc) = 0;
+        virtual void create_render_target(const CaptureRenderTargetChunk& desc) = 0;
+        virtual void upload_buffer(const CaptureUploadChunk& upload, const void* data, uint64_t size) = 0;
+        virtual void begin_command_list(CaptureQueue queue) = 0;
+        // `payload` is unaligned; read it with read_capture_payload.
+        virtual void record_command(CaptureCommandType type, const void* payload, uint32_t size) = 0;
+        // Submits the command list begun last.
+        virtual void end_command_list() = 0;
+        virtual void wait_for_queue(const CaptureQueueWaitChunk& wait) = 0;
+        virtual void begin_frame(uint32_t frame_index) = 0;
+        virtual void end_frame(uint32_t frame_index) = 0;
+    };
+
+    // Loads a capture, checks that it is well formed and feeds its setup and frames to a
+    // ReplayDevice.
+    class CaptureReader
+    {
+    public:
+        bool open(const std::string& path, std::string& error);
+        // Parses a capture already in memory; `data` is copied.
+        bool parse(const void* data, size_t size, std::string& error);
+
+        const CaptureFileHeader& get_header() const { return _header; }
+        uint32_t get_frame_count() const { return static_cast<uint32_t>(_frames.size()); }
+        // Recorded time from the start of the first frame to the start of `frame_index`,
+        // and the recorded CPU time between its begin and end markers.
+        uint64_t get_frame_start_ns(uint32_t frame_index) const { return _frames[frame_index].begin_ns - _frames[0].begin_ns; }
+        uint64_t get_frame_duration_ns(uint32_t frame_index) const { return _frames[frame_index].end_ns - _frames[frame_index].begin_ns; }
+
+        // Creates the objects and runs the work recorded before the first frame.
+        void replay_setup(ReplayDevice& device) const;
+        void replay_frame(uint32_t frame_index, ReplayDevice& device) const;
+
+    private:
+        struct FrameRange
+        {
+            size_t begin;  // Offset of the kBeginFrame chunk.
+            size_t end;    // Offset just past the kEndFrame chunk.
+            uint64_t begin_ns;
+            uint64_t end_ns;
+        };
+
+        std::vector<uint8_t> _data;
+        CaptureFileHeader _header = {};
+        size_t _setup_end = 0;
+        std::vector<FrameRange> _frames;
+
+        bool _validate_chunk(const CaptureChunkHeader& chunk, const uint8_t* payload, std::string& error) const;
+        bool _validate_commands(const uint8_t* commands, size_t size, std::string& error) const;
+        void _replay_range(size_t begin, size_t end, ReplayDevice& device) const;
+    };
+}  // namespace learn_d3d12
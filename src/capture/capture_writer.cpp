@@ -0,0 +1,164 @@
+#include "capture_writer.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+namespace learn_d3d12
+{
+    CaptureWriter::~CaptureWriter()
+    {
+        if (is_open())
+        {
+            std::string error;
+            close(error);
+        }
+    }
+
+    bool CaptureWriter::open(const std::string& path, uint32_t width, uint32_t height, std::string& error)
+    {
+        _file.open(path, std::ios::binary | std::ios::trunc);
+        if (!_file.is_open())
+        {
+            error = "cannot open " + path + " for writing";
+            return false;
+        }
+        _path = path;
+        _start_time = std::chrono::steady_clock::now();
+        _next_id = 1;
+        _frame_count = 0;
+        std::fill(std::begin(_submission_counts), std::end(_submission_counts), 0);
+
+        CaptureFileHeader header = {kCaptureMagic, kCaptureVersion, width, height, 0, 0};
+        _write(&header, sizeof(header));
+        return true;
+    }
+
+    bool CaptureWriter::close(std::string& error)
+    {
+        if (!is_open())
+        {
+            error = "capture is not open";
+            return false;
+        }
+        _file.seekp(offsetof(CaptureFileHeader, frame_count));
+        _write(&_frame_count, sizeof(_frame_count));
+        bool succeeded = _file.good();
+        _file.close();
+        if (!succeeded || _file.fail())
+        {
+            error = "failed to write " + _path;
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t CaptureWriter::create_root_signature(const void* serialized, uint32_t size)
+    {
+        CaptureRootSignatureChunk chunk = {_next_id++};
+        _write_chunk_header(CaptureChunkType::kCreateRootSignature, sizeof(chunk) + size);
+        _write(&chunk, sizeof(chunk));
+        _write(serialized, size);
+        return chunk.id;
+    }
+
+    uint32_t CaptureWriter::create_graphics_pipeline(CaptureGraphicsPipelineChunk desc, const CaptureInputElement* input_elements, const void* vertex_shader, const void* pixel_shader)
+    {
+        desc.id = _next_id++;
+        const uint64_t input_layout_size = sizeof(CaptureInputElement) * desc.input_element_count;
+        _write_chunk_header(CaptureChunkType::kCreateGraphicsPipeline, sizeof(desc) + input_layout_size + desc.vertex_shader_size + desc.pixel_shader_size);
+        _write(&desc, sizeof(desc));
+        _write(input_elements, input_layout_size);
+        _write(vertex_shader, desc.vertex_shader_size);
+        _write(pixel_shader, desc.pixel_shader_size);
+        return desc.id;
+    }
+
+    uint32_t CaptureWriter::create_compute_pipeline(uint32_t root_signature_id, const void* compute_shader, uint32_t compute_shader_size)
+    {
+        CaptureComputePipelineChunk chunk = {_next_id++, root_signature_id, compute_shader_size};
+        _write_chunk_header(CaptureChunkType::kCreateComputePipeline, sizeof(chunk) + compute_shader_size);
+        _write(&chunk, sizeof(chunk));
+        _write(compute_shader, compute_shader_size);
+        return chunk.id;
+    }
+
+    uint32_t CaptureWriter::create_buffer(uint32_t heap_type, uint32_t initial_state, uint32_t flags, uint64_t size)
+    {
+        CaptureBufferChunk chunk = {_next_id++, heap_type, initial_state, flags, size};
+        _write_chunk_header(CaptureChunkType::kCreateBuffer, sizeof(chunk));
+        _write(&chunk, sizeof(chunk));
+        return chunk.id;
+    }
+
+    uint32_t CaptureWriter::create_render_target(uint32_t width, uint32_t height, uint32_t format)
+    {
+        CaptureRenderTargetChunk chunk = {_next_id++, width, height, format};
+        _write_chunk_header(CaptureChunkType::kCreateRenderTarget, sizeof(chunk));
+        _write(&chunk, sizeof(chunk));
+        return chunk.id;
+    }
+
+    void CaptureWriter::upload_buffer(uint32_t buffer_id, uint64_t offset, const void* data, uint64_t size)
+    {
+        CaptureUploadChunk chunk = {buffer_id, 0, offset};
+        _write_chunk_header(CaptureChunkType::kUploadBuffer, sizeof(chunk) + size);
+        _write(&chunk, sizeof(chunk));
+        _write(data, size);
+    }
+
+    uint64_t CaptureWriter::write_command_list(CaptureQueue queue, const CaptureCommandStream& commands)
+    {
+        CaptureCommandListChunk chunk = {queue};
+        _write_chunk_header(CaptureChunkType::kCommandList, sizeof(chunk) + commands.get_size());
+        _write(&chunk, sizeof(chunk));
+        _write(commands.get_data(), commands.get_size());
+        return ++_submission_counts[static_cast<uint32_t>(queue)];
+    }
+
+    void CaptureWriter::write_queue_wait(CaptureQueue queue, CaptureQueue wait_queue, uint64_t submission)
+    {
+        CaptureQueueWaitChunk chunk = {queue, wait_queue, _submission_counts[static_cast<uint32_t>(wait_queue)] - submission};
+        _write_chunk_header(CaptureChunkType::kQueueWait, sizeof(chunk));
+        _write(&chunk, sizeof(chunk));
+    }
+
+    void CaptureWriter::begin_frame()
+    {
+        CaptureFrameChunk chunk = {_frame_count, 0, _get_time_ns()};
+        _write_chunk_header(CaptureChunkType::kBeginFrame, sizeof(chunk));
+        _write(&chunk, sizeof(chunk));
+    }
+
+    void CaptureWriter::end_frame()
+    {
+        CaptureFrameChunk chunk = {_frame_count, 0, _get_time_ns()};
+        _write_chunk_header(CaptureChunkType::kEndFrame, sizeof(chunk));
+        _write(&chunk, sizeof(chunk));
+        _frame_count++;
+    }
+
+    uint64_t CaptureWriter::_get_time_ns() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start_time).count());
+    }
+
+    void CaptureWriter::_write_chunk_header(CaptureChunkType type, uint64_t payload_size)
+    {
+        if (payload_size > UINT32_MAX)
+        {
+            // Chunk sizes are 32-bit; fail the capture instead of writing a corrupt file.
+            _file.setstate(std::ios::badbit);
+            return;
+        }
+        CaptureChunkHeader header = {type, static_cast<uint32_t>(payload_size)};
+        _write(&header, sizeof(header));
+    }
+
+    void CaptureWriter::_write(const void* data, uint64_t size)
+    {
+        if (size != 0)
+        {
+            _file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        }
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "capture_format.h"
+#include <chrono>
+#include <fstream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // Commands of one command list, encoded as CaptureCommandHeader plus payload. The
+    // encoding lives no longer than its frame, so it may allocate from a FrameArena.
+    class CaptureCommandStream
+    {
+    public:
+        explicit CaptureCommandStream(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : _data(resource)
+        {
+        }
+
+        template<typename Payload>
+        void add(CaptureCommandType type, const Payload& payload, const void* extra = nullptr, uint32_t extra_size = 0)
+        {
+            CaptureCommandHeader header = {type, static_cast<uint32_t>(sizeof(Payload)) + extra_size};
+            _append(&header, sizeof(header));
+            _append(&payload, sizeof(Payload));
+            _append(extra, extra_size);
+        }
+
+        const uint8_t* get_data() const { return _data.data(); }
+        uint32_t get_size() const { return static_cast<uint32_t>(_data.size()); }
+        bool is_empty() const { return _data.empty(); }
+        void clear() { _data.clear(); }
+
+    private:
+        std::pmr::vector<uint8_t> _data;
+
+        void _append(const void* data, size_t size)
+        {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            _data.insert(_data.end(), bytes, bytes + size);
+        }
+    };
+
+    // Writes a capture file chunk by chunk. The create_* functions return the id that
+    // later chunks and commands use to refer to the object. Writing does not throw; the
+    // first I/O error is kept and reported by close().
+    class CaptureWriter
+    {
+    public:
+        ~CaptureWriter();
+
+        bool open(const std::string& path, uint32_t width, uint32_t height, std::string& error);
+        bool is_open() const { return _file.is_open(); }
+        // Patches the frame count into the header. Returns false with `error` set when any
+        // write failed.
+        bool close(std::string& error);
+
+        uint32_t create_root_signature(const void* serialized, uint32_t size);
+        // `desc.id` is assigned here; the sizes in `desc` describe the arrays that follow.
+        uint32_t create_graphics_pipeline(CaptureGraphicsPipelineChunk desc, const CaptureInputElement* input_elements, const void* vertex_shader, const void* pixel_shader);
+        uint32_t create_compute_pipeline(uint32_t root_signature_id, const void* compute_shader, uint32_t compute_shader_size);
+        uint32_t create_buffer(uint32_t heap_type, uint32_t initial_state, uint32_t flags, uint64_t size);
+        uint32_t create_render_target(uint32_t width, uint32_t height, uint32_t format);
+        void upload_buffer(uint32_t buffer_id, uint64_t offset, const void* data, uint64_t size);
+        // Returns the submission number on `queue`, starting at 1, for write_queue_wait.
+        uint64_t write_command_list(CaptureQueue queue, const CaptureCommandStream& commands);
+        // Makes `queue` wait for a submission returned by write_command_list on `wait_queue`.
+        void write_queue_wait(CaptureQueue queue, CaptureQueue wait_queue, uint64_t submission);
+        void begin_frame();
+        void end_frame();
+
+        uint32_t get_frame_count() const { return _frame_count; }
+        uint64_t get_submission_count(CaptureQueue queue) const { return _submission_counts[static_cast<uint32_t>(queue)]; }
+
+    private:
+        std::ofstream _file;
+        std::string _path;
+        std::chrono::steady_clock::time_point _start_time;
+        uint32_t _next_id = 1;
+        uint32_t _frame_count = 0;
+        uint64_t _submission_counts[kCaptureQueueCount] = {};
+
+        uint64_t _get_time_ns() const;
+        void _write_chunk_header(CaptureChunkType type, uint64_t payload_size);
+        void _write(const void* data, uint64_t size);
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,317 @@
+#include "d3d12_frame_capture.h"
+#include <algorithm>
+#include <directx/d3dx12.h>
+#include <vector>
+
+namespace learn_d3d12
+{
+    bool D3d12FrameCapture::open(const std::string& path, uint32_t width, uint32_t height, uint32_t frame_count, std::string& error)
+    {
+        if (!_writer.open(path, width, height, error))
+        {
+            return false;
+        }
+        _ids.clear();
+        _remaining_frames = std::max(frame_count, 1u);
+        _in_frame = false;
+        return true;
+    }
+
+    void D3d12FrameCapture::register_root_signature(ID3D12RootSignature* root_signature, ID3DBlob* serialized)
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        _ids[root_signature] = _writer.create_root_signature(serialized->GetBufferPointer(), static_cast<uint32_t>(serialized->GetBufferSize()));
+    }
+
+    void D3d12FrameCapture::register_graphics_pipeline(ID3D12PipelineState* pipeline_state, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        const D3D12_RENDER_TARGET_BLEND_DESC& blend = desc.BlendState.RenderTarget[0];
+        CaptureGraphicsPipelineChunk chunk = {};
+        chunk.root_signature_id = get_id(desc.pRootSignature);
+        chunk.primitive_topology_type = desc.PrimitiveTopologyType;
+        chunk.render_target_format = desc.RTVFormats[0];
+        chunk.cull_mode = desc.RasterizerState.CullMode;
+        chunk.blend_enable = blend.BlendEnable;
+        chunk.src_blend = blend.SrcBlend;
+        chunk.dest_blend = blend.DestBlend;
+        chunk.blend_op = blend.BlendOp;
+        chunk.input_element_count = desc.InputLayout.NumElements;
+        chunk.vertex_shader_size = static_cast<uint32_t>(desc.VS.BytecodeLength);
+        chunk.pixel_shader_size = static_cast<uint32_t>(desc.PS.BytecodeLength);
+
+        std::vector<CaptureInputElement> input_elements(desc.InputLayout.NumElements);
+        for (uint32_t i = 0; i < desc.InputLayout.NumElements; i++)
+        {
+            const D3D12_INPUT_ELEMENT_DESC& source = desc.InputLayout.pInputElementDescs[i];
+            CaptureInputElement& element = input_elements[i];
+            element = {};
+            strncpy_s(element.semantic_name, source.SemanticName, _TRUNCATE);
+            element.semantic_index = source.SemanticIndex;
+            element.format = source.Format;
+            element.input_slot = source.InputSlot;
+            element.aligned_byte_offset = source.AlignedByteOffset;
+        }
+        _ids[pipeline_state] = _writer.create_graphics_pipeline(chunk, input_elements.data(), desc.VS.pShaderBytecode, desc.PS.pShaderBytecode);
+    }
+
+    void D3d12FrameCapture::register_compute_pipeline(ID3D12PipelineState* pipeline_state, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        _ids[pipeline_state] = _writer.create_compute_pipeline(get_id(desc.pRootSignature), desc.CS.pShaderBytecode, static_cast<uint32_t>(desc.CS.BytecodeLength));
+    }
+
+    void D3d12FrameCapture::register_buffer(ID3D12Resource* buffer, D3D12_HEAP_TYPE heap_type, D3D12_RESOURCE_STATES initial_state)
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        D3D12_RESOURCE_DESC desc = buffer->GetDesc();
+        _ids[buffer] = _writer.create_buffer(heap_type, initial_state, desc.Flags, desc.Width);
+    }
+
+    void D3d12FrameCapture::register_render_target(ID3D12Resource* render_target)
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        D3D12_RESOURCE_DESC desc = render_target->GetDesc();
+        _ids[render_target] = _writer.create_render_target(static_cast<uint32_t>(desc.Width), desc.Height, desc.Format);
+    }
+
+    void D3d12FrameCapture::record_upload(ID3D12Resource* buffer, uint64_t offset, const void* data, uint64_t size)
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        _writer.upload_buffer(get_id(buffer), offset, data, size);
+    }
+
+    uint64_t D3d12FrameCapture::record_submission(QueueType queue, const CaptureCommandStream& commands)
+    {
+        if (!is_recording())
+        {
+            return 0;
+        }
+        return _writer.write_command_list(static_cast<CaptureQueue>(queue), commands);
+    }
+
+    void D3d12FrameCapture::record_queue_wait(QueueType queue, QueueType wait_queue, uint64_t submission)
+    {
+        if (!is_recording() || submission == 0)
+        {
+            return;
+        }
+        _writer.write_queue_wait(static_cast<CaptureQueue>(queue), static_cast<CaptureQueue>(wait_queue), submission);
+    }
+
+    void D3d12FrameCapture::begin_frame()
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        _writer.begin_frame();
+        _in_frame = true;
+    }
+
+    bool D3d12FrameCapture::end_frame(std::string& error)
+    {
+        if (!is_recording() || !_in_frame)
+        {
+            return true;
+        }
+        _writer.end_frame();
+        _in_frame = false;
+        if (--_remaining_frames == 0)
+        {
+            _ids.clear();
+            return _writer.close(error);
+        }
+        return true;
+    }
+
+    uint32_t D3d12FrameCapture::get_id(const void* object) const
+    {
+        auto it = _ids.find(object);
+        return it != _ids.end() ? it->second : 0;
+    }
+
+    CapturedCommandList::CapturedCommandList(ID3D12GraphicsCommandList* command_list, D3d12FrameCapture& capture, ID3D12PipelineState* initial_state, std::pmr::memory_resource* scratch)
+        : _command_list(command_list)
+        , _capture(capture)
+        , _commands(scratch ? scratch : std::pmr::get_default_resource())
+        , _recording(capture.is_recording())
+    {
+        if (_recording && initial_state)
+        {
+            _commands.add(CaptureCommandType::kSetPipelineState, CaptureObjectCommand {_capture.get_id(initial_state)});
+        }
+    }
+
+    void CapturedCommandList::set_pipeline_state(ID3D12PipelineState* pipeline_state)
+    {
+        _command_list->SetPipelineState(pipeline_state);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetPipelineState, CaptureObjectCommand {_capture.get_id(pipeline_state)});
+        }
+    }
+
+    void CapturedCommandList::set_graphics_root_signature(ID3D12RootSignature* root_signature)
+    {
+        _command_list->SetGraphicsRootSignature(root_signature);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetGraphicsRootSignature, CaptureObjectCommand {_capture.get_id(root_signature)});
+        }
+    }
+
+    void CapturedCommandList::set_compute_root_signature(ID3D12RootSignature* root_signature)
+    {
+        _command_list->SetComputeRootSignature(root_signature);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetComputeRootSignature, CaptureObjectCommand {_capture.get_id(root_signature)});
+        }
+    }
+
+    void CapturedCommandList::set_graphics_root_32bit_constants(uint32_t root_parameter, uint32_t count, const void* data, uint32_t dest_offset)
+    {
+        _command_list->SetGraphicsRoot32BitConstants(root_parameter, count, data, dest_offset);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetGraphicsRoot32BitConstants, CaptureRootConstantsCommand {root_parameter, dest_offset, count}, data, count * static_cast<uint32_t>(sizeof(uint32_t)));
+        }
+    }
+
+    void CapturedCommandList::set_compute_root_32bit_constants(uint32_t root_parameter, uint32_t count, const void* data, uint32_t dest_offset)
+    {
+        _command_list->SetComputeRoot32BitConstants(root_parameter, count, data, dest_offset);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetComputeRoot32BitConstants, CaptureRootConstantsCommand {root_parameter, dest_offset, count}, data, count * static_cast<uint32_t>(sizeof(uint32_t)));
+        }
+    }
+
+    void CapturedCommandList::set_graphics_root_shader_resource_view(uint32_t root_parameter, ID3D12Resource* buffer, uint64_t offset)
+    {
+        _command_list->SetGraphicsRootShaderResourceView(root_parameter, buffer->GetGPUVirtualAddress() + offset);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetGraphicsRootShaderResourceView, CaptureRootDescriptorCommand {root_parameter, _capture.get_id(buffer), offset});
+        }
+    }
+
+    void CapturedCommandList::set_compute_root_unordered_access_view(uint32_t root_parameter, ID3D12Resource* buffer, uint64_t offset)
+    {
+        _command_list->SetComputeRootUnorderedAccessView(root_parameter, buffer->GetGPUVirtualAddress() + offset);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetComputeRootUnorderedAccessView, CaptureRootDescriptorCommand {root_parameter, _capture.get_id(buffer), offset});
+        }
+    }
+
+    void CapturedCommandList::set_viewport(const D3D12_VIEWPORT& viewport)
+    {
+        _command_list->RSSetViewports(1, &viewport);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetViewport, CaptureViewportCommand {viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height, viewport.MinDepth, viewport.MaxDepth});
+        }
+    }
+
+    void CapturedCommandList::set_scissor_rect(const D3D12_RECT& scissor_rect)
+    {
+        _command_list->RSSetScissorRects(1, &scissor_rect);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetScissorRect, CaptureScissorRectCommand {scissor_rect.left, scissor_rect.top, scissor_rect.right, scissor_rect.bottom});
+        }
+    }
+
+    void CapturedCommandList::transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state_before, D3D12_RESOURCE_STATES state_after)
+    {
+        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource, state_before, state_after);
+        _command_list->ResourceBarrier(1, &barrier);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kResourceBarrier, CaptureBarrierCommand {_capture.get_id(resource), static_cast<uint32_t>(state_before), static_cast<uint32_t>(state_after)});
+        }
+    }
+
+    void CapturedCommandList::set_render_target(D3D12_CPU_DESCRIPTOR_HANDLE rtv, ID3D12Resource* render_target)
+    {
+        _command_list->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetRenderTarget, CaptureObjectCommand {_capture.get_id(render_target)});
+        }
+    }
+
+    void CapturedCommandList::clear_render_target(D3D12_CPU_DESCRIPTOR_HANDLE rtv, ID3D12Resource* render_target, const float color[4])
+    {
+        _command_list->ClearRenderTargetView(rtv, color, 0, nullptr);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kClearRenderTarget, CaptureClearCommand {_capture.get_id(render_target), {color[0], color[1], color[2], color[3]}});
+        }
+    }
+
+    void CapturedCommandList::set_primitive_topology(D3D12_PRIMITIVE_TOPOLOGY topology)
+    {
+        _command_list->IASetPrimitiveTopology(topology);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetPrimitiveTopology, CaptureObjectCommand {static_cast<uint32_t>(topology)});
+        }
+    }
+
+    void CapturedCommandList::set_vertex_buffer(uint32_t slot, const D3D12_VERTEX_BUFFER_VIEW& view, ID3D12Resource* buffer)
+    {
+        _command_list->IASetVertexBuffers(slot, 1, &view);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kSetVertexBuffer, CaptureVertexBufferCommand {slot, _capture.get_id(buffer), view.SizeInBytes, view.StrideInBytes, view.BufferLocation - buffer->GetGPUVirtualAddress()});
+        }
+    }
+
+    void CapturedCommandList::draw_instanced(uint32_t vertex_count_per_instance, uint32_t instance_count, uint32_t start_vertex_location, uint32_t start_instance_location)
+    {
+        _command_list->DrawInstanced(vertex_count_per_instance, instance_count, start_vertex_location, start_instance_location);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kDrawInstanced, CaptureDrawCommand {vertex_count_per_instance, instance_count, start_vertex_location, start_instance_location});
+        }
+    }
+
+    void CapturedCommandList::dispatch(uint32_t thread_group_count_x, uint32_t thread_group_count_y, uint32_t thread_group_count_z)
+    {
+        _command_list->Dispatch(thread_group_count_x, thread_group_count_y, thread_group_count_z);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kDispatch, CaptureDispatchCommand {thread_group_count_x, thread_group_count_y, thread_group_count_z});
+        }
+    }
+
+    void CapturedCommandList::copy_buffer_region(ID3D12Resource* dest, uint64_t dest_offset, ID3D12Resource* source, uint64_t source_offset, uint64_t size)
+    {
+        _command_list->CopyBufferRegion(dest, dest_offset, source, source_offset, size);
+        if (_recording)
+        {
+            _commands.add(CaptureCommandType::kCopyBufferRegion, CaptureCopyBufferCommand {_capture.get_id(dest), _capture.get_id(source), dest_offset, source_offset, size});
+        }
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../renderer/command_context_manager.h"
+#include "capture_writer.h"
+#include <string>
+#include <unordered_map>
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <directx/d3d12.h>
+
+namespace learn_d3d12
+{
+    // Records what a renderer submits into a capture file. Objects are registered as they
+    // are created, which writes their creation chunks; frames are recorded from the first
+    // begin_frame until `frame_count` frames have ended, then the file is closed. Register
+    // calls and recorded command lists are cheap no-ops while no capture is open.
+    class D3d12FrameCapture
+    {
+    public:
+        bool open(const std::string& path, uint32_t width, uint32_t height, uint32_t frame_count, std::string& error);
+        bool is_recording() const { return _writer.is_open(); }
+
+        void register_root_signature(ID3D12RootSignature* root_signature, ID3DBlob* serialized);
+        void register_graphics_pipeline(ID3D12PipelineState* pipeline_state, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+        void register_compute_pipeline(ID3D12PipelineState* pipeline_state, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc);
+        void register_buffer(ID3D12Resource* buffer, D3D12_HEAP_TYPE heap_type, D3D12_RESOURCE_STATES initial_state);
+        void register_render_target(ID3D12Resource* render_target);
+        // Records bytes the CPU wrote into a mapped upload heap buffer.
+        void record_upload(ID3D12Resource* buffer, uint64_t offset, const void* data, uint64_t size);
+        // Returns the submission number for record_queue_wait, or 0 while not recording.
+        uint64_t record_submission(QueueType queue, const CaptureCommandStream& commands);
+        void record_queue_wait(QueueType queue, QueueType wait_queue, uint64_t submission);
+        void begin_frame();
+        // Closes the file after the last requested frame; returns false if writing failed.
+        bool end_frame(std::string& error);
+
+        // Capture id of a registered object, 0 if it is unknown.
+        uint32_t get_id(const void* object) const;
+
+    private:
+        CaptureWriter _writer;
+        std::unordered_map<const void*, uint32_t> _ids;
+        uint32_t _remaining_frames = 0;
+        bool _in_frame = false;
+    };
+
+    // Forwards to an ID3D12GraphicsCommandList and, while a capture is recording, encodes
+    // the same calls with capture ids. Only the calls the renderers make are wrapped; call
+    // get() for anything that should not be captured, such as profiler queries.
+    class CapturedCommandList
+    {
+    public:
+        // `initial_state` must be the pipeline state the command list was reset with. The
+        // encoded commands are allocated from `scratch`, such as a FrameArena, when given.
+        CapturedCommandList(ID3D12GraphicsCommandList* command_list, D3d12FrameCapture& capture, ID3D12PipelineState* initial_state = nullptr, std::pmr::memory_resource* scratch = nullptr);
+
+        ID3D12GraphicsCommandList* get() const { return _command_list; }
+        const CaptureCommandStream& get_commands() const { return _commands; }
+
+        void set_pipeline_state(ID3D12PipelineState* pipeline_state);
+        void set_graphics_root_signature(ID3D12RootSignature* root_signature);
+        void set_compute_root_signature(ID3D12RootSignature* root_signature);
+        void set_graphics_root_32bit_constants(uint32_t root_parameter, uint32_t count, const void* data, uint32_t dest_offset);
+        void set_compute_root_32bit_constants(uint32_t root_parameter, uint32_t count, const void* data, uint32_t dest_offset);
+        void set_graphics_root_shader_resource_view(uint32_t root_parameter, ID3D12Resource* buffer, uint64_t offset = 0);
+        void set_compute_root_unordered_access_view(uint32_t root_parameter, ID3D12Resource* buffer, uint64_t offset = 0);
+        void set_viewport(const D3D12_VIEWPORT& viewport);
+        void set_scissor_rect(const D3D12_RECT& scissor_rect);
+        void transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state_before, D3D12_RESOURCE_STATES state_after);
+        // Descriptors are not captured, so the resource behind `rtv` is passed as well.
+        void set_render_target(D3D12_CPU_DESCRIPTOR_HANDLE rtv, ID3D12Resource* render_target);
+        void clear_render_target(D3D12_CPU_DESCRIPTOR_HANDLE rtv, ID3D12Resource* render_target, const float color[4]);
+        void set_primitive_topology(D3D12_PRIMITIVE_TOPOLOGY topology);
+        void set_vertex_buffer(uint32_t slot, const D3D12_VERTEX_BUFFER_VIEW& view, ID3D12Resource* buffer);
+        void draw_instanced(uint32_t vertex_count_per_instance, uint32_t instance_count, uint32_t start_vertex_location, uint32_t start_instance_location);
+        void dispatch(uint32_t thread_group_count_x, uint32_t thread_group_count_y, uint32_t thread_group_count_z);
+        void copy_buffer_region(ID3D12Resource* dest, uint64_t dest_offset, ID3D12Resource* source, uint64_t source_offset, uint64_t size);
+
+    private:
+        ID3D12GraphicsCommandList* _command_list;
+        D3d12FrameCapture& _capture;
+        CaptureCommandStream _commands;
+        bool _recording;
+    };
+}  // namespace learn_d3d12
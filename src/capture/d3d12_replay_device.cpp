@@ -0,0 +1,281 @@
+#include "d3d12_replay_device.h"
+#include "../renderer/d3d12_helper.h"
+#include <directx/d3dx12.h>
+#include <cstring>
+
+namespace learn_d3d12
+{
+    D3d12ReplayDevice::D3d12ReplayDevice(ID3D12Device* device)
+        : _device(device)
+        , _rtv_descriptor_size(0)
+        , _render_target_count(0)
+        , _frame_fence_values {}
+        , _frame_slot(0)
+    {
+        _command_contexts.initialize(device);
+
+        D3D12_DESCRIPTOR_HEAP_DESC rtv_heap_desc = {};
+        rtv_heap_desc.NumDescriptors = kMaxRenderTargets;
+        rtv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+        rtv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        throw_if_failed(_device->CreateDescriptorHeap(&rtv_heap_desc, IID_PPV_ARGS(&_rtv_heap)));
+        _rtv_descriptor_size = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    }
+
+    D3d12ReplayDevice::~D3d12ReplayDevice()
+    {
+        _command_contexts.shutdown();
+        for (auto& [id, data] : _mapped_buffers)
+        {
+            _resources[id]->Unmap(0, nullptr);
+        }
+    }
+
+    void D3d12ReplayDevice::create_root_signature(uint32_t id, const void* serialized, uint32_t size)
+    {
+        throw_if_failed(_device->CreateRootSignature(0, serialized, size, IID_PPV_ARGS(&_root_signatures[id])));
+    }
+
+    void D3d12ReplayDevice::create_graphics_pipeline(const CaptureGraphicsPipeline& pipeline)
+    {
+        // The renderers only use per-vertex data, so the classification is not captured.
+        std::vector<D3D12_INPUT_ELEMENT_DESC> input_element_descs;
+        for (const auto& element : pipeline.input_elements)
+        {
+            input_element_descs.push_back({element.semantic_name,
+                                           element.semantic_index,
+                                           static_cast<DXGI_FORMAT>(element.format),
+                                           element.input_slot,
+                                           element.aligned_byte_offset,
+                                           D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+                                           0});
+        }
+
+        CD3DX12_BLEND_DESC blend_desc(D3D12_DEFAULT);
+        blend_desc.RenderTarget[0].BlendEnable = pipeline.desc.blend_enable;
+        if (pipeline.desc.blend_enable)
+        {
+            blend_desc.RenderTarget[0].SrcBlend = static_cast<D3D12_BLEND>(pipeline.desc.src_blend);
+            blend_desc.RenderTarget[0].DestBlend = static_cast<D3D12_BLEND>(pipeline.desc.dest_blend);
+            blend_desc.RenderTarget[0].BlendOp = static_cast<D3D12_BLEND_OP>(pipeline.desc.blend_op);
+        }
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
+        pso_desc.InputLayout = {input_element_descs.data(), static_cast<UINT>(input_element_descs.size())};
+        pso_desc.pRootSignature = _root_signatures[pipeline.desc.root_signature_id].Get();
+        pso_desc.VS = CD3DX12_SHADER_BYTECODE(pipeline.vertex_shader, pipeline.desc.vertex_shader_size);
+        pso_desc.PS = CD3DX12_SHADER_BYTECODE(pipeline.pixel_shader, pipeline.desc.pixel_shader_size);
+        pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        pso_desc.RasterizerState.CullMode = static_cast<D3D12_CULL_MODE>(pipeline.desc.cull_mode);
+        pso_desc.BlendState = blend_desc;
+        pso_desc.DepthStencilState.DepthEnable = FALSE;
+        pso_desc.DepthStencilState.StencilEnable = FALSE;
+        pso_desc.SampleMask = UINT_MAX;
+        pso_desc.PrimitiveTopologyType = static_cast<D3D12_PRIMITIVE_TOPOLOGY_TYPE>(pipeline.desc.primitive_topology_type);
+        pso_desc.NumRenderTargets = 1;
+        pso_desc.RTVFormats[0] = static_cast<DXGI_FORMAT>(pipeline.desc.render_target_format);
+        pso_desc.SampleDesc.Count = 1;
+        throw_if_failed(_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&_pipeline_states[pipeline.desc.id])));
+    }
+
+    void D3d12ReplayDevice::create_compute_pipeline(const CaptureComputePipelineChunk& desc, const void* compute_shader)
+    {
+        D3D12_COMPUTE_PIPELINE_STATE_DESC compute_pso_desc = {};
+        compute_pso_desc.pRootSignature = _root_signatures[desc.root_signature_id].Get();
+        compute_pso_desc.CS = CD3DX12_SHADER_BYTECODE(compute_shader, desc.compute_shader_size);
+        throw_if_failed(_device->CreateComputePipelineState(&compute_pso_desc, IID_PPV_ARGS(&_pipeline_states[desc.id])));
+    }
+
+    void D3d12ReplayDevice::create_buffer(const CaptureBufferChunk& desc)
+    {
+        const auto heap_type = static_cast<D3D12_HEAP_TYPE>(desc.heap_type);
+        CD3DX12_HEAP_PROPERTIES props(heap_type);
+        CD3DX12_RESOURCE_DESC resource_desc = CD3DX12_RESOURCE_DESC::Buffer(desc.size, static_cast<D3D12_RESOURCE_FLAGS>(desc.flags));
+        ComPtr<ID3D12Resource>& buffer = _resources[desc.id];
+        throw_if_failed(_device->CreateCommittedResource(
+            &props,
+            D3D12_HEAP_FLAG_NONE,
+            &resource_desc,
+            static_cast<D3D12_RESOURCE_STATES>(desc.initial_state),
+            nullptr,
+            IID_PPV_ARGS(&buffer)));
+
+        // Upload heaps stay mapped, like in the renderers.
+        if (heap_type == D3D12_HEAP_TYPE_UPLOAD)
+        {
+            CD3DX12_RANGE read_range(0, 0);  // We do not intend to read from this resource on the CPU.
+            throw_if_failed(buffer->Map(0, &read_range, reinterpret_cast<void**>(&_mapped_buffers[desc.id])));
+        }
+    }
+
+    void D3d12ReplayDevice::create_render_target(const CaptureRenderTargetChunk& desc)
+    {
+        if (_render_target_count == kMaxRenderTargets)
+        {
+            throw std::runtime_error("capture uses more than " + std::to_string(kMaxRenderTargets) + " render targets");
+        }
+        CD3DX12_HEAP_PROPERTIES props(D3D12_HEAP_TYPE_DEFAULT);
+        CD3DX12_RESOURCE_DESC resource_desc = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(desc.format), desc.width, desc.height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+        ComPtr<ID3D12Resource>& render_target = _resources[desc.id];
+        throw_if_failed(_device->CreateCommittedResource(
+            &props,
+            D3D12_HEAP_FLAG_NONE,
+            &resource_desc,
+            D3D12_RESOURCE_STATE_PRESENT,
+            nullptr,
+            IID_PPV_ARGS(&render_target)));
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart(), _render_target_count++, _rtv_descriptor_size);
+        _device->CreateRenderTargetView(render_target.Get(), nullptr, rtv_handle);
+        _render_target_views[desc.id] = rtv_handle;
+    }
+
+    void D3d12ReplayDevice::upload_buffer(const CaptureUploadChunk& upload, const void* data, uint64_t size)
+    {
+        memcpy(_mapped_buffers[upload.buffer_id] + upload.offset, data, size);
+    }
+
+    void D3d12ReplayDevice::begin_command_list(CaptureQueue queue)
+    {
+        // The captured initial pipeline state, if any, is the first recorded command.
+        _context = _command_contexts.begin(static_cast<QueueType>(queue));
+    }
+
+    void D3d12ReplayDevice::record_command(CaptureCommandType type, const void* payload, uint32_t size)
+    {
+        ID3D12GraphicsCommandList* command_list = _context.command_list.Get();
+        switch (type)
+        {
+            case CaptureCommandType::kSetPipelineState:
+                command_list->SetPipelineState(_pipeline_states[read_capture_payload<CaptureObjectCommand>(payload).id].Get());
+                break;
+            case CaptureCommandType::kSetGraphicsRootSignature:
+                command_list->SetGraphicsRootSignature(_root_signatures[read_capture_payload<CaptureObjectCommand>(payload).id].Get());
+                break;
+            case CaptureCommandType::kSetComputeRootSignature:
+                command_list->SetComputeRootSignature(_root_signatures[read_capture_payload<CaptureObjectCommand>(payload).id].Get());
+                break;
+            case CaptureCommandType::kSetGraphicsRoot32BitConstants:
+            case CaptureCommandType::kSetComputeRoot32BitConstants: {
+                auto command = read_capture_payload<CaptureRootConstantsCommand>(payload);
+                // The values are unaligned in the capture.
+                std::vector<uint32_t> values(command.count);
+                memcpy(values.data(), static_cast<const uint8_t*>(payload) + sizeof(command), sizeof(uint32_t) * command.count);
+                if (type == CaptureCommandType::kSetGraphicsRoot32BitConstants)
+                {
+                    command_list->SetGraphicsRoot32BitConstants(command.root_parameter, command.count, values.data(), command.dest_offset);
+                }
+                else
+                {
+                    command_list->SetComputeRoot32BitConstants(command.root_parameter, command.count, values.data(), command.dest_offset);
+                }
+                break;
+            }
+            case CaptureCommandType::kSetGraphicsRootShaderResourceView: {
+                auto command = read_capture_payload<CaptureRootDescriptorCommand>(payload);
+                command_list->SetGraphicsRootShaderResourceView(command.root_parameter, _get_resource(command.buffer_id)->GetGPUVirtualAddress() + command.offset);
+                break;
+            }
+            case CaptureCommandType::kSetComputeRootUnorderedAccessView: {
+                auto command = read_capture_payload<CaptureRootDescriptorCommand>(payload);
+                command_list->SetComputeRootUnorderedAccessView(command.root_parameter, _get_resource(command.buffer_id)->GetGPUVirtualAddress() + command.offset);
+                break;
+            }
+            case CaptureCommandType::kSetViewport: {
+                auto command = read_capture_payload<CaptureViewportCommand>(payload);
+                D3D12_VIEWPORT viewport = {command.top_left_x, command.top_left_y, command.width, command.height, command.min_depth, command.max_depth};
+                command_list->RSSetViewports(1, &viewport);
+                break;
+            }
+            case CaptureCommandType::kSetScissorRect: {
+                auto command = read_capture_payload<CaptureScissorRectCommand>(payload);
+                D3D12_RECT scissor_rect = {command.left, command.top, command.right, command.bottom};
+                command_list->RSSetScissorRects(1, &scissor_rect);
+                break;
+            }
+            case CaptureCommandType::kResourceBarrier: {
+                auto command = read_capture_payload<CaptureBarrierCommand>(payload);
+                auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(_get_resource(command.resource_id),
+                                                                    static_cast<D3D12_RESOURCE_STATES>(command.state_before),
+                                                                    static_cast<D3D12_RESOURCE_STATES>(command.state_after));
+                command_list->ResourceBarrier(1, &barrier);
+                break;
+            }
+            case CaptureCommandType::kSetRenderTarget: {
+                D3D12_CPU_DESCRIPTOR_HANDLE rtv_handle = _render_target_views[read_capture_payload<CaptureObjectCommand>(payload).id];
+                command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, nullptr);
+                break;
+            }
+            case CaptureCommandType::kClearRenderTarget: {
+                auto command = read_capture_payload<CaptureClearCommand>(payload);
+                command_list->ClearRenderTargetView(_render_target_views[command.render_target_id], command.color, 0, nullptr);
+                break;
+            }
+            case CaptureCommandType::kSetPrimitiveTopology:
+                command_list->IASetPrimitiveTopology(static_cast<D3D12_PRIMITIVE_TOPOLOGY>(read_capture_payload<CaptureObjectCommand>(payload).id));
+                break;
+            case CaptureCommandType::kSetVertexBuffer: {
+                auto command = read_capture_payload<CaptureVertexBufferCommand>(payload);
+                D3D12_VERTEX_BUFFER_VIEW view = {_get_resource(command.buffer_id)->GetGPUVirtualAddress() + command.offset, command.size, command.stride};
+                command_list->IASetVertexBuffers(command.slot, 1, &view);
+                break;
+            }
+            case CaptureCommandType::kDrawInstanced: {
+                auto command = read_capture_payload<CaptureDrawCommand>(payload);
+                command_list->DrawInstanced(command.vertex_count_per_instance, command.instance_count, command.start_vertex_location, command.start_instance_location);
+                break;
+            }
+            case CaptureCommandType::kDispatch: {
+                auto command = read_capture_payload<CaptureDispatchCommand>(payload);
+                command_list->Dispatch(command.thread_group_count_x, command.thread_group_count_y, command.thread_group_count_z);
+                break;
+            }
+            case CaptureCommandType::kCopyBufferRegion: {
+                auto command = read_capture_payload<CaptureCopyBufferCommand>(payload);
+                command_list->CopyBufferRegion(_get_resource(command.dest_buffer_id), command.dest_offset, _get_resource(command.source_buffer_id), command.source_offset, command.size);
+                break;
+            }
+        }
+    }
+
+    void D3d12ReplayDevice::end_command_list()
+    {
+        auto queue_index = static_cast<uint32_t>(_context.type);
+        _submission_fence_values[queue_index].push_back(_command_contexts.submit(_context));
+    }
+
+    void D3d12ReplayDevice::wait_for_queue(const CaptureQueueWaitChunk& wait)
+    {
+        const auto& fence_values = _submission_fence_values[static_cast<uint32_t>(wait.wait_queue)];
+        if (wait.submissions_ago >= fence_values.size())
+        {
+            throw std::runtime_error("capture waits for a submission that was never made");
+        }
+        uint64_t fence_value = fence_values[fence_values.size() - 1 - wait.submissions_ago];
+        _command_contexts.get_queue(static_cast<QueueType>(wait.queue)).wait_for_queue(_command_contexts.get_queue(static_cast<QueueType>(wait.wait_queue)), fence_value);
+    }
+
+    void D3d12ReplayDevice::begin_frame(uint32_t frame_index)
+    {
+        // Throttle like a swap chain would, so the CPU cannot run away from the GPU.
+        _command_contexts.get_queue(QueueType::kDirect).wait_for_fence(_frame_fence_values[_frame_slot]);
+    }
+
+    void D3d12ReplayDevice::end_frame(uint32_t frame_index)
+    {
+        const auto& direct_fence_values = _submission_fence_values[static_cast<uint32_t>(CaptureQueue::kDirect)];
+        _frame_fence_values[_frame_slot] = direct_fence_values.empty() ? 0 : direct_fence_values.back();
+        _frame_slot = (_frame_slot + 1) % kFrameLatency;
+    }
+
+    void D3d12ReplayDevice::wait_idle()
+    {
+        _command_contexts.wait_idle();
+    }
+
+    ID3D12Resource* D3d12ReplayDevice::_get_resource(uint32_t id) const
+    {
+        auto it = _resources.find(id);
+        return it != _resources.end() ? it->second.Get() : nullptr;
+    }
+}  // namespace learn_d3d12
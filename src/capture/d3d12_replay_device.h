@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../renderer/command_context_manager.h"
+#include "capture_reader.h"
+#include <unordered_map>
+#include <vector>
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <directx/d3d12.h>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace learn_d3d12
+{
+    // Re-issues a capture on a D3D12 device. Swap chain buffers become offscreen render
+    // targets and nothing is presented, so frames run as fast as the GPU allows, with up
+    // to kFrameLatency frames in flight.
+    class D3d12ReplayDevice : public ReplayDevice
+    {
+    public:
+        static const uint32_t kFrameLatency = 2;
+        static const uint32_t kMaxRenderTargets = 16;
+
+        explicit D3d12ReplayDevice(ID3D12Device* device);
+        ~D3d12ReplayDevice() override;
+
+        void create_root_signature(uint32_t id, const void* serialized, uint32_t size) override;
+        void create_graphics_pipeline(const CaptureGraphicsPipeline& pipeline) override;
+        void create_compute_pipeline(const CaptureComputePipelineChunk& desc, const void* compute_shader) override;
+        void create_buffer(const CaptureBufferChunk& desc) override;
+        void create_render_target(const CaptureRenderTargetChunk& desc) override;
+        void upload_buffer(const CaptureUploadChunk& upload, const void* data, uint64_t size) override;
+        void begin_command_list(CaptureQueue queue) override;
+        void record_command(CaptureCommandType type, const void* payload, uint32_t size) override;
+        void end_command_list() override;
+        void wait_for_queue(const CaptureQueueWaitChunk& wait) override;
+        void begin_frame(uint32_t frame_index) override;
+        void end_frame(uint32_t frame_index) override;
+
+        // Blocks until the GPU has finished everything replayed so far.
+        void wait_idle();
+
+    private:
+        ComPtr<ID3D12Device> _device;
+        CommandContextManager _command_contexts;
+        ComPtr<ID3D12DescriptorHeap> _rtv_heap;
+        uint32_t _rtv_descriptor_size;
+        uint32_t _render_target_count;
+        std::unordered_map<uint32_t, ComPtr<ID3D12RootSignature>> _root_signatures;
+        std::unordered_map<uint32_t, ComPtr<ID3D12PipelineState>> _pipeline_states;
+        std::unordered_map<uint32_t, ComPtr<ID3D12Resource>> _resources;
+        std::unordered_map<uint32_t, uint8_t*> _mapped_buffers;
+        std::unordered_map<uint32_t, D3D12_CPU_DESCRIPTOR_HANDLE> _render_target_views;
+        // Fence value of every replayed submission per queue, to resolve queue waits.
+        std::vector<uint64_t> _submission_fence_values[kCaptureQueueCount];
+        CommandContext _context;
+        uint64_t _frame_fence_values[kFrameLatency];
+        uint32_t _frame_slot;
+
+        ID3D12Resource* _get_resource(uint32_t id) const;
+    };
+}  // namespace learn_d3d12
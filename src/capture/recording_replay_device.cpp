@@ -0,0 +1,316 @@
+#include "recording_replay_device.h"
+#include <iterator>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        const char* const kQueueNames[] = {"direct", "compute", "copy"};
+
+        const char* get_command_name(CaptureCommandType type)
+        {
+            static const char* const kNames[] = {
+                "unknown",
+                "set_pipeline_state",
+                "set_graphics_root_signature",
+                "set_compute_root_signature",
+                "set_graphics_root_32bit_constants",
+                "set_compute_root_32bit_constants",
+                "set_graphics_root_shader_resource_view",
+                "set_compute_root_unordered_access_view",
+                "set_viewport",
+                "set_scissor_rect",
+                "resource_barrier",
+                "set_render_target",
+                "clear_render_target",
+                "set_primitive_topology",
+                "set_vertex_buffer",
+                "draw_instanced",
+                "dispatch",
+                "copy_buffer_region",
+            };
+            auto index = static_cast<uint32_t>(type);
+            return index < std::size(kNames) ? kNames[index] : kNames[0];
+        }
+    }  // namespace
+
+    RecordingReplayDevice::RecordingReplayDevice(std::ostream* log)
+        : _log(log)
+        , _hash(14695981039346656037ull)
+        , _error_count(0)
+        , _queue(CaptureQueue::kDirect)
+        , _recording(false)
+        , _has_pipeline(false)
+    {
+    }
+
+    void RecordingReplayDevice::create_root_signature(uint32_t id, const void* serialized, uint32_t size)
+    {
+        _hash_bytes(&id, sizeof(id));
+        _hash_bytes(serialized, size);
+        _create(id, {ObjectKind::kRootSignature, 0, size, 0});
+        if (_log)
+        {
+            *_log << "create_root_signature id=" << id << " size=" << size << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::create_graphics_pipeline(const CaptureGraphicsPipeline& pipeline)
+    {
+        _hash_bytes(&pipeline.desc, sizeof(pipeline.desc));
+        _hash_bytes(pipeline.input_elements.data(), sizeof(CaptureInputElement) * pipeline.input_elements.size());
+        _hash_bytes(pipeline.vertex_shader, pipeline.desc.vertex_shader_size);
+        _hash_bytes(pipeline.pixel_shader, pipeline.desc.pixel_shader_size);
+        _find(pipeline.desc.root_signature_id, ObjectKind::kRootSignature);
+        _create(pipeline.desc.id, {ObjectKind::kGraphicsPipeline, 0, 0, 0});
+        if (_log)
+        {
+            *_log << "create_graphics_pipeline id=" << pipeline.desc.id << " root_signature=" << pipeline.desc.root_signature_id << " inputs=";
+            for (const auto& element : pipeline.input_elements)
+            {
+                *_log << element.semantic_name << element.semantic_index << "@" << element.aligned_byte_offset << " ";
+            }
+            *_log << "vs=" << pipeline.desc.vertex_shader_size << " ps=" << pipeline.desc.pixel_shader_size << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::create_compute_pipeline(const CaptureComputePipelineChunk& desc, const void* compute_shader)
+    {
+        _hash_bytes(&desc, sizeof(desc));
+        _hash_bytes(compute_shader, desc.compute_shader_size);
+        _find(desc.root_signature_id, ObjectKind::kRootSignature);
+        _create(desc.id, {ObjectKind::kComputePipeline, 0, 0, 0});
+        if (_log)
+        {
+            *_log << "create_compute_pipeline id=" << desc.id << " root_signature=" << desc.root_signature_id << " cs=" << desc.compute_shader_size << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::create_buffer(const CaptureBufferChunk& desc)
+    {
+        _hash_bytes(&desc, sizeof(desc));
+        _create(desc.id, {ObjectKind::kBuffer, desc.heap_type, desc.size, desc.initial_state});
+        if (_log)
+        {
+            *_log << "create_buffer id=" << desc.id << " heap=" << desc.heap_type << " state=" << desc.initial_state << " size=" << desc.size << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::create_render_target(const CaptureRenderTargetChunk& desc)
+    {
+        _hash_bytes(&desc, sizeof(desc));
+        _create(desc.id, {ObjectKind::kRenderTarget, 0, 0, 0});
+        if (_log)
+        {
+            *_log << "create_render_target id=" << desc.id << " " << desc.width << "x" << desc.height << " format=" << desc.format << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::upload_buffer(const CaptureUploadChunk& upload, const void* data, uint64_t size)
+    {
+        _hash_bytes(&upload, sizeof(upload));
+        _hash_bytes(data, size);
+        _counters.uploaded_bytes += size;
+        if (Object* buffer = _find(upload.buffer_id, ObjectKind::kBuffer))
+        {
+            if (buffer->heap_type != kCaptureUploadHeapType)
+            {
+                _error("upload into buffer " + std::to_string(upload.buffer_id) + ", which is not in an upload heap");
+            }
+            if (upload.offset > buffer->size || size > buffer->size - upload.offset)
+            {
+                _error("upload outside buffer " + std::to_string(upload.buffer_id));
+            }
+        }
+        if (_log)
+        {
+            *_log << "upload_buffer id=" << upload.buffer_id << " offset=" << upload.offset << " size=" << size << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::begin_command_list(CaptureQueue queue)
+    {
+        _hash_bytes(&queue, sizeof(queue));
+        if (_recording)
+        {
+            _error("command list begun while another one is open");
+        }
+        _queue = queue;
+        _recording = true;
+        _has_pipeline = false;
+        if (_log)
+        {
+            *_log << "begin_command_list " << kQueueNames[static_cast<uint32_t>(queue)] << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::record_command(CaptureCommandType type, const void* payload, uint32_t size)
+    {
+        _hash_bytes(&type, sizeof(type));
+        _hash_bytes(payload, size);
+        _counters.commands++;
+        if (!_recording)
+        {
+            _error("command outside a command list");
+        }
+        if (_log)
+        {
+            *_log << "  " << get_command_name(type) << "\n";
+        }
+
+        switch (type)
+        {
+            case CaptureCommandType::kSetPipelineState: {
+                auto command = read_capture_payload<CaptureObjectCommand>(payload);
+                auto it = _objects.find(command.id);
+                if (it == _objects.end() || (it->second.kind != ObjectKind::kGraphicsPipeline && it->second.kind != ObjectKind::kComputePipeline))
+                {
+                    _error("unknown pipeline " + std::to_string(command.id));
+                }
+                _has_pipeline = true;
+                break;
+            }
+            case CaptureCommandType::kSetGraphicsRootSignature:
+            case CaptureCommandType::kSetComputeRootSignature:
+                _find(read_capture_payload<CaptureObjectCommand>(payload).id, ObjectKind::kRootSignature);
+                break;
+            case CaptureCommandType::kSetGraphicsRootShaderResourceView:
+            case CaptureCommandType::kSetComputeRootUnorderedAccessView:
+                _find(read_capture_payload<CaptureRootDescriptorCommand>(payload).buffer_id, ObjectKind::kBuffer);
+                break;
+            case CaptureCommandType::kResourceBarrier: {
+                _counters.barriers++;
+                auto command = read_capture_payload<CaptureBarrierCommand>(payload);
+                auto it = _objects.find(command.resource_id);
+                if (it == _objects.end() || (it->second.kind != ObjectKind::kBuffer && it->second.kind != ObjectKind::kRenderTarget))
+                {
+                    _error("barrier on unknown resource " + std::to_string(command.resource_id));
+                }
+                else if (it->second.kind == ObjectKind::kRenderTarget)
+                {
+                    if (it->second.state != command.state_before)
+                    {
+                        _error("barrier on render target " + std::to_string(command.resource_id) + " from state " + std::to_string(command.state_before) + ", but it is in state " + std::to_string(it->second.state));
+                    }
+                    it->second.state = command.state_after;
+                }
+                break;
+            }
+            case CaptureCommandType::kSetRenderTarget:
+                _find(read_capture_payload<CaptureObjectCommand>(payload).id, ObjectKind::kRenderTarget);
+                break;
+            case CaptureCommandType::kClearRenderTarget:
+                _find(read_capture_payload<CaptureClearCommand>(payload).render_target_id, ObjectKind::kRenderTarget);
+                break;
+            case CaptureCommandType::kSetVertexBuffer:
+                _find(read_capture_payload<CaptureVertexBufferCommand>(payload).buffer_id, ObjectKind::kBuffer);
+                break;
+            case CaptureCommandType::kDrawInstanced:
+            case CaptureCommandType::kDispatch:
+                (type == CaptureCommandType::kDrawInstanced ? _counters.draws : _counters.dispatches)++;
+                if (!_has_pipeline)
+                {
+                    _error(std::string(get_command_name(type)) + " without a pipeline state");
+                }
+                break;
+            case CaptureCommandType::kCopyBufferRegion: {
+                _counters.copies++;
+                auto command = read_capture_payload<CaptureCopyBufferCommand>(payload);
+                Object* dest = _find(command.dest_buffer_id, ObjectKind::kBuffer);
+                Object* source = _find(command.source_buffer_id, ObjectKind::kBuffer);
+                if ((dest && (command.dest_offset > dest->size || command.size > dest->size - command.dest_offset)) ||
+                    (source && (command.source_offset > source->size || command.size > source->size - command.source_offset)))
+                {
+                    _error("copy outside a buffer");
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void RecordingReplayDevice::end_command_list()
+    {
+        if (!_recording)
+        {
+            _error("command list ended without beginning");
+        }
+        _recording = false;
+        _counters.command_lists[static_cast<uint32_t>(_queue)]++;
+    }
+
+    void RecordingReplayDevice::wait_for_queue(const CaptureQueueWaitChunk& wait)
+    {
+        _hash_bytes(&wait, sizeof(wait));
+        _counters.queue_waits++;
+        // A wait on a submission that does not exist would hang a real GPU.
+        if (wait.submissions_ago >= _counters.command_lists[static_cast<uint32_t>(wait.wait_queue)])
+        {
+            _error("wait for a submission on the " + std::string(kQueueNames[static_cast<uint32_t>(wait.wait_queue)]) + " queue that was never made");
+        }
+        if (_log)
+        {
+            *_log << "wait_for_queue " << kQueueNames[static_cast<uint32_t>(wait.queue)] << " on " << kQueueNames[static_cast<uint32_t>(wait.wait_queue)] << " submissions_ago=" << wait.submissions_ago << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::begin_frame(uint32_t frame_index)
+    {
+        _hash_bytes(&frame_index, sizeof(frame_index));
+        if (_log)
+        {
+            *_log << "begin_frame " << frame_index << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::end_frame(uint32_t frame_index)
+    {
+        if (_recording)
+        {
+            _error("frame ended with an open command list");
+        }
+        if (_log)
+        {
+            *_log << "end_frame " << frame_index << "\n";
+        }
+    }
+
+    void RecordingReplayDevice::_hash_bytes(const void* data, uint64_t size)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (uint64_t i = 0; i < size; i++)
+        {
+            _hash = (_hash ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    void RecordingReplayDevice::_create(uint32_t id, const Object& object)
+    {
+        if (!_objects.emplace(id, object).second)
+        {
+            _error("id " + std::to_string(id) + " is created twice");
+        }
+    }
+
+    RecordingReplayDevice::Object* RecordingReplayDevice::_find(uint32_t id, ObjectKind kind)
+    {
+        auto it = _objects.find(id);
+        if (it == _objects.end() || it->second.kind != kind)
+        {
+            _error("unknown or mismatched object " + std::to_string(id));
+            return nullptr;
+        }
+        return &it->second;
+    }
+
+    void RecordingReplayDevice::_error(const std::string& message)
+    {
+        // A broken capture replayed in a loop repeats its errors; keep the first ones.
+        _error_count++;
+        if (_errors.size() < kMaxKeptErrors)
+        {
+            _errors.push_back(message);
+        }
+    }
+}  // namespace learn_d3d12
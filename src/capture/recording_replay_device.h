@@ -0,0 +1,89 @@
+#pragma once
+
+#include "capture_reader.h"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // Stand-in for a GPU: executes nothing, but checks what a real device would reject
+    // (unknown ids, uploads outside a buffer or into a non-upload heap, draws without a
+    // pipeline, waits on submissions that never happen, barriers from the wrong render
+    // target state) and hashes every call so replays can be compared. Optionally writes
+    // one line per call.
+    class RecordingReplayDevice : public ReplayDevice
+    {
+    public:
+        struct Counters
+        {
+            uint64_t command_lists[kCaptureQueueCount] = {};
+            uint64_t commands = 0;
+            uint64_t draws = 0;
+            uint64_t dispatches = 0;
+            uint64_t copies = 0;
+            uint64_t barriers = 0;
+            uint64_t uploaded_bytes = 0;
+            uint64_t queue_waits = 0;
+        };
+
+        explicit RecordingReplayDevice(std::ostream* log = nullptr);
+
+        void create_root_signature(uint32_t id, const void* serialized, uint32_t size) override;
+        void create_graphics_pipeline(const CaptureGraphicsPipeline& pipeline) override;
+        void create_compute_pipeline(const CaptureComputePipelineChunk& desc, const void* compute_shader) override;
+        void create_buffer(const CaptureBufferChunk& desc) override;
+        void create_render_target(const CaptureRenderTargetChunk& desc) override;
+        void upload_buffer(const CaptureUploadChunk& upload, const void* data, uint64_t size) override;
+        void begin_command_list(CaptureQueue queue) override;
+        void record_command(CaptureCommandType type, const void* payload, uint32_t size) override;
+        void end_command_list() override;
+        void wait_for_queue(const CaptureQueueWaitChunk& wait) override;
+        void begin_frame(uint32_t frame_index) override;
+        void end_frame(uint32_t frame_index) override;
+
+        const Counters& get_counters() const { return _counters; }
+        // FNV-1a over every call and its data, in call order.
+        uint64_t get_hash() const { return _hash; }
+        uint64_t get_error_count() const { return _error_count; }
+        // The first errors, in the order they were found.
+        const std::vector<std::string>& get_errors() const { return _errors; }
+
+    private:
+        static const uint32_t kMaxKeptErrors = 32;
+
+        enum class ObjectKind
+        {
+            kRootSignature,
+            kGraphicsPipeline,
+            kComputePipeline,
+            kBuffer,
+            kRenderTarget,
+        };
+
+        struct Object
+        {
+            ObjectKind kind;
+            uint32_t heap_type;
+            uint64_t size;
+            uint32_t state;  // Tracked for render targets, which do not decay like buffers.
+        };
+
+        std::ostream* _log;
+        std::unordered_map<uint32_t, Object> _objects;
+        Counters _counters;
+        uint64_t _hash;
+        uint64_t _error_count;
+        std::vector<std::string> _errors;
+        // State of the open command list.
+        CaptureQueue _queue;
+        bool _recording;
+        bool _has_pipeline;
+
+        void _hash_bytes(const void* data, uint64_t size);
+        void _create(uint32_t id, const Object& object);
+        Object* _find(uint32_t id, ObjectKind kind);
+        void _error(const std::string& message);
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,431 @@
+#include "occlusion_culler.h"
+#include "../simd/cpu_features.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        constexpr uint32_t kFullRow = 0xFFFFFFFFu;
+        constexpr uint32_t kOccludeeGrainSize = 256;
+        // Clip space w below this counts as touching the eye.
+        constexpr float kMinClipW = 1e-5f;
+        // Pulls coverage edges inwards a little so float error never marks a pixel the
+        // triangle misses, which would let a tile commit a depth it does not have.
+        constexpr float kCoverageEpsilon = 1.0f / 64.0f;
+
+        struct ClipVertex
+        {
+            float x;
+            float y;
+            float z;
+            float w;
+        };
+
+        ClipVertex transform_point(const float* point, const float* matrix)
+        {
+            ClipVertex result;
+            float* out = &result.x;
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                out[j] = point[0] * matrix[j] + point[1] * matrix[4 + j] + point[2] * matrix[8 + j] + matrix[12 + j];
+            }
+            return result;
+        }
+
+        double milliseconds_since(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Coverage of one triangle over the 32x8 pixels of a tile, a 32-bit mask per row
+        // where bit i is pixel tile_x + i. Pixel centers sit at +0.5.
+        template<typename Triangle>
+        bool compute_coverage_scalar(const Triangle& triangle, float tile_x, float tile_y, uint32_t* rows)
+        {
+            uint32_t any = 0;
+            for (uint32_t r = 0; r < OcclusionCuller::kTileHeight; r++)
+            {
+                float y = tile_y + static_cast<float>(r) + 0.5f;
+                uint32_t mask = kFullRow;
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    float a = triangle.edge_a[e];
+                    float row_value = triangle.edge_b[e] * y + triangle.edge_c[e];
+                    if (a == 0.0f)
+                    {
+                        mask &= row_value >= 0.0f ? kFullRow : 0u;
+                        continue;
+                    }
+                    float offset = -row_value / a - 0.5f - tile_x;
+                    if (a > 0.0f)
+                    {
+                        int32_t first = static_cast<int32_t>(std::ceil(std::clamp(offset + kCoverageEpsilon, -1.0f, 33.0f)));
+                        first = std::clamp(first, 0, 32);
+                        mask &= first >= 32 ? 0u : kFullRow << first;
+                    }
+                    else
+                    {
+                        int32_t count = static_cast<int32_t>(std::floor(std::clamp(offset - kCoverageEpsilon, -2.0f, 33.0f))) + 1;
+                        count = std::clamp(count, 0, 32);
+                        mask &= count == 0 ? 0u : kFullRow >> (32 - count);
+                    }
+                }
+                rows[r] = mask;
+                any |= mask;
+            }
+            return any != 0;
+        }
+
+#if LEARN_D3D12_X86
+        // Same as compute_coverage_scalar with the eight rows in the eight lanes. Variable
+        // shifts by 32 or more produce zero, which is exactly the empty row.
+        template<typename Triangle>
+        LEARN_D3D12_TARGET_AVX2 bool compute_coverage_avx2(const Triangle& triangle, float tile_x, float tile_y, uint32_t* rows)
+        {
+            const __m256 y = _mm256_add_ps(_mm256_set1_ps(tile_y + 0.5f), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+            const __m256i full = _mm256_set1_epi32(-1);
+            const __m256 zero = _mm256_setzero_ps();
+            __m256i mask = full;
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                float a = triangle.edge_a[e];
+                __m256 row_value = _mm256_fmadd_ps(_mm256_set1_ps(triangle.edge_b[e]), y, _mm256_set1_ps(triangle.edge_c[e]));
+                if (a == 0.0f)
+                {
+                    mask = _mm256_and_si256(mask, _mm256_castps_si256(_mm256_cmp_ps(row_value, zero, _CMP_GE_OQ)));
+                    continue;
+                }
+                __m256 offset = _mm256_sub_ps(_mm256_mul_ps(row_value, _mm256_set1_ps(-1.0f / a)), _mm256_set1_ps(0.5f + tile_x));
+                if (a > 0.0f)
+                {
+                    __m256 first = _mm256_add_ps(offset, _mm256_set1_ps(kCoverageEpsilon));
+                    first = _mm256_ceil_ps(_mm256_min_ps(_mm256_max_ps(first, _mm256_set1_ps(0.0f)), _mm256_set1_ps(32.0f)));
+                    mask = _mm256_and_si256(mask, _mm256_sllv_epi32(full, _mm256_cvtps_epi32(first)));
+                }
+                else
+                {
+                    __m256 last = _mm256_sub_ps(offset, _mm256_set1_ps(kCoverageEpsilon));
+                    __m256 count = _mm256_add_ps(_mm256_floor_ps(_mm256_max_ps(last, _mm256_set1_ps(-1.0f))), _mm256_set1_ps(1.0f));
+                    count = _mm256_min_ps(count, _mm256_set1_ps(32.0f));
+                    mask = _mm256_and_si256(mask, _mm256_srlv_epi32(full, _mm256_sub_epi32(_mm256_set1_epi32(32), _mm256_cvtps_epi32(count))));
+                }
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows), mask);
+            return !_mm256_testz_si256(mask, mask);
+        }
+
+        // True when any of `count` (at most eight) tile depths is at or beyond `depth`.
+        LEARN_D3D12_TARGET_AVX2 bool any_tile_not_nearer_avx2(const float* tile_depths, uint32_t count, float depth)
+        {
+            alignas(32) static const int32_t kLaneIndex[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+            __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int32_t>(count)), _mm256_load_si256(reinterpret_cast<const __m256i*>(kLaneIndex)));
+            __m256 depths = _mm256_maskload_ps(tile_depths, valid);
+            __m256 not_nearer = _mm256_cmp_ps(depths, _mm256_set1_ps(depth), _CMP_GE_OQ);
+            return (_mm256_movemask_ps(_mm256_and_ps(not_nearer, _mm256_castsi256_ps(valid)))) != 0;
+        }
+#endif
+    }  // namespace
+
+    OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+        : _tile_count_x((std::max(width, 1u) + kTileWidth - 1) / kTileWidth)
+        , _tile_count_y((std::max(height, 1u) + kTileHeight - 1) / kTileHeight)
+        , _view_projection {}
+    {
+        _width = _tile_count_x * kTileWidth;
+        _height = _tile_count_y * kTileHeight;
+        uint32_t tile_count = _tile_count_x * _tile_count_y;
+        _committed_depth.resize(tile_count);
+        _working_depth.resize(tile_count);
+        _coverage.resize(static_cast<size_t>(tile_count) * kTileHeight);
+    }
+
+    void OcclusionCuller::begin_frame(const float view_projection[16])
+    {
+        std::copy(view_projection, view_projection + 16, _view_projection);
+        std::fill(_committed_depth.begin(), _committed_depth.end(), 1.0f);
+        std::fill(_working_depth.begin(), _working_depth.end(), 0.0f);
+        std::fill(_coverage.begin(), _coverage.end(), 0u);
+        _stats = {};
+    }
+
+    void OcclusionCuller::render_occluders(const OccluderMesh* meshes, uint32_t mesh_count, TaskPool* pool)
+    {
+        auto start = std::chrono::steady_clock::now();
+        _setup_triangles(meshes, mesh_count);
+        bool use_avx2 = _simd_enabled && cpu_supports_avx2();
+        if (pool)
+        {
+            pool->parallel_for(_tile_count_y, 1, [this, use_avx2](uint32_t begin, uint32_t end) { _rasterize_tile_rows(begin, end, use_avx2); });
+        }
+        else
+        {
+            _rasterize_tile_rows(0, _tile_count_y, use_avx2);
+        }
+        _stats.occluder_triangle_count += static_cast<uint32_t>(_triangles.size());
+        _stats.raster_milliseconds += milliseconds_since(start);
+    }
+
+    void OcclusionCuller::test_occludees(const BoundingBox* boxes, uint32_t box_count, uint8_t* visibility, TaskPool* pool)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool use_avx2 = _simd_enabled && cpu_supports_avx2();
+        std::atomic<uint32_t> occluded_count = 0;
+        auto test_range = [&](uint32_t begin, uint32_t end) {
+            uint32_t occluded = 0;
+            for (uint32_t i = begin; i < end; i++)
+            {
+                bool visible = _test_box(boxes[i], use_avx2);
+                visibility[i] = visible ? 1 : 0;
+                occluded += visible ? 0 : 1;
+            }
+            occluded_count.fetch_add(occluded, std::memory_order_relaxed);
+        };
+        if (pool)
+        {
+            pool->parallel_for(box_count, kOccludeeGrainSize, test_range);
+        }
+        else
+        {
+            test_range(0, box_count);
+        }
+        _stats.tested_count += box_count;
+        _stats.occluded_count += occluded_count.load(std::memory_order_relaxed);
+        _stats.test_milliseconds += milliseconds_since(start);
+    }
+
+    void OcclusionCuller::collect_visible(const BoundingBox* boxes, uint32_t box_count, std::pmr::vector<uint32_t>& visible_indices, TaskPool* pool, std::pmr::memory_resource* scratch)
+    {
+        std::pmr::vector<uint8_t> visibility(box_count, scratch ? scratch : std::pmr::get_default_resource());
+        test_occludees(boxes, box_count, visibility.data(), pool);
+        visible_indices.clear();
+        for (uint32_t i = 0; i < box_count; i++)
+        {
+            if (visibility[i])
+            {
+                visible_indices.push_back(i);
+            }
+        }
+    }
+
+    void OcclusionCuller::_setup_triangles(const OccluderMesh* meshes, uint32_t mesh_count)
+    {
+        _triangles.clear();
+        const float width = static_cast<float>(_width);
+        const float height = static_cast<float>(_height);
+        for (uint32_t m = 0; m < mesh_count; m++)
+        {
+            const OccluderMesh& mesh = meshes[m];
+            for (uint32_t i = 0; i + 2 < mesh.index_count; i += 3)
+            {
+                float screen[3][3];
+                bool clipped = false;
+                for (uint32_t v = 0; v < 3; v++)
+                {
+                    ClipVertex clip = transform_point(&mesh.positions[mesh.indices[i + v] * 3], _view_projection);
+                    if (clip.w < kMinClipW || clip.z < 0.0f)
+                    {
+                        clipped = true;
+                        break;
+                    }
+                    float inverse_w = 1.0f / clip.w;
+                    screen[v][0] = (clip.x * inverse_w * 0.5f + 0.5f) * width;
+                    screen[v][1] = (0.5f - clip.y * inverse_w * 0.5f) * height;
+                    screen[v][2] = clip.z * inverse_w;
+                }
+                if (clipped)
+                {
+                    continue;
+                }
+
+                float area = (screen[1][0] - screen[0][0]) * (screen[2][1] - screen[0][1]) - (screen[2][0] - screen[0][0]) * (screen[1][1] - screen[0][1]);
+                if (area == 0.0f)
+                {
+                    continue;
+                }
+                // Occluders are solid from both sides, so flip clockwise triangles.
+                if (area < 0.0f)
+                {
+                    std::swap(screen[1], screen[2]);
+                    area = -area;
+                }
+
+                TriangleSetup triangle;
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    const float* p = screen[e];
+                    const float* q = screen[(e + 1) % 3];
+                    triangle.edge_a[e] = p[1] - q[1];
+                    triangle.edge_b[e] = q[0] - p[0];
+                    triangle.edge_c[e] = p[0] * q[1] - p[1] * q[0];
+                }
+                float dz1 = screen[1][2] - screen[0][2];
+                float dz2 = screen[2][2] - screen[0][2];
+                triangle.z_a = (dz1 * (screen[2][1] - screen[0][1]) - dz2 * (screen[1][1] - screen[0][1])) / area;
+                triangle.z_b = (dz2 * (screen[1][0] - screen[0][0]) - dz1 * (screen[2][0] - screen[0][0])) / area;
+                triangle.z_c = screen[0][2] - triangle.z_a * screen[0][0] - triangle.z_b * screen[0][1];
+                triangle.max_z = std::min(std::max({screen[0][2], screen[1][2], screen[2][2]}), 1.0f);
+
+                float min_x = std::min({screen[0][0], screen[1][0], screen[2][0]});
+                float max_x = std::max({screen[0][0], screen[1][0], screen[2][0]});
+                float min_y = std::min({screen[0][1], screen[1][1], screen[2][1]});
+                float max_y = std::max({screen[0][1], screen[1][1], screen[2][1]});
+                if (max_x < 0.0f || max_y < 0.0f || min_x >= width || min_y >= height)
+                {
+                    continue;
+                }
+                triangle.min_x = static_cast<int32_t>(std::max(std::floor(min_x), 0.0f));
+                triangle.min_y = static_cast<int32_t>(std::max(std::floor(min_y), 0.0f));
+                triangle.max_x = static_cast<int32_t>(std::min(std::ceil(max_x), width - 1.0f));
+                triangle.max_y = static_cast<int32_t>(std::min(std::ceil(max_y), height - 1.0f));
+                _triangles.push_back(triangle);
+            }
+        }
+    }
+
+    void OcclusionCuller::_rasterize_tile_rows(uint32_t first_row, uint32_t last_row, bool use_avx2)
+    {
+        uint32_t coverage[kTileHeight];
+        for (const auto& triangle : _triangles)
+        {
+            uint32_t tile_y_begin = std::max(static_cast<uint32_t>(triangle.min_y) / kTileHeight, first_row);
+            uint32_t tile_y_end = std::min(static_cast<uint32_t>(triangle.max_y) / kTileHeight + 1, last_row);
+            uint32_t tile_x_begin = static_cast<uint32_t>(triangle.min_x) / kTileWidth;
+            uint32_t tile_x_end = static_cast<uint32_t>(triangle.max_x) / kTileWidth + 1;
+            for (uint32_t tile_y = tile_y_begin; tile_y < tile_y_end; tile_y++)
+            {
+                for (uint32_t tile_x = tile_x_begin; tile_x < tile_x_end; tile_x++)
+                {
+                    float x = static_cast<float>(tile_x * kTileWidth);
+                    float y = static_cast<float>(tile_y * kTileHeight);
+                    bool covered;
+#if LEARN_D3D12_X86
+                    if (use_avx2)
+                    {
+                        covered = compute_coverage_avx2(triangle, x, y, coverage);
+                    }
+                    else
+#endif
+                    {
+                        covered = compute_coverage_scalar(triangle, x, y, coverage);
+                    }
+                    if (covered)
+                    {
+                        _update_tile(tile_y * _tile_count_x + tile_x, triangle, tile_x, tile_y, coverage);
+                    }
+                }
+            }
+        }
+    }
+
+    void OcclusionCuller::_update_tile(uint32_t tile_index, const TriangleSetup& triangle, uint32_t tile_x, uint32_t tile_y, const uint32_t* coverage)
+    {
+        // Farthest depth of the triangle inside the part of the tile its bounds overlap.
+        float x0 = static_cast<float>(std::max<int32_t>(tile_x * kTileWidth, triangle.min_x));
+        float x1 = static_cast<float>(std::min<int32_t>((tile_x + 1) * kTileWidth, triangle.max_x + 1));
+        float y0 = static_cast<float>(std::max<int32_t>(tile_y * kTileHeight, triangle.min_y));
+        float y1 = static_cast<float>(std::min<int32_t>((tile_y + 1) * kTileHeight, triangle.max_y + 1));
+        float corner_max = std::max(
+            std::max(triangle.z_a * x0 + triangle.z_b * y0, triangle.z_a * x1 + triangle.z_b * y0),
+            std::max(triangle.z_a * x0 + triangle.z_b * y1, triangle.z_a * x1 + triangle.z_b * y1));
+        float triangle_depth = std::min(corner_max + triangle.z_c, triangle.max_z);
+
+        uint32_t* tile_coverage = &_coverage[static_cast<size_t>(tile_index) * kTileHeight];
+        float& working_depth = _working_depth[tile_index];
+        float& committed_depth = _committed_depth[tile_index];
+        // Merge heuristic from masked occlusion culling: when the triangle is much nearer
+        // than the working layer, that layer would only ever commit a poor depth, so it is
+        // dropped and the triangle starts a new one. Forgetting coverage stays conservative.
+        if (working_depth - triangle_depth > committed_depth - working_depth)
+        {
+            working_depth = 0.0f;
+            std::fill(tile_coverage, tile_coverage + kTileHeight, 0u);
+        }
+        bool full = true;
+        for (uint32_t r = 0; r < kTileHeight; r++)
+        {
+            tile_coverage[r] |= coverage[r];
+            full &= tile_coverage[r] == kFullRow;
+        }
+        working_depth = std::max(working_depth, triangle_depth);
+        if (full)
+        {
+            // Every pixel is now at or nearer than the working depth, and was already at
+            // or nearer than the committed one.
+            committed_depth = std::min(committed_depth, working_depth);
+            working_depth = 0.0f;
+            std::fill(tile_coverage, tile_coverage + kTileHeight, 0u);
+        }
+    }
+
+    bool OcclusionCuller::_test_box(const BoundingBox& box, bool use_avx2) const
+    {
+        float min_x = std::numeric_limits<float>::max();
+        float min_y = std::numeric_limits<float>::max();
+        float max_x = std::numeric_limits<float>::lowest();
+        float max_y = std::numeric_limits<float>::lowest();
+        float min_z = 1.0f;
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            float point[3] = {
+                (corner & 1) ? box.max[0] : box.min[0],
+                (corner & 2) ? box.max[1] : box.min[1],
+                (corner & 4) ? box.max[2] : box.min[2],
+            };
+            ClipVertex clip = transform_point(point, _view_projection);
+            if (clip.w < kMinClipW || clip.z < 0.0f)
+            {
+                // Crosses the near plane; the box is right in front of the camera.
+                return true;
+            }
+            float inverse_w = 1.0f / clip.w;
+            float x = (clip.x * inverse_w * 0.5f + 0.5f) * static_cast<float>(_width);
+            float y = (0.5f - clip.y * inverse_w * 0.5f) * static_cast<float>(_height);
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+            min_z = std::min(min_z, clip.z * inverse_w);
+        }
+        if (max_x < 0.0f || max_y < 0.0f || min_x >= static_cast<float>(_width) || min_y >= static_cast<float>(_height))
+        {
+            // Outside the view; leaving that decision to frustum culling.
+            return true;
+        }
+
+        uint32_t tile_x_begin = static_cast<uint32_t>(std::max(min_x, 0.0f)) / kTileWidth;
+        uint32_t tile_x_end = std::min(static_cast<uint32_t>(std::min(max_x, static_cast<float>(_width - 1))) / kTileWidth + 1, _tile_count_x);
+        uint32_t tile_y_begin = static_cast<uint32_t>(std::max(min_y, 0.0f)) / kTileHeight;
+        uint32_t tile_y_end = std::min(static_cast<uint32_t>(std::min(max_y, static_cast<float>(_height - 1))) / kTileHeight + 1, _tile_count_y);
+        for (uint32_t tile_y = tile_y_begin; tile_y < tile_y_end; tile_y++)
+        {
+            const float* row = &_committed_depth[tile_y * _tile_count_x];
+            for (uint32_t tile_x = tile_x_begin; tile_x < tile_x_end;)
+            {
+#if LEARN_D3D12_X86
+                if (use_avx2)
+                {
+                    uint32_t count = std::min(tile_x_end - tile_x, 8u);
+                    if (any_tile_not_nearer_avx2(row + tile_x, count, min_z))
+                    {
+                        return true;
+                    }
+                    tile_x += count;
+                    continue;
+                }
+#endif
+                if (row[tile_x] >= min_z)
+                {
+                    return true;
+                }
+                tile_x++;
+            }
+        }
+        return false;
+    }
+}  // namespace learn_d3d12
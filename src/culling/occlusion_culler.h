@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    // Occluder geometry in world space: xyz positions and a triangle list.
+    struct OccluderMesh
+    {
+        const float* positions;
+        uint32_t vertex_count;
+        const uint32_t* indices;
+        uint32_t index_count;
+    };
+
+    struct BoundingBox
+    {
+        float min[3];
+        float max[3];
+    };
+
+    struct OcclusionStats
+    {
+        uint32_t occluder_triangle_count = 0;
+        uint32_t tested_count = 0;
+        uint32_t occluded_count = 0;
+        double raster_milliseconds = 0.0;
+        double test_milliseconds = 0.0;
+
+        double get_occluded_percentage() const { return tested_count ? 100.0 * occluded_count / tested_count : 0.0; }
+    };
+
+    // Software occlusion culling against a low resolution masked depth buffer.
+    //
+    // The screen is split into tiles of 32x8 pixels. Each tile stores a coverage bit per
+    // pixel and two depths: the farthest depth of a layer that covers the whole tile, and
+    // the farthest depth of the layer still being filled. When the working layer's mask
+    // becomes full it replaces the committed one if it is nearer. Coverage of a triangle
+    // over a tile is built row by row with AVX2 shifts, one 32-bit lane per pixel row.
+    //
+    // Occluders are rasterized in parallel across bands of tile rows, so no tile is
+    // written by two threads. Occludees are tested by their screen-space rectangle and
+    // nearest depth against the committed tile depths. Depth follows D3D: z/w in [0, 1],
+    // smaller is nearer. Matrices are row major and transform row vectors, like DirectXMath.
+    class OcclusionCuller
+    {
+    public:
+        static const uint32_t kTileWidth = 32;
+        static const uint32_t kTileHeight = 8;
+
+        // The resolution is rounded up to whole tiles.
+        OcclusionCuller(uint32_t width = 320, uint32_t height = 192);
+
+        uint32_t get_width() const { return _width; }
+        uint32_t get_height() const { return _height; }
+
+        // Clears the buffer and sets the camera for the frame.
+        void begin_frame(const float view_projection[16]);
+        // Triangles crossing the near plane are skipped, which only loses occlusion.
+        void render_occluders(const OccluderMesh* meshes, uint32_t mesh_count, TaskPool* pool = nullptr);
+        // Writes 1 for every box that may be visible and 0 for every box that is hidden.
+        void test_occludees(const BoundingBox* boxes, uint32_t box_count, uint8_t* visibility, TaskPool* pool = nullptr);
+        // Convenience wrapper returning the indices of the boxes that may be visible, in order.
+        // The per-box flags are kept in `scratch`, such as a FrameArena, when given; the
+        // indices go wherever `visible_indices` allocates.
+        void collect_visible(const BoundingBox* boxes, uint32_t box_count, std::pmr::vector<uint32_t>& visible_indices, TaskPool* pool = nullptr, std::pmr::memory_resource* scratch = nullptr);
+
+        const OcclusionStats& get_stats() const { return _stats; }
+        // Farthest depth guaranteed for every pixel of the tile, for debugging views.
+        float get_tile_depth(uint32_t tile_x, uint32_t tile_y) const { return _committed_depth[tile_y * _tile_count_x + tile_x]; }
+
+        void set_simd_enabled(bool enabled) { _simd_enabled = enabled; }
+
+    private:
+        struct TriangleSetup
+        {
+            // Edge functions a * x + b * y + c, non-negative inside.
+            float edge_a[3];
+            float edge_b[3];
+            float edge_c[3];
+            // Depth plane z = z_a * x + z_b * y + z_c.
+            float z_a;
+            float z_b;
+            float z_c;
+            float max_z;
+            int32_t min_x;
+            int32_t min_y;
+            int32_t max_x;
+            int32_t max_y;
+        };
+
+        uint32_t _width;
+        uint32_t _height;
+        uint32_t _tile_count_x;
+        uint32_t _tile_count_y;
+        float _view_projection[16];
+        bool _simd_enabled = true;
+        std::vector<float> _committed_depth;
+        std::vector<float> _working_depth;
+        // Eight rows of 32 coverage bits per tile.
+        std::vector<uint32_t> _coverage;
+        std::vector<TriangleSetup> _triangles;
+        OcclusionStats _stats;
+
+        void _setup_triangles(const OccluderMesh* meshes, uint32_t mesh_count);
+        void _rasterize_tile_rows(uint32_t first_row, uint32_t last_row, bool use_avx2);
+        void _update_tile(uint32_t tile_index, const TriangleSetup& triangle, uint32_t tile_x, uint32_t tile_y, const uint32_t* coverage);
+        bool _test_box(const BoundingBox& box, bool use_avx2) const;
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,389 @@
+#include "meshlet_builder.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        constexpr uint8_t kNotInMeshlet = 0xFF;
+        constexpr uint32_t kCullingGrainSize = 1024;
+
+        struct Float3
+        {
+            float x;
+            float y;
+            float z;
+        };
+
+        Float3 load_position(const float* positions, uint32_t index)
+        {
+            return {positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2]};
+        }
+
+        Float3 subtract(const Float3& a, const Float3& b)
+        {
+            return {a.x - b.x, a.y - b.y, a.z - b.z};
+        }
+
+        float dot(const Float3& a, const Float3& b)
+        {
+            return a.x * b.x + a.y * b.y + a.z * b.z;
+        }
+
+        Float3 cross(const Float3& a, const Float3& b)
+        {
+            return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+        }
+
+        float length(const Float3& a)
+        {
+            return std::sqrt(dot(a, a));
+        }
+
+        // Ritter's bounding sphere: start from two far apart points, then grow to
+        // include the rest. Within a few percent of optimal and linear in the points.
+        void compute_bounding_sphere(const float* positions, const uint32_t* vertices, uint32_t count, MeshletBounds& bounds)
+        {
+            Float3 first = load_position(positions, vertices[0]);
+            auto farthest_from = [&](const Float3& origin) {
+                Float3 result = origin;
+                float best = -1.0f;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    Float3 p = load_position(positions, vertices[i]);
+                    Float3 d = subtract(p, origin);
+                    if (dot(d, d) > best)
+                    {
+                        best = dot(d, d);
+                        result = p;
+                    }
+                }
+                return result;
+            };
+            Float3 a = farthest_from(first);
+            Float3 b = farthest_from(a);
+            Float3 center = {(a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f};
+            float radius = length(subtract(b, a)) * 0.5f;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                Float3 p = load_position(positions, vertices[i]);
+                float distance = length(subtract(p, center));
+                if (distance > radius)
+                {
+                    float new_radius = (radius + distance) * 0.5f;
+                    float shift = (new_radius - radius) / distance;
+                    center = {center.x + (p.x - center.x) * shift, center.y + (p.y - center.y) * shift, center.z + (p.z - center.z) * shift};
+                    radius = new_radius;
+                }
+            }
+            bounds.center[0] = center.x;
+            bounds.center[1] = center.y;
+            bounds.center[2] = center.z;
+            bounds.radius = radius;
+        }
+
+        void compute_normal_cone(const float* positions, const MeshletMesh& mesh, const Meshlet& meshlet, MeshletBounds& bounds)
+        {
+            bounds.cone_axis[0] = 0.0f;
+            bounds.cone_axis[1] = 0.0f;
+            bounds.cone_axis[2] = 0.0f;
+            bounds.cone_cutoff = 1.0f;
+
+            std::vector<Float3> normals;
+            normals.reserve(meshlet.triangle_count);
+            Float3 sum = {0.0f, 0.0f, 0.0f};
+            for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+            {
+                const uint8_t* local = &mesh.primitive_indices[(meshlet.triangle_offset + t) * 3];
+                Float3 p0 = load_position(positions, mesh.vertex_indices[meshlet.vertex_offset + local[0]]);
+                Float3 p1 = load_position(positions, mesh.vertex_indices[meshlet.vertex_offset + local[1]]);
+                Float3 p2 = load_position(positions, mesh.vertex_indices[meshlet.vertex_offset + local[2]]);
+                Float3 normal = cross(subtract(p1, p0), subtract(p2, p0));
+                float normal_length = length(normal);
+                if (normal_length == 0.0f)
+                {
+                    continue;
+                }
+                normal = {normal.x / normal_length, normal.y / normal_length, normal.z / normal_length};
+                normals.push_back(normal);
+                sum = {sum.x + normal.x, sum.y + normal.y, sum.z + normal.z};
+            }
+            float sum_length = length(sum);
+            if (normals.empty() || sum_length < 1e-6f)
+            {
+                return;
+            }
+            Float3 axis = {sum.x / sum_length, sum.y / sum_length, sum.z / sum_length};
+            float min_dot = 1.0f;
+            for (const auto& normal : normals)
+            {
+                min_dot = std::min(min_dot, dot(normal, axis));
+            }
+            bounds.cone_axis[0] = axis.x;
+            bounds.cone_axis[1] = axis.y;
+            bounds.cone_axis[2] = axis.z;
+            // A spread of 90 degrees or more faces every direction somewhere.
+            bounds.cone_cutoff = min_dot <= 0.0f ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+        }
+
+        bool is_meshlet_visible(const MeshletBounds& bounds, const ClusterCullingView& view, ClusterCullingStats& stats)
+        {
+            for (const auto& plane : view.planes)
+            {
+                if (plane[0] * bounds.center[0] + plane[1] * bounds.center[1] + plane[2] * bounds.center[2] + plane[3] < -bounds.radius)
+                {
+                    stats.frustum_rejected++;
+                    return false;
+                }
+            }
+            if (bounds.cone_cutoff < 1.0f)
+            {
+                // Every triangle faces away when the view direction to the sphere lies
+                // outside the cone widened by 90 degrees, with margin for the radius.
+                Float3 to_center = {
+                    bounds.center[0] - view.camera_position[0],
+                    bounds.center[1] - view.camera_position[1],
+                    bounds.center[2] - view.camera_position[2],
+                };
+                Float3 axis = {bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]};
+                if (dot(to_center, axis) >= bounds.cone_cutoff * length(to_center) + bounds.radius)
+                {
+                    stats.cone_rejected++;
+                    return false;
+                }
+            }
+            return true;
+        }
+    }  // namespace
+
+    MeshletMesh build_meshlets(const float* positions, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, uint32_t max_vertices, uint32_t max_triangles)
+    {
+        max_vertices = std::clamp(max_vertices, 3u, static_cast<uint32_t>(kNotInMeshlet));
+        max_triangles = std::max(max_triangles, 1u);
+        const uint32_t triangle_count = index_count / 3;
+
+        // Triangles around each vertex.
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for (uint32_t i = 0; i < triangle_count * 3; i++)
+        {
+            adjacency_offsets[indices[i] + 1]++;
+        }
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        }
+        std::vector<uint32_t> adjacency(triangle_count * 3);
+        {
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (uint32_t i = 0; i < triangle_count * 3; i++)
+            {
+                adjacency[fill[indices[i]]++] = i / 3;
+            }
+        }
+
+        MeshletMesh mesh;
+        std::vector<uint8_t> used(triangle_count, 0);
+        std::vector<uint8_t> local_index(vertex_count, kNotInMeshlet);
+        Meshlet current = {0, 0, 0, 0};
+        uint32_t seed_scan = 0;
+
+        auto count_new_vertices = [&](uint32_t triangle) {
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                count += local_index[indices[triangle * 3 + k]] == kNotInMeshlet ? 1 : 0;
+            }
+            return count;
+        };
+        Float3 centroid_sum = {0.0f, 0.0f, 0.0f};
+        auto get_triangle_center = [&](uint32_t triangle) {
+            Float3 a = load_position(positions, indices[triangle * 3]);
+            Float3 b = load_position(positions, indices[triangle * 3 + 1]);
+            Float3 c = load_position(positions, indices[triangle * 3 + 2]);
+            return Float3 {(a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f};
+        };
+        auto finish_meshlet = [&] {
+            if (current.triangle_count == 0)
+            {
+                return;
+            }
+            for (uint32_t i = 0; i < current.vertex_count; i++)
+            {
+                local_index[mesh.vertex_indices[current.vertex_offset + i]] = kNotInMeshlet;
+            }
+            mesh.meshlets.push_back(current);
+            centroid_sum = {0.0f, 0.0f, 0.0f};
+            current = {static_cast<uint32_t>(mesh.vertex_indices.size()), static_cast<uint32_t>(mesh.primitive_indices.size() / 3), 0, 0};
+        };
+
+        for (uint32_t emitted = 0; emitted < triangle_count; emitted++)
+        {
+            uint32_t best = UINT32_MAX;
+            uint32_t best_new_vertices = UINT32_MAX;
+            float best_distance = std::numeric_limits<float>::max();
+            Float3 centroid = {0.0f, 0.0f, 0.0f};
+            if (current.vertex_count > 0)
+            {
+                float scale = 1.0f / static_cast<float>(current.vertex_count);
+                centroid = {centroid_sum.x * scale, centroid_sum.y * scale, centroid_sum.z * scale};
+            }
+            for (uint32_t i = 0; i < current.vertex_count; i++)
+            {
+                uint32_t vertex = mesh.vertex_indices[current.vertex_offset + i];
+                for (uint32_t a = adjacency_offsets[vertex]; a < adjacency_offsets[vertex + 1]; a++)
+                {
+                    uint32_t triangle = adjacency[a];
+                    if (used[triangle])
+                    {
+                        continue;
+                    }
+                    // Fewest new vertices first, then the triangle nearest the meshlet's
+                    // centroid, which grows round patches instead of long strips.
+                    uint32_t new_vertices = count_new_vertices(triangle);
+                    if (new_vertices > best_new_vertices)
+                    {
+                        continue;
+                    }
+                    Float3 offset = subtract(get_triangle_center(triangle), centroid);
+                    float distance = dot(offset, offset);
+                    if (new_vertices < best_new_vertices || distance < best_distance)
+                    {
+                        best = triangle;
+                        best_new_vertices = new_vertices;
+                        best_distance = distance;
+                    }
+                }
+            }
+            if (best == UINT32_MAX)
+            {
+                // Nothing connected is left; continue with the next triangle in index order.
+                while (used[seed_scan])
+                {
+                    seed_scan++;
+                }
+                best = seed_scan;
+                best_new_vertices = count_new_vertices(best);
+            }
+            if (current.vertex_count + best_new_vertices > max_vertices || current.triangle_count + 1 > max_triangles)
+            {
+                finish_meshlet();
+            }
+
+            used[best] = 1;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t vertex = indices[best * 3 + k];
+                if (local_index[vertex] == kNotInMeshlet)
+                {
+                    local_index[vertex] = static_cast<uint8_t>(current.vertex_count++);
+                    mesh.vertex_indices.push_back(vertex);
+                    Float3 position = load_position(positions, vertex);
+                    centroid_sum = {centroid_sum.x + position.x, centroid_sum.y + position.y, centroid_sum.z + position.z};
+                }
+                mesh.primitive_indices.push_back(local_index[vertex]);
+            }
+            current.triangle_count++;
+        }
+        finish_meshlet();
+
+        mesh.bounds.resize(mesh.meshlets.size());
+        for (size_t m = 0; m < mesh.meshlets.size(); m++)
+        {
+            const Meshlet& meshlet = mesh.meshlets[m];
+            compute_bounding_sphere(positions, &mesh.vertex_indices[meshlet.vertex_offset], meshlet.vertex_count, mesh.bounds[m]);
+            compute_normal_cone(positions, mesh, meshlet, mesh.bounds[m]);
+        }
+        return mesh;
+    }
+
+    std::vector<uint32_t> build_meshlet_index_buffer(const MeshletMesh& mesh)
+    {
+        std::vector<uint32_t> indices;
+        indices.reserve(mesh.primitive_indices.size());
+        for (const auto& meshlet : mesh.meshlets)
+        {
+            for (uint32_t i = 0; i < meshlet.triangle_count * 3; i++)
+            {
+                indices.push_back(mesh.vertex_indices[meshlet.vertex_offset + mesh.primitive_indices[meshlet.triangle_offset * 3 + i]]);
+            }
+        }
+        return indices;
+    }
+
+    ClusterCullingView make_cluster_culling_view(const float view_projection[16], const float camera_position[3])
+    {
+        ClusterCullingView view;
+        std::copy(camera_position, camera_position + 3, view.camera_position);
+        // With row vectors, clip component j is the dot product with column j.
+        auto column = [&](uint32_t j, uint32_t i) { return view_projection[i * 4 + j]; };
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            view.planes[0][i] = column(3, i) + column(0, i);
+            view.planes[1][i] = column(3, i) - column(0, i);
+            view.planes[2][i] = column(3, i) + column(1, i);
+            view.planes[3][i] = column(3, i) - column(1, i);
+            view.planes[4][i] = column(2, i);
+            view.planes[5][i] = column(3, i) - column(2, i);
+        }
+        for (auto& plane : view.planes)
+        {
+            float inverse_length = 1.0f / std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            for (auto& value : plane)
+            {
+                value *= inverse_length;
+            }
+        }
+        return view;
+    }
+
+    void cull_meshlets(const MeshletMesh& mesh, const ClusterCullingView& view, std::vector<DrawIndexedArguments>& draws, ClusterCullingStats& stats, TaskPool* pool)
+    {
+        const auto meshlet_count = static_cast<uint32_t>(mesh.meshlets.size());
+        std::vector<uint8_t> visible(meshlet_count);
+        std::vector<ClusterCullingStats> chunk_stats((meshlet_count + kCullingGrainSize - 1) / kCullingGrainSize);
+        auto cull_range = [&](uint32_t begin, uint32_t end) {
+            // Ranges never straddle grain boundaries, so each chunk has its own counters.
+            ClusterCullingStats& local = chunk_stats[begin / kCullingGrainSize];
+            for (uint32_t m = begin; m < end; m++)
+            {
+                visible[m] = is_meshlet_visible(mesh.bounds[m], view, local) ? 1 : 0;
+            }
+        };
+        if (pool)
+        {
+            pool->parallel_for(meshlet_count, kCullingGrainSize, cull_range);
+        }
+        else
+        {
+            for (uint32_t begin = 0; begin < meshlet_count; begin += kCullingGrainSize)
+            {
+                cull_range(begin, std::min(begin + kCullingGrainSize, meshlet_count));
+            }
+        }
+
+        stats.meshlet_count += meshlet_count;
+        for (const auto& local : chunk_stats)
+        {
+            stats.frustum_rejected += local.frustum_rejected;
+            stats.cone_rejected += local.cone_rejected;
+        }
+        for (uint32_t m = 0; m < meshlet_count; m++)
+        {
+            if (!visible[m])
+            {
+                continue;
+            }
+            const Meshlet& meshlet = mesh.meshlets[m];
+            uint32_t start_index = meshlet.triangle_offset * 3;
+            if (!draws.empty() && draws.back().start_index_location + draws.back().index_count_per_instance == start_index)
+            {
+                draws.back().index_count_per_instance += meshlet.triangle_count * 3;
+                continue;
+            }
+            draws.push_back({meshlet.triangle_count * 3, 1, start_index, 0, 0});
+        }
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    // Limits that fit the usual mesh shader output: 64 vertices and 124 primitives keep
+    // the primitive indices of a meshlet within 372 bytes, a multiple of 4.
+    constexpr uint32_t kMeshletMaxVertices = 64;
+    constexpr uint32_t kMeshletMaxTriangles = 124;
+
+    struct Meshlet
+    {
+        uint32_t vertex_offset;
+        uint32_t triangle_offset;
+        uint32_t vertex_count;
+        uint32_t triangle_count;
+    };
+
+    // Bounding sphere plus normal cone. Triangle normals are cross(p1 - p0, p2 - p0), which
+    // faces the camera for triangles D3D12 treats as front facing (clockwise on screen).
+    // `cone_cutoff` is the sine of the cone's half angle; 1 means the cone is too wide
+    // for backface culling.
+    struct MeshletBounds
+    {
+        float center[3];
+        float radius;
+        float cone_axis[3];
+        float cone_cutoff;
+    };
+
+    struct MeshletMesh
+    {
+        std::vector<Meshlet> meshlets;
+        std::vector<MeshletBounds> bounds;
+        // Mesh vertex index of every meshlet vertex, addressed by Meshlet::vertex_offset.
+        std::vector<uint32_t> vertex_indices;
+        // Three meshlet-local vertex indices per triangle, addressed by 3 * triangle_offset.
+        std::vector<uint8_t> primitive_indices;
+    };
+
+    // Same layout as D3D12_DRAW_INDEXED_ARGUMENTS, for ExecuteIndirect.
+    struct DrawIndexedArguments
+    {
+        uint32_t index_count_per_instance;
+        uint32_t instance_count;
+        uint32_t start_index_location;
+        int32_t base_vertex_location;
+        uint32_t start_instance_location;
+    };
+
+    // Camera for cluster culling: world space position and the six frustum planes
+    // (a, b, c, d with normalized a, b, c, inside when a * x + b * y + c * z + d >= 0).
+    struct ClusterCullingView
+    {
+        float camera_position[3];
+        float planes[6][4];
+    };
+
+    struct ClusterCullingStats
+    {
+        uint32_t meshlet_count = 0;
+        uint32_t frustum_rejected = 0;
+        uint32_t cone_rejected = 0;
+
+        double get_rejection_rate() const { return meshlet_count ? static_cast<double>(frustum_rejected + cone_rejected) / meshlet_count : 0.0; }
+    };
+
+    // Splits an indexed triangle list into meshlets. Triangles are gathered greedily:
+    // the next triangle is the unused neighbour of the current meshlet that adds the
+    // fewest new vertices, so meshlets stay compact and triangles inside a meshlet are
+    // ordered by adjacency, which keeps their local vertex indices close together.
+    MeshletMesh build_meshlets(const float* positions, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, uint32_t max_vertices = kMeshletMaxVertices, uint32_t max_triangles = kMeshletMaxTriangles);
+
+    // Index buffer holding the triangles in meshlet order, so that meshlet m covers
+    // indices [3 * triangle_offset, 3 * (triangle_offset + triangle_count)).
+    std::vector<uint32_t> build_meshlet_index_buffer(const MeshletMesh& mesh);
+
+    // Builds the frustum planes from a row-major, row-vector view-projection matrix.
+    ClusterCullingView make_cluster_culling_view(const float view_projection[16], const float camera_position[3]);
+
+    // Tests every meshlet against the frustum and its normal cone, and appends indexed
+    // draws for the survivors, merging meshlets that are adjacent in the index buffer.
+    // This is the fallback for hardware without mesh shaders.
+    void cull_meshlets(const MeshletMesh& mesh, const ClusterCullingView& view, std::vector<DrawIndexedArguments>& draws, ClusterCullingStats& stats, TaskPool* pool = nullptr);
+}  // namespace learn_d3d12
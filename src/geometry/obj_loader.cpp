@@ -0,0 +1,66 @@
+#include "obj_loader.h"
+#include <fstream>
+#include <sstream>
+
+namespace learn_d3d12
+{
+    bool load_obj(const std::string& path, std::vector<float>& positions, std::vector<uint32_t>& indices, std::string& error)
+    {
+        std::ifstream stream(path);
+        if (!stream)
+        {
+            error = "Failed to open " + path + ".";
+            return false;
+        }
+        positions.clear();
+        indices.clear();
+
+        std::string line;
+        std::vector<uint32_t> polygon;
+        uint32_t line_number = 0;
+        while (std::getline(stream, line))
+        {
+            line_number++;
+            std::istringstream tokens(line);
+            std::string keyword;
+            tokens >> keyword;
+            if (keyword == "v")
+            {
+                float x = 0.0f;
+                float y = 0.0f;
+                float z = 0.0f;
+                tokens >> x >> y >> z;
+                positions.insert(positions.end(), {x, y, z});
+            }
+            else if (keyword == "f")
+            {
+                polygon.clear();
+                std::string corner;
+                const auto vertex_count = static_cast<int64_t>(positions.size() / 3);
+                while (tokens >> corner)
+                {
+                    // "v", "v/vt", "v//vn" or "v/vt/vn"; negative indices count from the end.
+                    int64_t index = 0;
+                    std::istringstream(corner.substr(0, corner.find('/'))) >> index;
+                    index = index < 0 ? vertex_count + index : index - 1;
+                    if (index < 0 || index >= vertex_count)
+                    {
+                        error = path + ":" + std::to_string(line_number) + ": vertex index out of range.";
+                        return false;
+                    }
+                    polygon.push_back(static_cast<uint32_t>(index));
+                }
+                for (size_t i = 2; i < polygon.size(); i++)
+                {
+                    indices.insert(indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+                }
+            }
+        }
+        if (indices.empty())
+        {
+            error = path + " has no faces.";
+            return false;
+        }
+        return true;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // Reads the positions and faces of a Wavefront OBJ file. Polygons are fanned into
+    // triangles; texture coordinates, normals, groups and materials are ignored.
+    bool load_obj(const std::string& path, std::vector<float>& positions, std::vector<uint32_t>& indices, std::string& error);
+}  // namespace learn_d3d12
@@ -1,13 +1,57 @@
 #include "log_manager.h"
+#include <spdlog/details/file_helper.h>
+#include <spdlog/sinks/base_sink.h>
+#include <algorithm>
 #include <chrono>
-#include <format>
+#include <ctime>
+#include <functional>
 #ifdef _WIN32
 #include <shlobj_core.h>
 #endif
 
 namespace learn_d3d12
 {
-    void LogManager::initialize()
+    namespace
+    {
+        // File sink that only resolves its path and opens the file for the first message.
+        class DeferredFileSink final : public spdlog::sinks::base_sink<std::mutex>
+        {
+        public:
+            explicit DeferredFileSink(std::function<std::string()> get_path)
+                : _get_path(std::move(get_path))
+            {
+            }
+
+        protected:
+            void sink_it_(const spdlog::details::log_msg& message) override
+            {
+                if (!_opened)
+                {
+                    // Throws, and so retries with the next message, if the file cannot be opened.
+                    _file_helper.open(_get_path());
+                    _opened = true;
+                }
+                spdlog::memory_buf_t formatted;
+                formatter_->format(message, formatted);
+                _file_helper.write(formatted);
+            }
+
+            void flush_() override
+            {
+                if (_opened)
+                {
+                    _file_helper.flush();
+                }
+            }
+
+        private:
+            std::function<std::string()> _get_path;
+            spdlog::details::file_helper _file_helper;
+            bool _opened = false;
+        };
+    }  // namespace
+
+    void LogManager::initialize(bool defer_file_sink)
     {
         _stdout_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
         _stdout_sink->set_level(spdlog::level::info);
@@ -15,8 +59,14 @@ namespace learn_d3d12
         _stdout_sink->set_color(spdlog::level::warn, _stdout_sink->yellow);
         _stdout_sink->set_color(spdlog::level::err, _stdout_sink->red);
 #endif
-        std::string log_path = _get_log_file_path(_log_file_prefix);
-        _engine_file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(log_path);
+        if (defer_file_sink)
+        {
+            _engine_file_sink = std::make_shared<DeferredFileSink>([prefix = _log_file_prefix] { return _get_log_file_path(prefix); });
+        }
+        else
+        {
+            _engine_file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(_get_log_file_path(_log_file_prefix));
+        }
         register_logger("LearnD3d12", true);
     }
 
@@ -50,12 +100,34 @@ namespace learn_d3d12
         _logger_names.push_back(logger_name);
     }
 
+    void LogManager::unregister_logger(const std::string& logger_name)
+    {
+        auto it = std::find(_logger_names.begin(), _logger_names.end(), logger_name);
+        if (it == _logger_names.end())
+        {
+            return;
+        }
+        if (auto logger = spdlog::get(logger_name))
+        {
+            logger->flush();
+        }
+        spdlog::drop(logger_name);
+        _logger_names.erase(it);
+    }
+
     std::string LogManager::_get_log_file_path(const std::string& prefix)
     {
-        const auto now = std::chrono::system_clock::now();
-        const auto* time_zone = std::chrono::current_zone();
-        const auto local_time = time_zone->to_local(now);
-        auto time_string = std::format("{:%Y%m%d_%H%M%S}", floor<std::chrono::seconds>(local_time));
+        // std::chrono::current_zone and std::format need a newer standard library than the
+        // tools are built with on Linux, so the C time functions do the local time.
+        const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm local_time = {};
+#ifdef _WIN32
+        localtime_s(&local_time, &now);
+#else
+        localtime_r(&now, &local_time);
+#endif
+        char time_string[32];
+        std::strftime(time_string, sizeof(time_string), "%Y%m%d_%H%M%S", &local_time);
         std::string log_file_path;
 #ifdef _WIN32
         wchar_t* appdata = nullptr;
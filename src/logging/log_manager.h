@@ -20,9 +20,14 @@ namespace learn_d3d12
         LogManager& operator=(const LogManager&) = delete;
         LogManager& operator=(LogManager&&) = delete;
 
-        void initialize();
+        // With `defer_file_sink` the log file is neither named (which loads the time zone
+        // database) nor opened until the first message reaches it, keeping both off the
+        // startup path.
+        void initialize(bool defer_file_sink = false);
         void finalize();
         void register_logger(const std::string& logger_name, bool save_file = true);
+        // Flushes and drops the logger; messages to it are ignored until it is registered again.
+        void unregister_logger(const std::string& logger_name);
 
         template<typename... TARGS>
         void log(const std::string& logger_name, spdlog::level::level_enum level, fmt::format_string<TARGS...> fmt, TARGS&&... args)
@@ -70,7 +75,7 @@ namespace learn_d3d12
     private:
         LogManager() = default;
         std::shared_ptr<spdlog::sinks::stdout_color_sink_mt> _stdout_sink;
-        std::shared_ptr<spdlog::sinks::basic_file_sink_mt> _engine_file_sink;
+        spdlog::sink_ptr _engine_file_sink;
         std::string _log_file_prefix = "LearnD3d12";
         std::vector<std::string> _logger_names;
 
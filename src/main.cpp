@@ -1,9 +1,16 @@
 #include "application/application.h"
 #include "logging/log_manager.h"
+#include "metrics/metrics_exporter.h"
+#include "metrics/metrics_registry.h"
+#include "profiling/startup_tracer.h"
 #include "renderer/d3d12_renderer.h"
+#include <algorithm>
+#include <chrono>
 #include <cxxopts.hpp>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 #ifdef _WIN32
 #ifndef NOMINMAX
 #define NOMINMAX  // Avoid compile error
@@ -17,22 +24,29 @@ _Use_decl_annotations_ int WINAPI WinMain(HINSTANCE instance, HINSTANCE hPrevIns
 int main(int argc, char** argv)
 #endif
 {
+    // Startup times are measured from here.
+    auto& startup_tracer = learn_d3d12::StartupTracer::get_instance();
+    uint32_t startup_phase = startup_tracer.begin_phase("parse_options");
+
     // Parse arguments
 #ifdef _WIN32
     int argc;
     wchar_t** wargv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    // The converted strings must outlive parsing, so they are kept here rather than in a
+    // buffer local to the loop.
+    std::vector<std::string> arg_storage(argc, std::string(MAX_PATH, '\0'));
     std::vector<char*> vargv;
+    vargv.reserve(argc);
     for (size_t i = 0; i < argc; i++)
     {
-        char arg[MAX_PATH];
         size_t j;
-        int err = wcstombs_s(&j, arg, MAX_PATH, wargv[i], MAX_PATH);
+        int err = wcstombs_s(&j, arg_storage[i].data(), MAX_PATH, wargv[i], MAX_PATH);
         if (err)
         {
             std::cerr << "Failed to convert args to char**, index: " << i << std::endl;
             return err;
         }
-        vargv.push_back(arg);
+        vargv.push_back(arg_storage[i].data());
     }
     char** argv = vargv.data();
     LocalFree(wargv);
@@ -41,7 +55,26 @@ int main(int argc, char** argv)
     // clang-format off
     options.add_options()
         ("p,platform", "Application platform, win32 or glfw.", cxxopts::value<std::string>()->default_value("glfw"))
-        ("v,variant", "Renderer variant.", cxxopts::value<std::string>()->default_value("HelloTriangle"));
+        ("v,variant", "Renderer variant.", cxxopts::value<std::string>()->default_value("HelloTriangle"))
+        ("fast-start", "Open the log file on first use and create the device while the window is created.", cxxopts::value<bool>()->default_value("false"))
+        ("particle-count", "Number of particles simulated by the Particles variant.", cxxopts::value<uint32_t>()->default_value("1000000"))
+        ("particle-simulation", "Where the Particles variant simulates, cpu or gpu.", cxxopts::value<std::string>()->default_value("cpu"))
+        ("skinned-meshes", "Number of meshes skinned on the CPU by the SkinnedMeshes variant.", cxxopts::value<uint32_t>()->default_value("64"))
+        ("stress-instances", "Number of instances streamed by the StressInstancing variant.", cxxopts::value<uint32_t>()->default_value("100000"))
+        ("stress-meshes", "Number of unique meshes the StressInstancing instances share.", cxxopts::value<uint32_t>()->default_value("8"))
+        ("stress-occlusion", "Add walls to the StressInstancing scene and cull the instances they hide on the CPU.", cxxopts::value<bool>()->default_value("false"))
+        ("capture", "Record HelloTriangle frames to this file for LearnD3d12Replay. Disabled when empty.", cxxopts::value<std::string>()->default_value(""))
+        ("capture-frames", "Number of frames to capture.", cxxopts::value<uint32_t>()->default_value("60"))
+        ("residency-budget-mb", "Video memory budget in MiB when the adapter does not report one.", cxxopts::value<uint64_t>()->default_value("2048"))
+        ("dynamic-resolution", "Scale the HelloTriangle render resolution to hold the target GPU frame time.", cxxopts::value<bool>()->default_value("false"))
+        ("target-frame-ms", "GPU frame time dynamic resolution aims for.", cxxopts::value<float>()->default_value("14"))
+        ("resolution-trace", "Record GPU frame times and render scales to this file for LearnD3d12ResolutionSim. Disabled when empty.", cxxopts::value<std::string>()->default_value(""))
+        ("hot-reload", "Recompile edited HelloTriangle shaders in the background and swap them in.", cxxopts::value<bool>()->default_value("false"))
+        ("shader-dir", "Shader sources watched by --hot-reload.", cxxopts::value<std::string>()->default_value(LEARN_D3D12_SHADER_SOURCE_DIR))
+        ("dxc", "DXC executable used by --hot-reload.", cxxopts::value<std::string>()->default_value(LEARN_D3D12_DXC_EXECUTABLE))
+        ("metrics-sink", "Metrics destination: file:<path>, udp:<host>:<port> or unix:<path>. Disabled when empty.", cxxopts::value<std::string>()->default_value(""))
+        ("metrics-format", "Metrics line protocol, statsd or prometheus.", cxxopts::value<std::string>()->default_value("statsd"))
+        ("metrics-interval", "Seconds between metrics snapshots.", cxxopts::value<uint32_t>()->default_value("10"));
     // clang-format on
     cxxopts::ParseResult result;
     try
@@ -53,17 +86,66 @@ int main(int argc, char** argv)
         std::cerr << "LearnD3d12: " << e.what() << std::endl;
         return EXIT_FAILURE;
     }
+    const bool fast_start = result["fast-start"].as<bool>();
+    startup_tracer.end_phase(startup_phase);
 
-    learn_d3d12::LogManager::get_instance().initialize();
-    auto renderer = learn_d3d12::D3d12Renderer::create(result["variant"].as<std::string>(), 1600, 900, "Learn D3D12");
+    startup_phase = startup_tracer.begin_phase("log_initialize");
+    learn_d3d12::LogManager::get_instance().initialize(fast_start);
+    startup_tracer.end_phase(startup_phase);
+    std::unique_ptr<learn_d3d12::MetricsExporter> metrics_exporter;
+    if (auto metrics_sink = result["metrics-sink"].as<std::string>(); !metrics_sink.empty())
+    {
+        learn_d3d12::MetricsExporter::Format metrics_format;
+        if (!learn_d3d12::MetricsExporter::parse_format(result["metrics-format"].as<std::string>(), metrics_format))
+        {
+            std::cerr << "LearnD3d12: unknown metrics format " << result["metrics-format"].as<std::string>() << std::endl;
+            return EXIT_FAILURE;
+        }
+        metrics_exporter = std::make_unique<learn_d3d12::MetricsExporter>(
+            learn_d3d12::MetricsRegistry::get_instance(),
+            metrics_sink,
+            metrics_format,
+            std::chrono::seconds(std::max(result["metrics-interval"].as<uint32_t>(), 1u)));
+        if (!metrics_exporter->start())
+        {
+            std::cerr << "LearnD3d12: cannot open metrics sink " << metrics_sink << std::endl;
+            learn_d3d12::LogManager::get_instance().finalize();
+            return EXIT_FAILURE;
+        }
+    }
+    learn_d3d12::RendererConfig renderer_config;
+    renderer_config.particle_count = result["particle-count"].as<uint32_t>();
+    renderer_config.gpu_particle_simulation = result["particle-simulation"].as<std::string>() == "gpu";
+    renderer_config.skinned_mesh_count = result["skinned-meshes"].as<uint32_t>();
+    renderer_config.stress_instance_count = result["stress-instances"].as<uint32_t>();
+    renderer_config.stress_mesh_count = result["stress-meshes"].as<uint32_t>();
+    renderer_config.stress_occlusion_culling = result["stress-occlusion"].as<bool>();
+    renderer_config.capture_path = result["capture"].as<std::string>();
+    renderer_config.capture_frame_count = result["capture-frames"].as<uint32_t>();
+    renderer_config.residency_budget_mb = result["residency-budget-mb"].as<uint64_t>();
+    renderer_config.dynamic_resolution = result["dynamic-resolution"].as<bool>();
+    renderer_config.target_frame_ms = result["target-frame-ms"].as<float>();
+    renderer_config.resolution_trace_path = result["resolution-trace"].as<std::string>();
+    renderer_config.shader_hot_reload = result["hot-reload"].as<bool>();
+    renderer_config.shader_source_dir = result["shader-dir"].as<std::string>();
+    renderer_config.dxc_executable = result["dxc"].as<std::string>();
+    renderer_config.shader_model = LEARN_D3D12_SHADER_MODEL;
+    startup_phase = startup_tracer.begin_phase("renderer_create");
+    auto renderer = learn_d3d12::D3d12Renderer::create(result["variant"].as<std::string>(), 1600, 900, "Learn D3D12", renderer_config);
+    startup_tracer.end_phase(startup_phase);
     if (!renderer)
     {
         return EXIT_FAILURE;
     }
+    if (fast_start)
+    {
+        renderer->begin_device_creation();
+    }
     auto app = learn_d3d12::Application::create(result["platform"].as<std::string>());
     auto return_code = app->exec(renderer);
     renderer.reset();
     app.reset();
+    metrics_exporter.reset();
     learn_d3d12::LogManager::get_instance().finalize();
     return return_code;
 }
@@ -0,0 +1,129 @@
+#include "allocation_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<uint64_t> allocation_count {0};
+    std::atomic<uint64_t> allocated_bytes {0};
+
+    void* counted_allocate(size_t size)
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* counted_allocate_aligned(size_t size, size_t alignment)
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+#ifdef _WIN32
+        return _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+        // aligned_alloc wants the size to be a multiple of the alignment.
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+
+    void free_aligned(void* pointer)
+    {
+#ifdef _WIN32
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+}  // namespace
+
+namespace learn_d3d12
+{
+    uint64_t get_allocation_count()
+    {
+        return allocation_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_allocated_bytes()
+    {
+        return allocated_bytes.load(std::memory_order_relaxed);
+    }
+}  // namespace learn_d3d12
+
+void* operator new(size_t size)
+{
+    if (void* pointer = counted_allocate(size))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (void* pointer = counted_allocate_aligned(size, static_cast<size_t>(alignment)))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace learn_d3d12
+{
+    // Counts calls to the global operator new. allocation_counter.cpp replaces the global
+    // allocation operators, so only tools that measure allocations link it.
+    uint64_t get_allocation_count();
+    uint64_t get_allocated_bytes();
+}  // namespace learn_d3d12
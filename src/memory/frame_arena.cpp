@@ -0,0 +1,211 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        // Hands out the smallest free thread index, so that a program which keeps creating
+        // short-lived threads keeps reusing the first sub-arenas instead of spilling into
+        // the shared one.
+        class ThreadIndexAllocator
+        {
+        public:
+            static ThreadIndexAllocator& get_instance()
+            {
+                static ThreadIndexAllocator instance;
+                return instance;
+            }
+
+            uint32_t acquire()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_free_indices.empty())
+                {
+                    return _next_index++;
+                }
+                uint32_t index = _free_indices.top();
+                _free_indices.pop();
+                return index;
+            }
+
+            void release(uint32_t index)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _free_indices.push(index);
+            }
+
+        private:
+            std::mutex _mutex;
+            std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> _free_indices;
+            uint32_t _next_index = 0;
+        };
+
+        // Returns the index of its thread to the allocator when the thread exits.
+        class ThreadIndexHandle
+        {
+        public:
+            ThreadIndexHandle()
+                : _allocator(ThreadIndexAllocator::get_instance())
+                , _index(_allocator.acquire())
+            {
+            }
+            ~ThreadIndexHandle() { _allocator.release(_index); }
+            ThreadIndexHandle(const ThreadIndexHandle&) = delete;
+            ThreadIndexHandle& operator=(const ThreadIndexHandle&) = delete;
+
+            uint32_t get() const { return _index; }
+
+        private:
+            // Held by reference so the allocator is constructed first and outlives every handle.
+            ThreadIndexAllocator& _allocator;
+            uint32_t _index;
+        };
+    }  // namespace
+
+    LinearArena::LinearArena(size_t block_size)
+        : _block_size(std::max<size_t>(block_size, 256))
+    {
+    }
+
+    void* LinearArena::allocate(size_t size, size_t alignment)
+    {
+        size = std::max<size_t>(size, 1);
+        while (_block_index < _blocks.size())
+        {
+            Block& block = _blocks[_block_index];
+            auto base = reinterpret_cast<uintptr_t>(block.memory.get());
+            size_t aligned_offset = ((base + _offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+            if (aligned_offset + size <= block.size)
+            {
+                _offset = aligned_offset + size;
+                _used_bytes += size;
+                return block.memory.get() + aligned_offset;
+            }
+            // Blocks after this one are only left over from earlier frames; move on.
+            _block_index++;
+            _offset = 0;
+        }
+
+        // operator new[] only guarantees the default alignment, so leave room to align up.
+        size_t block_size = std::max(_block_size, size + alignment);
+        _blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[block_size]), block_size});
+        _block_index = _blocks.size() - 1;
+        _offset = 0;
+        return allocate(size, alignment);
+    }
+
+    void LinearArena::reset()
+    {
+        if (_blocks.size() > 1)
+        {
+            size_t capacity = get_capacity();
+            _blocks.clear();
+            _blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[capacity]), capacity});
+        }
+        _block_index = 0;
+        _offset = 0;
+        _used_bytes = 0;
+    }
+
+    size_t LinearArena::get_capacity() const
+    {
+        size_t capacity = 0;
+        for (const auto& block : _blocks)
+        {
+            capacity += block.size;
+        }
+        return capacity;
+    }
+
+    void* FrameArena::LockedResource::do_allocate(size_t bytes, size_t alignment)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _upstream->allocate(bytes, alignment);
+    }
+
+    FrameArena::FrameArena(uint32_t frame_count, size_t block_size, uint32_t max_thread_count)
+        : _block_size(block_size)
+        , _slots(std::max(frame_count, 1u))
+    {
+        for (auto& slot : _slots)
+        {
+            slot.thread_arenas.resize(max_thread_count);
+            slot.shared_arena = std::make_unique<ThreadArena>(block_size);
+            slot.shared_resource = std::make_unique<LockedResource>(&slot.shared_arena->resource);
+        }
+    }
+
+    bool FrameArena::begin_frame(uint64_t completed_fence_value)
+    {
+        uint32_t next_slot = (_current_slot + 1) % get_frame_count();
+        Slot& slot = _slots[next_slot];
+        if (slot.fence_value > completed_fence_value)
+        {
+            return false;
+        }
+        for (auto& thread_arena : slot.thread_arenas)
+        {
+            if (thread_arena)
+            {
+                thread_arena->arena.reset();
+            }
+        }
+        slot.shared_arena->arena.reset();
+        _current_slot = next_slot;
+        return true;
+    }
+
+    void FrameArena::end_frame(uint64_t fence_value)
+    {
+        _slots[_current_slot].fence_value = fence_value;
+    }
+
+    uint64_t FrameArena::get_required_fence_value() const
+    {
+        return _slots[(_current_slot + 1) % get_frame_count()].fence_value;
+    }
+
+    std::pmr::memory_resource* FrameArena::get_resource()
+    {
+        Slot& slot = _slots[_current_slot];
+        uint32_t thread_index = _get_thread_index();
+        if (thread_index >= slot.thread_arenas.size())
+        {
+            return slot.shared_resource.get();
+        }
+        // Only this thread ever touches its entry, so creating it needs no lock.
+        auto& thread_arena = slot.thread_arenas[thread_index];
+        if (!thread_arena)
+        {
+            thread_arena = std::make_unique<ThreadArena>(_block_size);
+        }
+        return &thread_arena->resource;
+    }
+
+    FrameArenaStats FrameArena::get_stats() const
+    {
+        FrameArenaStats stats;
+        const Slot& slot = _slots[_current_slot];
+        for (const auto& thread_arena : slot.thread_arenas)
+        {
+            if (thread_arena)
+            {
+                stats.used_bytes += thread_arena->arena.get_used_bytes();
+                stats.capacity += thread_arena->arena.get_capacity();
+                stats.thread_arena_count++;
+            }
+        }
+        stats.used_bytes += slot.shared_arena->arena.get_used_bytes();
+        stats.capacity += slot.shared_arena->arena.get_capacity();
+        return stats;
+    }
+
+    uint32_t FrameArena::_get_thread_index()
+    {
+        thread_local ThreadIndexHandle thread_index;
+        return thread_index.get();
+    }
+}  // namespace learn_d3d12
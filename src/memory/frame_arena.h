@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // Bump allocator over a list of blocks. Deallocation is a no-op; reset() rewinds to the
+    // start and keeps the memory, so once it has grown to a frame's high water mark it no
+    // longer touches the heap. Not thread-safe.
+    class LinearArena
+    {
+    public:
+        explicit LinearArena(size_t block_size = 64 * 1024);
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+        // Frees nothing. If the last frame spilled into several blocks they are merged
+        // into one big enough for all of them.
+        void reset();
+
+        size_t get_used_bytes() const { return _used_bytes; }
+        size_t get_capacity() const;
+        uint32_t get_block_count() const { return static_cast<uint32_t>(_blocks.size()); }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> memory;
+            size_t size;
+        };
+
+        size_t _block_size;
+        std::vector<Block> _blocks;
+        size_t _block_index = 0;
+        size_t _offset = 0;
+        size_t _used_bytes = 0;
+    };
+
+    // std::pmr adapter so standard containers can allocate from a LinearArena.
+    class ArenaResource : public std::pmr::memory_resource
+    {
+    public:
+        explicit ArenaResource(LinearArena& arena)
+            : _arena(arena)
+        {
+        }
+
+    private:
+        LinearArena& _arena;
+
+        void* do_allocate(size_t bytes, size_t alignment) override { return _arena.allocate(bytes, alignment); }
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    struct FrameArenaStats
+    {
+        // Summed over every thread's sub-arena of the current frame slot.
+        size_t used_bytes = 0;
+        size_t capacity = 0;
+        uint32_t thread_arena_count = 0;
+    };
+
+    // Scratch memory for everything that lives no longer than one frame: draw lists,
+    // barrier arrays, command recording scratch. There is one slot per frame in flight and
+    // every thread allocates from its own sub-arena of the current slot, so allocation
+    // never locks. A slot is rewound when it comes round again, once the fence value of the
+    // frame that last used it has completed, because command lists may still point into
+    // it until then.
+    //
+    // begin_frame() and end_frame() belong to the render thread and must not overlap with
+    // allocations on other threads; TaskPool::parallel_for returning is enough.
+    class FrameArena
+    {
+    public:
+        explicit FrameArena(uint32_t frame_count, size_t block_size = 64 * 1024, uint32_t max_thread_count = 64);
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        // Moves to the next slot and rewinds it. Returns false, and stays on the current
+        // slot, if the frame that used the next slot is beyond `completed_fence_value`; the
+        // caller then waits for get_required_fence_value() and tries again.
+        bool begin_frame(uint64_t completed_fence_value);
+        // `fence_value` is signaled once the frame's last command list has executed.
+        void end_frame(uint64_t fence_value);
+        uint64_t get_required_fence_value() const;
+
+        // Sub-arena of the calling thread for the current frame. Indices of exited threads
+        // are reused; threads beyond `max_thread_count` alive at once share one arena behind
+        // a lock.
+        std::pmr::memory_resource* get_resource();
+
+        uint32_t get_frame_count() const { return static_cast<uint32_t>(_slots.size()); }
+        FrameArenaStats get_stats() const;
+
+    private:
+        struct ThreadArena
+        {
+            explicit ThreadArena(size_t block_size)
+                : arena(block_size)
+                , resource(arena)
+            {
+            }
+
+            LinearArena arena;
+            ArenaResource resource;
+        };
+
+        // Serializes the shared arena for threads past the per-thread limit.
+        class LockedResource : public std::pmr::memory_resource
+        {
+        public:
+            explicit LockedResource(std::pmr::memory_resource* upstream)
+                : _upstream(upstream)
+            {
+            }
+
+        private:
+            std::pmr::memory_resource* _upstream;
+            std::mutex _mutex;
+
+            void* do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void*, size_t, size_t) override {}
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+        };
+
+        struct Slot
+        {
+            uint64_t fence_value = 0;
+            // Indexed by thread index; created on a thread's first allocation in the slot.
+            std::vector<std::unique_ptr<ThreadArena>> thread_arenas;
+            std::unique_ptr<ThreadArena> shared_arena;
+            std::unique_ptr<LockedResource> shared_resource;
+        };
+
+        size_t _block_size;
+        std::vector<Slot> _slots;
+        uint32_t _current_slot = 0;
+
+        static uint32_t _get_thread_index();
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,107 @@
+#include "hdr_histogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace learn_d3d12
+{
+    uint64_t HistogramSnapshot::value_at_percentile(double percentile) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        double clamped = std::clamp(percentile, 0.0, 100.0);
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(count))));
+        uint64_t cumulative = 0;
+        for (uint32_t i = 0; i < buckets.size(); i++)
+        {
+            cumulative += buckets[i];
+            if (cumulative >= target)
+            {
+                return std::clamp(HdrHistogram::get_bucket_highest_value(i), min, max);
+            }
+        }
+        return max;
+    }
+
+    HdrHistogram::HdrHistogram()
+        : _sum(0)
+        , _min(UINT64_MAX)
+        , _max(0)
+    {
+        for (auto& bucket : _buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void HdrHistogram::record(uint64_t value)
+    {
+        value = std::min(value, kMaxValue);
+        _buckets[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t current_min = _min.load(std::memory_order_relaxed);
+        while (value < current_min && !_min.compare_exchange_weak(current_min, value, std::memory_order_relaxed))
+        {
+        }
+        uint64_t current_max = _max.load(std::memory_order_relaxed);
+        while (value > current_max && !_max.compare_exchange_weak(current_max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void HdrHistogram::snapshot_and_reset(HistogramSnapshot& snapshot)
+    {
+        // Values recorded while this runs land in either this interval or the next one,
+        // so `sum` can be off by a few samples relative to the bucket total.
+        snapshot.buckets.resize(kBucketCount);
+        snapshot.count = 0;
+        for (uint32_t i = 0; i < kBucketCount; i++)
+        {
+            snapshot.buckets[i] = _buckets[i].exchange(0, std::memory_order_relaxed);
+            snapshot.count += snapshot.buckets[i];
+        }
+        snapshot.sum = _sum.exchange(0, std::memory_order_relaxed);
+        snapshot.min = _min.exchange(UINT64_MAX, std::memory_order_relaxed);
+        snapshot.max = _max.exchange(0, std::memory_order_relaxed);
+        if (snapshot.count == 0)
+        {
+            snapshot.min = 0;
+            snapshot.max = 0;
+        }
+    }
+
+    uint32_t HdrHistogram::get_bucket_index(uint64_t value)
+    {
+        if (value < kSubBucketCount)
+        {
+            return static_cast<uint32_t>(value);
+        }
+        uint32_t shift = static_cast<uint32_t>(std::bit_width(value)) - 1 - kSubBucketBits;
+        uint32_t sub_bucket = static_cast<uint32_t>(value >> shift) - kSubBucketCount;
+        return (shift + 1) * kSubBucketCount + sub_bucket;
+    }
+
+    uint64_t HdrHistogram::get_bucket_lowest_value(uint32_t index)
+    {
+        if (index < kSubBucketCount * 2)
+        {
+            return index;
+        }
+        uint32_t shift = index / kSubBucketCount - 1;
+        uint64_t top = kSubBucketCount + index % kSubBucketCount;
+        return top << shift;
+    }
+
+    uint64_t HdrHistogram::get_bucket_highest_value(uint32_t index)
+    {
+        if (index < kSubBucketCount * 2)
+        {
+            return index;
+        }
+        uint32_t shift = index / kSubBucketCount - 1;
+        return get_bucket_lowest_value(index) + (uint64_t(1) << shift) - 1;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace learn_d3d12
+{
+    struct HistogramSnapshot
+    {
+        std::vector<uint64_t> buckets;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+
+        double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+        // `percentile` is in [0, 100]. Returns the highest value equivalent to the matching bucket.
+        uint64_t value_at_percentile(double percentile) const;
+    };
+
+    // Log-linear histogram in the spirit of HdrHistogram: every power of two is split
+    // into kSubBucketCount linear buckets, which keeps the relative error around 3%.
+    // Recording is a handful of relaxed atomic operations and never allocates, so any
+    // thread may record while the exporter thread takes snapshots.
+    class HdrHistogram
+    {
+    public:
+        static constexpr uint32_t kSubBucketBits = 5;
+        static constexpr uint32_t kSubBucketCount = 1u << kSubBucketBits;
+        // Values are clamped to 2^40 - 1, a little over 18 minutes when recording nanoseconds.
+        static constexpr uint32_t kMaxValueBits = 40;
+        static constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxValueBits) - 1;
+        static constexpr uint32_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+        HdrHistogram();
+        HdrHistogram(const HdrHistogram&) = delete;
+        HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+        void record(uint64_t value);
+        // Copies the current contents into `snapshot` and clears the histogram for the next interval.
+        void snapshot_and_reset(HistogramSnapshot& snapshot);
+
+        static uint32_t get_bucket_index(uint64_t value);
+        static uint64_t get_bucket_lowest_value(uint32_t index);
+        static uint64_t get_bucket_highest_value(uint32_t index);
+
+    private:
+        std::atomic<uint64_t> _buckets[kBucketCount];
+        std::atomic<uint64_t> _sum;
+        std::atomic<uint64_t> _min;
+        std::atomic<uint64_t> _max;
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,389 @@
+// winsock2.h has to be included before anything that pulls in windows.h.
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include "metrics_exporter.h"
+#include "../logging/log_macros.h"
+#include "metrics_registry.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#ifndef _WIN32
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        constexpr const char* kMetricPrefix = "learn_d3d12";
+        // Stay below the common 1500 byte MTU so datagrams are never fragmented.
+        constexpr size_t kMaxDatagramSize = 1400;
+
+        struct Percentile
+        {
+            double percentile;
+            const char* prometheus_quantile;
+            const char* statsd_suffix;
+        };
+
+        constexpr Percentile kPercentiles[] = {
+            {50.0, "0.5", "p50"},
+            {90.0, "0.9", "p90"},
+            {99.0, "0.99", "p99"},
+            {99.9, "0.999", "p999"},
+        };
+
+        void close_socket(intptr_t socket)
+        {
+#ifdef _WIN32
+            closesocket(static_cast<SOCKET>(socket));
+#else
+            close(static_cast<int>(socket));
+#endif
+        }
+    }  // namespace
+
+    MetricsExporter::MetricsExporter(MetricsRegistry& registry, std::string sink, Format format, std::chrono::milliseconds interval)
+        : _registry(registry)
+        , _sink(std::move(sink))
+        , _format(format)
+        , _interval(interval)
+    {
+    }
+
+    MetricsExporter::~MetricsExporter()
+    {
+        stop();
+    }
+
+    bool MetricsExporter::start()
+    {
+        if (_worker.joinable())
+        {
+            return true;
+        }
+        if (!_open_sink())
+        {
+            return false;
+        }
+        _stop_requested = false;
+        _worker = std::thread(&MetricsExporter::_run, this);
+        return true;
+    }
+
+    void MetricsExporter::stop()
+    {
+        if (!_worker.joinable())
+        {
+            return;
+        }
+        {
+            std::lock_guard lock(_mutex);
+            _stop_requested = true;
+        }
+        _wake.notify_one();
+        _worker.join();
+        _close_sink();
+    }
+
+    std::string MetricsExporter::collect()
+    {
+        std::string payload;
+        HistogramSnapshot snapshot;
+        _registry.for_each_histogram([&](const std::string& name, HdrHistogram& histogram) {
+            histogram.snapshot_and_reset(snapshot);
+            if (_format == Format::kPrometheus)
+            {
+                std::string metric = std::string(kMetricPrefix) + "_" + name;
+                payload += "# TYPE " + metric + " summary\n";
+                for (const auto& percentile : kPercentiles)
+                {
+                    payload += metric + "{quantile=\"" + percentile.prometheus_quantile + "\"} " + std::to_string(snapshot.value_at_percentile(percentile.percentile)) + "\n";
+                }
+                payload += metric + "{quantile=\"1\"} " + std::to_string(snapshot.max) + "\n";
+                SummaryTotals& totals = _summary_totals[name];
+                totals.count += snapshot.count;
+                totals.sum += snapshot.sum;
+                payload += metric + "_sum " + std::to_string(totals.sum) + "\n";
+                payload += metric + "_count " + std::to_string(totals.count) + "\n";
+            }
+            else
+            {
+                std::string metric = std::string(kMetricPrefix) + "." + name + ".";
+                for (const auto& percentile : kPercentiles)
+                {
+                    payload += metric + percentile.statsd_suffix + ":" + std::to_string(snapshot.value_at_percentile(percentile.percentile)) + "|g\n";
+                }
+                payload += metric + "max:" + std::to_string(snapshot.max) + "|g\n";
+                payload += metric + "count:" + std::to_string(snapshot.count) + "|g\n";
+            }
+        });
+        _registry.for_each_counter([&](const std::string& name, const MetricCounter& counter) {
+            uint64_t value = counter.get();
+            if (_format == Format::kPrometheus)
+            {
+                std::string metric = std::string(kMetricPrefix) + "_" + name + "_total";
+                payload += "# TYPE " + metric + " counter\n";
+                payload += metric + " " + std::to_string(value) + "\n";
+            }
+            else
+            {
+                // StatsD counters are deltas.
+                uint64_t& last_value = _last_counter_values[name];
+                payload += std::string(kMetricPrefix) + "." + name + ":" + std::to_string(value - last_value) + "|c\n";
+                last_value = value;
+            }
+        });
+        return payload;
+    }
+
+    bool MetricsExporter::parse_format(const std::string& name, Format& format)
+    {
+        if (name == "statsd")
+        {
+            format = Format::kStatsd;
+            return true;
+        }
+        if (name == "prometheus")
+        {
+            format = Format::kPrometheus;
+            return true;
+        }
+        return false;
+    }
+
+    bool MetricsExporter::_open_sink()
+    {
+        size_t colon = _sink.find(':');
+        if (colon == std::string::npos)
+        {
+            LOG_ERROR(LearnD3d12, "Invalid metrics sink \"{0}\", expected file:<path>, udp:<host>:<port> or unix:<path>.", _sink);
+            return false;
+        }
+        std::string scheme = _sink.substr(0, colon);
+        _sink_target = _sink.substr(colon + 1);
+        if (scheme == "file")
+        {
+            _sink_type = SinkType::kFile;
+            return true;
+        }
+        if (scheme == "udp")
+        {
+            size_t port_colon = _sink_target.rfind(':');
+            if (port_colon == std::string::npos)
+            {
+                LOG_ERROR(LearnD3d12, "Metrics sink \"{0}\" is missing a port.", _sink);
+                return false;
+            }
+            std::string host = _sink_target.substr(0, port_colon);
+            std::string port = _sink_target.substr(port_colon + 1);
+#ifdef _WIN32
+            WSADATA wsa_data;
+            if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+            {
+                LOG_ERROR(LearnD3d12, "WSAStartup failed, metrics export disabled.");
+                return false;
+            }
+#endif
+            if (!_open_udp_socket(host, port))
+            {
+#ifdef _WIN32
+                WSACleanup();
+#endif
+                return false;
+            }
+            _sink_type = SinkType::kUdp;
+            return true;
+        }
+        if (scheme == "unix")
+        {
+#ifdef _WIN32
+            LOG_ERROR(LearnD3d12, "Unix datagram sockets are not supported on Windows.");
+            return false;
+#else
+            sockaddr_un address = {};
+            if (_sink_target.size() >= sizeof(address.sun_path))
+            {
+                LOG_ERROR(LearnD3d12, "Metrics socket path \"{0}\" is too long.", _sink_target);
+                return false;
+            }
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, _sink_target.c_str(), _sink_target.size());
+            int handle = socket(AF_UNIX, SOCK_DGRAM, 0);
+            if (handle == -1)
+            {
+                return false;
+            }
+            if (connect(handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+            {
+                LOG_ERROR(LearnD3d12, "Cannot connect to metrics socket \"{0}\".", _sink_target);
+                close(handle);
+                return false;
+            }
+            _socket = handle;
+            _sink_type = SinkType::kUnix;
+            return true;
+#endif
+        }
+        LOG_ERROR(LearnD3d12, "Unknown metrics sink type \"{0}\".", scheme);
+        return false;
+    }
+
+    bool MetricsExporter::_open_udp_socket(const std::string& host, const std::string& port)
+    {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0 || !addresses)
+        {
+            LOG_ERROR(LearnD3d12, "Cannot resolve metrics sink \"{0}\".", _sink);
+            return false;
+        }
+        for (addrinfo* address = addresses; address; address = address->ai_next)
+        {
+            auto socket_handle = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            intptr_t handle = static_cast<intptr_t>(socket_handle);
+            if (handle == -1)
+            {
+                continue;
+            }
+            if (connect(socket_handle, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0)
+            {
+                _socket = handle;
+                break;
+            }
+            close_socket(handle);
+        }
+        freeaddrinfo(addresses);
+        if (_socket == -1)
+        {
+            LOG_ERROR(LearnD3d12, "Cannot connect to metrics sink \"{0}\".", _sink);
+            return false;
+        }
+        return true;
+    }
+
+    void MetricsExporter::_close_sink()
+    {
+        if (_socket != -1)
+        {
+            close_socket(_socket);
+            _socket = -1;
+        }
+#ifdef _WIN32
+        if (_sink_type == SinkType::kUdp)
+        {
+            WSACleanup();
+        }
+#endif
+        _sink_type = SinkType::kNone;
+    }
+
+    void MetricsExporter::_write(const std::string& payload)
+    {
+        if (payload.empty())
+        {
+            return;
+        }
+        switch (_sink_type)
+        {
+            case SinkType::kFile:
+                _write_file(payload);
+                break;
+            case SinkType::kUdp:
+            case SinkType::kUnix:
+                _send_datagrams(payload);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void MetricsExporter::_write_file(const std::string& payload)
+    {
+        if (_format == Format::kStatsd)
+        {
+            std::ofstream file(_sink_target, std::ios::out | std::ios::app);
+            if (!file)
+            {
+                LOG_WARN(LearnD3d12, "Cannot open metrics file \"{0}\".", _sink_target);
+                return;
+            }
+            file << payload;
+            return;
+        }
+        // Prometheus textfile collectors expect the latest snapshot only and may read the file
+        // at any moment, so the snapshot is written next to it and renamed over it.
+        std::filesystem::path target(_sink_target);
+        std::filesystem::path temp_path = target;
+        temp_path += ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::out | std::ios::trunc);
+            if (!file)
+            {
+                LOG_WARN(LearnD3d12, "Cannot open metrics file \"{0}\".", temp_path.string());
+                return;
+            }
+            file << payload;
+            if (!file.flush())
+            {
+                LOG_WARN(LearnD3d12, "Cannot write metrics file \"{0}\".", temp_path.string());
+                return;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temp_path, target, error);
+        if (error)
+        {
+            LOG_WARN(LearnD3d12, "Cannot replace metrics file \"{0}\": {1}", _sink_target, error.message());
+            std::filesystem::remove(temp_path, error);
+        }
+    }
+
+    void MetricsExporter::_send_datagrams(const std::string& payload)
+    {
+        // Split on line boundaries so that no metric is cut in half.
+        size_t begin = 0;
+        while (begin < payload.size())
+        {
+            size_t end = begin;
+            while (end < payload.size())
+            {
+                size_t line_end = payload.find('\n', end);
+                line_end = line_end == std::string::npos ? payload.size() : line_end + 1;
+                if (line_end - begin > kMaxDatagramSize && end != begin)
+                {
+                    break;
+                }
+                end = line_end;
+            }
+#ifdef _WIN32
+            send(static_cast<SOCKET>(_socket), payload.data() + begin, static_cast<int>(end - begin), 0);
+#else
+            send(static_cast<int>(_socket), payload.data() + begin, end - begin, MSG_DONTWAIT);
+#endif
+            begin = end;
+        }
+    }
+
+    void MetricsExporter::_run()
+    {
+        std::unique_lock lock(_mutex);
+        while (!_stop_requested)
+        {
+            _wake.wait_for(lock, _interval, [this] { return _stop_requested; });
+            lock.unlock();
+            _write(collect());
+            lock.lock();
+        }
+    }
+}  // namespace learn_d3d12
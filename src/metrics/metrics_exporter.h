@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace learn_d3d12
+{
+    class MetricsRegistry;
+
+    // Periodically snapshots every histogram in the registry and writes percentiles and
+    // counters to a sink. The sink is described by a string:
+    //   file:<path>           Prometheus format overwrites the file, StatsD appends to it.
+    //   udp:<host>:<port>     One datagram per batch of lines.
+    //   unix:<path>           Unix datagram socket (not available on Windows).
+    class MetricsExporter
+    {
+    public:
+        enum class Format
+        {
+            kStatsd = 0,
+            kPrometheus = 1,
+        };
+
+        MetricsExporter(MetricsRegistry& registry, std::string sink, Format format, std::chrono::milliseconds interval);
+        ~MetricsExporter();
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+        bool start();
+        void stop();
+        // Formats the current interval and resets the histograms. Called by the worker thread.
+        std::string collect();
+
+        static bool parse_format(const std::string& name, Format& format);
+
+    private:
+        enum class SinkType
+        {
+            kNone = 0,
+            kFile = 1,
+            kUdp = 2,
+            kUnix = 3,
+        };
+
+        MetricsRegistry& _registry;
+        std::string _sink;
+        Format _format;
+        std::chrono::milliseconds _interval;
+        SinkType _sink_type = SinkType::kNone;
+        std::string _sink_target;
+        uint16_t _sink_port = 0;
+        intptr_t _socket = -1;
+        std::unordered_map<std::string, uint64_t> _last_counter_values;
+        // Prometheus summaries expect _sum and _count to grow monotonically, while the
+        // histograms are reset every interval.
+        struct SummaryTotals
+        {
+            uint64_t count = 0;
+            uint64_t sum = 0;
+        };
+        std::unordered_map<std::string, SummaryTotals> _summary_totals;
+
+        std::thread _worker;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        bool _stop_requested = false;
+
+        bool _open_sink();
+        bool _open_udp_socket(const std::string& host, const std::string& port);
+        void _close_sink();
+        void _write(const std::string& payload);
+        void _write_file(const std::string& payload);
+        void _send_datagrams(const std::string& payload);
+        void _run();
+    };
+}  // namespace learn_d3d12
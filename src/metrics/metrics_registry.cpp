@@ -0,0 +1,61 @@
+#include "metrics_registry.h"
+
+namespace learn_d3d12
+{
+    MetricsRegistry::MetricsRegistry()
+    {
+        _frame_time = &register_histogram("frame_time_ns");
+        _cpu_record_time = &register_histogram("cpu_record_time_ns");
+        _present_wait_time = &register_histogram("present_wait_ns");
+        _frame_count = &register_counter("frames");
+        _time_to_first_frame = &register_histogram("time_to_first_frame_ns");
+    }
+
+    HdrHistogram& MetricsRegistry::register_histogram(const std::string& name)
+    {
+        std::lock_guard lock(_mutex);
+        for (auto& entry : _histograms)
+        {
+            if (entry.name == name)
+            {
+                return entry.metric;
+            }
+        }
+        auto& entry = _histograms.emplace_back();
+        entry.name = name;
+        return entry.metric;
+    }
+
+    MetricCounter& MetricsRegistry::register_counter(const std::string& name)
+    {
+        std::lock_guard lock(_mutex);
+        for (auto& entry : _counters)
+        {
+            if (entry.name == name)
+            {
+                return entry.metric;
+            }
+        }
+        auto& entry = _counters.emplace_back();
+        entry.name = name;
+        return entry.metric;
+    }
+
+    void MetricsRegistry::for_each_histogram(const std::function<void(const std::string&, HdrHistogram&)>& callback)
+    {
+        std::lock_guard lock(_mutex);
+        for (auto& entry : _histograms)
+        {
+            callback(entry.name, entry.metric);
+        }
+    }
+
+    void MetricsRegistry::for_each_counter(const std::function<void(const std::string&, const MetricCounter&)>& callback)
+    {
+        std::lock_guard lock(_mutex);
+        for (auto& entry : _counters)
+        {
+            callback(entry.name, entry.metric);
+        }
+    }
+}  // namespace learn_d3d12
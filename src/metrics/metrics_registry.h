@@ -0,0 +1,95 @@
+#pragma once
+
+#include "hdr_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace learn_d3d12
+{
+    class MetricCounter
+    {
+    public:
+        void add(uint64_t value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+        uint64_t get() const { return _value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> _value {0};
+    };
+
+    // Owns every histogram and counter. Registration takes a lock and allocates, so it belongs
+    // in initialization code; the returned references stay valid for the life of the process
+    // and recording through them is lock-free.
+    class MetricsRegistry
+    {
+    public:
+        static MetricsRegistry& get_instance()
+        {
+            static MetricsRegistry instance;
+            return instance;
+        }
+        ~MetricsRegistry() = default;
+        MetricsRegistry(const MetricsRegistry&) = delete;
+        MetricsRegistry(MetricsRegistry&&) = delete;
+        MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+        MetricsRegistry& operator=(MetricsRegistry&&) = delete;
+
+        HdrHistogram& register_histogram(const std::string& name);
+        MetricCounter& register_counter(const std::string& name);
+
+        void for_each_histogram(const std::function<void(const std::string&, HdrHistogram&)>& callback);
+        void for_each_counter(const std::function<void(const std::string&, const MetricCounter&)>& callback);
+
+        // Metrics recorded by the frame loops, all durations in nanoseconds.
+        HdrHistogram& get_frame_time() { return *_frame_time; }
+        HdrHistogram& get_cpu_record_time() { return *_cpu_record_time; }
+        HdrHistogram& get_present_wait_time() { return *_present_wait_time; }
+        MetricCounter& get_frame_count() { return *_frame_count; }
+        // Recorded once, from entering main() to the first presented frame.
+        HdrHistogram& get_time_to_first_frame() { return *_time_to_first_frame; }
+
+    private:
+        MetricsRegistry();
+
+        template<typename T>
+        struct Entry
+        {
+            std::string name;
+            T metric;
+        };
+
+        std::mutex _mutex;
+        // std::deque never relocates existing elements on push_back.
+        std::deque<Entry<HdrHistogram>> _histograms;
+        std::deque<Entry<MetricCounter>> _counters;
+        HdrHistogram* _frame_time;
+        HdrHistogram* _cpu_record_time;
+        HdrHistogram* _present_wait_time;
+        MetricCounter* _frame_count;
+        HdrHistogram* _time_to_first_frame;
+    };
+
+    class ScopedMetricTimer
+    {
+    public:
+        explicit ScopedMetricTimer(HdrHistogram& histogram)
+            : _histogram(histogram)
+            , _start(std::chrono::steady_clock::now())
+        {
+        }
+        ~ScopedMetricTimer()
+        {
+            auto elapsed = std::chrono::steady_clock::now() - _start;
+            _histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+        ScopedMetricTimer(const ScopedMetricTimer&) = delete;
+        ScopedMetricTimer& operator=(const ScopedMetricTimer&) = delete;
+
+    private:
+        HdrHistogram& _histogram;
+        std::chrono::steady_clock::time_point _start;
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,151 @@
+#include "gpu_timestamp_tracker.h"
+#include <algorithm>
+
+namespace learn_d3d12
+{
+    GpuTimestampTracker::GpuTimestampTracker(uint32_t max_scopes_per_frame, uint32_t frame_latency)
+        : _max_scopes_per_frame(std::max(max_scopes_per_frame, 1u))
+        , _frames(std::max(frame_latency, 1u))
+    {
+        for (auto& frame : _frames)
+        {
+            frame.scopes.resize(_max_scopes_per_frame);
+        }
+    }
+
+    bool GpuTimestampTracker::begin_frame()
+    {
+        uint32_t slot = _write_cursor;
+        if (_frames[slot].state != SlotState::kIdle)
+        {
+            _dropped_frame_count++;
+            return false;
+        }
+        _frames[slot].state = SlotState::kRecording;
+        _frames[slot].scope_count = 0;
+        _recording_slot = slot;
+        _scope_depth = 0;
+        _skipped_depth = 0;
+        return true;
+    }
+
+    uint32_t GpuTimestampTracker::begin_scope(const char* name)
+    {
+        if (!is_recording())
+        {
+            return kInvalidQuery;
+        }
+        FrameSlot& frame = _frames[_recording_slot];
+        if (_skipped_depth > 0 || frame.scope_count >= _max_scopes_per_frame || _scope_depth >= kMaxScopeDepth)
+        {
+            // The matching end_scope must not close the enclosing scope.
+            _skipped_depth++;
+            return kInvalidQuery;
+        }
+        uint32_t scope_index = frame.scope_count++;
+        frame.scopes[scope_index] = {name, false};
+        _scope_stack[_scope_depth++] = scope_index;
+        return _get_first_query(_recording_slot) + scope_index * 2;
+    }
+
+    uint32_t GpuTimestampTracker::end_scope()
+    {
+        if (!is_recording())
+        {
+            return kInvalidQuery;
+        }
+        if (_skipped_depth > 0)
+        {
+            _skipped_depth--;
+            return kInvalidQuery;
+        }
+        if (_scope_depth == 0)
+        {
+            return kInvalidQuery;
+        }
+        uint32_t scope_index = _scope_stack[--_scope_depth];
+        _frames[_recording_slot].scopes[scope_index].closed = true;
+        return _get_first_query(_recording_slot) + scope_index * 2 + 1;
+    }
+
+    GpuTimestampTracker::QueryRange GpuTimestampTracker::end_frame(uint64_t fence_value)
+    {
+        if (!is_recording())
+        {
+            return {};
+        }
+        uint32_t slot = _recording_slot;
+        FrameSlot& frame = _frames[slot];
+        frame.state = SlotState::kInFlight;
+        frame.fence_value = fence_value;
+        _recording_slot = kInvalidSlot;
+        _scope_depth = 0;
+        _skipped_depth = 0;
+        _write_cursor = (_write_cursor + 1) % get_frame_latency();
+        return {_get_first_query(slot), frame.scope_count * 2};
+    }
+
+    uint32_t GpuTimestampTracker::pop_completed_frame(uint64_t completed_fence_value, QueryRange& range)
+    {
+        uint32_t slot = _read_cursor;
+        FrameSlot& frame = _frames[slot];
+        if (frame.state != SlotState::kInFlight || frame.fence_value > completed_fence_value)
+        {
+            return kInvalidSlot;
+        }
+        range = {_get_first_query(slot), frame.scope_count * 2};
+        _read_cursor = (_read_cursor + 1) % get_frame_latency();
+        return slot;
+    }
+
+    void GpuTimestampTracker::accumulate(uint32_t slot, const uint64_t* timestamps)
+    {
+        FrameSlot& frame = _frames[slot];
+        for (uint32_t i = 0; i < frame.scope_count; i++)
+        {
+            const FrameScope& scope = frame.scopes[i];
+            if (!scope.closed)
+            {
+                continue;
+            }
+            double elapsed_ms = ticks_to_milliseconds(timestamps[i * 2], timestamps[i * 2 + 1]);
+            GpuScopeStats& stats = _find_or_add_stats(scope.name);
+            stats.last_ms = elapsed_ms;
+            stats.min_ms = stats.sample_count ? std::min(stats.min_ms, elapsed_ms) : elapsed_ms;
+            stats.max_ms = stats.sample_count ? std::max(stats.max_ms, elapsed_ms) : elapsed_ms;
+            stats.total_ms += elapsed_ms;
+            stats.sample_count++;
+        }
+        frame.state = SlotState::kIdle;
+        frame.scope_count = 0;
+    }
+
+    double GpuTimestampTracker::ticks_to_milliseconds(uint64_t begin, uint64_t end) const
+    {
+        if (end <= begin || _timestamp_frequency == 0)
+        {
+            return 0.0;
+        }
+        return static_cast<double>(end - begin) * 1000.0 / static_cast<double>(_timestamp_frequency);
+    }
+
+    void GpuTimestampTracker::reset_stats()
+    {
+        _scope_stats.clear();
+        _dropped_frame_count = 0;
+    }
+
+    GpuScopeStats& GpuTimestampTracker::_find_or_add_stats(const char* name)
+    {
+        for (auto& stats : _scope_stats)
+        {
+            if (stats.name == name)
+            {
+                return stats;
+            }
+        }
+        GpuScopeStats& stats = _scope_stats.emplace_back();
+        stats.name = name;
+        return stats;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace learn_d3d12
+{
+    struct GpuScopeStats
+    {
+        std::string name;
+        double last_ms = 0.0;
+        double min_ms = 0.0;
+        double max_ms = 0.0;
+        double total_ms = 0.0;
+        uint64_t sample_count = 0;
+
+        double average_ms() const { return sample_count ? total_ms / static_cast<double>(sample_count) : 0.0; }
+    };
+
+    // Bookkeeping for GPU timestamp queries, independent of the graphics API.
+    // The query heap is split into `frame_latency` equal ranges, one per frame in flight.
+    // Each scope owns two consecutive queries (begin, end) inside its frame's range.
+    // Timestamps are only read back once the fence value of that frame has completed,
+    // so collecting results never waits on the GPU.
+    class GpuTimestampTracker
+    {
+    public:
+        static constexpr uint32_t kInvalidQuery = UINT32_MAX;
+        static constexpr uint32_t kInvalidSlot = UINT32_MAX;
+        static constexpr uint32_t kMaxScopeDepth = 16;
+
+        struct QueryRange
+        {
+            uint32_t first_query = 0;
+            uint32_t query_count = 0;
+        };
+
+        GpuTimestampTracker(uint32_t max_scopes_per_frame, uint32_t frame_latency);
+
+        void set_timestamp_frequency(uint64_t ticks_per_second) { _timestamp_frequency = ticks_per_second; }
+        uint64_t get_timestamp_frequency() const { return _timestamp_frequency; }
+        uint32_t get_query_count() const { return _max_scopes_per_frame * 2 * get_frame_latency(); }
+        uint32_t get_frame_latency() const { return static_cast<uint32_t>(_frames.size()); }
+        uint64_t get_dropped_frame_count() const { return _dropped_frame_count; }
+        bool is_recording() const { return _recording_slot != kInvalidSlot; }
+
+        // Returns false when the next ring slot is still in flight; the frame is then not profiled.
+        bool begin_frame();
+        // Both return the query index to write a timestamp into, or kInvalidQuery.
+        uint32_t begin_scope(const char* name);
+        uint32_t end_scope();
+        // Closes the frame and returns the query range that has to be resolved into the readback buffer.
+        QueryRange end_frame(uint64_t fence_value);
+
+        // Returns the oldest in-flight slot whose fence value has been reached, or kInvalidSlot.
+        uint32_t pop_completed_frame(uint64_t completed_fence_value, QueryRange& range);
+        // `timestamps` holds the resolved values of `range` returned by pop_completed_frame.
+        void accumulate(uint32_t slot, const uint64_t* timestamps);
+
+        double ticks_to_milliseconds(uint64_t begin, uint64_t end) const;
+        const std::vector<GpuScopeStats>& get_scope_stats() const { return _scope_stats; }
+        void reset_stats();
+
+    private:
+        enum class SlotState
+        {
+            kIdle = 0,
+            kRecording = 1,
+            kInFlight = 2,
+        };
+
+        struct FrameScope
+        {
+            const char* name = nullptr;
+            bool closed = false;
+        };
+
+        struct FrameSlot
+        {
+            SlotState state = SlotState::kIdle;
+            uint64_t fence_value = 0;
+            uint32_t scope_count = 0;
+            std::vector<FrameScope> scopes;
+        };
+
+        uint32_t _max_scopes_per_frame;
+        uint64_t _timestamp_frequency = 1;
+        uint64_t _dropped_frame_count = 0;
+        uint32_t _write_cursor = 0;
+        uint32_t _read_cursor = 0;
+        uint32_t _recording_slot = kInvalidSlot;
+        uint32_t _scope_stack[kMaxScopeDepth] = {};
+        uint32_t _scope_depth = 0;
+        // Scopes opened past the limits, innermost first; they get no queries.
+        uint32_t _skipped_depth = 0;
+        std::vector<FrameSlot> _frames;
+        std::vector<GpuScopeStats> _scope_stats;
+
+        uint32_t _get_first_query(uint32_t slot) const { return slot * _max_scopes_per_frame * 2; }
+        GpuScopeStats& _find_or_add_stats(const char* name);
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,185 @@
+#include "startup_tracer.h"
+#include "../logging/log_macros.h"
+#include "../metrics/metrics_registry.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        // Phases the calling thread has begun and not yet ended, innermost last.
+        thread_local std::vector<uint32_t> open_phases;
+    }  // namespace
+
+    StartupTracer::StartupTracer()
+        : _start(std::chrono::steady_clock::now())
+    {
+        _threads.push_back(std::this_thread::get_id());
+    }
+
+    uint32_t StartupTracer::begin_phase(const char* name)
+    {
+        double now = _now_ms();
+        std::lock_guard lock(_mutex);
+        StartupPhase phase;
+        phase.name = name;
+        phase.start_ms = now;
+        phase.thread = _get_thread_index();
+        phase.depth = static_cast<uint32_t>(open_phases.size());
+        auto index = static_cast<uint32_t>(_phases.size());
+        _phases.push_back(std::move(phase));
+        open_phases.push_back(index);
+        return index;
+    }
+
+    void StartupTracer::end_phase(uint32_t phase)
+    {
+        double now = _now_ms();
+        std::lock_guard lock(_mutex);
+        if (phase < _phases.size())
+        {
+            _phases[phase].end_ms = now;
+        }
+        if (!open_phases.empty() && open_phases.back() == phase)
+        {
+            open_phases.pop_back();
+        }
+    }
+
+    void StartupTracer::add_dependency(uint32_t phase)
+    {
+        std::lock_guard lock(_mutex);
+        if (open_phases.empty() || phase >= _phases.size())
+        {
+            return;
+        }
+        _phases[open_phases.front()].dependencies.push_back(phase);
+    }
+
+    bool StartupTracer::mark_first_frame()
+    {
+        if (_first_frame_marked.load(std::memory_order_relaxed) || _first_frame_marked.exchange(true))
+        {
+            return false;
+        }
+        double now = _now_ms();
+        {
+            std::lock_guard lock(_mutex);
+            _first_frame_ms = now;
+        }
+        MetricsRegistry::get_instance().get_time_to_first_frame().record(static_cast<uint64_t>(now * 1e6));
+        return true;
+    }
+
+    std::vector<StartupPhase> StartupTracer::get_phases() const
+    {
+        std::lock_guard lock(_mutex);
+        return _phases;
+    }
+
+    std::vector<uint32_t> StartupTracer::get_critical_path() const
+    {
+        std::lock_guard lock(_mutex);
+        auto is_candidate = [&](uint32_t i, double before_ms) {
+            const auto& phase = _phases[i];
+            return phase.depth == 0 && phase.end_ms >= 0.0 && phase.end_ms <= before_ms;
+        };
+        // The latest finishing depth 0 phase that ended by `before_ms`, on `thread` unless
+        // that is UINT32_MAX.
+        auto latest_before = [&](double before_ms, uint32_t thread, uint32_t limit) {
+            uint32_t best = kInvalidPhase;
+            for (uint32_t i = 0; i < limit; i++)
+            {
+                if (is_candidate(i, before_ms) && (thread == UINT32_MAX || _phases[i].thread == thread) && (best == kInvalidPhase || _phases[i].end_ms > _phases[best].end_ms))
+                {
+                    best = i;
+                }
+            }
+            return best;
+        };
+
+        auto phase_count = static_cast<uint32_t>(_phases.size());
+        double end_ms = _first_frame_marked.load() ? _first_frame_ms : _now_ms();
+        std::vector<uint32_t> path;
+        for (uint32_t current = latest_before(end_ms, UINT32_MAX, phase_count); current != kInvalidPhase;)
+        {
+            path.push_back(current);
+            const auto& phase = _phases[current];
+            // The previous phase on the same thread. The first phase of a worker thread was
+            // started by whatever finished last before it.
+            uint32_t predecessor = latest_before(phase.start_ms, phase.thread, current);
+            if (predecessor == kInvalidPhase && phase.thread != 0)
+            {
+                predecessor = latest_before(phase.start_ms, UINT32_MAX, current);
+            }
+            // A phase that waited on another thread finished no earlier than what it waited for.
+            for (uint32_t dependency : phase.dependencies)
+            {
+                if (dependency < current && _phases[dependency].end_ms >= 0.0 && (predecessor == kInvalidPhase || _phases[dependency].end_ms > _phases[predecessor].end_ms))
+                {
+                    predecessor = dependency;
+                }
+            }
+            current = predecessor;
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    void StartupTracer::write_report(std::ostream& stream) const
+    {
+        std::vector<StartupPhase> phases = get_phases();
+        std::vector<uint32_t> critical_path = get_critical_path();
+        // A phase that waited on another thread only adds the time after that one finished.
+        double critical_ms = 0.0;
+        double previous_end_ms = 0.0;
+        for (uint32_t phase : critical_path)
+        {
+            critical_ms += phases[phase].end_ms - std::max(phases[phase].start_ms, previous_end_ms);
+            previous_end_ms = phases[phase].end_ms;
+        }
+        double end_ms = _first_frame_marked.load() ? _first_frame_ms : _now_ms();
+
+        stream << std::fixed << std::setprecision(3);
+        stream << "Startup: first frame after " << end_ms << " ms, critical path " << critical_ms << " ms in phases, " << end_ms - critical_ms << " ms untraced\n";
+        stream << "     start ms  duration ms  thread  phase (* on the critical path)\n";
+        for (uint32_t i = 0; i < phases.size(); i++)
+        {
+            const auto& phase = phases[i];
+            bool critical = std::find(critical_path.begin(), critical_path.end(), i) != critical_path.end();
+            stream << (critical ? "*" : " ") << std::setw(12) << phase.start_ms << std::setw(13) << (phase.end_ms >= 0.0 ? phase.duration_ms() : 0.0) << std::setw(8) << phase.thread << "  "
+                   << std::string(2 * phase.depth, ' ') << phase.name << (phase.end_ms >= 0.0 ? "" : " (running)") << "\n";
+        }
+    }
+
+    void StartupTracer::log_report() const
+    {
+        std::ostringstream report;
+        write_report(report);
+        std::istringstream lines(report.str());
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            LOG_INFO(LearnD3d12, "{0}", line);
+        }
+    }
+
+    double StartupTracer::_now_ms() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+    uint32_t StartupTracer::_get_thread_index()
+    {
+        auto id = std::this_thread::get_id();
+        auto it = std::find(_threads.begin(), _threads.end(), id);
+        if (it != _threads.end())
+        {
+            return static_cast<uint32_t>(it - _threads.begin());
+        }
+        _threads.push_back(id);
+        return static_cast<uint32_t>(_threads.size() - 1);
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace learn_d3d12
+{
+    struct StartupPhase
+    {
+        std::string name;
+        // Milliseconds since the tracer was created, which main() does first.
+        double start_ms = 0.0;
+        double end_ms = -1.0;
+        // 0 for the thread that created the tracer, then in order of first use.
+        uint32_t thread = 0;
+        // Nesting depth on its thread; only depth 0 phases form the critical path.
+        uint32_t depth = 0;
+        // Phases on other threads this one waited for.
+        std::vector<uint32_t> dependencies;
+
+        double duration_ms() const { return end_ms - start_ms; }
+    };
+
+    // Records wall-clock time of the startup phases up to the first presented frame.
+    // Phases may run on several threads. The critical path is recovered backwards from the
+    // first frame: each phase's predecessor is whichever of the previous phase on its
+    // thread and the phases it waited for (add_dependency) finished last.
+    class StartupTracer
+    {
+    public:
+        static constexpr uint32_t kInvalidPhase = UINT32_MAX;
+
+        static StartupTracer& get_instance()
+        {
+            static StartupTracer instance;
+            return instance;
+        }
+        StartupTracer(const StartupTracer&) = delete;
+        StartupTracer& operator=(const StartupTracer&) = delete;
+
+        // Thread safe. Phases nest per thread and must end in reverse order.
+        uint32_t begin_phase(const char* name);
+        void end_phase(uint32_t phase);
+        // Records that the calling thread's open depth 0 phase waited for `phase`.
+        void add_dependency(uint32_t phase);
+
+        // Returns true only for the first call. Records time to first frame as the
+        // time_to_first_frame_ns metric.
+        bool mark_first_frame();
+        double get_first_frame_ms() const { return _first_frame_ms; }
+
+        std::vector<StartupPhase> get_phases() const;
+        // Indices into get_phases(), in execution order.
+        std::vector<uint32_t> get_critical_path() const;
+        void write_report(std::ostream& stream) const;
+        void log_report() const;
+
+    private:
+        StartupTracer();
+
+        mutable std::mutex _mutex;
+        std::chrono::steady_clock::time_point _start;
+        std::vector<StartupPhase> _phases;
+        std::vector<std::thread::id> _threads;
+        std::atomic<bool> _first_frame_marked {false};
+        double _first_frame_ms = 0.0;
+
+        double _now_ms() const;
+        uint32_t _get_thread_index();
+    };
+
+    class ScopedStartupPhase
+    {
+    public:
+        explicit ScopedStartupPhase(const char* name)
+            : _phase(StartupTracer::get_instance().begin_phase(name))
+        {
+        }
+        ~ScopedStartupPhase() { StartupTracer::get_instance().end_phase(_phase); }
+        ScopedStartupPhase(const ScopedStartupPhase&) = delete;
+        ScopedStartupPhase& operator=(const ScopedStartupPhase&) = delete;
+
+        uint32_t get_phase() const { return _phase; }
+
+    private:
+        uint32_t _phase;
+    };
+}  // namespace learn_d3d12
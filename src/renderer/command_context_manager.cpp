@@ -0,0 +1,185 @@
+#include "command_context_manager.h"
+#include "d3d12_helper.h"
+#include <algorithm>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        D3D12_COMMAND_LIST_TYPE get_command_list_type(QueueType type)
+        {
+            switch (type)
+            {
+                case QueueType::kCompute:
+                    return D3D12_COMMAND_LIST_TYPE_COMPUTE;
+                case QueueType::kCopy:
+                    return D3D12_COMMAND_LIST_TYPE_COPY;
+                default:
+                    return D3D12_COMMAND_LIST_TYPE_DIRECT;
+            }
+        }
+    }  // namespace
+
+    CommandQueue::CommandQueue()
+        : _type(QueueType::kDirect)
+        , _next_fence_value(1)
+        , _completed_fence_value(0)
+    {
+    }
+
+    void CommandQueue::initialize(ID3D12Device* device, QueueType type)
+    {
+        _type = type;
+
+        D3D12_COMMAND_QUEUE_DESC queue_desc = {};
+        queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+        queue_desc.Type = get_command_list_type(type);
+        throw_if_failed(device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&_command_queue)));
+
+        throw_if_failed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_fence)));
+        _next_fence_value = 1;
+        _completed_fence_value = 0;
+    }
+
+    void CommandQueue::shutdown()
+    {
+        if (!_command_queue)
+        {
+            return;
+        }
+        flush();
+        _command_list_pool.clear();
+        _allocator_pool.clear();
+        _fence.Reset();
+        _command_queue.Reset();
+    }
+
+    uint64_t CommandQueue::get_completed_fence_value()
+    {
+        // Several threads may poll at once; never let the cached value go backwards.
+        uint64_t completed = _fence->GetCompletedValue();
+        uint64_t cached = _completed_fence_value.load(std::memory_order_relaxed);
+        while (cached < completed && !_completed_fence_value.compare_exchange_weak(cached, completed, std::memory_order_relaxed))
+        {
+        }
+        return std::max(cached, completed);
+    }
+
+    bool CommandQueue::is_fence_complete(uint64_t fence_value)
+    {
+        // Polling the fence is a call into the driver, so try the cached value first.
+        if (fence_value <= _completed_fence_value.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+        return fence_value <= get_completed_fence_value();
+    }
+
+    void CommandQueue::wait_for_fence(uint64_t fence_value)
+    {
+        if (is_fence_complete(fence_value))
+        {
+            return;
+        }
+        // Without an event handle SetEventOnCompletion blocks until the value is reached,
+        // which lets several threads wait without sharing an event.
+        throw_if_failed(_fence->SetEventOnCompletion(fence_value, nullptr));
+        get_completed_fence_value();
+    }
+
+    void CommandQueue::wait_for_queue(const CommandQueue& other, uint64_t fence_value)
+    {
+        throw_if_failed(_command_queue->Wait(other._fence.Get(), fence_value));
+    }
+
+    uint64_t CommandQueue::execute(ID3D12CommandList* const* command_lists, uint32_t command_list_count)
+    {
+        std::lock_guard<std::mutex> lock(_submit_mutex);
+        _command_queue->ExecuteCommandLists(command_list_count, command_lists);
+        uint64_t fence_value = _next_fence_value.load(std::memory_order_relaxed);
+        throw_if_failed(_command_queue->Signal(_fence.Get(), fence_value));
+        _next_fence_value.store(fence_value + 1, std::memory_order_release);
+        return fence_value;
+    }
+
+    void CommandQueue::flush()
+    {
+        uint64_t fence_value;
+        {
+            std::lock_guard<std::mutex> lock(_submit_mutex);
+            fence_value = _next_fence_value.load(std::memory_order_relaxed);
+            throw_if_failed(_command_queue->Signal(_fence.Get(), fence_value));
+            _next_fence_value.store(fence_value + 1, std::memory_order_release);
+        }
+        wait_for_fence(fence_value);
+    }
+
+    void CommandContextManager::initialize(ID3D12Device* device)
+    {
+        _device = device;
+        for (uint32_t i = 0; i < kQueueTypeCount; i++)
+        {
+            _queues[i].initialize(device, static_cast<QueueType>(i));
+        }
+    }
+
+    void CommandContextManager::shutdown()
+    {
+        for (auto& queue : _queues)
+        {
+            queue.shutdown();
+        }
+        _device.Reset();
+    }
+
+    CommandContext CommandContextManager::begin(QueueType type, ID3D12PipelineState* initial_state)
+    {
+        CommandQueue& queue = get_queue(type);
+        const D3D12_COMMAND_LIST_TYPE list_type = get_command_list_type(type);
+
+        CommandContext context;
+        context.type = type;
+        // Command list allocators can only be reset when the associated command lists have
+        // finished execution on the GPU, which the pool guarantees.
+        if (queue._allocator_pool.try_acquire(queue.get_completed_fence_value(), context.command_allocator))
+        {
+            throw_if_failed(context.command_allocator->Reset());
+        }
+        else
+        {
+            throw_if_failed(_device->CreateCommandAllocator(list_type, IID_PPV_ARGS(&context.command_allocator)));
+        }
+
+        // Command lists are created in the recording state, and a recycled one is reset
+        // into it.
+        if (queue._command_list_pool.try_acquire(0, context.command_list))
+        {
+            throw_if_failed(context.command_list->Reset(context.command_allocator.Get(), initial_state));
+        }
+        else
+        {
+            throw_if_failed(_device->CreateCommandList(0, list_type, context.command_allocator.Get(), initial_state, IID_PPV_ARGS(&context.command_list)));
+        }
+        return context;
+    }
+
+    uint64_t CommandContextManager::submit(CommandContext& context)
+    {
+        CommandQueue& queue = get_queue(context.type);
+        throw_if_failed(context.command_list->Close());
+        ID3D12CommandList* command_lists[] = {context.command_list.Get()};
+        uint64_t fence_value = queue.execute(command_lists, _countof(command_lists));
+
+        queue._allocator_pool.release(fence_value, std::move(context.command_allocator));
+        queue._command_list_pool.release(0, std::move(context.command_list));
+        return fence_value;
+    }
+
+    void CommandContextManager::wait_idle()
+    {
+        for (auto& queue : _queues)
+        {
+            queue.flush();
+        }
+    }
+}  // namespace learn_d3d12
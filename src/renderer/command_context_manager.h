@@ -0,0 +1,103 @@
+#pragma once
+
+#include "fence_recycled_pool.h"
+#include <atomic>
+#include <mutex>
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <directx/d3d12.h>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace learn_d3d12
+{
+    enum class QueueType : uint32_t
+    {
+        kDirect = 0,
+        kCompute = 1,
+        kCopy = 2,
+    };
+
+    constexpr uint32_t kQueueTypeCount = 3;
+
+    // An open command list recording into an allocator taken from its queue's pool.
+    struct CommandContext
+    {
+        QueueType type = QueueType::kDirect;
+        ComPtr<ID3D12GraphicsCommandList> command_list;
+        ComPtr<ID3D12CommandAllocator> command_allocator;
+    };
+
+    // One hardware queue with its own fence. Every submission signals the next fence value,
+    // starting at 1, so a fence value names the point on this queue's timeline where the
+    // submission has finished.
+    class CommandQueue
+    {
+    public:
+        CommandQueue();
+        CommandQueue(const CommandQueue&) = delete;
+        CommandQueue& operator=(const CommandQueue&) = delete;
+
+        void initialize(ID3D12Device* device, QueueType type);
+        void shutdown();
+
+        ID3D12CommandQueue* get_command_queue() const { return _command_queue.Get(); }
+        ID3D12Fence* get_fence() const { return _fence.Get(); }
+        QueueType get_type() const { return _type; }
+        // The value the next submission will signal.
+        uint64_t get_next_fence_value() const { return _next_fence_value.load(std::memory_order_acquire); }
+        uint64_t get_completed_fence_value();
+        bool is_fence_complete(uint64_t fence_value);
+        // Blocks the calling thread until `fence_value` has completed.
+        void wait_for_fence(uint64_t fence_value);
+        // Makes later submissions to this queue wait on the GPU until `other` has reached
+        // `fence_value`, without blocking the CPU.
+        void wait_for_queue(const CommandQueue& other, uint64_t fence_value);
+        // Executes the closed command lists and returns the fence value signaled after them.
+        uint64_t execute(ID3D12CommandList* const* command_lists, uint32_t command_list_count);
+        // Signals and waits for everything submitted so far.
+        void flush();
+
+    private:
+        friend class CommandContextManager;
+
+        QueueType _type;
+        ComPtr<ID3D12CommandQueue> _command_queue;
+        ComPtr<ID3D12Fence> _fence;
+        // Keeps ExecuteCommandLists and Signal of one submission together.
+        std::mutex _submit_mutex;
+        std::atomic<uint64_t> _next_fence_value;
+        std::atomic<uint64_t> _completed_fence_value;
+        FenceRecycledPool<ComPtr<ID3D12CommandAllocator>> _allocator_pool;
+        // Command lists can be reset as soon as they were executed, so they are released
+        // with fence value 0.
+        FenceRecycledPool<ComPtr<ID3D12GraphicsCommandList>> _command_list_pool;
+    };
+
+    // Owns a DIRECT, a COMPUTE and a COPY queue. Allocators are pooled per queue and
+    // recycled once the fence of the submission that used them has completed, so uploads
+    // and async compute can be recorded and submitted alongside graphics work. Order work
+    // across queues with CommandQueue::wait_for_queue.
+    class CommandContextManager
+    {
+    public:
+        void initialize(ID3D12Device* device);
+        // Waits for all queues and releases every pooled object.
+        void shutdown();
+
+        CommandQueue& get_queue(QueueType type) { return _queues[static_cast<uint32_t>(type)]; }
+
+        // Opens a command list on a recycled or new allocator of the queue's type.
+        CommandContext begin(QueueType type, ID3D12PipelineState* initial_state = nullptr);
+        // Closes and executes the context on its queue, returns the pooled objects and
+        // returns the fence value that retires them.
+        uint64_t submit(CommandContext& context);
+        void wait_idle();
+
+    private:
+        ComPtr<ID3D12Device> _device;
+        CommandQueue _queues[kQueueTypeCount];
+    };
+}  // namespace learn_d3d12
@@ -1,5 +1,10 @@
 #include "d3d12_renderer.h"
+#include "../profiling/startup_tracer.h"
+#include "d3d12_helper.h"
 #include "hello_triangle.h"
+#include "particles.h"
+#include "skinned_meshes.h"
+#include "stress_instancing.h"
 #include <wrl.h>
 
 using Microsoft::WRL::ComPtr;
@@ -15,16 +20,93 @@ namespace learn_d3d12
         aspect_ratio = static_cast<float>(width) / static_cast<float>(height);
     }
 
-    std::shared_ptr<D3d12Renderer> D3d12Renderer::create(std::string app_type, uint32_t width, uint32_t height, std::string name)
+    std::shared_ptr<D3d12Renderer> D3d12Renderer::create(std::string app_type, uint32_t width, uint32_t height, std::string name, const RendererConfig& config)
     {
         std::shared_ptr<D3d12Renderer> renderer = nullptr;
         if (app_type == "HelloTriangle")
         {
-            renderer = std::make_shared<HelloTriangle>(width, height, name);
+            renderer = std::make_shared<HelloTriangle>(width, height, name, config);
+        }
+        else if (app_type == "Particles")
+        {
+            renderer = std::make_shared<Particles>(width, height, name, config);
+        }
+        else if (app_type == "SkinnedMeshes")
+        {
+            renderer = std::make_shared<SkinnedMeshes>(width, height, name, config);
+        }
+        else if (app_type == "StressInstancing")
+        {
+            renderer = std::make_shared<StressInstancing>(width, height, name, config);
         }
         return renderer;
     }
 
+    void D3d12Renderer::begin_device_creation()
+    {
+        if (!pending_device.valid())
+        {
+            pending_device = std::async(std::launch::async, create_device, use_warp_device);
+        }
+    }
+
+    D3d12Renderer::DeviceObjects D3d12Renderer::acquire_device()
+    {
+        if (!pending_device.valid())
+        {
+            return create_device(use_warp_device);
+        }
+        DeviceObjects device_objects = pending_device.get();
+        StartupTracer::get_instance().add_dependency(device_objects.startup_phase);
+        return device_objects;
+    }
+
+    D3d12Renderer::DeviceObjects D3d12Renderer::create_device(bool use_warp)
+    {
+        ScopedStartupPhase phase("device_create");
+        DeviceObjects device_objects;
+        device_objects.startup_phase = phase.get_phase();
+
+        uint32_t dxgi_factory_flags = 0;
+#if defined(_DEBUG)
+        // Enable the debug layer (requires the Graphics Tools "optional feature").
+        // NOTE: Enabling the debug layer after device creation will invalidate the active device.
+        {
+            ComPtr<ID3D12Debug> debug_controller;
+            if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debug_controller))))
+            {
+                debug_controller->EnableDebugLayer();
+
+                // Enable additional debug layers.
+                dxgi_factory_flags |= DXGI_CREATE_FACTORY_DEBUG;
+            }
+        }
+#endif
+        throw_if_failed(CreateDXGIFactory2(dxgi_factory_flags, IID_PPV_ARGS(&device_objects.factory)));
+
+        if (use_warp)
+        {
+            ComPtr<IDXGIAdapter> warp_adapter;
+            throw_if_failed(device_objects.factory->EnumWarpAdapter(IID_PPV_ARGS(&warp_adapter)));
+
+            throw_if_failed(D3D12CreateDevice(
+                warp_adapter.Get(),
+                D3D_FEATURE_LEVEL_11_0,
+                IID_PPV_ARGS(&device_objects.device)));
+        }
+        else
+        {
+            ComPtr<IDXGIAdapter1> hardware_adapter;
+            get_hardware_adapter(device_objects.factory.Get(), &hardware_adapter);
+
+            throw_if_failed(D3D12CreateDevice(
+                hardware_adapter.Get(),
+                D3D_FEATURE_LEVEL_11_0,
+                IID_PPV_ARGS(&device_objects.device)));
+        }
+        return device_objects;
+    }
+
     void D3d12Renderer::get_hardware_adapter(IDXGIFactory1* factory, IDXGIAdapter1** adapter, bool request_high_performance_adapter)
     {
         *adapter = nullptr;
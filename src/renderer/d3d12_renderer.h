@@ -1,6 +1,8 @@
 #pragma once
 
+#include "render_command_queue.h"
 #include <cstdint>
+#include <future>
 #include <memory>
 #include <string>
 #ifndef NOMINMAX
@@ -9,9 +11,38 @@
 #include <directx/d3d12.h>
 #include <dxgi1_6.h>
 #include <windows.h>
+#include <wrl.h>
 
 namespace learn_d3d12
 {
+    // Settings for the renderer variants that take command line parameters.
+    struct RendererConfig
+    {
+        uint32_t particle_count = 1000000;
+        bool gpu_particle_simulation = false;
+        uint32_t skinned_mesh_count = 64;
+        uint32_t stress_instance_count = 100000;
+        uint32_t stress_mesh_count = 8;
+        // Add walls to the StressInstancing scene and only draw the instances they do not hide.
+        bool stress_occlusion_culling = false;
+        // Frame capture for LearnD3d12Replay; disabled when the path is empty.
+        std::string capture_path;
+        uint32_t capture_frame_count = 60;
+        // Video memory budget when the adapter cannot report one.
+        uint64_t residency_budget_mb = 2048;
+        // Render at a scale chosen each frame to hold the GPU frame time at the target.
+        bool dynamic_resolution = false;
+        float target_frame_ms = 14.0f;
+        // Measured GPU frame times and scales for LearnD3d12ResolutionSim; disabled when empty.
+        std::string resolution_trace_path;
+        // Recompile edited shaders under shader_source_dir in the background and swap in
+        // the rebuilt pipeline states.
+        bool shader_hot_reload = false;
+        std::string shader_source_dir;
+        std::string dxc_executable;
+        std::string shader_model = "6_0";
+    };
+
     class D3d12Renderer
     {
     public:
@@ -26,16 +57,36 @@ namespace learn_d3d12
         uint32_t get_width() const { return width; }
         uint32_t get_height() const { return height; }
         const char* get_name() const { return name.c_str(); }
+        // Work other threads want done on the render thread; drained before on_update.
+        RenderCommandQueue& get_render_commands() { return render_commands; }
 
-        static std::shared_ptr<D3d12Renderer> create(std::string app_type, uint32_t width, uint32_t height, std::string name);
+        // Starts creating the DXGI factory and device on another thread, so that it overlaps
+        // with window creation. Optional: otherwise on_init creates them itself.
+        void begin_device_creation();
+
+        static std::shared_ptr<D3d12Renderer> create(std::string app_type, uint32_t width, uint32_t height, std::string name, const RendererConfig& config = {});
 
     protected:
+        struct DeviceObjects
+        {
+            Microsoft::WRL::ComPtr<IDXGIFactory4> factory;
+            Microsoft::WRL::ComPtr<ID3D12Device> device;
+            // StartupTracer phase that created them.
+            uint32_t startup_phase;
+        };
+
         uint32_t width;
         uint32_t height;
         float aspect_ratio;
         std::string name;
         bool use_warp_device;
+        RenderCommandQueue render_commands;
+        std::future<DeviceObjects> pending_device;
 
+        // Waits for begin_device_creation(), or creates the factory and device on the
+        // calling thread if it was not called.
+        DeviceObjects acquire_device();
+        static DeviceObjects create_device(bool use_warp);
         static void get_hardware_adapter(IDXGIFactory1* factory, IDXGIAdapter1** adapter, bool request_high_performance_adapter = true);
     };
 }  // namespace learn_d3d12
@@ -0,0 +1,43 @@
+#include "d3d12_residency_backend.h"
+#include "d3d12_helper.h"
+
+namespace learn_d3d12
+{
+    D3d12ResidencyBackend::D3d12ResidencyBackend(ID3D12Device* device, IDXGIAdapter3* adapter, CommandContextManager& command_contexts)
+        : _device(device)
+        , _adapter(adapter)
+        , _command_contexts(command_contexts)
+    {
+    }
+
+    bool D3d12ResidencyBackend::query_video_memory(VideoMemoryInfo& info)
+    {
+        DXGI_QUERY_VIDEO_MEMORY_INFO memory_info = {};
+        if (!_adapter || FAILED(_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memory_info)))
+        {
+            return false;
+        }
+        info = {memory_info.Budget, memory_info.CurrentUsage};
+        return true;
+    }
+
+    void D3d12ResidencyBackend::make_resident(void* const* handles, uint32_t count)
+    {
+        throw_if_failed(_device->MakeResident(count, reinterpret_cast<ID3D12Pageable* const*>(handles)));
+    }
+
+    void D3d12ResidencyBackend::evict(void* const* handles, uint32_t count)
+    {
+        throw_if_failed(_device->Evict(count, reinterpret_cast<ID3D12Pageable* const*>(handles)));
+    }
+
+    uint64_t D3d12ResidencyBackend::get_completed_fence_value(uint32_t queue)
+    {
+        return _command_contexts.get_queue(static_cast<QueueType>(queue)).get_completed_fence_value();
+    }
+
+    void D3d12ResidencyBackend::wait_for_fence(uint32_t queue, uint64_t fence_value)
+    {
+        _command_contexts.get_queue(static_cast<QueueType>(queue)).wait_for_fence(fence_value);
+    }
+}  // namespace learn_d3d12
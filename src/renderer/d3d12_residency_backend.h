@@ -0,0 +1,36 @@
+#pragma once
+
+#include "command_context_manager.h"
+#include "residency_manager.h"
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <directx/d3d12.h>
+#include <dxgi1_6.h>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace learn_d3d12
+{
+    // ResidencyBackend over a D3D12 device: handles are ID3D12Pageable pointers, the
+    // budget is the local segment of IDXGIAdapter3::QueryVideoMemoryInfo and the queues
+    // are those of a CommandContextManager, indexed by QueueType.
+    class D3d12ResidencyBackend : public ResidencyBackend
+    {
+    public:
+        // `adapter` may be null, in which case the manager falls back to its configured budget.
+        D3d12ResidencyBackend(ID3D12Device* device, IDXGIAdapter3* adapter, CommandContextManager& command_contexts);
+
+        bool query_video_memory(VideoMemoryInfo& info) override;
+        void make_resident(void* const* handles, uint32_t count) override;
+        void evict(void* const* handles, uint32_t count) override;
+        uint64_t get_completed_fence_value(uint32_t queue) override;
+        void wait_for_fence(uint32_t queue, uint64_t fence_value) override;
+
+    private:
+        ComPtr<ID3D12Device> _device;
+        ComPtr<IDXGIAdapter3> _adapter;
+        CommandContextManager& _command_contexts;
+    };
+}  // namespace learn_d3d12
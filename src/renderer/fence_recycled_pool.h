@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace learn_d3d12
+{
+    // Keeps objects the GPU may still be using, such as command allocators, until the fence
+    // value signaled after their last submission has completed. A queue's fence only grows,
+    // so retired objects are kept in release order and only the oldest one is checked.
+    // Releasing out of order is safe, it only delays reuse. Thread-safe.
+    template<typename Object>
+    class FenceRecycledPool
+    {
+    public:
+        // Takes the oldest retired object if its fence value is not beyond
+        // `completed_fence_value`. Returns false if the caller has to create a new one.
+        bool try_acquire(uint64_t completed_fence_value, Object& object)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_retired.empty() || _retired.front().fence_value > completed_fence_value)
+            {
+                return false;
+            }
+            object = std::move(_retired.front().object);
+            _retired.pop_front();
+            return true;
+        }
+
+        // Hands an object back; it is reused once `fence_value` has completed.
+        void release(uint64_t fence_value, Object object)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _retired.push_back({fence_value, std::move(object)});
+        }
+
+        size_t get_retired_count() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _retired.size();
+        }
+
+        // Drops every object. Only call once the GPU is idle.
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _retired.clear();
+        }
+
+    private:
+        struct RetiredObject
+        {
+            uint64_t fence_value;
+            Object object;
+        };
+
+        mutable std::mutex _mutex;
+        std::deque<RetiredObject> _retired;
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,269 @@
+#include "file_watcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
+namespace learn_d3d12
+{
+#ifdef _WIN32
+    namespace
+    {
+        constexpr DWORD kNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE;
+        // 64 KiB is the most ReadDirectoryChangesW accepts for network drives.
+        constexpr DWORD kBufferSize = 64 * 1024;
+    }  // namespace
+
+    struct FileWatcher::State
+    {
+        HANDLE directory = INVALID_HANDLE_VALUE;
+        OVERLAPPED overlapped = {};
+        // ReadDirectoryChangesW needs a DWORD aligned buffer.
+        std::vector<DWORD> buffer = std::vector<DWORD>(kBufferSize / sizeof(DWORD));
+        bool read_pending = false;
+
+        bool begin_read()
+        {
+            ResetEvent(overlapped.hEvent);
+            read_pending = ReadDirectoryChangesW(directory, buffer.data(), kBufferSize, TRUE, kNotifyFilter, nullptr, &overlapped, nullptr) != FALSE;
+            return read_pending;
+        }
+    };
+#elif defined(__linux__)
+    namespace
+    {
+        constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+        std::string join(const std::string& directory, const std::string& name)
+        {
+            return directory.empty() ? name : directory + "/" + name;
+        }
+    }  // namespace
+
+    struct FileWatcher::State
+    {
+        int fd = -1;
+        // Watch descriptors of the watched directories, relative to the root.
+        std::unordered_map<int, std::string> directories;
+
+        // inotify is not recursive, so every directory needs its own watch.
+        bool add_directory(const std::filesystem::path& root, const std::string& relative)
+        {
+            std::filesystem::path path = relative.empty() ? root : root / relative;
+            int wd = inotify_add_watch(fd, path.c_str(), kWatchMask);
+            if (wd < 0)
+            {
+                return false;
+            }
+            directories[wd] = relative;
+            std::error_code error;
+            for (const auto& entry : std::filesystem::directory_iterator(path, error))
+            {
+                if (entry.is_directory(error))
+                {
+                    add_directory(root, join(relative, entry.path().filename().string()));
+                }
+            }
+            return true;
+        }
+    };
+#else
+    struct FileWatcher::State
+    {
+    };
+#endif
+
+    FileWatcher::FileWatcher() = default;
+
+    FileWatcher::~FileWatcher()
+    {
+        stop();
+    }
+
+    bool FileWatcher::start(const std::filesystem::path& root, std::string& error)
+    {
+        stop();
+        _root = root;
+        auto state = std::make_unique<State>();
+#ifdef _WIN32
+        state->directory = CreateFileW(
+            root.c_str(),
+            FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+            nullptr);
+        if (state->directory == INVALID_HANDLE_VALUE)
+        {
+            error = "cannot open " + root.string() + " (error " + std::to_string(GetLastError()) + ")";
+            return false;
+        }
+        state->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!state->overlapped.hEvent || !state->begin_read())
+        {
+            error = "cannot watch " + root.string() + " (error " + std::to_string(GetLastError()) + ")";
+            if (state->overlapped.hEvent)
+            {
+                CloseHandle(state->overlapped.hEvent);
+            }
+            CloseHandle(state->directory);
+            return false;
+        }
+#elif defined(__linux__)
+        state->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (state->fd < 0)
+        {
+            error = std::string("inotify_init1 failed: ") + std::strerror(errno);
+            return false;
+        }
+        if (!state->add_directory(root, ""))
+        {
+            error = "cannot watch " + root.string() + ": " + std::strerror(errno);
+            close(state->fd);
+            return false;
+        }
+#else
+        error = "watching files is not supported on this platform";
+        return false;
+#endif
+        _state = std::move(state);
+        return true;
+    }
+
+    void FileWatcher::stop()
+    {
+        if (!_state)
+        {
+            return;
+        }
+#ifdef _WIN32
+        if (_state->read_pending)
+        {
+            CancelIoEx(_state->directory, &_state->overlapped);
+            DWORD bytes = 0;
+            GetOverlappedResult(_state->directory, &_state->overlapped, &bytes, TRUE);
+        }
+        CloseHandle(_state->overlapped.hEvent);
+        CloseHandle(_state->directory);
+#elif defined(__linux__)
+        close(_state->fd);
+#endif
+        _state.reset();
+    }
+
+    void FileWatcher::wait_for_changes(std::chrono::milliseconds timeout, std::vector<std::string>& changed)
+    {
+        if (!_state)
+        {
+            std::this_thread::sleep_for(timeout);
+            return;
+        }
+#ifdef _WIN32
+        if (!_state->read_pending && !_state->begin_read())
+        {
+            std::this_thread::sleep_for(timeout);
+            return;
+        }
+        if (WaitForSingleObject(_state->overlapped.hEvent, static_cast<DWORD>(timeout.count())) != WAIT_OBJECT_0)
+        {
+            return;
+        }
+        DWORD bytes = 0;
+        BOOL succeeded = GetOverlappedResult(_state->directory, &_state->overlapped, &bytes, FALSE);
+        _state->read_pending = false;
+        if (!succeeded || bytes == 0)
+        {
+            // The buffer overflowed before it was read.
+            changed.push_back("");
+        }
+        else
+        {
+            const auto* data = reinterpret_cast<const uint8_t*>(_state->buffer.data());
+            for (size_t offset = 0;;)
+            {
+                const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(data + offset);
+                int length = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+                int size = WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, nullptr, 0, nullptr, nullptr);
+                std::string path(static_cast<size_t>(size), '\0');
+                WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, path.data(), size, nullptr, nullptr);
+                std::replace(path.begin(), path.end(), '\\', '/');
+                changed.push_back(std::move(path));
+                if (info->NextEntryOffset == 0)
+                {
+                    break;
+                }
+                offset += info->NextEntryOffset;
+            }
+        }
+        _state->begin_read();
+#elif defined(__linux__)
+        pollfd descriptor = {_state->fd, POLLIN, 0};
+        if (poll(&descriptor, 1, static_cast<int>(timeout.count())) <= 0)
+        {
+            return;
+        }
+        alignas(inotify_event) char buffer[16 * 1024];
+        for (;;)
+        {
+            ssize_t length = read(_state->fd, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                // EAGAIN: everything queued has been read.
+                break;
+            }
+            for (char* next = buffer; next < buffer + length;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(next);
+                next += sizeof(inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    changed.push_back("");
+                    continue;
+                }
+                auto it = _state->directories.find(event->wd);
+                if (it == _state->directories.end())
+                {
+                    continue;
+                }
+                if (event->mask & IN_IGNORED)
+                {
+                    // The directory was deleted or moved away.
+                    _state->directories.erase(it);
+                    continue;
+                }
+                if (event->len == 0)
+                {
+                    continue;
+                }
+                std::string path = join(it->second, event->name);
+                if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                {
+                    // Files may have appeared in the new directory before its watch was added.
+                    _state->add_directory(_root, path);
+                    std::error_code error;
+                    for (const auto& entry : std::filesystem::recursive_directory_iterator(_root / path, error))
+                    {
+                        if (entry.is_regular_file(error))
+                        {
+                            changed.push_back(entry.path().lexically_relative(_root).generic_string());
+                        }
+                    }
+                }
+                changed.push_back(std::move(path));
+            }
+        }
+#endif
+    }
+}  // namespace learn_d3d12
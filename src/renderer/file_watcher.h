@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // Watches a directory tree with inotify on Linux and ReadDirectoryChangesW on Windows,
+    // and reports the files below it that were written, created, deleted or renamed.
+    // Editors often save by renaming a temporary file over the original, so both ends of a
+    // rename count as changes. Not thread-safe: one thread starts, waits and stops.
+    class FileWatcher
+    {
+    public:
+        FileWatcher();
+        ~FileWatcher();
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        // Starts watching `root` and every directory below it, including ones created
+        // later. Returns false with the reason in `error` if it cannot be watched.
+        bool start(const std::filesystem::path& root, std::string& error);
+        void stop();
+        bool is_watching() const { return _state != nullptr; }
+
+        // Waits up to `timeout` for changes and appends the changed paths to `changed`,
+        // relative to the root with '/' separators. Returns early once something changed.
+        // An empty path means the system dropped events, so anything may have changed.
+        void wait_for_changes(std::chrono::milliseconds timeout, std::vector<std::string>& changed);
+
+    private:
+        struct State;
+
+        std::filesystem::path _root;
+        std::unique_ptr<State> _state;
+    };
+}  // namespace learn_d3d12
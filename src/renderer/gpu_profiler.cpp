@@ -0,0 +1,118 @@
+#include "gpu_profiler.h"
+#include "../logging/log_macros.h"
+#include "d3d12_helper.h"
+#include <directx/d3dx12.h>
+
+namespace learn_d3d12
+{
+    GpuProfiler::GpuProfiler(uint32_t max_scopes_per_frame, uint32_t frame_latency)
+        : _tracker(max_scopes_per_frame, frame_latency)
+    {
+    }
+
+    void GpuProfiler::initialize(ID3D12Device* device, ID3D12CommandQueue* command_queue)
+    {
+        UINT64 frequency = 0;
+        throw_if_failed(command_queue->GetTimestampFrequency(&frequency));
+        _tracker.set_timestamp_frequency(frequency);
+
+        D3D12_QUERY_HEAP_DESC query_heap_desc = {};
+        query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        query_heap_desc.Count = _tracker.get_query_count();
+        throw_if_failed(device->CreateQueryHeap(&query_heap_desc, IID_PPV_ARGS(&_query_heap)));
+
+        // One readback region per frame in flight, laid out exactly like the query heap.
+        CD3DX12_HEAP_PROPERTIES props(D3D12_HEAP_TYPE_READBACK);
+        CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint64_t) * _tracker.get_query_count());
+        throw_if_failed(device->CreateCommittedResource(
+            &props,
+            D3D12_HEAP_FLAG_NONE,
+            &desc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&_readback_buffer)));
+    }
+
+    void GpuProfiler::shutdown()
+    {
+        _readback_buffer.Reset();
+        _query_heap.Reset();
+    }
+
+    void GpuProfiler::begin_frame(uint64_t completed_fence_value)
+    {
+        if (!_query_heap)
+        {
+            return;
+        }
+        _collect_completed_frames(completed_fence_value);
+        _tracker.begin_frame();
+    }
+
+    void GpuProfiler::begin_scope(ID3D12GraphicsCommandList* command_list, const char* name)
+    {
+        uint32_t query = _tracker.begin_scope(name);
+        if (query != GpuTimestampTracker::kInvalidQuery)
+        {
+            command_list->EndQuery(_query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+        }
+    }
+
+    void GpuProfiler::end_scope(ID3D12GraphicsCommandList* command_list)
+    {
+        uint32_t query = _tracker.end_scope();
+        if (query != GpuTimestampTracker::kInvalidQuery)
+        {
+            command_list->EndQuery(_query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+        }
+    }
+
+    void GpuProfiler::end_frame(ID3D12GraphicsCommandList* command_list, uint64_t fence_value)
+    {
+        GpuTimestampTracker::QueryRange range = _tracker.end_frame(fence_value);
+        if (range.query_count == 0)
+        {
+            return;
+        }
+        command_list->ResolveQueryData(
+            _query_heap.Get(),
+            D3D12_QUERY_TYPE_TIMESTAMP,
+            range.first_query,
+            range.query_count,
+            _readback_buffer.Get(),
+            sizeof(uint64_t) * range.first_query);
+    }
+
+    void GpuProfiler::log_summary() const
+    {
+        for (const auto& stats : _tracker.get_scope_stats())
+        {
+            LOG_INFO(LearnD3d12, "GPU {0}: avg {1:.3f} ms, min {2:.3f} ms, max {3:.3f} ms over {4} frames", stats.name, stats.average_ms(), stats.min_ms, stats.max_ms, stats.sample_count);
+        }
+        if (_tracker.get_dropped_frame_count())
+        {
+            LOG_INFO(LearnD3d12, "GPU profiler skipped {0} frames because every readback slot was in flight.", _tracker.get_dropped_frame_count());
+        }
+    }
+
+    void GpuProfiler::_collect_completed_frames(uint64_t completed_fence_value)
+    {
+        GpuTimestampTracker::QueryRange range;
+        uint32_t slot;
+        while ((slot = _tracker.pop_completed_frame(completed_fence_value, range)) != GpuTimestampTracker::kInvalidSlot)
+        {
+            if (range.query_count == 0)
+            {
+                _tracker.accumulate(slot, nullptr);
+                continue;
+            }
+            // The fence guarantees the resolve has finished, so mapping does not block.
+            CD3DX12_RANGE read_range(sizeof(uint64_t) * range.first_query, sizeof(uint64_t) * (range.first_query + range.query_count));
+            uint8_t* data = nullptr;
+            throw_if_failed(_readback_buffer->Map(0, &read_range, reinterpret_cast<void**>(&data)));
+            _tracker.accumulate(slot, reinterpret_cast<const uint64_t*>(data + read_range.Begin));
+            CD3DX12_RANGE write_range(0, 0);
+            _readback_buffer->Unmap(0, &write_range);
+        }
+    }
+}  // namespace learn_d3d12
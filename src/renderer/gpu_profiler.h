@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../profiling/gpu_timestamp_tracker.h"
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <directx/d3d12.h>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace learn_d3d12
+{
+    class GpuProfiler
+    {
+    public:
+        GpuProfiler(uint32_t max_scopes_per_frame = 32, uint32_t frame_latency = 3);
+
+        void initialize(ID3D12Device* device, ID3D12CommandQueue* command_queue);
+        void shutdown();
+
+        // Reads back every frame the GPU has finished with, then opens a new frame.
+        void begin_frame(uint64_t completed_fence_value);
+        void begin_scope(ID3D12GraphicsCommandList* command_list, const char* name);
+        void end_scope(ID3D12GraphicsCommandList* command_list);
+        // Must be recorded before the command list is closed; `fence_value` is the value
+        // that will be signaled once this command list has executed.
+        void end_frame(ID3D12GraphicsCommandList* command_list, uint64_t fence_value);
+
+        const GpuTimestampTracker& get_tracker() const { return _tracker; }
+        void log_summary() const;
+
+    private:
+        GpuTimestampTracker _tracker;
+        ComPtr<ID3D12QueryHeap> _query_heap;
+        ComPtr<ID3D12Resource> _readback_buffer;
+
+        void _collect_completed_frames(uint64_t completed_fence_value);
+    };
+
+    class GpuProfileScope
+    {
+    public:
+        GpuProfileScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* command_list, const char* name)
+            : _profiler(profiler)
+            , _command_list(command_list)
+        {
+            _profiler.begin_scope(_command_list, name);
+        }
+        ~GpuProfileScope() { _profiler.end_scope(_command_list); }
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+    private:
+        GpuProfiler& _profiler;
+        ID3D12GraphicsCommandList* _command_list;
+    };
+}  // namespace learn_d3d12
@@ -1,41 +1,142 @@
 #include "hello_triangle.h"
+#include "../logging/log_macros.h"
+#include "../metrics/metrics_registry.h"
 #include "d3d12_helper.h"
-#include <d3dcompiler.h>
+#include "shader_library.h"
+#include <algorithm>
+#include <cmath>
 
 namespace learn_d3d12
 {
-    HelloTriangle::HelloTriangle(uint32_t width, uint32_t height, std::string name)
+    namespace
+    {
+        constexpr const char* kSceneShaderPath = "hello_triangle/shaders.hlsl";
+        constexpr const char* kUpscaleShaderPath = "upscale/upscale.hlsl";
+
+        ResolutionControllerSettings get_resolution_settings(const RendererConfig& config)
+        {
+            ResolutionControllerSettings settings;
+            settings.target_frame_ms = config.target_frame_ms;
+            return settings;
+        }
+    }  // namespace
+
+    HelloTriangle::HelloTriangle(uint32_t width, uint32_t height, std::string name, const RendererConfig& config)
         : D3d12Renderer(width, height, name)
         , _viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height))
         , _scissor_rect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height))
-        , _rtv_descriptor_size(0) {};
+        , _rtv_descriptor_size(0)
+        , _frame_fence_values {}
+        , _frame_arena(kFrameCount)
+        , _capture_path(config.capture_path)
+        , _capture_frame_count(config.capture_frame_count)
+        , _residency_fallback_budget(config.residency_budget_mb * 1024 * 1024)
+        , _dynamic_resolution(config.dynamic_resolution)
+        , _resolution_controller(get_resolution_settings(config))
+        , _resolution_trace_path(config.resolution_trace_path)
+        , _gpu_frame_sample_count(0)
+        , _scene_width(width)
+        , _scene_height(height)
+        , _shader_hot_reload(config.shader_hot_reload)
+        , _shader_source_dir(config.shader_source_dir)
+        , _dxc_executable(config.dxc_executable)
+        , _shader_model(config.shader_model)
+    {
+        if (_dynamic_resolution)
+        {
+            float max_scale = _resolution_controller.get_settings().max_scale;
+            _scene_width = static_cast<uint32_t>(std::ceil(static_cast<float>(width) * max_scale));
+            _scene_height = static_cast<uint32_t>(std::ceil(static_cast<float>(height) * max_scale));
+        }
+    }
 
     void HelloTriangle::on_init(HWND hwnd)
     {
+        // Open the capture first so that every object is registered as it is created.
+        // Descriptor tables are not captured, so the upscale pass could not be replayed.
+        if (!_capture_path.empty() && _dynamic_resolution)
+        {
+            LOG_WARN(LearnD3d12, "Frame capture disabled: it does not support dynamic resolution.");
+        }
+        else if (!_capture_path.empty() && _shader_hot_reload)
+        {
+            LOG_WARN(LearnD3d12, "Frame capture disabled: it does not support replacing pipeline states.");
+        }
+        else if (!_capture_path.empty())
+        {
+            std::string error;
+            if (_frame_capture.open(_capture_path, width, height, _capture_frame_count, error))
+            {
+                LOG_INFO(LearnD3d12, "Capturing {0} frames to {1}.", _capture_frame_count, _capture_path);
+            }
+            else
+            {
+                LOG_ERROR(LearnD3d12, "Frame capture disabled: {0}", error);
+            }
+        }
+        if (!_resolution_trace_path.empty())
+        {
+            _resolution_trace.open(_resolution_trace_path);
+            if (_resolution_trace)
+            {
+                _resolution_trace << "# GPU frame time in milliseconds and render scale, one profiled frame per line\n";
+            }
+            else
+            {
+                LOG_ERROR(LearnD3d12, "Resolution trace disabled: cannot open {0}.", _resolution_trace_path);
+            }
+        }
         _load_pipeline(hwnd);
         _load_assets();
+        if (_shader_hot_reload)
+        {
+            _start_shader_reload();
+        }
+        if (_dynamic_resolution)
+        {
+            LOG_INFO(LearnD3d12, "Dynamic resolution targets {0} ms with a {1}x{2} scene target.", _resolution_controller.get_settings().target_frame_ms, _scene_width, _scene_height);
+        }
     }
 
     void HelloTriangle::on_destroy()
     {
+        // Stop rebuilding pipeline states before anything they use goes away.
+        if (_shader_reloader)
+        {
+            _shader_reloader->stop();
+            _shader_reloader.reset();
+        }
+
         // Ensure that the GPU is no longer referencing resources that are about to be
         // cleaned up by the destructor.
-        _wait_for_previous_frame();
-
-        CloseHandle(_fence_event);
-        _fence.Reset();
-        _command_list.Reset();
+        _command_contexts.wait_idle();
+        _pipeline_swaps.clear();
+        _gpu_profiler.log_summary();
+        _gpu_profiler.shutdown();
+
+        _residency->remove_object(_vertex_buffer_residency);
+        _residency->remove_object(_vertex_staging_residency);
+        if (_scene_target)
+        {
+            _residency->remove_object(_scene_target_residency);
+        }
         _vertex_buffer.Reset();
+        _vertex_staging_buffer.Reset();
+        _scene_target.Reset();
+        _srv_heap.Reset();
+        _upscale_pipeline_state.Reset();
+        _upscale_root_signature.Reset();
         _pipeline_state.Reset();
         _root_signature.Reset();
-        _command_allocator.Reset();
         for (auto& render_target : _render_targets)
         {
             render_target.Reset();
         }
         _rtv_heap.Reset();
         _swap_chain.Reset();
-        _command_queue.Reset();
+        _residency.reset();
+        _residency_backend.reset();
+        _command_contexts.shutdown();
         _device.Reset();
     }
 
@@ -45,66 +146,70 @@ namespace learn_d3d12
 
     void HelloTriangle::on_render()
     {
-        // Record all the commands we need to render the scene into the command list.
-        _populate_command_list();
+        auto& metrics = MetricsRegistry::get_instance();
 
-        // Execute the command list.
-        ID3D12CommandList* command_lists[] = {_command_list.Get()};
-        _command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
+        _swap_reloaded_pipelines();
+        _frame_capture.begin_frame();
 
-        // Present the frame.
-        throw_if_failed(_swap_chain->Present(1, 0));
-
-        _wait_for_previous_frame();
-    }
-
-    void HelloTriangle::_load_pipeline(HWND hwnd)
-    {
-        uint32_t dxgi_factory_flags = 0;
-#if defined(_DEBUG)
-        // Enable the debug layer (requires the Graphics Tools "optional feature").
-        // NOTE: Enabling the debug layer after device creation will invalidate the active device.
+        // The arena cycles its slots on its own, so the frame that last used the next slot
+        // is not necessarily the one _move_to_next_frame waited for.
+        CommandQueue& direct_queue = _command_contexts.get_queue(QueueType::kDirect);
+        while (!_frame_arena.begin_frame(direct_queue.get_completed_fence_value()))
         {
-            ComPtr<ID3D12Debug> debug_controller;
-            if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debug_controller))))
-            {
-                debug_controller->EnableDebugLayer();
-
-                // Enable additional debug layers.
-                dxgi_factory_flags |= DXGI_CREATE_FACTORY_DEBUG;
-            }
+            direct_queue.wait_for_fence(_frame_arena.get_required_fence_value());
         }
-#endif
-        ComPtr<IDXGIFactory4> factory;
-        throw_if_failed(CreateDXGIFactory2(dxgi_factory_flags, IID_PPV_ARGS(&factory)));
 
-        if (use_warp_device)
+        // Record all the commands we need to render the scene into the command list. The
+        // manager hands out an allocator whose previous command lists have finished
+        // executing on the GPU, and an open command list recording into it.
+        _frame_context = _command_contexts.begin(QueueType::kDirect, _pipeline_state.Get());
+        CapturedCommandList command_list(_frame_context.command_list.Get(), _frame_capture, _pipeline_state.Get(), _frame_arena.get_resource());
         {
-            ComPtr<IDXGIAdapter> warp_adapter;
-            throw_if_failed(factory->EnumWarpAdapter(IID_PPV_ARGS(&warp_adapter)));
-
-            throw_if_failed(D3D12CreateDevice(
-                warp_adapter.Get(),
-                D3D_FEATURE_LEVEL_11_0,
-                IID_PPV_ARGS(&_device)));
+            ScopedMetricTimer record_timer(metrics.get_cpu_record_time());
+            _populate_command_list(command_list);
         }
-        else
+
+        // Execute the command list once the buffers it reads are resident.
+        _residency->prepare(_frame_residency);
+        _frame_fence_values[_frame_index] = _command_contexts.submit(_frame_context);
+        _frame_arena.end_frame(_frame_fence_values[_frame_index]);
+        _residency->mark_submitted(_frame_residency, static_cast<uint32_t>(QueueType::kDirect), _frame_fence_values[_frame_index]);
+        _frame_capture.record_submission(QueueType::kDirect, command_list.get_commands());
+
+        // Present the frame.
         {
-            ComPtr<IDXGIAdapter1> hardware_adapter;
-            get_hardware_adapter(factory.Get(), &hardware_adapter);
+            ScopedMetricTimer present_timer(metrics.get_present_wait_time());
+            throw_if_failed(_swap_chain->Present(1, 0));
+        }
 
-            throw_if_failed(D3D12CreateDevice(
-                hardware_adapter.Get(),
-                D3D_FEATURE_LEVEL_11_0,
-                IID_PPV_ARGS(&_device)));
+        std::string capture_error;
+        if (!_frame_capture.end_frame(capture_error))
+        {
+            LOG_ERROR(LearnD3d12, "Frame capture failed: {0}", capture_error);
         }
 
-        // Describe and create the command queue.
-        D3D12_COMMAND_QUEUE_DESC queue_desc = {};
-        queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-        queue_desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+        _move_to_next_frame();
+    }
+
+    void HelloTriangle::_load_pipeline(HWND hwnd)
+    {
+        // The device may already be under way on another thread (--fast-start).
+        DeviceObjects device_objects = acquire_device();
+        ComPtr<IDXGIFactory4> factory = device_objects.factory;
+        _device = device_objects.device;
+
+        // Create the direct, compute and copy queues.
+        _command_contexts.initialize(_device.Get());
+
+        // Budget video memory with the adapter the device runs on. Without IDXGIAdapter3
+        // the residency manager uses the configured budget.
+        ComPtr<IDXGIAdapter3> adapter;
+        factory->EnumAdapterByLuid(_device->GetAdapterLuid(), IID_PPV_ARGS(&adapter));
+        _residency_backend = std::make_unique<D3d12ResidencyBackend>(_device.Get(), adapter.Get(), _command_contexts);
+        _residency = std::make_unique<ResidencyManager>(*_residency_backend, _residency_fallback_budget);
+        ID3D12CommandQueue* direct_queue = _command_contexts.get_queue(QueueType::kDirect).get_command_queue();
 
-        throw_if_failed(_device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&_command_queue)));
+        _gpu_profiler.initialize(_device.Get(), direct_queue);
 
         // Describe and create the swap chain.
         DXGI_SWAP_CHAIN_DESC1 swap_chain_desc = {};
@@ -118,7 +223,7 @@ namespace learn_d3d12
 
         ComPtr<IDXGISwapChain1> swap_chain;
         throw_if_failed(factory->CreateSwapChainForHwnd(
-            _command_queue.Get(),  // Swap chain needs the queue so that it can force a flush on it.
+            direct_queue,  // Swap chain needs the queue so that it can force a flush on it.
             hwnd,
             &swap_chain_desc,
             nullptr,
@@ -135,12 +240,23 @@ namespace learn_d3d12
         {
             // Describe and create a render target view (RTV) descriptor heap.
             D3D12_DESCRIPTOR_HEAP_DESC rtv_heap_desc = {};
-            rtv_heap_desc.NumDescriptors = kFrameCount;
+            // One more RTV for the scene target of dynamic resolution.
+            rtv_heap_desc.NumDescriptors = kFrameCount + 1;
             rtv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
             rtv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
             throw_if_failed(_device->CreateDescriptorHeap(&rtv_heap_desc, IID_PPV_ARGS(&_rtv_heap)));
 
             _rtv_descriptor_size = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+
+            if (_dynamic_resolution)
+            {
+                // Describe and create a shader resource view (SRV) heap for the upscale pass.
+                D3D12_DESCRIPTOR_HEAP_DESC srv_heap_desc = {};
+                srv_heap_desc.NumDescriptors = 1;
+                srv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+                srv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+                throw_if_failed(_device->CreateDescriptorHeap(&srv_heap_desc, IID_PPV_ARGS(&_srv_heap)));
+            }
         }
 
         // Create frame resources.
@@ -152,11 +268,28 @@ namespace learn_d3d12
             {
                 throw_if_failed(_swap_chain->GetBuffer(n, IID_PPV_ARGS(&_render_targets[n])));
                 _device->CreateRenderTargetView(_render_targets[n].Get(), nullptr, rtv_handle);
+                _frame_capture.register_render_target(_render_targets[n].Get());
                 rtv_handle.Offset(1, _rtv_descriptor_size);
             }
-        }
 
-        throw_if_failed(_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&_command_allocator)));
+            // The scene target rests in the shader resource state between frames.
+            if (_dynamic_resolution)
+            {
+                CD3DX12_HEAP_PROPERTIES default_props(D3D12_HEAP_TYPE_DEFAULT);
+                CD3DX12_RESOURCE_DESC scene_desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, _scene_width, _scene_height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+                throw_if_failed(_device->CreateCommittedResource(
+                    &default_props,
+                    D3D12_HEAP_FLAG_NONE,
+                    &scene_desc,
+                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                    nullptr,
+                    IID_PPV_ARGS(&_scene_target)));
+                _device->CreateRenderTargetView(_scene_target.Get(), nullptr, rtv_handle);
+                _device->CreateShaderResourceView(_scene_target.Get(), nullptr, _srv_heap->GetCPUDescriptorHandleForHeapStart());
+                _scene_target_residency = _residency->add_object(static_cast<ID3D12Pageable*>(_scene_target.Get()), _device->GetResourceAllocationInfo(0, 1, &scene_desc).SizeInBytes);
+                _frame_residency.add(_scene_target_residency);
+            }
+        }
     }
 
     void HelloTriangle::_load_assets()
@@ -170,53 +303,32 @@ namespace learn_d3d12
             ComPtr<ID3DBlob> error;
             throw_if_failed(D3D12SerializeRootSignature(&root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
             throw_if_failed(_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&_root_signature)));
+            _frame_capture.register_root_signature(_root_signature.Get(), signature.Get());
         }
 
-        // Create the pipeline state, which includes compiling and loading shaders.
+        // Create the pipeline state, which includes loading shaders compiled at build time.
+        _pipeline_state = _create_pipeline_state();
+
+        // Create the upscale pass: a fullscreen triangle sampling the scene target.
+        if (_dynamic_resolution)
         {
-            ComPtr<ID3DBlob> vertex_shader;
-            ComPtr<ID3DBlob> pixel_shader;
+            CD3DX12_DESCRIPTOR_RANGE ranges[1];
+            ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+            CD3DX12_ROOT_PARAMETER root_parameters[2];
+            root_parameters[0].InitAsDescriptorTable(_countof(ranges), ranges, D3D12_SHADER_VISIBILITY_PIXEL);
+            root_parameters[1].InitAsConstants(sizeof(UpscaleConstants) / sizeof(uint32_t), 0);
+            CD3DX12_STATIC_SAMPLER_DESC sampler(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
-#if defined(_DEBUG)
-            // Enable better shader debugging with the graphics debugging tools.
-            UINT compile_flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-            UINT compile_flags = 0;
-#endif
+            CD3DX12_ROOT_SIGNATURE_DESC root_signature_desc;
+            root_signature_desc.Init(_countof(root_parameters), root_parameters, 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
-            throw_if_failed(D3DCompileFromFile(L"shader/hello_triangle/shaders.hlsl", nullptr, nullptr, "VSMain", "vs_5_0", compile_flags, 0, &vertex_shader, nullptr));
-            throw_if_failed(D3DCompileFromFile(L"shader/hello_triangle/shaders.hlsl", nullptr, nullptr, "PSMain", "ps_5_0", compile_flags, 0, &pixel_shader, nullptr));
+            ComPtr<ID3DBlob> signature;
+            ComPtr<ID3DBlob> error;
+            throw_if_failed(D3D12SerializeRootSignature(&root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
+            throw_if_failed(_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&_upscale_root_signature)));
 
-            // Define the vertex input layout.
-            D3D12_INPUT_ELEMENT_DESC input_element_descs[] =
-                {
-                    {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-                    {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
-
-            // Describe and create the graphics pipeline state object (PSO).
-            D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
-            pso_desc.InputLayout = {input_element_descs, _countof(input_element_descs)};
-            pso_desc.pRootSignature = _root_signature.Get();
-            pso_desc.VS = CD3DX12_SHADER_BYTECODE(vertex_shader.Get());
-            pso_desc.PS = CD3DX12_SHADER_BYTECODE(pixel_shader.Get());
-            pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-            pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-            pso_desc.DepthStencilState.DepthEnable = FALSE;
-            pso_desc.DepthStencilState.StencilEnable = FALSE;
-            pso_desc.SampleMask = UINT_MAX;
-            pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-            pso_desc.NumRenderTargets = 1;
-            pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-            pso_desc.SampleDesc.Count = 1;
-            throw_if_failed(_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&_pipeline_state)));
-        }
-
-        // Create the command list.
-        throw_if_failed(_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, _command_allocator.Get(), _pipeline_state.Get(), IID_PPV_ARGS(&_command_list)));
-
-        // Command lists are created in the recording state, but there is nothing
-        // to record yet. The main loop expects it to be closed, so close it now.
-        throw_if_failed(_command_list->Close());
+            _upscale_pipeline_state = _create_upscale_pipeline_state();
+        }
 
         // Create the vertex buffer.
         {
@@ -229,22 +341,21 @@ namespace learn_d3d12
 
             const UINT vertex_buffer_size = sizeof(triangle_vertices);
 
-            CD3DX12_HEAP_PROPERTIES props(D3D12_HEAP_TYPE_UPLOAD);
+            // The vertex buffer lives in a default heap and is filled from a staging buffer
+            // on the copy queue. Buffers decay to the common state after the copy and are
+            // promoted to a vertex buffer on first use, so no barriers are needed.
+            CD3DX12_HEAP_PROPERTIES props(D3D12_HEAP_TYPE_DEFAULT);
             CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size, D3D12_RESOURCE_FLAG_NONE);
-
-            // Note: using upload heaps to transfer static data like vert buffers is not
-            // recommended. Every time the GPU needs it, the upload heap will be marshalled
-            // over. Please read up on Default Heap usage. An upload heap is used here for
-            // code simplicity and because there are very few verts to actually transfer.
             throw_if_failed(_device->CreateCommittedResource(
                 &props,
                 D3D12_HEAP_FLAG_NONE,
                 &desc,
-                D3D12_RESOURCE_STATE_GENERIC_READ,
+                D3D12_RESOURCE_STATE_COMMON,
                 nullptr,
                 IID_PPV_ARGS(&_vertex_buffer)));
+            _frame_capture.register_buffer(_vertex_buffer.Get(), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
+            _vertex_buffer_residency = _residency->add_object(static_cast<ID3D12Pageable*>(_vertex_buffer.Get()), vertex_buffer_size);
 
-            ComPtr<ID3D12Resource> staging_buffer;
             CD3DX12_HEAP_PROPERTIES staging_props(D3D12_HEAP_TYPE_UPLOAD);
             CD3DX12_RESOURCE_DESC staging_desc = CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size);
             throw_if_failed(_device->CreateCommittedResource(&staging_props,
@@ -252,114 +363,322 @@ namespace learn_d3d12
                                                              &staging_desc,
                                                              D3D12_RESOURCE_STATE_GENERIC_READ,
                                                              nullptr,
-                                                             IID_PPV_ARGS(&staging_buffer)));
-            // Copy the triangle data to the vertex buffer.
-            // D3D12_SUBRESOURCE_DATA subresource_data;
-            // subresource_data.pData = triangle_vertices;
-            // subresource_data.RowPitch = vertex_buffer_size;
-            // subresource_data.SlicePitch = subresource_data.RowPitch;
-            // UpdateSubresources(_command_list.Get(),
-            //                    _vertex_buffer.Get(),
-            //                    staging_buffer.Get(),
-            //                    0,
-            //                    0,
-            //                    1,
-            //                    &subresource_data);
+                                                             IID_PPV_ARGS(&_vertex_staging_buffer)));
+            _frame_capture.register_buffer(_vertex_staging_buffer.Get(), D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+            _vertex_staging_residency = _residency->add_object(static_cast<ID3D12Pageable*>(_vertex_staging_buffer.Get()), vertex_buffer_size);
 
+            // Copy the triangle data to the staging buffer.
             UINT8* p_vertex_data_begin;
             CD3DX12_RANGE read_range(0, 0);  // We do not intend to read from this resource on the CPU.
-            throw_if_failed(_vertex_buffer->Map(0, &read_range, reinterpret_cast<void**>(&p_vertex_data_begin)));
+            throw_if_failed(_vertex_staging_buffer->Map(0, &read_range, reinterpret_cast<void**>(&p_vertex_data_begin)));
             memcpy(p_vertex_data_begin, triangle_vertices, sizeof(triangle_vertices));
-            _vertex_buffer->Unmap(0, nullptr);
-
-            // auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            //     _vertex_buffer.Get(),
-            //     D3D12_RESOURCE_STATE_COPY_DEST,
-            //     D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-            // _command_list->ResourceBarrier(1, &barrier);
+            _vertex_staging_buffer->Unmap(0, nullptr);
+            _frame_capture.record_upload(_vertex_staging_buffer.Get(), 0, triangle_vertices, sizeof(triangle_vertices));
+
+            CommandContext upload_context = _command_contexts.begin(QueueType::kCopy);
+            CapturedCommandList upload_list(upload_context.command_list.Get(), _frame_capture);
+            upload_list.copy_buffer_region(_vertex_buffer.Get(), 0, _vertex_staging_buffer.Get(), 0, vertex_buffer_size);
+            ResidencySet upload_residency;
+            upload_residency.add(_vertex_buffer_residency);
+            upload_residency.add(_vertex_staging_residency);
+            _residency->prepare(upload_residency);
+            uint64_t upload_fence_value = _command_contexts.submit(upload_context);
+            _residency->mark_submitted(upload_residency, static_cast<uint32_t>(QueueType::kCopy), upload_fence_value);
+            uint64_t upload_submission = _frame_capture.record_submission(QueueType::kCopy, upload_list.get_commands());
+
+            // The first frame waits for the upload on the GPU; the CPU does not block on it.
+            _command_contexts.get_queue(QueueType::kDirect).wait_for_queue(_command_contexts.get_queue(QueueType::kCopy), upload_fence_value);
+            _frame_capture.record_queue_wait(QueueType::kDirect, QueueType::kCopy, upload_submission);
 
             // Initialize the vertex buffer view.
             _vertex_buffer_view.BufferLocation = _vertex_buffer->GetGPUVirtualAddress();
             _vertex_buffer_view.StrideInBytes = sizeof(Vertex);
             _vertex_buffer_view.SizeInBytes = vertex_buffer_size;
+
+            // Every frame reads the vertex buffer. The swap chain buffers are managed by
+            // DXGI and cannot be evicted, so they are not tracked.
+            _frame_residency.add(_vertex_buffer_residency);
         }
+    }
+
+    ComPtr<ID3D12PipelineState> HelloTriangle::_create_pipeline_state()
+    {
+        ShaderBytecode vertex_shader = get_shader_bytecode(kSceneShaderPath, "VSMain");
+        ShaderBytecode pixel_shader = get_shader_bytecode(kSceneShaderPath, "PSMain");
 
-        // Create synchronization objects and wait until assets have been uploaded to the GPU.
+        // Define the vertex input layout.
+        D3D12_INPUT_ELEMENT_DESC input_element_descs[] =
+            {
+                {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+                {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
+
+        // Describe and create the graphics pipeline state object (PSO).
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
+        pso_desc.InputLayout = {input_element_descs, _countof(input_element_descs)};
+        pso_desc.pRootSignature = _root_signature.Get();
+        pso_desc.VS = CD3DX12_SHADER_BYTECODE(vertex_shader.data, vertex_shader.size);
+        pso_desc.PS = CD3DX12_SHADER_BYTECODE(pixel_shader.data, pixel_shader.size);
+        pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        pso_desc.DepthStencilState.DepthEnable = FALSE;
+        pso_desc.DepthStencilState.StencilEnable = FALSE;
+        pso_desc.SampleMask = UINT_MAX;
+        pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        pso_desc.NumRenderTargets = 1;
+        pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        pso_desc.SampleDesc.Count = 1;
+        ComPtr<ID3D12PipelineState> pipeline_state;
+        throw_if_failed(_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&pipeline_state)));
+        // Does nothing unless capturing, and capturing excludes hot reloading.
+        _frame_capture.register_graphics_pipeline(pipeline_state.Get(), pso_desc);
+        return pipeline_state;
+    }
+
+    ComPtr<ID3D12PipelineState> HelloTriangle::_create_upscale_pipeline_state()
+    {
+        ShaderBytecode vertex_shader = get_shader_bytecode(kUpscaleShaderPath, "VSMain");
+        ShaderBytecode pixel_shader = get_shader_bytecode(kUpscaleShaderPath, "PSMain");
+
+        // The triangle is generated from SV_VertexID, so there is no input layout.
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
+        pso_desc.pRootSignature = _upscale_root_signature.Get();
+        pso_desc.VS = CD3DX12_SHADER_BYTECODE(vertex_shader.data, vertex_shader.size);
+        pso_desc.PS = CD3DX12_SHADER_BYTECODE(pixel_shader.data, pixel_shader.size);
+        pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        pso_desc.DepthStencilState.DepthEnable = FALSE;
+        pso_desc.DepthStencilState.StencilEnable = FALSE;
+        pso_desc.SampleMask = UINT_MAX;
+        pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        pso_desc.NumRenderTargets = 1;
+        pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        pso_desc.SampleDesc.Count = 1;
+        ComPtr<ID3D12PipelineState> pipeline_state;
+        throw_if_failed(_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&pipeline_state)));
+        return pipeline_state;
+    }
+
+    void HelloTriangle::_start_shader_reload()
+    {
+        ShaderReloader::Settings settings;
+        settings.shader_root = _shader_source_dir;
+        settings.shader_model = _shader_model;
+        settings.compile = make_dxc_compile_function(_dxc_executable);
+        settings.on_batch = [this](std::vector<ShaderReloadResult>& results) { _on_shaders_reloaded(results); };
+        _shader_reloader = std::make_unique<ShaderReloader>(std::move(settings));
+        std::string error;
+        if (!_shader_reloader->start(error))
         {
-            throw_if_failed(_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_fence)));
-            _fence_value = 1;
+            LOG_ERROR(LearnD3d12, "Shader hot reload disabled: {0}", error);
+            _shader_reloader.reset();
+            return;
+        }
+        LOG_INFO(LearnD3d12, "Hot reloading shaders from {0} with {1}.", _shader_source_dir, _dxc_executable);
+    }
 
-            // Create an event handle to use for frame synchronization.
-            _fence_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-            if (_fence_event == nullptr)
+    void HelloTriangle::_on_shaders_reloaded(std::vector<ShaderReloadResult>& results)
+    {
+        // Runs on the reloader's worker thread. The device is free-threaded, so the pipeline
+        // states are created here as well and the render thread only swaps pointers.
+        bool rebuild_scene = false;
+        bool rebuild_upscale = false;
+        for (auto& result : results)
+        {
+            const ShaderPermutation& permutation = result.permutation;
+            if (!result.succeeded)
             {
-                throw_if_failed(HRESULT_FROM_WIN32(GetLastError()));
+                LOG_ERROR(LearnD3d12, "Recompiling {0}:{1} failed, keeping the previous version:\n{2}", permutation.path, permutation.entry_point, result.log);
+                continue;
             }
+            LOG_INFO(LearnD3d12, "Recompiled {0}:{1} in {2:.1f} ms.", permutation.path, permutation.entry_point, result.compile_ms);
+            set_shader_bytecode(permutation.path, permutation.entry_point, std::move(result.bytecode));
+            rebuild_scene = rebuild_scene || permutation.path == kSceneShaderPath;
+            rebuild_upscale = rebuild_upscale || permutation.path == kUpscaleShaderPath;
+        }
 
-            // Wait for the command list to execute; we are reusing the same command
-            // list in our main loop but for now, we just want to wait for setup to
-            // complete before continuing.
-            _wait_for_previous_frame();
+        try
+        {
+            if (rebuild_scene)
+            {
+                _pipeline_swaps.publish(kScenePipelineSlot, _create_pipeline_state());
+            }
+            if (rebuild_upscale && _upscale_root_signature)
+            {
+                _pipeline_swaps.publish(kUpscalePipelineSlot, _create_upscale_pipeline_state());
+            }
+        }
+        catch (const std::exception& e)
+        {
+            // For example a new vertex shader whose inputs no longer match the input layout.
+            LOG_ERROR(LearnD3d12, "Rebuilding a pipeline state failed, keeping the previous one: {0}", e.what());
         }
     }
 
-    void HelloTriangle::_populate_command_list()
+    void HelloTriangle::_swap_reloaded_pipelines()
     {
-        // Command list allocators can only be reset when the associated
-        // command lists have finished execution on the GPU; apps should use
-        // fences to determine GPU execution progress.
-        throw_if_failed(_command_allocator->Reset());
+        if (!_shader_reloader)
+        {
+            return;
+        }
+        // Any frame submitted so far may still use the current pipeline states, so they are
+        // kept until the last submission has finished instead of waiting for it here.
+        CommandQueue& direct_queue = _command_contexts.get_queue(QueueType::kDirect);
+        const uint64_t last_submitted_fence_value = direct_queue.get_next_fence_value() - 1;
+        if (_pipeline_swaps.swap(kScenePipelineSlot, _pipeline_state, last_submitted_fence_value))
+        {
+            LOG_INFO(LearnD3d12, "Swapped in the rebuilt {0} pipeline state.", kSceneShaderPath);
+        }
+        if (_pipeline_swaps.swap(kUpscalePipelineSlot, _upscale_pipeline_state, last_submitted_fence_value))
+        {
+            LOG_INFO(LearnD3d12, "Swapped in the rebuilt {0} pipeline state.", kUpscaleShaderPath);
+        }
+        _pipeline_swaps.collect(direct_queue.get_completed_fence_value());
+    }
 
-        // However, when ExecuteCommandList() is called on a particular command
-        // list, that command list can then be reset at any time and must be before
-        // re-recording.
-        throw_if_failed(_command_list->Reset(_command_allocator.Get(), _pipeline_state.Get()));
+    void HelloTriangle::_populate_command_list(CapturedCommandList& command_list)
+    {
+        CommandQueue& direct_queue = _command_contexts.get_queue(QueueType::kDirect);
+
+        // Pick up timings of frames the GPU has already finished, without waiting on it.
+        // Profiler queries go to the command list directly and are not captured.
+        _gpu_profiler.begin_frame(direct_queue.get_completed_fence_value());
+        _update_resolution();
+        _gpu_profiler.begin_scope(command_list.get(), "Frame");
+
+        // With dynamic resolution the scene goes to the top-left corner of the scene target
+        // and is upscaled to the back buffer afterwards; only the viewport and scissor change
+        // from frame to frame. Otherwise it goes straight to the back buffer.
+        ID3D12Resource* back_buffer = _render_targets[_frame_index].Get();
+        CD3DX12_CPU_DESCRIPTOR_HANDLE back_buffer_rtv(_rtv_heap->GetCPUDescriptorHandleForHeapStart(), _frame_index, _rtv_descriptor_size);
+        ID3D12Resource* render_target = back_buffer;
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle = back_buffer_rtv;
+        D3D12_VIEWPORT viewport = _viewport;
+        D3D12_RECT scissor_rect = _scissor_rect;
+        float scale = 1.0f;
+        uint32_t render_width = width;
+        uint32_t render_height = height;
+        if (_dynamic_resolution)
+        {
+            scale = _resolution_controller.get_scale();
+            get_scaled_resolution(width, height, scale, _scene_width, _scene_height, render_width, render_height);
+            render_target = _scene_target.Get();
+            rtv_handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(_rtv_heap->GetCPUDescriptorHandleForHeapStart(), kFrameCount, _rtv_descriptor_size);
+            viewport = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(render_width), static_cast<float>(render_height));
+            scissor_rect = CD3DX12_RECT(0, 0, static_cast<LONG>(render_width), static_cast<LONG>(render_height));
+        }
+        if (_gpu_profiler.get_tracker().is_recording())
+        {
+            _profiled_scales.push_back(scale);
+        }
 
         // Set necessary state.
-        _command_list->SetGraphicsRootSignature(_root_signature.Get());
-        _command_list->RSSetViewports(1, &_viewport);
-        _command_list->RSSetScissorRects(1, &_scissor_rect);
+        command_list.set_graphics_root_signature(_root_signature.Get());
+        command_list.set_viewport(viewport);
+        command_list.set_scissor_rect(scissor_rect);
 
-        // Indicate that the back buffer will be used as a render target.
-        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-        _command_list->ResourceBarrier(1, &barrier);
-
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart(), _frame_index, _rtv_descriptor_size);
-        _command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, nullptr);
+        // Indicate that the render target will be used as a render target.
+        if (_dynamic_resolution)
+        {
+            command_list.transition(render_target, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        }
+        else
+        {
+            command_list.transition(render_target, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        }
+        command_list.set_render_target(rtv_handle, render_target);
 
         // Record commands.
-        const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
-        _command_list->ClearRenderTargetView(rtv_handle, clear_color, 0, nullptr);
-        _command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        _command_list->IASetVertexBuffers(0, 1, &_vertex_buffer_view);
-        _command_list->DrawInstanced(3, 1, 0, 0);
+        {
+            GpuProfileScope scope(_gpu_profiler, command_list.get(), "Clear");
+            const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
+            command_list.clear_render_target(rtv_handle, render_target, clear_color);
+        }
+        {
+            GpuProfileScope scope(_gpu_profiler, command_list.get(), "Triangle");
+            command_list.set_primitive_topology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            command_list.set_vertex_buffer(0, _vertex_buffer_view, _vertex_buffer.Get());
+            command_list.draw_instanced(3, 1, 0, 0);
+        }
+
+        if (_dynamic_resolution)
+        {
+            // Capture is off with dynamic resolution, so the upscale pass goes to the command
+            // list directly.
+            GpuProfileScope scope(_gpu_profiler, command_list.get(), "Upscale");
+            ID3D12GraphicsCommandList* upscale_list = command_list.get();
+            D3D12_RESOURCE_BARRIER barriers[] = {
+                CD3DX12_RESOURCE_BARRIER::Transition(render_target, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+                CD3DX12_RESOURCE_BARRIER::Transition(back_buffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET),
+            };
+            upscale_list->ResourceBarrier(_countof(barriers), barriers);
+            upscale_list->OMSetRenderTargets(1, &back_buffer_rtv, FALSE, nullptr);
+            upscale_list->RSSetViewports(1, &_viewport);
+            upscale_list->RSSetScissorRects(1, &_scissor_rect);
+
+            // Sample only the rendered corner, and keep bilinear taps half a texel inside it
+            // so stale pixels of larger earlier frames do not bleed in.
+            UpscaleConstants constants = {
+                {static_cast<float>(render_width) / static_cast<float>(_scene_width), static_cast<float>(render_height) / static_cast<float>(_scene_height)},
+                {(static_cast<float>(render_width) - 0.5f) / static_cast<float>(_scene_width), (static_cast<float>(render_height) - 0.5f) / static_cast<float>(_scene_height)},
+            };
+            ID3D12DescriptorHeap* heaps[] = {_srv_heap.Get()};
+            upscale_list->SetPipelineState(_upscale_pipeline_state.Get());
+            upscale_list->SetGraphicsRootSignature(_upscale_root_signature.Get());
+            upscale_list->SetDescriptorHeaps(_countof(heaps), heaps);
+            upscale_list->SetGraphicsRootDescriptorTable(0, _srv_heap->GetGPUDescriptorHandleForHeapStart());
+            upscale_list->SetGraphicsRoot32BitConstants(1, sizeof(UpscaleConstants) / sizeof(uint32_t), &constants, 0);
+            upscale_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            upscale_list->DrawInstanced(3, 1, 0, 0);
+        }
 
         // Indicate that the back buffer will now be used to present.
-        auto after_barrier = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-        _command_list->ResourceBarrier(1, &after_barrier);
+        command_list.transition(back_buffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 
-        throw_if_failed(_command_list->Close());
+        // on_render submits this list next, which signals the direct queue's next fence value.
+        _gpu_profiler.end_scope(command_list.get());
+        _gpu_profiler.end_frame(command_list.get(), direct_queue.get_next_fence_value());
     }
 
-    void HelloTriangle::_wait_for_previous_frame()
+    void HelloTriangle::_update_resolution()
     {
-        // WAITING FOR THE FRAME TO COMPLETE BEFORE CONTINUING IS NOT BEST PRACTICE.
-        // This is code implemented as such for simplicity. The D3D12HelloFrameBuffering
-        // sample illustrates how to use fences for efficient resource usage and to
-        // maximize GPU utilization.
-
-        // Signal and increment the fence value.
-        const UINT64 fence = _fence_value;
-        throw_if_failed(_command_queue->Signal(_fence.Get(), fence));
-        _fence_value++;
-
-        // Wait until the previous frame is finished.
-        if (_fence->GetCompletedValue() < fence)
+        // GPU times arrive a few frames late, once the profiler has read them back. When it
+        // reads back several frames at once only the newest time is kept.
+        if (!_dynamic_resolution && !_resolution_trace.is_open())
         {
-            throw_if_failed(_fence->SetEventOnCompletion(fence, _fence_event));
-            WaitForSingleObject(_fence_event, INFINITE);
+            return;
         }
+        for (const auto& stats : _gpu_profiler.get_tracker().get_scope_stats())
+        {
+            if (stats.name != "Frame" || stats.sample_count == _gpu_frame_sample_count)
+            {
+                continue;
+            }
+            uint64_t new_sample_count = stats.sample_count - _gpu_frame_sample_count;
+            _gpu_frame_sample_count = stats.sample_count;
+            float scale = 1.0f;
+            for (uint64_t i = 0; i < new_sample_count && !_profiled_scales.empty(); i++)
+            {
+                scale = _profiled_scales.front();
+                _profiled_scales.pop_front();
+            }
 
+            if (_dynamic_resolution)
+            {
+                _resolution_controller.update(static_cast<float>(stats.last_ms));
+            }
+            if (_resolution_trace.is_open())
+            {
+                _resolution_trace << stats.last_ms << " " << scale << "\n";
+            }
+        }
+    }
+
+    void HelloTriangle::_move_to_next_frame()
+    {
         _frame_index = _swap_chain->GetCurrentBackBufferIndex();
+
+        // Only wait for the GPU to finish the last frame that rendered to this back buffer,
+        // so that recording the next frame overlaps with the GPU executing the current one.
+        _command_contexts.get_queue(QueueType::kDirect).wait_for_fence(_frame_fence_values[_frame_index]);
     }
 }  // namespace learn_d3d12
@@ -1,8 +1,20 @@
 #pragma once
 
+#include "../capture/d3d12_frame_capture.h"
+#include "../memory/frame_arena.h"
+#include "command_context_manager.h"
 #include "d3d12_renderer.h"
+#include "d3d12_residency_backend.h"
+#include "gpu_profiler.h"
+#include "pipeline_swap_queue.h"
+#include "residency_manager.h"
+#include "resolution_controller.h"
+#include "shader_reloader.h"
 #include <DirectXMath.h>
+#include <deque>
 #include <directx/d3dx12.h>
+#include <fstream>
+#include <memory>
 #include <wrl.h>
 
 using Microsoft::WRL::ComPtr;
@@ -12,7 +24,7 @@ namespace learn_d3d12
     class HelloTriangle : public D3d12Renderer
     {
     public:
-        HelloTriangle(uint32_t width, uint32_t height, std::string name);
+        HelloTriangle(uint32_t width, uint32_t height, std::string name, const RendererConfig& config);
         virtual void on_init(HWND hwnd) override;
         virtual void on_destroy() override;
         virtual void on_update() override;
@@ -20,6 +32,9 @@ namespace learn_d3d12
 
     private:
         static const uint32_t kFrameCount = 2;
+        // Slots of the pipeline states hot reloading can replace.
+        static const uint32_t kScenePipelineSlot = 0;
+        static const uint32_t kUpscalePipelineSlot = 1;
 
         struct Vertex
         {
@@ -27,33 +42,94 @@ namespace learn_d3d12
             DirectX::XMFLOAT4 color;
         };
 
+        // Laid out like the UpscaleConstants cbuffer in upscale.hlsl.
+        struct UpscaleConstants
+        {
+            float uv_scale[2];
+            float uv_max[2];
+        };
+
         // Pipeline objects
         CD3DX12_VIEWPORT _viewport;
         CD3DX12_RECT _scissor_rect;
         ComPtr<ID3D12Device> _device;
         ComPtr<IDXGISwapChain3> _swap_chain;
         ComPtr<ID3D12Resource> _render_targets[kFrameCount];
-        ComPtr<ID3D12CommandAllocator> _command_allocator;
-        ComPtr<ID3D12CommandQueue> _command_queue;
+        CommandContextManager _command_contexts;
         ComPtr<ID3D12RootSignature> _root_signature;
         ComPtr<ID3D12DescriptorHeap> _rtv_heap;
         ComPtr<ID3D12PipelineState> _pipeline_state;
-        ComPtr<ID3D12GraphicsCommandList> _command_list;
+        CommandContext _frame_context;
         uint32_t _rtv_descriptor_size;
 
         // App resources
         ComPtr<ID3D12Resource> _vertex_buffer;
+        // Source of the copy queue upload; kept until on_destroy so that it is never
+        // released while the copy may still be running.
+        ComPtr<ID3D12Resource> _vertex_staging_buffer;
         D3D12_VERTEX_BUFFER_VIEW _vertex_buffer_view;
 
         // Synchronization objects
         uint32_t _frame_index;
-        HANDLE _fence_event;
-        ComPtr<ID3D12Fence> _fence;
-        size_t _fence_value;
+        // Direct queue fence value that retires the last frame rendered to each back buffer.
+        uint64_t _frame_fence_values[kFrameCount];
+        // Scratch memory of the frame being recorded, such as the captured command encoding.
+        FrameArena _frame_arena;
+
+        // Profiling
+        GpuProfiler _gpu_profiler;
+
+        // Capture
+        std::string _capture_path;
+        uint32_t _capture_frame_count;
+        D3d12FrameCapture _frame_capture;
+
+        // Residency
+        uint64_t _residency_fallback_budget;
+        std::unique_ptr<D3d12ResidencyBackend> _residency_backend;
+        std::unique_ptr<ResidencyManager> _residency;
+        uint32_t _vertex_buffer_residency;
+        uint32_t _vertex_staging_residency;
+        ResidencySet _frame_residency;
+
+        // Dynamic resolution. The scene target is allocated at the largest scale once; each
+        // frame renders into its top-left corner and the upscale pass stretches that to the
+        // back buffer, so changing the scale never recreates resources.
+        bool _dynamic_resolution;
+        ResolutionController _resolution_controller;
+        std::string _resolution_trace_path;
+        std::ofstream _resolution_trace;
+        // Scales of the profiled frames whose GPU time has not been read back yet, oldest first.
+        std::deque<float> _profiled_scales;
+        uint64_t _gpu_frame_sample_count;
+        uint32_t _scene_width;
+        uint32_t _scene_height;
+        ComPtr<ID3D12Resource> _scene_target;
+        uint32_t _scene_target_residency;
+        ComPtr<ID3D12DescriptorHeap> _srv_heap;
+        ComPtr<ID3D12RootSignature> _upscale_root_signature;
+        ComPtr<ID3D12PipelineState> _upscale_pipeline_state;
+
+        // Hot shader reload. The reloader's worker thread recompiles edited shaders and
+        // rebuilds the pipeline states that use them; on_render swaps those in between frames.
+        bool _shader_hot_reload;
+        std::string _shader_source_dir;
+        std::string _dxc_executable;
+        std::string _shader_model;
+        std::unique_ptr<ShaderReloader> _shader_reloader;
+        PipelineSwapQueue<ComPtr<ID3D12PipelineState>> _pipeline_swaps;
 
         void _load_pipeline(HWND hwnd);
         void _load_assets();
-        void _populate_command_list();
-        void _wait_for_previous_frame();
+        // Both only read objects that never change after _load_assets, so the reloader's
+        // worker thread calls them too.
+        ComPtr<ID3D12PipelineState> _create_pipeline_state();
+        ComPtr<ID3D12PipelineState> _create_upscale_pipeline_state();
+        void _start_shader_reload();
+        void _on_shaders_reloaded(std::vector<ShaderReloadResult>& results);
+        void _swap_reloaded_pipelines();
+        void _populate_command_list(CapturedCommandList& command_list);
+        void _update_resolution();
+        void _move_to_next_frame();
     };
 }  // namespace learn_d3d12
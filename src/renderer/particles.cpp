@@ -0,0 +1,435 @@
+#include "particles.h"
+#include "../logging/log_macros.h"
+#include "../metrics/metrics_registry.h"
+#include "d3d12_helper.h"
+#include "shader_library.h"
+#include <algorithm>
+
+namespace learn_d3d12
+{
+    Particles::Particles(uint32_t width, uint32_t height, std::string name, const RendererConfig& config)
+        : D3d12Renderer(width, height, name)
+        , _viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height))
+        , _scissor_rect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height))
+        , _rtv_descriptor_size(0)
+        , _gpu_simulation(config.gpu_particle_simulation)
+        , _particle_system(std::max(config.particle_count, 1u))
+        , _task_pool(config.gpu_particle_simulation ? 0 : UINT32_MAX)
+        , _constants {}
+        , _particle_upload_data(nullptr)
+        , _stream_size(0)
+    {
+        const ParticleSettings& settings = _particle_system.get_settings();
+        _constants.particle_capacity = _particle_system.get_capacity();
+        _constants.aspect_ratio = aspect_ratio;
+        _constants.particle_size = kParticleSize;
+        _constants.gravity = settings.gravity;
+        _constants.floor_height = settings.floor_height;
+        _constants.restitution = settings.restitution;
+        _constants.spawn_speed = settings.spawn_speed;
+        _constants.spawn_spread = settings.spawn_spread;
+        _constants.min_lifetime = settings.min_lifetime;
+        _constants.max_lifetime = settings.max_lifetime;
+    }
+
+    void Particles::on_init(HWND hwnd)
+    {
+        _load_pipeline(hwnd);
+        _load_assets();
+        _last_update_time = std::chrono::steady_clock::now();
+        LOG_INFO(LearnD3d12, "Simulating {0} particles on the {1}{2}.", _particle_system.get_count(), _gpu_simulation ? "GPU" : "CPU", _gpu_simulation ? "" : (ParticleSystem::is_avx2_available() ? " with AVX2" : " without SIMD"));
+    }
+
+    void Particles::on_destroy()
+    {
+        // Ensure that the GPU is no longer referencing resources that are about to be
+        // cleaned up by the destructor.
+        _wait_for_previous_frame();
+        _gpu_profiler.log_summary();
+        _gpu_profiler.shutdown();
+
+        CloseHandle(_fence_event);
+        _fence.Reset();
+        _command_list.Reset();
+        if (_particle_upload_buffer)
+        {
+            _particle_upload_buffer->Unmap(0, nullptr);
+        }
+        _particle_upload_buffer.Reset();
+        _particle_buffer.Reset();
+        _compute_pipeline_state.Reset();
+        _pipeline_state.Reset();
+        _root_signature.Reset();
+        _command_allocator.Reset();
+        for (auto& render_target : _render_targets)
+        {
+            render_target.Reset();
+        }
+        _rtv_heap.Reset();
+        _swap_chain.Reset();
+        _command_queue.Reset();
+        _device.Reset();
+    }
+
+    void Particles::on_update()
+    {
+        auto now = std::chrono::steady_clock::now();
+        // Clamp long stalls (window drags, breakpoints) so particles do not tunnel through the floor.
+        float delta_time = std::min(std::chrono::duration<float>(now - _last_update_time).count(), 0.1f);
+        _last_update_time = now;
+        _constants.delta_time = delta_time;
+
+        if (_gpu_simulation)
+        {
+            // The compute shader picks up the new constants when the frame is recorded.
+            return;
+        }
+        _particle_system.simulate(delta_time, &_task_pool);
+        // _wait_for_previous_frame guarantees the GPU has finished reading the upload buffer.
+        _upload_particles(_particle_upload_data, false);
+    }
+
+    void Particles::on_render()
+    {
+        auto& metrics = MetricsRegistry::get_instance();
+
+        // Record all the commands we need to render the scene into the command list.
+        {
+            ScopedMetricTimer record_timer(metrics.get_cpu_record_time());
+            _populate_command_list();
+        }
+
+        // Execute the command list.
+        ID3D12CommandList* command_lists[] = {_command_list.Get()};
+        _command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
+
+        // Present the frame.
+        ScopedMetricTimer present_timer(metrics.get_present_wait_time());
+        throw_if_failed(_swap_chain->Present(1, 0));
+
+        _wait_for_previous_frame();
+        _constants.generation++;
+    }
+
+    void Particles::_load_pipeline(HWND hwnd)
+    {
+        // The device may already be under way on another thread (--fast-start).
+        DeviceObjects device_objects = acquire_device();
+        ComPtr<IDXGIFactory4> factory = device_objects.factory;
+        _device = device_objects.device;
+
+        // Describe and create the command queue.
+        D3D12_COMMAND_QUEUE_DESC queue_desc = {};
+        queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+        queue_desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+        throw_if_failed(_device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&_command_queue)));
+
+        _gpu_profiler.initialize(_device.Get(), _command_queue.Get());
+
+        // Describe and create the swap chain.
+        DXGI_SWAP_CHAIN_DESC1 swap_chain_desc = {};
+        swap_chain_desc.BufferCount = kFrameCount;
+        swap_chain_desc.Width = width;
+        swap_chain_desc.Height = height;
+        swap_chain_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+        swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        swap_chain_desc.SampleDesc.Count = 1;
+
+        ComPtr<IDXGISwapChain1> swap_chain;
+        throw_if_failed(factory->CreateSwapChainForHwnd(
+            _command_queue.Get(),  // Swap chain needs the queue so that it can force a flush on it.
+            hwnd,
+            &swap_chain_desc,
+            nullptr,
+            nullptr,
+            &swap_chain));
+
+        // This sample does not support fullscreen transitions.
+        throw_if_failed(factory->MakeWindowAssociation(hwnd, DXGI_MWA_NO_ALT_ENTER));
+
+        throw_if_failed(swap_chain.As(&_swap_chain));
+        _frame_index = _swap_chain->GetCurrentBackBufferIndex();
+
+        // Create descriptor heaps.
+        {
+            // Describe and create a render target view (RTV) descriptor heap.
+            D3D12_DESCRIPTOR_HEAP_DESC rtv_heap_desc = {};
+            rtv_heap_desc.NumDescriptors = kFrameCount;
+            rtv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+            rtv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+            throw_if_failed(_device->CreateDescriptorHeap(&rtv_heap_desc, IID_PPV_ARGS(&_rtv_heap)));
+
+            _rtv_descriptor_size = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        }
+
+        // Create frame resources.
+        {
+            CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart());
+
+            // Create a RTV for each frame.
+            for (uint32_t n = 0; n < kFrameCount; n++)
+            {
+                throw_if_failed(_swap_chain->GetBuffer(n, IID_PPV_ARGS(&_render_targets[n])));
+                _device->CreateRenderTargetView(_render_targets[n].Get(), nullptr, rtv_handle);
+                rtv_handle.Offset(1, _rtv_descriptor_size);
+            }
+        }
+
+        throw_if_failed(_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&_command_allocator)));
+    }
+
+    void Particles::_load_assets()
+    {
+        // Create a root signature with the simulation constants and the particle buffer
+        // bound as root descriptors, so no descriptor heap is needed.
+        {
+            CD3DX12_ROOT_PARAMETER root_parameters[kRootParameterCount];
+            root_parameters[kRootConstants].InitAsConstants(sizeof(ParticleConstants) / sizeof(uint32_t), 0);
+            root_parameters[kRootParticleSrv].InitAsShaderResourceView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+            root_parameters[kRootParticleUav].InitAsUnorderedAccessView(0);
+
+            CD3DX12_ROOT_SIGNATURE_DESC root_signature_desc;
+            root_signature_desc.Init(_countof(root_parameters), root_parameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+            ComPtr<ID3DBlob> signature;
+            ComPtr<ID3DBlob> error;
+            throw_if_failed(D3D12SerializeRootSignature(&root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
+            throw_if_failed(_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&_root_signature)));
+        }
+
+        // Create the pipeline states, which includes loading shaders compiled at build time.
+        {
+            ShaderBytecode vertex_shader = get_shader_bytecode("particles/particles.hlsl", "VSMain");
+            ShaderBytecode pixel_shader = get_shader_bytecode("particles/particles.hlsl", "PSMain");
+            ShaderBytecode compute_shader = get_shader_bytecode("particles/particles.hlsl", "CSMain");
+
+            // Particles are additive, so they do not need sorting or depth.
+            CD3DX12_BLEND_DESC blend_desc(D3D12_DEFAULT);
+            blend_desc.RenderTarget[0].BlendEnable = TRUE;
+            blend_desc.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+            blend_desc.RenderTarget[0].DestBlend = D3D12_BLEND_ONE;
+            blend_desc.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+
+            // Describe and create the graphics pipeline state object (PSO).
+            // Quads are expanded from SV_VertexID, so there is no input layout.
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
+            pso_desc.pRootSignature = _root_signature.Get();
+            pso_desc.VS = CD3DX12_SHADER_BYTECODE(vertex_shader.data, vertex_shader.size);
+            pso_desc.PS = CD3DX12_SHADER_BYTECODE(pixel_shader.data, pixel_shader.size);
+            pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            pso_desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+            pso_desc.BlendState = blend_desc;
+            pso_desc.DepthStencilState.DepthEnable = FALSE;
+            pso_desc.DepthStencilState.StencilEnable = FALSE;
+            pso_desc.SampleMask = UINT_MAX;
+            pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            pso_desc.NumRenderTargets = 1;
+            pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+            pso_desc.SampleDesc.Count = 1;
+            throw_if_failed(_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&_pipeline_state)));
+
+            D3D12_COMPUTE_PIPELINE_STATE_DESC compute_pso_desc = {};
+            compute_pso_desc.pRootSignature = _root_signature.Get();
+            compute_pso_desc.CS = CD3DX12_SHADER_BYTECODE(compute_shader.data, compute_shader.size);
+            throw_if_failed(_device->CreateComputePipelineState(&compute_pso_desc, IID_PPV_ARGS(&_compute_pipeline_state)));
+        }
+
+        // Create the command list.
+        throw_if_failed(_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, _command_allocator.Get(), _pipeline_state.Get(), IID_PPV_ARGS(&_command_list)));
+
+        // Create the particle buffers. Every stream is padded to the system's capacity. The
+        // seed buffer only lives until the initial copy below has finished.
+        ComPtr<ID3D12Resource> seed_buffer;
+        {
+            _stream_size = sizeof(float) * _particle_system.get_capacity();
+            const uint64_t buffer_size = _stream_size * 8;
+
+            CD3DX12_HEAP_PROPERTIES upload_props(D3D12_HEAP_TYPE_UPLOAD);
+            CD3DX12_RESOURCE_DESC upload_desc = CD3DX12_RESOURCE_DESC::Buffer(buffer_size);
+            CD3DX12_RANGE read_range(0, 0);  // We do not intend to read from this resource on the CPU.
+            if (_gpu_simulation)
+            {
+                CD3DX12_HEAP_PROPERTIES default_props(D3D12_HEAP_TYPE_DEFAULT);
+                CD3DX12_RESOURCE_DESC default_desc = CD3DX12_RESOURCE_DESC::Buffer(buffer_size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+                throw_if_failed(_device->CreateCommittedResource(
+                    &default_props,
+                    D3D12_HEAP_FLAG_NONE,
+                    &default_desc,
+                    D3D12_RESOURCE_STATE_COPY_DEST,
+                    nullptr,
+                    IID_PPV_ARGS(&_particle_buffer)));
+
+                // Seed the GPU simulation with the initial CPU state.
+                throw_if_failed(_device->CreateCommittedResource(
+                    &upload_props,
+                    D3D12_HEAP_FLAG_NONE,
+                    &upload_desc,
+                    D3D12_RESOURCE_STATE_GENERIC_READ,
+                    nullptr,
+                    IID_PPV_ARGS(&seed_buffer)));
+                uint8_t* seed_data = nullptr;
+                throw_if_failed(seed_buffer->Map(0, &read_range, reinterpret_cast<void**>(&seed_data)));
+                _upload_particles(seed_data, true);
+                seed_buffer->Unmap(0, nullptr);
+                _command_list->CopyBufferRegion(_particle_buffer.Get(), 0, seed_buffer.Get(), 0, buffer_size);
+                auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(_particle_buffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                _command_list->ResourceBarrier(1, &barrier);
+            }
+            else
+            {
+                throw_if_failed(_device->CreateCommittedResource(
+                    &upload_props,
+                    D3D12_HEAP_FLAG_NONE,
+                    &upload_desc,
+                    D3D12_RESOURCE_STATE_GENERIC_READ,
+                    nullptr,
+                    IID_PPV_ARGS(&_particle_upload_buffer)));
+
+                // The upload buffer stays mapped; the CPU path rewrites it every frame.
+                throw_if_failed(_particle_upload_buffer->Map(0, &read_range, reinterpret_cast<void**>(&_particle_upload_data)));
+                _upload_particles(_particle_upload_data, true);
+            }
+        }
+
+        throw_if_failed(_command_list->Close());
+        ID3D12CommandList* command_lists[] = {_command_list.Get()};
+        _command_queue->ExecuteCommandLists(_countof(command_lists), command_lists);
+
+        // Create synchronization objects and wait until assets have been uploaded to the GPU.
+        {
+            throw_if_failed(_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_fence)));
+            _fence_value = 1;
+
+            // Create an event handle to use for frame synchronization.
+            _fence_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+            if (_fence_event == nullptr)
+            {
+                throw_if_failed(HRESULT_FROM_WIN32(GetLastError()));
+            }
+
+            // Wait for the initial copy to finish before the main loop starts.
+            _wait_for_previous_frame();
+        }
+    }
+
+    void Particles::_upload_particles(uint8_t* destination, bool all_streams)
+    {
+        // Stream order matches particles.hlsl. The vertex shader only reads position,
+        // lifetime and color, so velocities are copied once to seed the GPU simulation.
+        const void* streams[] = {
+            _particle_system.get_position_x(),
+            _particle_system.get_position_y(),
+            _particle_system.get_position_z(),
+            all_streams ? _particle_system.get_velocity_x() : nullptr,
+            all_streams ? _particle_system.get_velocity_y() : nullptr,
+            all_streams ? _particle_system.get_velocity_z() : nullptr,
+            _particle_system.get_lifetime(),
+            _particle_system.get_color(),
+        };
+        for (uint32_t i = 0; i < _countof(streams); i++)
+        {
+            if (streams[i])
+            {
+                memcpy(destination + _stream_size * i, streams[i], _stream_size);
+            }
+        }
+    }
+
+    void Particles::_populate_command_list()
+    {
+        // Command list allocators can only be reset when the associated
+        // command lists have finished execution on the GPU; apps should use
+        // fences to determine GPU execution progress.
+        throw_if_failed(_command_allocator->Reset());
+
+        // However, when ExecuteCommandList() is called on a particular command
+        // list, that command list can then be reset at any time and must be before
+        // re-recording.
+        throw_if_failed(_command_list->Reset(_command_allocator.Get(), _pipeline_state.Get()));
+
+        _gpu_profiler.begin_frame(_fence->GetCompletedValue());
+        _gpu_profiler.begin_scope(_command_list.Get(), "Frame");
+
+        const uint32_t constant_count = sizeof(ParticleConstants) / sizeof(uint32_t);
+        D3D12_GPU_VIRTUAL_ADDRESS particle_address;
+        if (_gpu_simulation)
+        {
+            GpuProfileScope scope(_gpu_profiler, _command_list.Get(), "Simulate");
+            _command_list->SetPipelineState(_compute_pipeline_state.Get());
+            _command_list->SetComputeRootSignature(_root_signature.Get());
+            _command_list->SetComputeRoot32BitConstants(kRootConstants, constant_count, &_constants, 0);
+            _command_list->SetComputeRootUnorderedAccessView(kRootParticleUav, _particle_buffer->GetGPUVirtualAddress());
+            _command_list->Dispatch((_constants.particle_capacity + kComputeGroupSize - 1) / kComputeGroupSize, 1, 1);
+
+            auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(_particle_buffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            _command_list->ResourceBarrier(1, &barrier);
+            _command_list->SetPipelineState(_pipeline_state.Get());
+            particle_address = _particle_buffer->GetGPUVirtualAddress();
+        }
+        else
+        {
+            particle_address = _particle_upload_buffer->GetGPUVirtualAddress();
+        }
+
+        // Set necessary state.
+        _command_list->SetGraphicsRootSignature(_root_signature.Get());
+        _command_list->SetGraphicsRoot32BitConstants(kRootConstants, constant_count, &_constants, 0);
+        _command_list->SetGraphicsRootShaderResourceView(kRootParticleSrv, particle_address);
+        _command_list->RSSetViewports(1, &_viewport);
+        _command_list->RSSetScissorRects(1, &_scissor_rect);
+
+        // Indicate that the back buffer will be used as a render target.
+        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        _command_list->ResourceBarrier(1, &barrier);
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart(), _frame_index, _rtv_descriptor_size);
+        _command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, nullptr);
+
+        // Record commands.
+        {
+            GpuProfileScope scope(_gpu_profiler, _command_list.Get(), "Draw");
+            const float clear_color[] = {0.0f, 0.0f, 0.0f, 1.0f};
+            _command_list->ClearRenderTargetView(rtv_handle, clear_color, 0, nullptr);
+            _command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            _command_list->DrawInstanced(6, _particle_system.get_count(), 0, 0);
+        }
+
+        // Indicate that the back buffer will now be used to present.
+        D3D12_RESOURCE_BARRIER after_barriers[2];
+        uint32_t after_barrier_count = 0;
+        after_barriers[after_barrier_count++] = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        if (_gpu_simulation)
+        {
+            after_barriers[after_barrier_count++] = CD3DX12_RESOURCE_BARRIER::Transition(_particle_buffer.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
+        _command_list->ResourceBarrier(after_barrier_count, after_barriers);
+
+        // _wait_for_previous_frame signals _fence_value right after this list is executed.
+        _gpu_profiler.end_scope(_command_list.Get());
+        _gpu_profiler.end_frame(_command_list.Get(), _fence_value);
+
+        throw_if_failed(_command_list->Close());
+    }
+
+    void Particles::_wait_for_previous_frame()
+    {
+        // Like HelloTriangle, wait for the GPU every frame. This keeps the CPU upload
+        // buffer single-buffered at the cost of CPU/GPU overlap.
+
+        // Signal and increment the fence value.
+        const UINT64 fence = _fence_value;
+        throw_if_failed(_command_queue->Signal(_fence.Get(), fence));
+        _fence_value++;
+
+        // Wait until the previous frame is finished.
+        if (_fence->GetCompletedValue() < fence)
+        {
+            throw_if_failed(_fence->SetEventOnCompletion(fence, _fence_event));
+            WaitForSingleObject(_fence_event, INFINITE);
+        }
+
+        _frame_index = _swap_chain->GetCurrentBackBufferIndex();
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../simulation/particle_system.h"
+#include "../threading/task_pool.h"
+#include "d3d12_renderer.h"
+#include "gpu_profiler.h"
+#include <chrono>
+#include <directx/d3dx12.h>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace learn_d3d12
+{
+    // Fountain of particles drawn as instanced quads. The simulation runs either on the CPU
+    // (ParticleSystem, AVX2 across the task pool) followed by an upload of the streams the
+    // vertex shader needs, or entirely on the GPU in a compute shader writing a UAV.
+    class Particles : public D3d12Renderer
+    {
+    public:
+        Particles(uint32_t width, uint32_t height, std::string name, const RendererConfig& config);
+        virtual void on_init(HWND hwnd) override;
+        virtual void on_destroy() override;
+        virtual void on_update() override;
+        virtual void on_render() override;
+
+    private:
+        static const uint32_t kFrameCount = 2;
+        static const uint32_t kComputeGroupSize = 256;
+        static constexpr float kParticleSize = 0.004f;
+
+        // Laid out like the ParticleConstants cbuffer in particles.hlsl.
+        struct ParticleConstants
+        {
+            uint32_t particle_capacity;
+            uint32_t generation;
+            float delta_time;
+            float aspect_ratio;
+            float particle_size;
+            float gravity;
+            float floor_height;
+            float restitution;
+            float spawn_speed;
+            float spawn_spread;
+            float min_lifetime;
+            float max_lifetime;
+        };
+
+        enum RootParameter
+        {
+            kRootConstants = 0,
+            kRootParticleSrv = 1,
+            kRootParticleUav = 2,
+            kRootParameterCount = 3,
+        };
+
+        // Pipeline objects
+        CD3DX12_VIEWPORT _viewport;
+        CD3DX12_RECT _scissor_rect;
+        ComPtr<ID3D12Device> _device;
+        ComPtr<IDXGISwapChain3> _swap_chain;
+        ComPtr<ID3D12Resource> _render_targets[kFrameCount];
+        ComPtr<ID3D12CommandAllocator> _command_allocator;
+        ComPtr<ID3D12CommandQueue> _command_queue;
+        ComPtr<ID3D12RootSignature> _root_signature;
+        ComPtr<ID3D12DescriptorHeap> _rtv_heap;
+        ComPtr<ID3D12PipelineState> _pipeline_state;
+        ComPtr<ID3D12PipelineState> _compute_pipeline_state;
+        ComPtr<ID3D12GraphicsCommandList> _command_list;
+        uint32_t _rtv_descriptor_size;
+
+        // App resources
+        bool _gpu_simulation;
+        ParticleSystem _particle_system;
+        TaskPool _task_pool;
+        ParticleConstants _constants;
+        std::chrono::steady_clock::time_point _last_update_time;
+        // The upload buffer holds the CPU simulation result and only exists in CPU mode; the
+        // default buffer is the UAV the compute shader simulates in and only exists in GPU
+        // mode. Both share the stream layout of ParticleSystem.
+        ComPtr<ID3D12Resource> _particle_upload_buffer;
+        ComPtr<ID3D12Resource> _particle_buffer;
+        uint8_t* _particle_upload_data;
+        uint64_t _stream_size;
+
+        // Synchronization objects
+        uint32_t _frame_index;
+        HANDLE _fence_event;
+        ComPtr<ID3D12Fence> _fence;
+        size_t _fence_value;
+
+        // Profiling
+        GpuProfiler _gpu_profiler;
+
+        void _load_pipeline(HWND hwnd);
+        void _load_assets();
+        void _upload_particles(uint8_t* destination, bool all_streams);
+        void _populate_command_list();
+        void _wait_for_previous_frame();
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "fence_recycled_pool.h"
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // Hands objects built on another thread, such as pipeline states rebuilt after a shader
+    // edit, to the render thread. The render thread swaps them in between frames, and the
+    // objects they replace are kept until the fence value of the last frame that used them
+    // has completed, so swapping never waits on the GPU. The replaced objects wait in a
+    // FenceRecycledPool that is only ever drained. Objects are identified by a slot index
+    // chosen by the caller. Thread-safe.
+    template<typename Object>
+    class PipelineSwapQueue
+    {
+    public:
+        // Any thread. Replaces an object published for the same slot that was not swapped
+        // in yet; that one was never used by the GPU and is dropped right away.
+        void publish(uint32_t slot, Object object)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (slot >= _pending.size())
+            {
+                _pending.resize(slot + 1);
+            }
+            _pending[slot] = std::move(object);
+        }
+
+        // Render thread, between frames. If an object was published for `slot`, moves it
+        // into `current` and retires the previous one until `last_use_fence_value` has
+        // completed. Returns true if it swapped.
+        bool swap(uint32_t slot, Object& current, uint64_t last_use_fence_value)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (slot >= _pending.size() || !_pending[slot])
+            {
+                return false;
+            }
+            _retired.release(last_use_fence_value, std::move(current));
+            current = std::move(*_pending[slot]);
+            _pending[slot].reset();
+            return true;
+        }
+
+        // Releases the retired objects whose fence value is not beyond `completed_fence_value`.
+        void collect(uint64_t completed_fence_value)
+        {
+            Object object;
+            while (_retired.try_acquire(completed_fence_value, object))
+            {
+                object = Object();
+            }
+        }
+
+        size_t get_retired_count() const { return _retired.get_retired_count(); }
+
+        // Drops every object. Only call once the GPU is idle.
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending.clear();
+            _retired.clear();
+        }
+
+    private:
+        // Guards _pending; the pool has its own lock.
+        std::mutex _mutex;
+        std::vector<std::optional<Object>> _pending;
+        FenceRecycledPool<Object> _retired;
+    };
+}  // namespace learn_d3d12
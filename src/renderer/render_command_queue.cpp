@@ -0,0 +1,88 @@
+#include "render_command_queue.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace learn_d3d12
+{
+    RenderCommandQueue::RenderCommandQueue(uint32_t frame_capacity)
+        : _frame_capacity(std::max(frame_capacity / kRecordAlignment * kRecordAlignment, static_cast<uint32_t>(2 * sizeof(CommandHeader))))
+        , _header_limit(_frame_capacity - static_cast<uint32_t>(sizeof(CommandHeader)))
+        , _head(0)
+        , _dropped_count(0)
+        , _epoch(0)
+    {
+        for (auto& buffer : _frame_buffers)
+        {
+            // Zeroed, so every header starts out unpublished.
+            buffer.reset(new (std::align_val_t(kRecordAlignment)) std::byte[_frame_capacity]());
+        }
+    }
+
+    RenderCommandQueue::~RenderCommandQueue()
+    {
+        // Commands that were never executed still own their captures.
+        _drain(_epoch, _head.load(std::memory_order_acquire), false);
+    }
+
+    uint32_t RenderCommandQueue::execute_pending()
+    {
+        uint64_t epoch = _epoch++;
+        uint64_t head = _head.exchange(_epoch << kOffsetBits, std::memory_order_acq_rel);
+        return _drain(epoch, head, true);
+    }
+
+    RenderCommandQueue::CommandHeader* RenderCommandQueue::_reserve(uint32_t record_size)
+    {
+        uint64_t head = _head.fetch_add(record_size, std::memory_order_acq_rel);
+        uint64_t offset = head & kOffsetMask;
+        std::byte* buffer = _frame_buffers[(head >> kOffsetBits) % kFrameSlotCount].get();
+        if (offset + record_size <= _frame_capacity)
+        {
+            return reinterpret_cast<CommandHeader*>(buffer + offset);
+        }
+        // The first reservation that does not fit always still has room for a header,
+        // because every earlier record ended at or before the header limit.
+        if (offset <= _header_limit)
+        {
+            _publish(reinterpret_cast<CommandHeader*>(buffer + offset), record_size, nullptr);
+        }
+        _dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    void RenderCommandQueue::_publish(CommandHeader* header, uint32_t record_size, DispatchFunction dispatch)
+    {
+        header->dispatch = dispatch;
+        std::atomic_ref<uint32_t>(header->size).store(record_size, std::memory_order_release);
+    }
+
+    uint32_t RenderCommandQueue::_drain(uint64_t epoch, uint64_t head, bool execute)
+    {
+        std::byte* buffer = _frame_buffers[epoch % kFrameSlotCount].get();
+        uint64_t reserved = std::min<uint64_t>(head & kOffsetMask, _frame_capacity);
+        uint32_t offset = 0;
+        uint32_t executed = 0;
+        while (offset < reserved && offset <= _header_limit)
+        {
+            auto* header = reinterpret_cast<CommandHeader*>(buffer + offset);
+            uint32_t size;
+            // A producer that reserved before the switch may still be constructing its command.
+            while ((size = std::atomic_ref<uint32_t>(header->size).load(std::memory_order_acquire)) == 0)
+            {
+                std::this_thread::yield();
+            }
+            if (!header->dispatch)
+            {
+                break;
+            }
+            header->dispatch(header + 1, execute);
+            executed++;
+            offset += size;
+        }
+        // Headers written the next time this buffer is used may land anywhere inside old
+        // records, so everything that was reserved goes back to unpublished.
+        std::memset(buffer, 0, static_cast<size_t>(reserved));
+        return executed;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace learn_d3d12
+{
+    // Lets any thread hand small pieces of work (resource updates, draw registrations,
+    // uploads) to the thread that owns the renderer.
+    //
+    // Commands are callables constructed in place inside a linear buffer that belongs to
+    // the frame being recorded. Reserving space is one fetch_add on a 64-bit word packing
+    // the frame epoch with the write offset, so producers neither lock nor allocate. The
+    // render thread calls execute_pending() at the start of a frame: it switches producers
+    // to the other buffer and runs the previous frame's commands in reservation order.
+    // A full buffer makes enqueue() fail instead of blocking.
+    class RenderCommandQueue
+    {
+    public:
+        static const uint32_t kFrameSlotCount = 2;
+        static const uint32_t kDefaultFrameCapacity = 1 << 20;
+
+        explicit RenderCommandQueue(uint32_t frame_capacity = kDefaultFrameCapacity);
+        ~RenderCommandQueue();
+        RenderCommandQueue(const RenderCommandQueue&) = delete;
+        RenderCommandQueue& operator=(const RenderCommandQueue&) = delete;
+
+        // Thread safe. `command` is later called as command() on the render thread and
+        // destroyed right after. Returns false, dropping the command, when this frame's
+        // buffer is full.
+        template<typename Command>
+        bool enqueue(Command&& command);
+
+        // Render thread only. Returns the number of commands executed.
+        uint32_t execute_pending();
+
+        uint64_t get_dropped_count() const { return _dropped_count.load(std::memory_order_relaxed); }
+        uint32_t get_frame_capacity() const { return _frame_capacity; }
+
+    private:
+        using DispatchFunction = void (*)(void* command, bool execute);
+
+        // Precedes every command in the frame buffer. `size` covers the header and the
+        // command and is written last; zero means the producer has not finished yet.
+        // A null `dispatch` terminates a frame that ran out of space.
+        struct alignas(16) CommandHeader
+        {
+            uint32_t size;
+            uint32_t reserved;
+            DispatchFunction dispatch;
+        };
+
+        static const uint32_t kRecordAlignment = 16;
+        static const uint32_t kOffsetBits = 40;
+        static const uint64_t kOffsetMask = (uint64_t(1) << kOffsetBits) - 1;
+
+        uint32_t _frame_capacity;
+        // Last offset a header may start at; reservations past it only mark the frame end.
+        uint32_t _header_limit;
+        std::unique_ptr<std::byte[]> _frame_buffers[kFrameSlotCount];
+        alignas(64) std::atomic<uint64_t> _head;
+        alignas(64) std::atomic<uint64_t> _dropped_count;
+        uint64_t _epoch;
+
+        CommandHeader* _reserve(uint32_t record_size);
+        static void _publish(CommandHeader* header, uint32_t record_size, DispatchFunction dispatch);
+        uint32_t _drain(uint64_t epoch, uint64_t head, bool execute);
+    };
+
+    template<typename Command>
+    bool RenderCommandQueue::enqueue(Command&& command)
+    {
+        using Stored = std::decay_t<Command>;
+        static_assert(alignof(Stored) <= kRecordAlignment, "Render commands must not be over-aligned.");
+        constexpr uint32_t record_size = (sizeof(CommandHeader) + sizeof(Stored) + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+
+        CommandHeader* header = _reserve(record_size);
+        if (!header)
+        {
+            return false;
+        }
+        try
+        {
+            new (header + 1) Stored(std::forward<Command>(command));
+        }
+        catch (...)
+        {
+            // The slot is already reserved, so it still has to be published for the drain to move past it.
+            _publish(header, record_size, [](void*, bool) {});
+            throw;
+        }
+        _publish(header, record_size, [](void* command, bool execute) {
+            auto* stored = static_cast<Stored*>(command);
+            if (execute)
+            {
+                (*stored)();
+            }
+            stored->~Stored();
+        });
+        return true;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,219 @@
+#include "residency_manager.h"
+#include <algorithm>
+
+namespace learn_d3d12
+{
+    ResidencyManager::ResidencyManager(ResidencyBackend& backend, uint64_t fallback_budget)
+        : _backend(backend)
+        , _fallback_budget(fallback_budget)
+    {
+    }
+
+    uint32_t ResidencyManager::add_object(void* handle, uint64_t size)
+    {
+        uint32_t index;
+        if (!_free_objects.empty())
+        {
+            index = _free_objects.back();
+            _free_objects.pop_back();
+            _objects[index] = {};
+        }
+        else
+        {
+            index = static_cast<uint32_t>(_objects.size());
+            _objects.emplace_back();
+        }
+        Object& object = _objects[index];
+        object.handle = handle;
+        object.size = size;
+        object.resident = true;
+        _link_tail(index);
+        _stats.resident_bytes += size;
+        _stats.resident_count++;
+        return index;
+    }
+
+    void ResidencyManager::remove_object(uint32_t index)
+    {
+        Object& object = _objects[index];
+        if (object.resident)
+        {
+            _unlink(index);
+            _stats.resident_bytes -= object.size;
+            _stats.resident_count--;
+        }
+        object = {};
+        _free_objects.push_back(index);
+    }
+
+    void ResidencyManager::prepare(const ResidencySet& set)
+    {
+        // Objects of this set move to the most recently used end, so the eviction walk
+        // below stops as soon as it reaches one of them.
+        _prepare_stamp++;
+        uint64_t needed_bytes = 0;
+        uint64_t set_bytes = 0;
+        _pending_objects.clear();
+        for (uint32_t index : set.get_objects())
+        {
+            Object& object = _objects[index];
+            if (object.prepare_stamp == _prepare_stamp)
+            {
+                continue;
+            }
+            object.prepare_stamp = _prepare_stamp;
+            set_bytes += object.size;
+            if (object.resident)
+            {
+                _unlink(index);
+                _link_tail(index);
+            }
+            else
+            {
+                needed_bytes += object.size;
+                _pending_objects.push_back(index);
+            }
+        }
+
+        VideoMemoryInfo info;
+        if (!_backend.query_video_memory(info))
+        {
+            info = {_fallback_budget, _stats.resident_bytes};
+        }
+        uint64_t usage = info.current_usage;
+        // When the set cannot fit anyway, stalling on the GPU to evict busy objects would
+        // not avoid paging, so only idle objects are evicted then.
+        const bool may_wait = set_bytes <= info.budget;
+        _pending_handles.clear();
+        while (usage + needed_bytes > info.budget && _lru_head != kInvalidObject)
+        {
+            const uint32_t index = _lru_head;
+            Object& object = _objects[index];
+            if (object.prepare_stamp == _prepare_stamp)
+            {
+                break;
+            }
+            if (!may_wait && !_is_idle(object))
+            {
+                break;
+            }
+            _wait_until_idle(object);
+            _unlink(index);
+            object.resident = false;
+            usage -= std::min(usage, object.size);
+            _stats.resident_bytes -= object.size;
+            _stats.resident_count--;
+            _stats.evicted_bytes += object.size;
+            _stats.eviction_count++;
+            _pending_handles.push_back(object.handle);
+        }
+        if (usage + needed_bytes > info.budget)
+        {
+            // Everything else is needed right now; the OS pages instead.
+            _stats.over_budget_count++;
+        }
+        if (!_pending_handles.empty())
+        {
+            _backend.evict(_pending_handles.data(), static_cast<uint32_t>(_pending_handles.size()));
+        }
+
+        if (_pending_objects.empty())
+        {
+            return;
+        }
+        _pending_handles.clear();
+        for (uint32_t index : _pending_objects)
+        {
+            Object& object = _objects[index];
+            object.resident = true;
+            _link_tail(index);
+            _stats.resident_bytes += object.size;
+            _stats.resident_count++;
+            _pending_handles.push_back(object.handle);
+        }
+        _stats.made_resident_bytes += needed_bytes;
+        _backend.make_resident(_pending_handles.data(), static_cast<uint32_t>(_pending_handles.size()));
+    }
+
+    void ResidencyManager::mark_submitted(const ResidencySet& set, uint32_t queue, uint64_t fence_value)
+    {
+        for (uint32_t index : set.get_objects())
+        {
+            _objects[index].fence_values[queue] = fence_value;
+        }
+    }
+
+    uint64_t ResidencyManager::get_budget()
+    {
+        VideoMemoryInfo info;
+        return _backend.query_video_memory(info) ? info.budget : _fallback_budget;
+    }
+
+    void ResidencyManager::_link_tail(uint32_t index)
+    {
+        Object& object = _objects[index];
+        object.previous = _lru_tail;
+        object.next = kInvalidObject;
+        if (_lru_tail != kInvalidObject)
+        {
+            _objects[_lru_tail].next = index;
+        }
+        else
+        {
+            _lru_head = index;
+        }
+        _lru_tail = index;
+    }
+
+    void ResidencyManager::_unlink(uint32_t index)
+    {
+        Object& object = _objects[index];
+        if (object.previous != kInvalidObject)
+        {
+            _objects[object.previous].next = object.next;
+        }
+        else
+        {
+            _lru_head = object.next;
+        }
+        if (object.next != kInvalidObject)
+        {
+            _objects[object.next].previous = object.previous;
+        }
+        else
+        {
+            _lru_tail = object.previous;
+        }
+        object.previous = kInvalidObject;
+        object.next = kInvalidObject;
+    }
+
+    bool ResidencyManager::_is_idle(const Object& object)
+    {
+        for (uint32_t queue = 0; queue < kQueueCount; queue++)
+        {
+            if (object.fence_values[queue] > _backend.get_completed_fence_value(queue))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void ResidencyManager::_wait_until_idle(Object& object)
+    {
+        bool waited = false;
+        for (uint32_t queue = 0; queue < kQueueCount; queue++)
+        {
+            if (object.fence_values[queue] > _backend.get_completed_fence_value(queue))
+            {
+                _backend.wait_for_fence(queue, object.fence_values[queue]);
+                waited = true;
+            }
+        }
+        if (waited)
+        {
+            _stats.wait_count++;
+        }
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace learn_d3d12
+{
+    struct VideoMemoryInfo
+    {
+        uint64_t budget;
+        uint64_t current_usage;
+    };
+
+    // What ResidencyManager needs from the device: memory numbers, the paging calls and
+    // the queue fences. Handles are opaque; the D3D12 backend passes ID3D12Pageable
+    // pointers and tests pass anything.
+    class ResidencyBackend
+    {
+    public:
+        virtual ~ResidencyBackend() = default;
+
+        // Returns false when the platform cannot report a budget.
+        virtual bool query_video_memory(VideoMemoryInfo& info) = 0;
+        virtual void make_resident(void* const* handles, uint32_t count) = 0;
+        virtual void evict(void* const* handles, uint32_t count) = 0;
+        virtual uint64_t get_completed_fence_value(uint32_t queue) = 0;
+        virtual void wait_for_fence(uint32_t queue, uint64_t fence_value) = 0;
+    };
+
+    // Objects that a batch of command lists references.
+    class ResidencySet
+    {
+    public:
+        void add(uint32_t object) { _objects.push_back(object); }
+        void clear() { _objects.clear(); }
+        const std::vector<uint32_t>& get_objects() const { return _objects; }
+
+    private:
+        std::vector<uint32_t> _objects;
+    };
+
+    // Keeps the heaps the GPU is about to use resident while staying under the video
+    // memory budget. Resident objects form an LRU list ordered by the submission that
+    // last referenced them; when a submission needs more memory than the budget allows,
+    // objects are evicted from the least recently used end. An object the GPU may still
+    // be reading is waited for before it is evicted, so eviction never races the GPU;
+    // if the set alone exceeds the budget, eviction stops at the first busy object.
+    //
+    // The budget comes from the backend when it reports one, otherwise from
+    // `fallback_budget` measured against the bytes this manager has made resident. Not
+    // thread-safe; call it from the thread that submits.
+    class ResidencyManager
+    {
+    public:
+        static constexpr uint32_t kQueueCount = 3;
+        static constexpr uint32_t kInvalidObject = UINT32_MAX;
+
+        struct Stats
+        {
+            uint64_t resident_bytes = 0;
+            uint32_t resident_count = 0;
+            uint64_t made_resident_bytes = 0;
+            uint64_t evicted_bytes = 0;
+            uint64_t eviction_count = 0;
+            // Evictions that had to wait for the GPU first.
+            uint64_t wait_count = 0;
+            // Submissions whose set alone did not fit in the budget.
+            uint64_t over_budget_count = 0;
+        };
+
+        ResidencyManager(ResidencyBackend& backend, uint64_t fallback_budget);
+
+        // Starts tracking a heap or committed resource. Objects are resident when created.
+        uint32_t add_object(void* handle, uint64_t size);
+        // Stops tracking an object the GPU no longer uses.
+        void remove_object(uint32_t object);
+        bool is_resident(uint32_t object) const { return _objects[object].resident; }
+
+        // Makes every object in `set` resident, evicting others if needed. Call right
+        // before executing the command lists that reference `set`.
+        void prepare(const ResidencySet& set);
+        // Marks the objects in `set` as used until `fence_value` completes on `queue`.
+        void mark_submitted(const ResidencySet& set, uint32_t queue, uint64_t fence_value);
+
+        uint64_t get_budget();
+        const Stats& get_stats() const { return _stats; }
+
+    private:
+        struct Object
+        {
+            void* handle = nullptr;
+            uint64_t size = 0;
+            uint64_t fence_values[kQueueCount] = {};
+            uint64_t prepare_stamp = 0;
+            // LRU links, only meaningful while resident.
+            uint32_t previous = kInvalidObject;
+            uint32_t next = kInvalidObject;
+            bool resident = false;
+        };
+
+        ResidencyBackend& _backend;
+        uint64_t _fallback_budget;
+        std::vector<Object> _objects;
+        std::vector<uint32_t> _free_objects;
+        uint32_t _lru_head = kInvalidObject;
+        uint32_t _lru_tail = kInvalidObject;
+        uint64_t _prepare_stamp = 0;
+        Stats _stats;
+        // Scratch lists of prepare().
+        std::vector<uint32_t> _pending_objects;
+        std::vector<void*> _pending_handles;
+
+        void _link_tail(uint32_t object);
+        void _unlink(uint32_t object);
+        bool _is_idle(const Object& object);
+        void _wait_until_idle(Object& object);
+    };
+}  // namespace learn_d3d12
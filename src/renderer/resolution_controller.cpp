@@ -0,0 +1,54 @@
+#include "resolution_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace learn_d3d12
+{
+    ResolutionController::ResolutionController(const ResolutionControllerSettings& settings)
+        : _settings(settings)
+    {
+        _settings.min_scale = std::max(_settings.min_scale, 0.01f);
+        _settings.max_scale = std::max(_settings.max_scale, _settings.min_scale);
+        _min_log_area = 2.0f * std::log(_settings.min_scale);
+        _max_log_area = 2.0f * std::log(_settings.max_scale);
+        reset();
+    }
+
+    void ResolutionController::reset(float scale)
+    {
+        _scale = std::clamp(scale, _settings.min_scale, _settings.max_scale);
+        _log_area = 2.0f * std::log(_scale);
+        _integral = _log_area;
+        _previous_error = 0.0f;
+    }
+
+    float ResolutionController::update(float frame_ms)
+    {
+        if (!(frame_ms > 0.0f))
+        {
+            return _scale;
+        }
+
+        float error = std::log(_settings.target_frame_ms / frame_ms);
+        if (std::fabs(error) < std::log1p(_settings.deadband))
+        {
+            error = 0.0f;
+        }
+
+        _integral = std::clamp(_integral + _settings.integral_gain * error, _min_log_area, _max_log_area);
+        float log_area = _integral + _settings.proportional_gain * error + _settings.derivative_gain * (error - _previous_error);
+        _previous_error = error;
+
+        // Limit the step so a single hitch does not halve the resolution.
+        float max_step = std::log1p(_settings.max_step);
+        _log_area = std::clamp(std::clamp(log_area, _log_area - max_step, _log_area + max_step), _min_log_area, _max_log_area);
+        _scale = std::exp(0.5f * _log_area);
+        return _scale;
+    }
+
+    void get_scaled_resolution(uint32_t width, uint32_t height, float scale, uint32_t max_width, uint32_t max_height, uint32_t& scaled_width, uint32_t& scaled_height)
+    {
+        scaled_width = std::clamp(static_cast<uint32_t>(std::lround(static_cast<float>(width) * scale)), 1u, std::max(max_width, 1u));
+        scaled_height = std::clamp(static_cast<uint32_t>(std::lround(static_cast<float>(height) * scale)), 1u, std::max(max_height, 1u));
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+namespace learn_d3d12
+{
+    struct ResolutionControllerSettings
+    {
+        float target_frame_ms = 14.0f;
+        // Render resolution relative to the output, per axis. Above 1 the scene is supersampled.
+        float min_scale = 0.5f;
+        float max_scale = 1.5f;
+        // Gains act on log(target / measured) and drive the log of the pixel count, since GPU
+        // cost grows with pixels rather than with the per-axis scale. With an integral gain
+        // of 1 and no latency the controller would land on the target in one frame.
+        // The defaults were tuned with LearnD3d12ResolutionSim for two frames of readback
+        // latency; a larger proportional gain mostly turns timing noise into scale jitter.
+        float proportional_gain = 0.1f;
+        float integral_gain = 0.15f;
+        float derivative_gain = 0.0f;
+        // Errors within this fraction of the target count as on target, so timing noise does
+        // not move the resolution every frame.
+        float deadband = 0.05f;
+        // Largest change of the pixel count in one update, as a fraction.
+        float max_step = 0.1f;
+    };
+
+    // PID controller choosing the render scale from measured frame times. It knows nothing
+    // about the graphics API, so it can be tuned offline against recorded traces
+    // (LearnD3d12ResolutionSim). The integral term holds the operating point and is clamped
+    // to the scale range, so it does not wind up while the scale is pinned at a limit.
+    class ResolutionController
+    {
+    public:
+        explicit ResolutionController(const ResolutionControllerSettings& settings = {});
+
+        void reset(float scale = 1.0f);
+        // Feeds one measured frame time and returns the scale for the next frame.
+        float update(float frame_ms);
+
+        float get_scale() const { return _scale; }
+        const ResolutionControllerSettings& get_settings() const { return _settings; }
+
+    private:
+        ResolutionControllerSettings _settings;
+        float _min_log_area;
+        float _max_log_area;
+        float _log_area;
+        float _integral;
+        float _previous_error;
+        float _scale;
+    };
+
+    // Render size for `scale`, at least one pixel and at most `max_width` x `max_height`.
+    void get_scaled_resolution(uint32_t width, uint32_t height, float scale, uint32_t max_width, uint32_t max_height, uint32_t& scaled_width, uint32_t& scaled_height);
+}  // namespace learn_d3d12
@@ -0,0 +1,62 @@
+#include "shader_library.h"
+#include <shader_bytecode_index.inc>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        struct ShaderEntry
+        {
+            std::string_view path;
+            std::string_view entry_point;
+            const unsigned char* data;
+            size_t size;
+        };
+
+        const ShaderEntry kShaderEntries[] = {
+            LEARN_D3D12_SHADER_BYTECODE_ENTRIES};
+
+        // Bytecode set at runtime, keyed by "<path>:<entry point>".
+        std::mutex runtime_mutex;
+        std::unordered_map<std::string, std::shared_ptr<const std::vector<uint8_t>>> runtime_bytecode;
+
+        std::string get_key(std::string_view path, std::string_view entry_point)
+        {
+            return std::string(path) + ":" + std::string(entry_point);
+        }
+    }  // namespace
+
+    ShaderBytecode get_shader_bytecode(std::string_view path, std::string_view entry_point)
+    {
+        {
+            std::lock_guard lock(runtime_mutex);
+            if (!runtime_bytecode.empty())
+            {
+                auto it = runtime_bytecode.find(get_key(path, entry_point));
+                if (it != runtime_bytecode.end())
+                {
+                    return {it->second->data(), it->second->size(), it->second};
+                }
+            }
+        }
+        for (const auto& entry : kShaderEntries)
+        {
+            if (entry.path == path && entry.entry_point == entry_point)
+            {
+                return {entry.data, entry.size, nullptr};
+            }
+        }
+        throw std::runtime_error("Shader " + std::string(path) + ":" + std::string(entry_point) + " was not compiled into the executable.");
+    }
+
+    void set_shader_bytecode(std::string_view path, std::string_view entry_point, std::vector<uint8_t> bytecode)
+    {
+        auto storage = std::make_shared<const std::vector<uint8_t>>(std::move(bytecode));
+        std::lock_guard lock(runtime_mutex);
+        runtime_bytecode[get_key(path, entry_point)] = std::move(storage);
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace learn_d3d12
+{
+    struct ShaderBytecode
+    {
+        const void* data = nullptr;
+        size_t size = 0;
+        // Keeps bytecode set at runtime alive; empty for bytecode compiled at build time.
+        std::shared_ptr<const std::vector<uint8_t>> storage;
+    };
+
+    // Looks up the DXIL of shader/<path>: the bytecode last set with set_shader_bytecode,
+    // or else the bytecode compiled at build time. Thread-safe.
+    // Throws std::runtime_error when the shader was not part of the build.
+    ShaderBytecode get_shader_bytecode(std::string_view path, std::string_view entry_point);
+
+    // Replaces the bytecode get_shader_bytecode returns from now on, for example with a
+    // shader recompiled after an edit. Pipeline states created earlier keep their bytecode.
+    void set_shader_bytecode(std::string_view path, std::string_view entry_point, std::vector<uint8_t> bytecode);
+}  // namespace learn_d3d12
@@ -0,0 +1,422 @@
+#include "shader_reloader.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX  // Avoid compile error
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        // The same patterns learn_d3d12_compile_shaders and scan_shader_includes.cmake use.
+        const std::regex kEntryPointPattern("^[ \t]*(?:\\[[^\\]]*\\][ \t]*)*[A-Za-z_][A-Za-z0-9_]*(?:<[^>]*>)?[ \t]+((VS|PS|CS|AS|MS)Main)[ \t]*\\([^;]*$");
+        const std::regex kIncludePattern("^[ \t]*#[ \t]*include[ \t]*[\"<]([^\">]+)[\">]");
+
+        std::atomic<uint32_t> next_temp_file_id {0};
+
+#ifdef _WIN32
+        // Quotes an argument so that the child's C runtime, which splits its command line
+        // like CommandLineToArgvW, gives it back unchanged.
+        std::wstring quote_argument(const std::wstring& argument)
+        {
+            if (!argument.empty() && argument.find_first_of(L" \t\n\v\"") == std::wstring::npos)
+            {
+                return argument;
+            }
+            std::wstring quoted = L"\"";
+            size_t backslash_count = 0;
+            for (wchar_t c : argument)
+            {
+                if (c == L'\\')
+                {
+                    backslash_count++;
+                    continue;
+                }
+                // Backslashes only escape when they precede a quote.
+                quoted.append(c == L'"' ? backslash_count * 2 + 1 : backslash_count, L'\\');
+                quoted.push_back(c);
+                backslash_count = 0;
+            }
+            quoted.append(backslash_count * 2, L'\\');
+            quoted.push_back(L'"');
+            return quoted;
+        }
+#endif
+
+        // Runs arguments[0] with the other arguments, without a shell in between, and sends
+        // its standard output and error to `log_path`. Returns the exit code, or -1 with the
+        // reason in `error` if the process could not be run.
+        int run_process(const std::vector<std::string>& arguments, const std::filesystem::path& log_path, std::string& error)
+        {
+#ifdef _WIN32
+            std::wstring command_line;
+            for (const auto& argument : arguments)
+            {
+                command_line += (command_line.empty() ? L"" : L" ") + quote_argument(std::filesystem::path(argument).wstring());
+            }
+            SECURITY_ATTRIBUTES security_attributes = {sizeof(security_attributes), nullptr, TRUE};
+            HANDLE log_file = CreateFileW(log_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &security_attributes, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (log_file == INVALID_HANDLE_VALUE)
+            {
+                error = "cannot create " + log_path.string();
+                return -1;
+            }
+            STARTUPINFOW startup_info = {};
+            startup_info.cb = sizeof(startup_info);
+            startup_info.dwFlags = STARTF_USESTDHANDLES;
+            startup_info.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+            startup_info.hStdOutput = log_file;
+            startup_info.hStdError = log_file;
+            PROCESS_INFORMATION process_info = {};
+            BOOL created = CreateProcessW(nullptr, command_line.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &startup_info, &process_info);
+            DWORD create_error = GetLastError();
+            CloseHandle(log_file);
+            if (!created)
+            {
+                error = "cannot run " + arguments[0] + " (error " + std::to_string(create_error) + ")";
+                return -1;
+            }
+            WaitForSingleObject(process_info.hProcess, INFINITE);
+            DWORD exit_code = 0;
+            BOOL got_exit_code = GetExitCodeProcess(process_info.hProcess, &exit_code);
+            CloseHandle(process_info.hThread);
+            CloseHandle(process_info.hProcess);
+            if (!got_exit_code)
+            {
+                error = "cannot get the exit code of " + arguments[0];
+                return -1;
+            }
+            return static_cast<int>(exit_code);
+#else
+            posix_spawn_file_actions_t file_actions;
+            posix_spawn_file_actions_init(&file_actions);
+            posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            posix_spawn_file_actions_adddup2(&file_actions, STDOUT_FILENO, STDERR_FILENO);
+            std::vector<char*> argv;
+            for (const auto& argument : arguments)
+            {
+                argv.push_back(const_cast<char*>(argument.c_str()));
+            }
+            argv.push_back(nullptr);
+            pid_t pid = 0;
+            int spawn_error = posix_spawnp(&pid, argv[0], &file_actions, nullptr, argv.data(), environ);
+            posix_spawn_file_actions_destroy(&file_actions);
+            if (spawn_error != 0)
+            {
+                error = "cannot run " + arguments[0] + ": " + std::strerror(spawn_error);
+                return -1;
+            }
+            int status = 0;
+            pid_t waited = 0;
+            do
+            {
+                waited = waitpid(pid, &status, 0);
+            } while (waited < 0 && errno == EINTR);
+            if (waited < 0)
+            {
+                error = "cannot wait for " + arguments[0] + ": " + std::strerror(errno);
+                return -1;
+            }
+            if (!WIFEXITED(status))
+            {
+                error = arguments[0] + " did not exit normally";
+                return -1;
+            }
+            return WEXITSTATUS(status);
+#endif
+        }
+
+        bool read_file(const std::filesystem::path& path, std::string& content)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+            {
+                return false;
+            }
+            content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        void scan_includes(const std::filesystem::path& root, const std::filesystem::path& file, std::vector<std::string>& visited)
+        {
+            std::string relative = file.lexically_relative(root).generic_string();
+            if (std::find(visited.begin(), visited.end(), relative) != visited.end())
+            {
+                return;
+            }
+            // Includes that cannot be found are kept too: creating them later has to
+            // recompile the shaders that include them.
+            visited.push_back(relative);
+            std::ifstream stream(file);
+            std::string line;
+            while (std::getline(stream, line))
+            {
+                std::smatch match;
+                if (!std::regex_search(line, match, kIncludePattern))
+                {
+                    continue;
+                }
+                std::filesystem::path include_path = file.parent_path() / match[1].str();
+                if (!std::filesystem::exists(include_path))
+                {
+                    include_path = root / match[1].str();
+                }
+                scan_includes(root, include_path.lexically_normal(), visited);
+            }
+        }
+    }  // namespace
+
+    std::string get_shader_profile(const std::string& entry_point, const std::string& shader_model)
+    {
+        std::string stage = entry_point.substr(0, 2);
+        std::transform(stage.begin(), stage.end(), stage.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        if (stage == "as" || stage == "ms")
+        {
+            return stage + "_6_5";
+        }
+        return stage + "_" + shader_model;
+    }
+
+    void ShaderDependencyGraph::scan(const std::filesystem::path& root, const std::string& shader_model)
+    {
+        _permutations.clear();
+        _dependencies.clear();
+        std::filesystem::path normal_root = root.lexically_normal();
+        std::vector<std::filesystem::path> shader_files;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(normal_root, error))
+        {
+            if (entry.is_regular_file(error) && entry.path().extension() == ".hlsl")
+            {
+                shader_files.push_back(entry.path().lexically_normal());
+            }
+        }
+        // Directory iteration order is unspecified; keep the permutations in a stable order.
+        std::sort(shader_files.begin(), shader_files.end());
+
+        for (const auto& shader_file : shader_files)
+        {
+            std::string path = shader_file.lexically_relative(normal_root).generic_string();
+            std::vector<std::string> entry_points;
+            std::ifstream stream(shader_file);
+            std::string line;
+            while (std::getline(stream, line))
+            {
+                std::smatch match;
+                if (std::regex_search(line, match, kEntryPointPattern) && std::find(entry_points.begin(), entry_points.end(), match[1].str()) == entry_points.end())
+                {
+                    entry_points.push_back(match[1].str());
+                }
+            }
+            if (entry_points.empty())
+            {
+                continue;
+            }
+            for (const auto& entry_point : entry_points)
+            {
+                _permutations.push_back({path, entry_point, get_shader_profile(entry_point, shader_model)});
+            }
+            scan_includes(normal_root, shader_file, _dependencies[path]);
+        }
+    }
+
+    const std::vector<std::string>& ShaderDependencyGraph::get_dependencies(const std::string& path) const
+    {
+        static const std::vector<std::string> kNoDependencies;
+        auto it = _dependencies.find(path);
+        return it != _dependencies.end() ? it->second : kNoDependencies;
+    }
+
+    std::vector<uint32_t> ShaderDependencyGraph::get_affected(const std::vector<std::string>& changed_paths) const
+    {
+        bool everything = std::find(changed_paths.begin(), changed_paths.end(), std::string()) != changed_paths.end();
+        std::vector<uint32_t> affected;
+        for (uint32_t i = 0; i < _permutations.size(); i++)
+        {
+            const auto& dependencies = get_dependencies(_permutations[i].path);
+            bool is_affected = everything || std::any_of(changed_paths.begin(), changed_paths.end(), [&](const std::string& path) {
+                                   return std::find(dependencies.begin(), dependencies.end(), path) != dependencies.end();
+                               });
+            if (is_affected)
+            {
+                affected.push_back(i);
+            }
+        }
+        return affected;
+    }
+
+    ShaderReloadScheduler::ShaderReloadScheduler(std::chrono::milliseconds quiet_period)
+        : _quiet_period(quiet_period)
+    {
+    }
+
+    void ShaderReloadScheduler::add_change(const std::string& path, Clock::time_point now)
+    {
+        _pending.insert(path);
+        _last_change = now;
+    }
+
+    std::vector<std::string> ShaderReloadScheduler::take_due(Clock::time_point now)
+    {
+        if (_pending.empty() || now < get_due_time())
+        {
+            return {};
+        }
+        std::vector<std::string> due(_pending.begin(), _pending.end());
+        std::sort(due.begin(), due.end());
+        _pending.clear();
+        return due;
+    }
+
+    ShaderCompileFunction make_dxc_compile_function(std::string dxc_executable)
+    {
+        return [dxc_executable = std::move(dxc_executable)](const std::filesystem::path& root, const ShaderPermutation& permutation, std::vector<uint8_t>& bytecode, std::string& log) {
+            std::error_code error;
+            std::filesystem::path temp_directory = std::filesystem::temp_directory_path(error);
+            std::string stem = "learn_d3d12_shader_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_" + std::to_string(next_temp_file_id++);
+            std::filesystem::path output_path = temp_directory / (stem + ".dxil");
+            std::filesystem::path log_path = temp_directory / (stem + ".log");
+
+            std::vector<std::string> arguments = {dxc_executable, "-nologo", "-T", permutation.profile, "-E", permutation.entry_point, "-I", root.string()};
+#if defined(_DEBUG)
+            arguments.insert(arguments.end(), {"-Zi", "-Od", "-Qembed_debug"});
+#else
+            arguments.push_back("-O3");
+#endif
+            arguments.insert(arguments.end(), {"-Fo", output_path.string(), (root / permutation.path).string()});
+            std::string run_error;
+            int exit_code = run_process(arguments, log_path, run_error);
+
+            read_file(log_path, log);
+            std::string output;
+            bool succeeded = exit_code == 0 && read_file(output_path, output) && !output.empty();
+            if (succeeded)
+            {
+                bytecode.assign(output.begin(), output.end());
+            }
+            else if (!run_error.empty())
+            {
+                log = run_error;
+            }
+            else if (log.empty())
+            {
+                log = "dxc exited with status " + std::to_string(exit_code);
+            }
+            std::filesystem::remove(output_path, error);
+            std::filesystem::remove(log_path, error);
+            return succeeded;
+        };
+    }
+
+    ShaderReloader::ShaderReloader(Settings settings)
+        : _settings(std::move(settings))
+        , _scheduler(_settings.quiet_period)
+    {
+    }
+
+    ShaderReloader::~ShaderReloader()
+    {
+        stop();
+    }
+
+    bool ShaderReloader::start(std::string& error)
+    {
+        stop();
+        if (!_settings.compile)
+        {
+            error = "no shader compiler";
+            return false;
+        }
+        if (!_watcher.start(_settings.shader_root, error))
+        {
+            return false;
+        }
+        _stop_requested = false;
+        _worker = std::thread([this] { _run(); });
+        return true;
+    }
+
+    void ShaderReloader::stop()
+    {
+        _stop_requested = true;
+        if (_worker.joinable())
+        {
+            _worker.join();
+        }
+        _watcher.stop();
+    }
+
+    void ShaderReloader::_run()
+    {
+        std::vector<std::string> changed;
+        while (!_stop_requested.load(std::memory_order_relaxed))
+        {
+            // Wake up when the pending batch becomes due, or to check for stop requests.
+            auto timeout = kPollInterval;
+            if (_scheduler.has_pending())
+            {
+                auto until_due = std::chrono::ceil<std::chrono::milliseconds>(_scheduler.get_due_time() - ShaderReloadScheduler::Clock::now());
+                timeout = std::clamp(until_due, std::chrono::milliseconds(0), kPollInterval);
+            }
+            changed.clear();
+            _watcher.wait_for_changes(timeout, changed);
+
+            auto now = ShaderReloadScheduler::Clock::now();
+            for (const auto& path : changed)
+            {
+                _scheduler.add_change(path, now);
+            }
+            std::vector<std::string> due = _scheduler.take_due(now);
+            if (!due.empty())
+            {
+                _compile(due);
+            }
+        }
+    }
+
+    void ShaderReloader::_compile(const std::vector<std::string>& changed_paths)
+    {
+        // Rescan first: the edit may have added an entry point, an include or a shader.
+        _graph.scan(_settings.shader_root, _settings.shader_model);
+        std::vector<uint32_t> affected = _graph.get_affected(changed_paths);
+        if (affected.empty())
+        {
+            return;
+        }
+
+        std::vector<ShaderReloadResult> results;
+        results.reserve(affected.size());
+        for (uint32_t index : affected)
+        {
+            if (_stop_requested.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            ShaderReloadResult& result = results.emplace_back();
+            result.permutation = _graph.get_permutations()[index];
+            auto start = std::chrono::steady_clock::now();
+            result.succeeded = _settings.compile(_settings.shader_root, result.permutation, result.bytecode, result.log);
+            result.compile_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (_settings.on_batch)
+        {
+            _settings.on_batch(results);
+        }
+    }
+}  // namespace learn_d3d12
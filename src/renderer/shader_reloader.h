@@ -0,0 +1,129 @@
+#pragma once
+
+#include "file_watcher.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // One entry point of one shader file, named like get_shader_bytecode names it.
+    struct ShaderPermutation
+    {
+        // Relative to the shader directory, with '/' separators.
+        std::string path;
+        std::string entry_point;
+        // DXC target profile, for example "ps_6_0".
+        std::string profile;
+    };
+
+    // The profile learn_d3d12_compile_shaders uses for `entry_point`: amplification and mesh
+    // shaders need shader model 6.5, every other stage uses `shader_model` ("6_0").
+    std::string get_shader_profile(const std::string& entry_point, const std::string& shader_model);
+
+    // Which entry points every .hlsl under the shader directory has and which files each
+    // one includes, found with the same rules learn_d3d12_compile_shaders and
+    // scan_shader_includes.cmake apply at build time.
+    class ShaderDependencyGraph
+    {
+    public:
+        void scan(const std::filesystem::path& root, const std::string& shader_model);
+
+        const std::vector<ShaderPermutation>& get_permutations() const { return _permutations; }
+        // Files the shader at `path` compiles, itself first, relative to the root.
+        const std::vector<std::string>& get_dependencies(const std::string& path) const;
+        // Indices of the permutations that compile any of `changed_paths`. An empty path
+        // stands for an unknown change and selects every permutation.
+        std::vector<uint32_t> get_affected(const std::vector<std::string>& changed_paths) const;
+
+    private:
+        std::vector<ShaderPermutation> _permutations;
+        std::unordered_map<std::string, std::vector<std::string>> _dependencies;
+    };
+
+    // Decides when a batch of changes is ready to be compiled. Editors often write a file
+    // several times for one save, so a batch is only released once nothing changed for
+    // `quiet_period`. Holds no threads and takes the time as a parameter.
+    class ShaderReloadScheduler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit ShaderReloadScheduler(std::chrono::milliseconds quiet_period);
+
+        void add_change(const std::string& path, Clock::time_point now);
+        bool has_pending() const { return !_pending.empty(); }
+        // When the pending batch becomes due, if nothing else changes.
+        Clock::time_point get_due_time() const { return _last_change + _quiet_period; }
+        // The changed paths once they are due, each once; empty before that.
+        std::vector<std::string> take_due(Clock::time_point now);
+
+    private:
+        std::chrono::milliseconds _quiet_period;
+        Clock::time_point _last_change;
+        std::unordered_set<std::string> _pending;
+    };
+
+    struct ShaderReloadResult
+    {
+        ShaderPermutation permutation;
+        bool succeeded = false;
+        std::vector<uint8_t> bytecode;
+        // Compiler output, the errors when compilation failed.
+        std::string log;
+        double compile_ms = 0.0;
+    };
+
+    // Compiles one permutation of a shader under `root`. Returns false with the reason in `log`.
+    using ShaderCompileFunction = std::function<bool(const std::filesystem::path& root, const ShaderPermutation& permutation, std::vector<uint8_t>& bytecode, std::string& log)>;
+
+    // Runs the DXC executable once per permutation with the options learn_d3d12_compile_shaders uses.
+    ShaderCompileFunction make_dxc_compile_function(std::string dxc_executable);
+
+    // Watches the shader directory and recompiles the permutations affected by every
+    // batch of edits on a worker thread, which then hands the results to `on_batch`. The
+    // worker never touches the renderer; `on_batch` decides what to rebuild.
+    class ShaderReloader
+    {
+    public:
+        struct Settings
+        {
+            std::filesystem::path shader_root;
+            std::string shader_model = "6_0";
+            std::chrono::milliseconds quiet_period {100};
+            ShaderCompileFunction compile;
+            // Called on the worker thread with the results of one batch, failures included.
+            std::function<void(std::vector<ShaderReloadResult>& results)> on_batch;
+        };
+
+        explicit ShaderReloader(Settings settings);
+        ~ShaderReloader();
+        ShaderReloader(const ShaderReloader&) = delete;
+        ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+        bool start(std::string& error);
+        // Waits for the batch being compiled, if any.
+        void stop();
+
+    private:
+        // The longest the worker waits before checking whether it should stop.
+        static constexpr std::chrono::milliseconds kPollInterval {100};
+
+        Settings _settings;
+        FileWatcher _watcher;
+        ShaderReloadScheduler _scheduler;
+        ShaderDependencyGraph _graph;
+        std::thread _worker;
+        std::atomic<bool> _stop_requested {false};
+
+        void _run();
+        void _compile(const std::vector<std::string>& changed_paths);
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,374 @@
+#include "skinned_meshes.h"
+#include "../logging/log_macros.h"
+#include "../metrics/metrics_registry.h"
+#include "d3d12_helper.h"
+#include "shader_library.h"
+#include <algorithm>
+#include <cmath>
+#include <memory_resource>
+
+namespace learn_d3d12
+{
+    SkinnedMeshes::SkinnedMeshes(uint32_t width, uint32_t height, std::string name, const RendererConfig& config)
+        : D3d12Renderer(width, height, name)
+        , _viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height))
+        , _scissor_rect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height))
+        , _rtv_descriptor_size(0)
+        , _indices()
+        , _mesh(make_skinned_tube(kRingCount, kRingVertexCount, kBoneCount, kTubeLength, kTubeRadius, &_indices))
+        , _mesh_count(std::max(config.skinned_mesh_count, 1u))
+        , _palettes(static_cast<size_t>(_mesh_count) * kBoneCount)
+        , _jobs(_mesh_count)
+        , _task_pool(UINT32_MAX)
+        , _frame_arena(kFrameCount)
+        , _vertex_upload_data {}
+        , _vertex_buffer_views {}
+        , _index_buffer_view {}
+        , _frame_index(0)
+        , _frame_fence_values {}
+    {
+    }
+
+    void SkinnedMeshes::on_init(HWND hwnd)
+    {
+        _load_pipeline(hwnd);
+        _load_assets();
+        _start_time = std::chrono::steady_clock::now();
+        LOG_INFO(LearnD3d12, "Skinning {0} meshes of {1} vertices on {2} threads{3}.", _mesh_count, _mesh.get_vertex_count(), _task_pool.get_thread_count(), is_skinning_avx2_available() ? " with AVX2" : " without SIMD");
+    }
+
+    void SkinnedMeshes::on_destroy()
+    {
+        // Ensure that the GPU is no longer referencing resources that are about to be
+        // cleaned up by the destructor.
+        _command_contexts.wait_idle();
+        _gpu_profiler.log_summary();
+        _gpu_profiler.shutdown();
+
+        for (auto& vertex_upload_buffer : _vertex_upload_buffers)
+        {
+            if (vertex_upload_buffer)
+            {
+                vertex_upload_buffer->Unmap(0, nullptr);
+            }
+            vertex_upload_buffer.Reset();
+        }
+        _index_buffer.Reset();
+        _pipeline_state.Reset();
+        _root_signature.Reset();
+        for (auto& render_target : _render_targets)
+        {
+            render_target.Reset();
+        }
+        _depth_buffer.Reset();
+        _dsv_heap.Reset();
+        _rtv_heap.Reset();
+        _swap_chain.Reset();
+        _command_contexts.shutdown();
+        _device.Reset();
+    }
+
+    void SkinnedMeshes::on_update()
+    {
+        float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - _start_time).count();
+        for (uint32_t m = 0; m < _mesh_count; m++)
+        {
+            animate_tube_palette(time, static_cast<float>(m) * 0.7f, kBoneCount, kTubeLength, &_palettes[static_cast<size_t>(m) * kBoneCount]);
+        }
+        // _move_to_next_frame waited for the last frame that read this back buffer's vertex
+        // buffer, so the kernels write into it directly instead of going through a staging
+        // copy.
+        for (uint32_t m = 0; m < _mesh_count; m++)
+        {
+            _jobs[m].destination = _vertex_upload_data[_frame_index] + static_cast<size_t>(m) * _mesh.get_vertex_count();
+        }
+        // The arena cycles its slots on its own, so the frame that last used the next slot
+        // is not necessarily the one _move_to_next_frame waited for.
+        CommandQueue& direct_queue = _command_contexts.get_queue(QueueType::kDirect);
+        while (!_frame_arena.begin_frame(direct_queue.get_completed_fence_value()))
+        {
+            direct_queue.wait_for_fence(_frame_arena.get_required_fence_value());
+        }
+        skin_meshes(_jobs.data(), _mesh_count, &_task_pool, true, _frame_arena.get_resource());
+    }
+
+    void SkinnedMeshes::on_render()
+    {
+        auto& metrics = MetricsRegistry::get_instance();
+
+        // Record all the commands we need to render the scene into the command list. The
+        // manager hands out an allocator whose previous command lists have finished
+        // executing on the GPU, and an open command list recording into it.
+        _frame_context = _command_contexts.begin(QueueType::kDirect, _pipeline_state.Get());
+        {
+            ScopedMetricTimer record_timer(metrics.get_cpu_record_time());
+            _populate_command_list();
+        }
+
+        // Execute the command list.
+        _frame_fence_values[_frame_index] = _command_contexts.submit(_frame_context);
+        _frame_arena.end_frame(_frame_fence_values[_frame_index]);
+
+        // Present the frame.
+        {
+            ScopedMetricTimer present_timer(metrics.get_present_wait_time());
+            throw_if_failed(_swap_chain->Present(1, 0));
+        }
+
+        _move_to_next_frame();
+    }
+
+    void SkinnedMeshes::_load_pipeline(HWND hwnd)
+    {
+        // The device may already be under way on another thread (--fast-start).
+        DeviceObjects device_objects = acquire_device();
+        ComPtr<IDXGIFactory4> factory = device_objects.factory;
+        _device = device_objects.device;
+
+        // Create the direct, compute and copy queues.
+        _command_contexts.initialize(_device.Get());
+        ID3D12CommandQueue* direct_queue = _command_contexts.get_queue(QueueType::kDirect).get_command_queue();
+
+        _gpu_profiler.initialize(_device.Get(), direct_queue);
+
+        // Describe and create the swap chain.
+        DXGI_SWAP_CHAIN_DESC1 swap_chain_desc = {};
+        swap_chain_desc.BufferCount = kFrameCount;
+        swap_chain_desc.Width = width;
+        swap_chain_desc.Height = height;
+        swap_chain_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+        swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        swap_chain_desc.SampleDesc.Count = 1;
+
+        ComPtr<IDXGISwapChain1> swap_chain;
+        throw_if_failed(factory->CreateSwapChainForHwnd(
+            direct_queue,  // Swap chain needs the queue so that it can force a flush on it.
+            hwnd,
+            &swap_chain_desc,
+            nullptr,
+            nullptr,
+            &swap_chain));
+
+        // This sample does not support fullscreen transitions.
+        throw_if_failed(factory->MakeWindowAssociation(hwnd, DXGI_MWA_NO_ALT_ENTER));
+
+        throw_if_failed(swap_chain.As(&_swap_chain));
+        _frame_index = _swap_chain->GetCurrentBackBufferIndex();
+
+        // Create descriptor heaps.
+        {
+            // Describe and create a render target view (RTV) descriptor heap.
+            D3D12_DESCRIPTOR_HEAP_DESC rtv_heap_desc = {};
+            rtv_heap_desc.NumDescriptors = kFrameCount;
+            rtv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+            rtv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+            throw_if_failed(_device->CreateDescriptorHeap(&rtv_heap_desc, IID_PPV_ARGS(&_rtv_heap)));
+
+            _rtv_descriptor_size = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+
+            // The tubes overlap each other, so unlike the other variants this one needs depth.
+            D3D12_DESCRIPTOR_HEAP_DESC dsv_heap_desc = {};
+            dsv_heap_desc.NumDescriptors = 1;
+            dsv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+            dsv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+            throw_if_failed(_device->CreateDescriptorHeap(&dsv_heap_desc, IID_PPV_ARGS(&_dsv_heap)));
+        }
+
+        // Create frame resources.
+        {
+            CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart());
+
+            // Create a RTV for each frame.
+            for (uint32_t n = 0; n < kFrameCount; n++)
+            {
+                throw_if_failed(_swap_chain->GetBuffer(n, IID_PPV_ARGS(&_render_targets[n])));
+                _device->CreateRenderTargetView(_render_targets[n].Get(), nullptr, rtv_handle);
+                rtv_handle.Offset(1, _rtv_descriptor_size);
+            }
+
+            CD3DX12_HEAP_PROPERTIES default_props(D3D12_HEAP_TYPE_DEFAULT);
+            CD3DX12_RESOURCE_DESC depth_desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+            CD3DX12_CLEAR_VALUE depth_clear_value(DXGI_FORMAT_D32_FLOAT, 1.0f, 0);
+            throw_if_failed(_device->CreateCommittedResource(
+                &default_props,
+                D3D12_HEAP_FLAG_NONE,
+                &depth_desc,
+                D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                &depth_clear_value,
+                IID_PPV_ARGS(&_depth_buffer)));
+            _device->CreateDepthStencilView(_depth_buffer.Get(), nullptr, _dsv_heap->GetCPUDescriptorHandleForHeapStart());
+        }
+    }
+
+    void SkinnedMeshes::_load_assets()
+    {
+        // Create a root signature with the per-mesh constants.
+        {
+            CD3DX12_ROOT_PARAMETER root_parameters[1];
+            root_parameters[0].InitAsConstants(sizeof(MeshConstants) / sizeof(uint32_t), 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+            CD3DX12_ROOT_SIGNATURE_DESC root_signature_desc;
+            root_signature_desc.Init(_countof(root_parameters), root_parameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+            ComPtr<ID3DBlob> signature;
+            ComPtr<ID3DBlob> error;
+            throw_if_failed(D3D12SerializeRootSignature(&root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
+            throw_if_failed(_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&_root_signature)));
+        }
+
+        // Create the pipeline state, which includes loading shaders compiled at build time.
+        {
+            ShaderBytecode vertex_shader = get_shader_bytecode("skinned_meshes/skinned_meshes.hlsl", "VSMain");
+            ShaderBytecode pixel_shader = get_shader_bytecode("skinned_meshes/skinned_meshes.hlsl", "PSMain");
+
+            // Define the vertex input layout; it matches SkinnedVertex.
+            D3D12_INPUT_ELEMENT_DESC input_element_descs[] =
+                {
+                    {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+                    {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
+
+            // Describe and create the graphics pipeline state object (PSO).
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
+            pso_desc.InputLayout = {input_element_descs, _countof(input_element_descs)};
+            pso_desc.pRootSignature = _root_signature.Get();
+            pso_desc.VS = CD3DX12_SHADER_BYTECODE(vertex_shader.data, vertex_shader.size);
+            pso_desc.PS = CD3DX12_SHADER_BYTECODE(pixel_shader.data, pixel_shader.size);
+            pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            pso_desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+            pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+            pso_desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+            pso_desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+            pso_desc.SampleMask = UINT_MAX;
+            pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            pso_desc.NumRenderTargets = 1;
+            pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+            pso_desc.SampleDesc.Count = 1;
+            throw_if_failed(_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&_pipeline_state)));
+        }
+
+        // Create the vertex and index buffers. Both live in upload heaps: the vertices are
+        // rewritten by the CPU every frame, and the indices are small and never change.
+        {
+            CD3DX12_HEAP_PROPERTIES upload_props(D3D12_HEAP_TYPE_UPLOAD);
+            CD3DX12_RANGE read_range(0, 0);  // We do not intend to read from these resources on the CPU.
+
+            const uint64_t mesh_size = sizeof(SkinnedVertex) * _mesh.get_vertex_count();
+            const uint64_t vertex_buffer_size = mesh_size * _mesh_count;
+            CD3DX12_RESOURCE_DESC vertex_desc = CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size);
+            for (uint32_t n = 0; n < kFrameCount; n++)
+            {
+                throw_if_failed(_device->CreateCommittedResource(
+                    &upload_props,
+                    D3D12_HEAP_FLAG_NONE,
+                    &vertex_desc,
+                    D3D12_RESOURCE_STATE_GENERIC_READ,
+                    nullptr,
+                    IID_PPV_ARGS(&_vertex_upload_buffers[n])));
+                throw_if_failed(_vertex_upload_buffers[n]->Map(0, &read_range, reinterpret_cast<void**>(&_vertex_upload_data[n])));
+
+                _vertex_buffer_views[n].BufferLocation = _vertex_upload_buffers[n]->GetGPUVirtualAddress();
+                _vertex_buffer_views[n].StrideInBytes = sizeof(SkinnedVertex);
+                _vertex_buffer_views[n].SizeInBytes = static_cast<UINT>(vertex_buffer_size);
+            }
+
+            const uint64_t index_buffer_size = sizeof(uint32_t) * _indices.size();
+            CD3DX12_RESOURCE_DESC index_desc = CD3DX12_RESOURCE_DESC::Buffer(index_buffer_size);
+            throw_if_failed(_device->CreateCommittedResource(
+                &upload_props,
+                D3D12_HEAP_FLAG_NONE,
+                &index_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&_index_buffer)));
+            void* index_data;
+            throw_if_failed(_index_buffer->Map(0, &read_range, &index_data));
+            memcpy(index_data, _indices.data(), index_buffer_size);
+            _index_buffer->Unmap(0, nullptr);
+
+            _index_buffer_view.BufferLocation = _index_buffer->GetGPUVirtualAddress();
+            _index_buffer_view.Format = DXGI_FORMAT_R32_UINT;
+            _index_buffer_view.SizeInBytes = static_cast<UINT>(index_buffer_size);
+
+            // Each mesh owns a slice of the palettes, and of the vertex buffer on_update
+            // skins into.
+            for (uint32_t m = 0; m < _mesh_count; m++)
+            {
+                _jobs[m] = {&_mesh, &_palettes[static_cast<size_t>(m) * kBoneCount], nullptr};
+            }
+        }
+    }
+
+    void SkinnedMeshes::_populate_command_list()
+    {
+        CommandQueue& direct_queue = _command_contexts.get_queue(QueueType::kDirect);
+        ID3D12GraphicsCommandList* command_list = _frame_context.command_list.Get();
+
+        // Pick up timings of frames the GPU has already finished, without waiting on it.
+        _gpu_profiler.begin_frame(direct_queue.get_completed_fence_value());
+        _gpu_profiler.begin_scope(command_list, "Frame");
+
+        // Set necessary state.
+        command_list->SetGraphicsRootSignature(_root_signature.Get());
+        command_list->RSSetViewports(1, &_viewport);
+        command_list->RSSetScissorRects(1, &_scissor_rect);
+
+        // Indicate that the back buffer will be used as a render target.
+        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        command_list->ResourceBarrier(1, &barrier);
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart(), _frame_index, _rtv_descriptor_size);
+        D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle = _dsv_heap->GetCPUDescriptorHandleForHeapStart();
+        command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, &dsv_handle);
+
+        // Record commands.
+        {
+            GpuProfileScope scope(_gpu_profiler, command_list, "Draw");
+            const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
+            command_list->ClearRenderTargetView(rtv_handle, clear_color, 0, nullptr);
+            command_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+            command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            command_list->IASetVertexBuffers(0, 1, &_vertex_buffer_views[_frame_index]);
+            command_list->IASetIndexBuffer(&_index_buffer_view);
+
+            // The meshes stand on a square grid centred on the origin, listed row by row from
+            // the one nearest the camera. Drawing front to back like this lets the depth test
+            // reject the hidden parts of the rows behind.
+            const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(_mesh_count))));
+            const float spacing = 3.0f / static_cast<float>(columns);
+            std::pmr::vector<DrawItem> draws(_frame_arena.get_resource());
+            draws.reserve(_mesh_count);
+            for (uint32_t m = 0; m < _mesh_count; m++)
+            {
+                draws.push_back({m,
+                                 {
+                                     (static_cast<float>(m % columns) - 0.5f * static_cast<float>(columns - 1)) * spacing,
+                                     (static_cast<float>(m / columns) - 0.5f * static_cast<float>(columns - 1)) * spacing,
+                                     aspect_ratio,
+                                 }});
+            }
+            for (const DrawItem& draw : draws)
+            {
+                command_list->SetGraphicsRoot32BitConstants(0, sizeof(MeshConstants) / sizeof(uint32_t), &draw.constants, 0);
+                command_list->DrawIndexedInstanced(static_cast<UINT>(_indices.size()), 1, 0, static_cast<INT>(draw.mesh * _mesh.get_vertex_count()), 0);
+            }
+        }
+
+        // Indicate that the back buffer will now be used to present.
+        barrier = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        command_list->ResourceBarrier(1, &barrier);
+
+        // on_render submits this list next, which signals the queue's next fence value.
+        _gpu_profiler.end_scope(command_list);
+        _gpu_profiler.end_frame(command_list, direct_queue.get_next_fence_value());
+    }
+
+    void SkinnedMeshes::_move_to_next_frame()
+    {
+        _frame_index = _swap_chain->GetCurrentBackBufferIndex();
+
+        // Only wait for the GPU to finish the last frame that rendered to this back buffer,
+        // so that skinning the next frame overlaps with the GPU drawing this one.
+        _command_contexts.get_queue(QueueType::kDirect).wait_for_fence(_frame_fence_values[_frame_index]);
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../animation/cpu_skinning.h"
+#include "../memory/frame_arena.h"
+#include "../threading/task_pool.h"
+#include "command_context_manager.h"
+#include "d3d12_renderer.h"
+#include "gpu_profiler.h"
+#include <chrono>
+#include <directx/d3dx12.h>
+#include <vector>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace learn_d3d12
+{
+    // A grid of bending tubes skinned on the CPU. Every frame the bone palettes are
+    // animated and all meshes are skinned across the task pool (AVX2 when available)
+    // straight into a persistently mapped upload buffer the vertex shader reads. There is
+    // one such buffer per back buffer, so skinning the next frame overlaps with the GPU
+    // drawing the current one.
+    class SkinnedMeshes : public D3d12Renderer
+    {
+    public:
+        SkinnedMeshes(uint32_t width, uint32_t height, std::string name, const RendererConfig& config);
+        virtual void on_init(HWND hwnd) override;
+        virtual void on_destroy() override;
+        virtual void on_update() override;
+        virtual void on_render() override;
+
+    private:
+        static const uint32_t kFrameCount = 2;
+        static const uint32_t kRingCount = 64;
+        static const uint32_t kRingVertexCount = 32;
+        static const uint32_t kBoneCount = 32;
+        static constexpr float kTubeLength = 1.0f;
+        static constexpr float kTubeRadius = 0.03f;
+
+        // Laid out like the MeshConstants cbuffer in skinned_meshes.hlsl.
+        struct MeshConstants
+        {
+            float offset_x;
+            float offset_z;
+            float aspect_ratio;
+        };
+
+        struct DrawItem
+        {
+            uint32_t mesh;
+            MeshConstants constants;
+        };
+
+        // Pipeline objects
+        CD3DX12_VIEWPORT _viewport;
+        CD3DX12_RECT _scissor_rect;
+        ComPtr<ID3D12Device> _device;
+        ComPtr<IDXGISwapChain3> _swap_chain;
+        ComPtr<ID3D12Resource> _render_targets[kFrameCount];
+        ComPtr<ID3D12Resource> _depth_buffer;
+        CommandContextManager _command_contexts;
+        ComPtr<ID3D12RootSignature> _root_signature;
+        ComPtr<ID3D12DescriptorHeap> _rtv_heap;
+        ComPtr<ID3D12DescriptorHeap> _dsv_heap;
+        ComPtr<ID3D12PipelineState> _pipeline_state;
+        CommandContext _frame_context;
+        uint32_t _rtv_descriptor_size;
+
+        // App resources
+        // Every mesh shares the bind pose and indices; only the palettes differ. The
+        // indices are declared first because making the mesh fills them.
+        std::vector<uint32_t> _indices;
+        SkinnedMesh _mesh;
+        uint32_t _mesh_count;
+        std::vector<Float3x4> _palettes;
+        std::vector<SkinningJob> _jobs;
+        TaskPool _task_pool;
+        // Transient data of the frame being built: skinning chunks and the draw list.
+        FrameArena _frame_arena;
+        std::chrono::steady_clock::time_point _start_time;
+        // Persistently mapped skinned vertex buffers, one per back buffer.
+        ComPtr<ID3D12Resource> _vertex_upload_buffers[kFrameCount];
+        SkinnedVertex* _vertex_upload_data[kFrameCount];
+        D3D12_VERTEX_BUFFER_VIEW _vertex_buffer_views[kFrameCount];
+        ComPtr<ID3D12Resource> _index_buffer;
+        D3D12_INDEX_BUFFER_VIEW _index_buffer_view;
+
+        // Synchronization objects
+        uint32_t _frame_index;
+        // Direct queue fence value that retires the last frame rendered to each back buffer,
+        // and with it the reads of that back buffer's vertex buffer.
+        uint64_t _frame_fence_values[kFrameCount];
+
+        // Profiling
+        GpuProfiler _gpu_profiler;
+
+        void _load_pipeline(HWND hwnd);
+        void _load_assets();
+        void _populate_command_list();
+        void _move_to_next_frame();
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,651 @@
+#include "stress_instancing.h"
+#include "../logging/log_macros.h"
+#include "d3d12_helper.h"
+#include "shader_library.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        // The cube [-1, 1]^3 as six faces of four corners each, with the face normals.
+        void make_box(std::vector<float>& positions, std::vector<float>& normals, std::vector<uint32_t>& indices)
+        {
+            const float corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                for (float side : {-1.0f, 1.0f})
+                {
+                    const auto first = static_cast<uint32_t>(positions.size() / 3);
+                    for (const auto& corner : corners)
+                    {
+                        float position[3];
+                        float normal[3] = {};
+                        position[axis] = side;
+                        position[(axis + 1) % 3] = corner[0];
+                        position[(axis + 2) % 3] = corner[1];
+                        normal[axis] = side;
+                        positions.insert(positions.end(), position, position + 3);
+                        normals.insert(normals.end(), normal, normal + 3);
+                    }
+                    indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+                }
+            }
+        }
+    }  // namespace
+
+    StressInstancing::StressInstancing(uint32_t width, uint32_t height, std::string name, const RendererConfig& config)
+        : D3d12Renderer(width, height, name)
+        , _viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height))
+        , _scissor_rect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height))
+        , _rtv_descriptor_size(0)
+        , _field(config.stress_instance_count, config.stress_mesh_count)
+        , _occlusion_culling(config.stress_occlusion_culling)
+        , _task_pool(UINT32_MAX)
+        , _frame_arena(kFrameCount)
+        , _instance_upload_data {}
+        , _vertex_buffer_view {}
+        , _index_buffer_view {}
+        , _frame_index(0)
+        , _frame_fence_values {}
+        , _instance_build_time(MetricsRegistry::get_instance().register_histogram("instance_build_ns"))
+        , _instance_upload_bytes(MetricsRegistry::get_instance().register_counter("instance_upload_bytes"))
+        , _occlusion_cull_time(MetricsRegistry::get_instance().register_histogram("occlusion_cull_ns"))
+        , _report_frames(0)
+        , _report_build_ms(0.0)
+        , _report_cull_ms(0.0)
+        , _report_visible_instances(0)
+        , _report_record_ms(0.0)
+        , _report_upload_bytes(0)
+        , _report_gpu_start_ms(0.0)
+        , _report_gpu_start_samples(0)
+    {
+    }
+
+    void StressInstancing::on_init(HWND hwnd)
+    {
+        _load_pipeline(hwnd);
+        _load_assets();
+        _start_time = std::chrono::steady_clock::now();
+        _report_start = _start_time;
+        LOG_INFO(LearnD3d12,
+                 "Streaming {0} instances of {1} meshes ({2} bytes each) on {3} threads{4}.",
+                 _field.get_instance_count(),
+                 _field.get_mesh_count(),
+                 sizeof(InstanceData),
+                 _task_pool.get_thread_count(),
+                 _occlusion_culling ? ", culling the instances the walls hide" : "");
+    }
+
+    void StressInstancing::on_destroy()
+    {
+        // Ensure that the GPU is no longer referencing resources that are about to be
+        // cleaned up by the destructor.
+        _command_contexts.wait_idle();
+        _gpu_profiler.log_summary();
+        _gpu_profiler.shutdown();
+
+        for (auto& instance_upload_buffer : _instance_upload_buffers)
+        {
+            if (instance_upload_buffer)
+            {
+                instance_upload_buffer->Unmap(0, nullptr);
+            }
+            instance_upload_buffer.Reset();
+        }
+        _index_buffer.Reset();
+        _vertex_buffer.Reset();
+        _pipeline_state.Reset();
+        _root_signature.Reset();
+        for (auto& render_target : _render_targets)
+        {
+            render_target.Reset();
+        }
+        _depth_buffer.Reset();
+        _dsv_heap.Reset();
+        _rtv_heap.Reset();
+        _swap_chain.Reset();
+        _command_contexts.shutdown();
+        _device.Reset();
+    }
+
+    void StressInstancing::on_update()
+    {
+        float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - _start_time).count();
+
+        // The arena cycles its slots on its own, so the frame that last used the next slot
+        // is not necessarily the one _move_to_next_frame waited for.
+        CommandQueue& direct_queue = _command_contexts.get_queue(QueueType::kDirect);
+        while (!_frame_arena.begin_frame(direct_queue.get_completed_fence_value()))
+        {
+            direct_queue.wait_for_fence(_frame_arena.get_required_fence_value());
+        }
+        _frame_draws.emplace(_frame_arena.get_resource());
+        if (_occlusion_culling)
+        {
+            _cull_instances();
+        }
+
+        // _move_to_next_frame waited for the last frame that read this back buffer's instance
+        // buffer, so the field is written straight into it.
+        InstanceData* instance_upload_data = _instance_upload_data[_frame_index];
+        auto start = std::chrono::steady_clock::now();
+        uint32_t written_count = _field.get_instance_count();
+        if (_occlusion_culling)
+        {
+            const auto& visible_instances = _frame_draws->visible_instances;
+            written_count = static_cast<uint32_t>(visible_instances.size());
+            _field.write(time, visible_instances.data(), written_count, instance_upload_data, &_task_pool);
+            _field.get_draws(visible_instances.data(), written_count, _frame_draws->draws);
+            std::copy(_occluder_instances.begin(), _occluder_instances.end(), instance_upload_data + written_count);
+            _frame_draws->occluder_first = written_count;
+            written_count += kOccluderCount;
+        }
+        else
+        {
+            _field.write(time, instance_upload_data, &_task_pool);
+            _field.get_draws(_frame_draws->draws);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        const uint64_t upload_bytes = sizeof(InstanceData) * static_cast<uint64_t>(written_count);
+        _instance_build_time.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        _instance_upload_bytes.add(upload_bytes);
+        _report_build_ms += std::chrono::duration<double, std::milli>(elapsed).count();
+        _report_upload_bytes += upload_bytes;
+    }
+
+    void StressInstancing::on_render()
+    {
+        auto& metrics = MetricsRegistry::get_instance();
+
+        // Record all the commands we need to render the scene into the command list. The
+        // manager hands out an allocator whose previous command lists have finished
+        // executing on the GPU, and an open command list recording into it.
+        _frame_context = _command_contexts.begin(QueueType::kDirect, _pipeline_state.Get());
+        {
+            auto start = std::chrono::steady_clock::now();
+            ScopedMetricTimer record_timer(metrics.get_cpu_record_time());
+            _populate_command_list();
+            _report_record_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Execute the command list.
+        _frame_fence_values[_frame_index] = _command_contexts.submit(_frame_context);
+        _frame_arena.end_frame(_frame_fence_values[_frame_index]);
+
+        // Present the frame.
+        {
+            ScopedMetricTimer present_timer(metrics.get_present_wait_time());
+            throw_if_failed(_swap_chain->Present(1, 0));
+        }
+
+        _move_to_next_frame();
+        _report();
+    }
+
+    void StressInstancing::_load_pipeline(HWND hwnd)
+    {
+        // The device may already be under way on another thread (--fast-start).
+        DeviceObjects device_objects = acquire_device();
+        ComPtr<IDXGIFactory4> factory = device_objects.factory;
+        _device = device_objects.device;
+
+        // Create the direct, compute and copy queues.
+        _command_contexts.initialize(_device.Get());
+        ID3D12CommandQueue* direct_queue = _command_contexts.get_queue(QueueType::kDirect).get_command_queue();
+
+        _gpu_profiler.initialize(_device.Get(), direct_queue);
+
+        // Describe and create the swap chain.
+        DXGI_SWAP_CHAIN_DESC1 swap_chain_desc = {};
+        swap_chain_desc.BufferCount = kFrameCount;
+        swap_chain_desc.Width = width;
+        swap_chain_desc.Height = height;
+        swap_chain_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+        swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        swap_chain_desc.SampleDesc.Count = 1;
+
+        ComPtr<IDXGISwapChain1> swap_chain;
+        throw_if_failed(factory->CreateSwapChainForHwnd(
+            direct_queue,  // Swap chain needs the queue so that it can force a flush on it.
+            hwnd,
+            &swap_chain_desc,
+            nullptr,
+            nullptr,
+            &swap_chain));
+
+        // This sample does not support fullscreen transitions.
+        throw_if_failed(factory->MakeWindowAssociation(hwnd, DXGI_MWA_NO_ALT_ENTER));
+
+        throw_if_failed(swap_chain.As(&_swap_chain));
+        _frame_index = _swap_chain->GetCurrentBackBufferIndex();
+
+        // Create descriptor heaps.
+        {
+            // Describe and create a render target view (RTV) descriptor heap.
+            D3D12_DESCRIPTOR_HEAP_DESC rtv_heap_desc = {};
+            rtv_heap_desc.NumDescriptors = kFrameCount;
+            rtv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+            rtv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+            throw_if_failed(_device->CreateDescriptorHeap(&rtv_heap_desc, IID_PPV_ARGS(&_rtv_heap)));
+
+            _rtv_descriptor_size = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+
+            D3D12_DESCRIPTOR_HEAP_DESC dsv_heap_desc = {};
+            dsv_heap_desc.NumDescriptors = 1;
+            dsv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+            dsv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+            throw_if_failed(_device->CreateDescriptorHeap(&dsv_heap_desc, IID_PPV_ARGS(&_dsv_heap)));
+        }
+
+        // Create frame resources.
+        {
+            CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart());
+
+            // Create a RTV for each frame.
+            for (uint32_t n = 0; n < kFrameCount; n++)
+            {
+                throw_if_failed(_swap_chain->GetBuffer(n, IID_PPV_ARGS(&_render_targets[n])));
+                _device->CreateRenderTargetView(_render_targets[n].Get(), nullptr, rtv_handle);
+                rtv_handle.Offset(1, _rtv_descriptor_size);
+            }
+
+            CD3DX12_HEAP_PROPERTIES default_props(D3D12_HEAP_TYPE_DEFAULT);
+            CD3DX12_RESOURCE_DESC depth_desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+            CD3DX12_CLEAR_VALUE depth_clear_value(DXGI_FORMAT_D32_FLOAT, 1.0f, 0);
+            throw_if_failed(_device->CreateCommittedResource(
+                &default_props,
+                D3D12_HEAP_FLAG_NONE,
+                &depth_desc,
+                D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                &depth_clear_value,
+                IID_PPV_ARGS(&_depth_buffer)));
+            _device->CreateDepthStencilView(_depth_buffer.Get(), nullptr, _dsv_heap->GetCPUDescriptorHandleForHeapStart());
+        }
+    }
+
+    void StressInstancing::_load_assets()
+    {
+        if (_occlusion_culling)
+        {
+            _create_occluders();
+        }
+
+        // Create a root signature with the per-draw constants and the instance buffer.
+        {
+            CD3DX12_ROOT_PARAMETER root_parameters[2];
+            root_parameters[0].InitAsConstants(sizeof(DrawConstants) / sizeof(uint32_t), 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+            root_parameters[1].InitAsShaderResourceView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+            CD3DX12_ROOT_SIGNATURE_DESC root_signature_desc;
+            root_signature_desc.Init(_countof(root_parameters), root_parameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+            ComPtr<ID3DBlob> signature;
+            ComPtr<ID3DBlob> error;
+            throw_if_failed(D3D12SerializeRootSignature(&root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
+            throw_if_failed(_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&_root_signature)));
+        }
+
+        // Create the pipeline state, which includes loading shaders compiled at build time.
+        {
+            ShaderBytecode vertex_shader = get_shader_bytecode("stress_instancing/stress_instancing.hlsl", "VSMain");
+            ShaderBytecode pixel_shader = get_shader_bytecode("stress_instancing/stress_instancing.hlsl", "PSMain");
+
+            // Define the vertex input layout; it matches MeshVertex. The instance data comes
+            // from the structured buffer, not from a per-instance vertex stream.
+            D3D12_INPUT_ELEMENT_DESC input_element_descs[] =
+                {
+                    {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+                    {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
+
+            // Describe and create the graphics pipeline state object (PSO).
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
+            pso_desc.InputLayout = {input_element_descs, _countof(input_element_descs)};
+            pso_desc.pRootSignature = _root_signature.Get();
+            pso_desc.VS = CD3DX12_SHADER_BYTECODE(vertex_shader.data, vertex_shader.size);
+            pso_desc.PS = CD3DX12_SHADER_BYTECODE(pixel_shader.data, pixel_shader.size);
+            pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            pso_desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+            pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+            pso_desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+            pso_desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+            pso_desc.SampleMask = UINT_MAX;
+            pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            pso_desc.NumRenderTargets = 1;
+            pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+            pso_desc.SampleDesc.Count = 1;
+            throw_if_failed(_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&_pipeline_state)));
+        }
+
+        // Make the unique meshes: flat shaded prisms with 3, 4, ... 12 sides, so each mesh
+        // is recognisable, all in one vertex and one index buffer.
+        std::vector<MeshVertex> vertices;
+        std::vector<uint32_t> indices;
+        _mesh_ranges.resize(_field.get_mesh_count() + 1);
+        for (uint32_t m = 0; m < _field.get_mesh_count(); m++)
+        {
+            const uint32_t sides = 3 + m % 10;
+            const float half_height = kPrismHalfHeight;
+            MeshRange& range = _mesh_ranges[m];
+            const auto base_vertex = static_cast<uint32_t>(vertices.size());
+            range.index_offset = static_cast<uint32_t>(indices.size());
+            range.base_vertex = static_cast<int32_t>(base_vertex);
+
+            for (uint32_t k = 0; k < sides; k++)
+            {
+                float angle0 = 6.2831853f * static_cast<float>(k) / static_cast<float>(sides);
+                float angle1 = 6.2831853f * static_cast<float>(k + 1) / static_cast<float>(sides);
+                float normal_angle = 0.5f * (angle0 + angle1);
+                float normal[3] = {std::cos(normal_angle), 0.0f, std::sin(normal_angle)};
+                uint32_t first = static_cast<uint32_t>(vertices.size()) - base_vertex;
+                vertices.push_back({{std::cos(angle0), -half_height, std::sin(angle0)}, {normal[0], normal[1], normal[2]}});
+                vertices.push_back({{std::cos(angle1), -half_height, std::sin(angle1)}, {normal[0], normal[1], normal[2]}});
+                vertices.push_back({{std::cos(angle1), half_height, std::sin(angle1)}, {normal[0], normal[1], normal[2]}});
+                vertices.push_back({{std::cos(angle0), half_height, std::sin(angle0)}, {normal[0], normal[1], normal[2]}});
+                indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+            }
+            for (float cap_y : {-half_height, half_height})
+            {
+                uint32_t first = static_cast<uint32_t>(vertices.size()) - base_vertex;
+                for (uint32_t k = 0; k < sides; k++)
+                {
+                    float angle = 6.2831853f * static_cast<float>(k) / static_cast<float>(sides);
+                    vertices.push_back({{std::cos(angle), cap_y, std::sin(angle)}, {0.0f, cap_y > 0.0f ? 1.0f : -1.0f, 0.0f}});
+                }
+                for (uint32_t k = 1; k + 1 < sides; k++)
+                {
+                    indices.insert(indices.end(), {first, first + k, first + k + 1});
+                }
+            }
+            range.index_count = static_cast<uint32_t>(indices.size()) - range.index_offset;
+        }
+        {
+            std::vector<float> box_positions;
+            std::vector<float> box_normals;
+            std::vector<uint32_t> box_indices;
+            make_box(box_positions, box_normals, box_indices);
+            MeshRange& range = _mesh_ranges.back();
+            range.index_offset = static_cast<uint32_t>(indices.size());
+            range.index_count = static_cast<uint32_t>(box_indices.size());
+            range.base_vertex = static_cast<int32_t>(vertices.size());
+            for (size_t v = 0; v < box_positions.size(); v += 3)
+            {
+                vertices.push_back({{box_positions[v], box_positions[v + 1], box_positions[v + 2]}, {box_normals[v], box_normals[v + 1], box_normals[v + 2]}});
+            }
+            indices.insert(indices.end(), box_indices.begin(), box_indices.end());
+        }
+
+        // Create the buffers. The meshes are small and never change, so like the other
+        // variants they simply live in upload heaps. The instance buffer is rewritten by the
+        // CPU every frame and read by the GPU over the bus.
+        {
+            CD3DX12_HEAP_PROPERTIES upload_props(D3D12_HEAP_TYPE_UPLOAD);
+            CD3DX12_RANGE read_range(0, 0);  // We do not intend to read from these resources on the CPU.
+
+            const uint64_t vertex_buffer_size = sizeof(MeshVertex) * vertices.size();
+            CD3DX12_RESOURCE_DESC vertex_desc = CD3DX12_RESOURCE_DESC::Buffer(vertex_buffer_size);
+            throw_if_failed(_device->CreateCommittedResource(
+                &upload_props,
+                D3D12_HEAP_FLAG_NONE,
+                &vertex_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&_vertex_buffer)));
+            void* vertex_data;
+            throw_if_failed(_vertex_buffer->Map(0, &read_range, &vertex_data));
+            memcpy(vertex_data, vertices.data(), vertex_buffer_size);
+            _vertex_buffer->Unmap(0, nullptr);
+
+            _vertex_buffer_view.BufferLocation = _vertex_buffer->GetGPUVirtualAddress();
+            _vertex_buffer_view.StrideInBytes = sizeof(MeshVertex);
+            _vertex_buffer_view.SizeInBytes = static_cast<UINT>(vertex_buffer_size);
+
+            const uint64_t index_buffer_size = sizeof(uint32_t) * indices.size();
+            CD3DX12_RESOURCE_DESC index_desc = CD3DX12_RESOURCE_DESC::Buffer(index_buffer_size);
+            throw_if_failed(_device->CreateCommittedResource(
+                &upload_props,
+                D3D12_HEAP_FLAG_NONE,
+                &index_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&_index_buffer)));
+            void* index_data;
+            throw_if_failed(_index_buffer->Map(0, &read_range, &index_data));
+            memcpy(index_data, indices.data(), index_buffer_size);
+            _index_buffer->Unmap(0, nullptr);
+
+            _index_buffer_view.BufferLocation = _index_buffer->GetGPUVirtualAddress();
+            _index_buffer_view.Format = DXGI_FORMAT_R32_UINT;
+            _index_buffer_view.SizeInBytes = static_cast<UINT>(index_buffer_size);
+
+            // The walls follow the visible instances.
+            const uint64_t instance_buffer_size = sizeof(InstanceData) * (static_cast<uint64_t>(_field.get_instance_count()) + (_occlusion_culling ? kOccluderCount : 0));
+            CD3DX12_RESOURCE_DESC instance_desc = CD3DX12_RESOURCE_DESC::Buffer(instance_buffer_size);
+            for (uint32_t n = 0; n < kFrameCount; n++)
+            {
+                throw_if_failed(_device->CreateCommittedResource(
+                    &upload_props,
+                    D3D12_HEAP_FLAG_NONE,
+                    &instance_desc,
+                    D3D12_RESOURCE_STATE_GENERIC_READ,
+                    nullptr,
+                    IID_PPV_ARGS(&_instance_upload_buffers[n])));
+                throw_if_failed(_instance_upload_buffers[n]->Map(0, &read_range, reinterpret_cast<void**>(&_instance_upload_data[n])));
+            }
+        }
+    }
+
+    void StressInstancing::_create_occluders()
+    {
+        // Two walls across the front half of the cube with a gap between them, and a smaller
+        // one behind the gap: centre and half size, in units of the cube's extent.
+        const float walls[kOccluderCount][6] = {
+            {-0.585f, 0.0f, -0.35f, 0.465f, 1.05f, 0.02f},
+            {0.585f, 0.0f, -0.35f, 0.465f, 1.05f, 0.02f},
+            {0.0f, 0.0f, 0.3f, 0.5f, 0.6f, 0.02f},
+        };
+
+        // The walls are children of a node scaling them to the cube, so their world matrices
+        // come out of a TransformHierarchy like those of any other scene node. The same
+        // matrices place the box instances and the culler's triangles.
+        TransformHierarchy hierarchy;
+        LocalTransform cube;
+        std::fill(std::begin(cube.scale), std::end(cube.scale), _field.get_extent());
+        const uint32_t cube_node = hierarchy.add_node(TransformHierarchy::kInvalidNode, cube);
+        uint32_t wall_nodes[kOccluderCount];
+        for (uint32_t w = 0; w < kOccluderCount; w++)
+        {
+            LocalTransform local;
+            std::copy(walls[w], walls[w] + 3, local.translation);
+            std::copy(walls[w] + 3, walls[w] + 6, local.scale);
+            wall_nodes[w] = hierarchy.add_node(cube_node, local);
+        }
+        hierarchy.update();
+
+        std::vector<float> box_positions;
+        std::vector<float> box_normals;
+        std::vector<uint32_t> box_indices;
+        make_box(box_positions, box_normals, box_indices);
+        for (uint32_t wall_node : wall_nodes)
+        {
+            const Float3x4 world = hierarchy.get_world_matrix(wall_node);
+            const auto first = static_cast<uint32_t>(_occluder_positions.size() / 3);
+            for (size_t v = 0; v < box_positions.size(); v += 3)
+            {
+                for (const auto& row : world.m)
+                {
+                    _occluder_positions.push_back(row[0] * box_positions[v] + row[1] * box_positions[v + 1] + row[2] * box_positions[v + 2] + row[3]);
+                }
+            }
+            for (uint32_t index : box_indices)
+            {
+                _occluder_indices.push_back(first + index);
+            }
+            InstanceData instance;
+            instance.world = world;
+            instance.color = 0xff9a9a9au;
+            _occluder_instances.push_back(instance);
+        }
+
+        // The instances spin in place, so a box around the sphere bounding the prism at
+        // any angle holds for every frame.
+        const float bounding_radius = std::sqrt(1.0f + kPrismHalfHeight * kPrismHalfHeight);
+        _instance_bounds.resize(_field.get_instance_count());
+        for (uint32_t i = 0; i < _field.get_instance_count(); i++)
+        {
+            float center[3];
+            float scale;
+            _field.get_placement(i, center, scale);
+            const float radius = scale * bounding_radius;
+            _instance_bounds[i] = {{center[0] - radius, center[1] - radius, center[2] - radius}, {center[0] + radius, center[1] + radius, center[2] + radius}};
+        }
+    }
+
+    void StressInstancing::_cull_instances()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // The projection of stress_instancing.hlsl as a row-vector matrix: the camera sits
+        // camera_distance in front of the cube and looks down +z.
+        const float camera_distance = _get_camera_distance();
+        const float depth_scale = kFarPlane / (kFarPlane - kNearPlane);
+        const float view_projection[16] = {
+            kFocalLength / aspect_ratio, 0.0f, 0.0f, 0.0f,
+            0.0f, kFocalLength, 0.0f, 0.0f,
+            0.0f, 0.0f, depth_scale, 1.0f,
+            0.0f, 0.0f, (camera_distance - kNearPlane) * depth_scale, camera_distance,
+        };
+        _occlusion_culler.begin_frame(view_projection);
+        const OccluderMesh walls = {_occluder_positions.data(), static_cast<uint32_t>(_occluder_positions.size() / 3), _occluder_indices.data(), static_cast<uint32_t>(_occluder_indices.size())};
+        _occlusion_culler.render_occluders(&walls, 1, &_task_pool);
+        _occlusion_culler.collect_visible(_instance_bounds.data(), _field.get_instance_count(), _frame_draws->visible_instances, &_task_pool, _frame_arena.get_resource());
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        _occlusion_cull_time.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        _report_cull_ms += std::chrono::duration<double, std::milli>(elapsed).count();
+        _report_visible_instances += _frame_draws->visible_instances.size();
+    }
+
+    void StressInstancing::_populate_command_list()
+    {
+        CommandQueue& direct_queue = _command_contexts.get_queue(QueueType::kDirect);
+        ID3D12GraphicsCommandList* command_list = _frame_context.command_list.Get();
+
+        // Pick up timings of frames the GPU has already finished, without waiting on it.
+        _gpu_profiler.begin_frame(direct_queue.get_completed_fence_value());
+        _gpu_profiler.begin_scope(command_list, "Frame");
+
+        // Set necessary state.
+        command_list->SetGraphicsRootSignature(_root_signature.Get());
+        command_list->SetGraphicsRootShaderResourceView(1, _instance_upload_buffers[_frame_index]->GetGPUVirtualAddress());
+        command_list->RSSetViewports(1, &_viewport);
+        command_list->RSSetScissorRects(1, &_scissor_rect);
+
+        // Indicate that the back buffer will be used as a render target.
+        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        command_list->ResourceBarrier(1, &barrier);
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(_rtv_heap->GetCPUDescriptorHandleForHeapStart(), _frame_index, _rtv_descriptor_size);
+        D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle = _dsv_heap->GetCPUDescriptorHandleForHeapStart();
+        command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, &dsv_handle);
+
+        // Record commands.
+        {
+            GpuProfileScope scope(_gpu_profiler, command_list, "Draw");
+            const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
+            command_list->ClearRenderTargetView(rtv_handle, clear_color, 0, nullptr);
+            command_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+            command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            command_list->IASetVertexBuffers(0, 1, &_vertex_buffer_view);
+            command_list->IASetIndexBuffer(&_index_buffer_view);
+
+            // One instanced draw per unique mesh, however many instances there are.
+            DrawConstants constants = {0, aspect_ratio, _get_camera_distance()};
+            for (const InstanceDraw& draw : _frame_draws->draws)
+            {
+                const MeshRange& range = _mesh_ranges[draw.mesh];
+                constants.instance_offset = draw.first;
+                command_list->SetGraphicsRoot32BitConstants(0, sizeof(DrawConstants) / sizeof(uint32_t), &constants, 0);
+                command_list->DrawIndexedInstanced(range.index_count, draw.count, range.index_offset, range.base_vertex, 0);
+            }
+            if (_occlusion_culling)
+            {
+                const MeshRange& range = _mesh_ranges.back();
+                constants.instance_offset = _frame_draws->occluder_first;
+                command_list->SetGraphicsRoot32BitConstants(0, sizeof(DrawConstants) / sizeof(uint32_t), &constants, 0);
+                command_list->DrawIndexedInstanced(range.index_count, kOccluderCount, range.index_offset, range.base_vertex, 0);
+            }
+        }
+
+        // Indicate that the back buffer will now be used to present.
+        barrier = CD3DX12_RESOURCE_BARRIER::Transition(_render_targets[_frame_index].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        command_list->ResourceBarrier(1, &barrier);
+
+        // on_render submits this list next, which signals the queue's next fence value.
+        _gpu_profiler.end_scope(command_list);
+        _gpu_profiler.end_frame(command_list, direct_queue.get_next_fence_value());
+    }
+
+    void StressInstancing::_move_to_next_frame()
+    {
+        _frame_index = _swap_chain->GetCurrentBackBufferIndex();
+
+        // Only wait for the GPU to finish the last frame that rendered to this back buffer,
+        // so that building the next frame's instances overlaps with the GPU drawing this one.
+        _command_contexts.get_queue(QueueType::kDirect).wait_for_fence(_frame_fence_values[_frame_index]);
+    }
+
+    void StressInstancing::_report()
+    {
+        _report_frames++;
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - _report_start).count() < kReportIntervalSeconds)
+        {
+            return;
+        }
+
+        // GPU times arrive a few frames late, so average whatever was read back since the
+        // last report rather than the frames the CPU numbers cover.
+        double gpu_ms = 0.0;
+        for (const auto& stats : _gpu_profiler.get_tracker().get_scope_stats())
+        {
+            if (stats.name == "Frame" && stats.sample_count > _report_gpu_start_samples)
+            {
+                gpu_ms = (stats.total_ms - _report_gpu_start_ms) / static_cast<double>(stats.sample_count - _report_gpu_start_samples);
+                _report_gpu_start_ms = stats.total_ms;
+                _report_gpu_start_samples = stats.sample_count;
+            }
+        }
+
+        const double frames = static_cast<double>(_report_frames);
+        const double upload_gb_per_second = _report_build_ms > 0.0 ? static_cast<double>(_report_upload_bytes) / _report_build_ms / 1e6 : 0.0;
+        LOG_INFO(LearnD3d12,
+                 "{0} instances: CPU build {1:.3f} ms ({2:.2f} GB/s upload), record {3:.3f} ms, GPU frame {4:.3f} ms",
+                 _field.get_instance_count(),
+                 _report_build_ms / frames,
+                 upload_gb_per_second,
+                 _report_record_ms / frames,
+                 gpu_ms);
+        if (_occlusion_culling)
+        {
+            const double visible = static_cast<double>(_report_visible_instances) / frames;
+            LOG_INFO(LearnD3d12,
+                     "Occlusion culling: {0:.0f} instances visible ({1:.1f}% occluded), cull {2:.3f} ms",
+                     visible,
+                     100.0 * (1.0 - visible / static_cast<double>(_field.get_instance_count())),
+                     _report_cull_ms / frames);
+        }
+
+        _report_start = now;
+        _report_frames = 0;
+        _report_build_ms = 0.0;
+        _report_cull_ms = 0.0;
+        _report_visible_instances = 0;
+        _report_record_ms = 0.0;
+        _report_upload_bytes = 0;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "../culling/occlusion_culler.h"
+#include "../memory/frame_arena.h"
+#include "../metrics/metrics_registry.h"
+#include "../scene/instance_field.h"
+#include "../threading/task_pool.h"
+#include "command_context_manager.h"
+#include "d3d12_renderer.h"
+#include "gpu_profiler.h"
+#include <chrono>
+#include <directx/d3dx12.h>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <wrl.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace learn_d3d12
+{
+    // Stresses the instancing path: a cube of spinning prisms, one instanced draw per unique
+    // mesh. Every frame the CPU rebuilds all instance transforms and colors across the task
+    // pool straight into a persistently mapped upload buffer the vertex shader reads as a
+    // structured buffer. There is one such buffer per back buffer, so the CPU builds the
+    // next frame's instances while the GPU still draws the current ones. The visible list
+    // and the draw list live in a FrameArena. The CPU build time and upload bandwidth are
+    // reported apart from the GPU frame time; LearnD3d12InstancingBench measures the CPU
+    // side without a device.
+    //
+    // With occlusion culling, a few walls stand in the cube. Before the instances are
+    // written, the walls are rasterized by OcclusionCuller and every instance's bounds are
+    // tested against them; only the visible instances are written, packed per mesh, so
+    // each mesh's draw only covers its visible instances.
+    class StressInstancing : public D3d12Renderer
+    {
+    public:
+        StressInstancing(uint32_t width, uint32_t height, std::string name, const RendererConfig& config);
+        virtual void on_init(HWND hwnd) override;
+        virtual void on_destroy() override;
+        virtual void on_update() override;
+        virtual void on_render() override;
+
+    private:
+        static const uint32_t kFrameCount = 2;
+        static constexpr double kReportIntervalSeconds = 2.0;
+        static const uint32_t kOccluderCount = 3;
+        // The prisms have a radius of 1 around the y axis.
+        static constexpr float kPrismHalfHeight = 0.6f;
+        // Must match stress_instancing.hlsl.
+        static constexpr float kFocalLength = 1.5f;
+        static constexpr float kNearPlane = 0.05f;
+        static constexpr float kFarPlane = 100.0f;
+
+        // Laid out like the DrawConstants cbuffer in stress_instancing.hlsl.
+        struct DrawConstants
+        {
+            // SV_InstanceID restarts at zero for every draw, so the shader adds this itself.
+            uint32_t instance_offset;
+            float aspect_ratio;
+            float camera_distance;
+        };
+
+        struct MeshVertex
+        {
+            float position[3];
+            float normal[3];
+        };
+
+        // A range of the shared vertex and index buffers.
+        struct MeshRange
+        {
+            uint32_t index_offset;
+            uint32_t index_count;
+            int32_t base_vertex;
+        };
+
+        // What on_update wrote to the instance buffer, rebuilt in the frame arena every frame.
+        struct FrameDrawList
+        {
+            explicit FrameDrawList(std::pmr::memory_resource* resource)
+                : visible_instances(resource)
+                , draws(resource)
+            {
+            }
+
+            std::pmr::vector<uint32_t> visible_instances;
+            std::pmr::vector<InstanceDraw> draws;
+            // The walls follow the instances in the instance buffer.
+            uint32_t occluder_first = 0;
+        };
+
+        // Pipeline objects
+        CD3DX12_VIEWPORT _viewport;
+        CD3DX12_RECT _scissor_rect;
+        ComPtr<ID3D12Device> _device;
+        ComPtr<IDXGISwapChain3> _swap_chain;
+        ComPtr<ID3D12Resource> _render_targets[kFrameCount];
+        ComPtr<ID3D12Resource> _depth_buffer;
+        CommandContextManager _command_contexts;
+        ComPtr<ID3D12RootSignature> _root_signature;
+        ComPtr<ID3D12DescriptorHeap> _rtv_heap;
+        ComPtr<ID3D12DescriptorHeap> _dsv_heap;
+        ComPtr<ID3D12PipelineState> _pipeline_state;
+        CommandContext _frame_context;
+        uint32_t _rtv_descriptor_size;
+
+        // App resources
+        InstanceField _field;
+        // The prisms of every mesh of the field, then the box the walls are drawn with.
+        std::vector<MeshRange> _mesh_ranges;
+        bool _occlusion_culling;
+        OcclusionCuller _occlusion_culler;
+        std::vector<BoundingBox> _instance_bounds;
+        // The walls in world space, as triangles for the culler and as box instances.
+        std::vector<float> _occluder_positions;
+        std::vector<uint32_t> _occluder_indices;
+        std::vector<InstanceData> _occluder_instances;
+        TaskPool _task_pool;
+        FrameArena _frame_arena;
+        std::optional<FrameDrawList> _frame_draws;
+        std::chrono::steady_clock::time_point _start_time;
+        ComPtr<ID3D12Resource> _vertex_buffer;
+        ComPtr<ID3D12Resource> _index_buffer;
+        // Persistently mapped instance buffers, one per back buffer.
+        ComPtr<ID3D12Resource> _instance_upload_buffers[kFrameCount];
+        InstanceData* _instance_upload_data[kFrameCount];
+        D3D12_VERTEX_BUFFER_VIEW _vertex_buffer_view;
+        D3D12_INDEX_BUFFER_VIEW _index_buffer_view;
+
+        // Synchronization objects
+        uint32_t _frame_index;
+        // Direct queue fence value that retires the last frame rendered to each back buffer,
+        // and with it the reads of that back buffer's instance buffer.
+        uint64_t _frame_fence_values[kFrameCount];
+
+        // Profiling
+        GpuProfiler _gpu_profiler;
+        HdrHistogram& _instance_build_time;
+        MetricCounter& _instance_upload_bytes;
+        HdrHistogram& _occlusion_cull_time;
+        // Totals since the last report.
+        std::chrono::steady_clock::time_point _report_start;
+        uint32_t _report_frames;
+        double _report_build_ms;
+        double _report_cull_ms;
+        uint64_t _report_visible_instances;
+        double _report_record_ms;
+        uint64_t _report_upload_bytes;
+        double _report_gpu_start_ms;
+        uint64_t _report_gpu_start_samples;
+
+        void _load_pipeline(HWND hwnd);
+        void _load_assets();
+        void _create_occluders();
+        void _cull_instances();
+        float _get_camera_distance() const { return 3.0f * _field.get_extent(); }
+        void _populate_command_list();
+        void _move_to_next_frame();
+        void _report();
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,166 @@
+#include "instance_field.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        uint32_t hash(uint32_t value)
+        {
+            value ^= value >> 16;
+            value *= 0x7feb352du;
+            value ^= value >> 15;
+            value *= 0x846ca68bu;
+            value ^= value >> 16;
+            return value;
+        }
+
+        // Uniform in [0, 1).
+        float hash_unit(uint32_t value, uint32_t stream)
+        {
+            return static_cast<float>(hash(value * 4u + stream) >> 8) * (1.0f / 16777216.0f);
+        }
+    }  // namespace
+
+    InstanceField::InstanceField(uint32_t instance_count, uint32_t mesh_count)
+    {
+        instance_count = std::max(instance_count, 1u);
+        mesh_count = std::clamp(mesh_count, 1u, instance_count);
+
+        _mesh_first.resize(mesh_count + 1);
+        for (uint32_t m = 0; m <= mesh_count; m++)
+        {
+            _mesh_first[m] = static_cast<uint32_t>(static_cast<uint64_t>(instance_count) * m / mesh_count);
+        }
+
+        const auto side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(instance_count))));
+        const uint64_t cell_count = static_cast<uint64_t>(side) * side * side;
+        _extent = 0.5f * kSpacing * static_cast<float>(side);
+
+        _position_x.resize(instance_count);
+        _position_y.resize(instance_count);
+        _position_z.resize(instance_count);
+        _scale.resize(instance_count);
+        _tilt_cos.resize(instance_count);
+        _tilt_sin.resize(instance_count);
+        _spin_phase.resize(instance_count);
+        _spin_rate.resize(instance_count);
+        _colors.resize(instance_count);
+        for (uint32_t i = 0; i < instance_count; i++)
+        {
+            // Multiplying by a large prime permutes the cells, which scatters each mesh's
+            // contiguous range of instances over the whole cube.
+            uint64_t cell = static_cast<uint64_t>(i) * 2654435761u % cell_count;
+            uint32_t x = static_cast<uint32_t>(cell % side);
+            uint32_t y = static_cast<uint32_t>(cell / side % side);
+            uint32_t z = static_cast<uint32_t>(cell / side / side);
+            _position_x[i] = (static_cast<float>(x) + 0.25f + 0.5f * hash_unit(i, 0)) * kSpacing - _extent;
+            _position_y[i] = (static_cast<float>(y) + 0.25f + 0.5f * hash_unit(i, 1)) * kSpacing - _extent;
+            _position_z[i] = (static_cast<float>(z) + 0.25f + 0.5f * hash_unit(i, 2)) * kSpacing - _extent;
+
+            uint32_t random = hash(i ^ 0x9e3779b9u);
+            _scale[i] = kSpacing * (0.2f + 0.15f * static_cast<float>(random & 0xff) / 255.0f);
+            float tilt = 1.2f * (static_cast<float>((random >> 8) & 0xff) / 255.0f - 0.5f);
+            _tilt_cos[i] = std::cos(tilt);
+            _tilt_sin[i] = std::sin(tilt);
+            _spin_phase[i] = 6.2831853f * hash_unit(i, 3);
+            _spin_rate[i] = 0.5f + 2.0f * static_cast<float>((random >> 16) & 0xff) / 255.0f;
+
+            // Saturated colors: one channel high, one low, one random.
+            uint32_t channels[3] = {255u, 40u, hash(random) & 0xff};
+            uint32_t rotation = random % 3;
+            _colors[i] = channels[rotation] | (channels[(rotation + 1) % 3] << 8) | (channels[(rotation + 2) % 3] << 16) | 0xff000000u;
+        }
+    }
+
+    void InstanceField::get_placement(uint32_t index, float center[3], float& scale) const
+    {
+        center[0] = _position_x[index];
+        center[1] = _position_y[index];
+        center[2] = _position_z[index];
+        scale = _scale[index];
+    }
+
+    void InstanceField::write(float time, InstanceData* destination, TaskPool* pool) const
+    {
+        auto write_range = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                destination[i] = _make_instance(time, i);
+            }
+        };
+        if (!pool)
+        {
+            write_range(0, get_instance_count());
+            return;
+        }
+        pool->parallel_for(get_instance_count(), kGrainSize, write_range);
+    }
+
+    void InstanceField::write(float time, const uint32_t* indices, uint32_t count, InstanceData* destination, TaskPool* pool) const
+    {
+        auto write_range = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                destination[i] = _make_instance(time, indices[i]);
+            }
+        };
+        if (!pool)
+        {
+            write_range(0, count);
+            return;
+        }
+        pool->parallel_for(count, kGrainSize, write_range);
+    }
+
+    void InstanceField::get_draws(std::pmr::vector<InstanceDraw>& draws) const
+    {
+        for (uint32_t m = 0; m < get_mesh_count(); m++)
+        {
+            if (get_mesh_instance_count(m) != 0)
+            {
+                draws.push_back({m, _mesh_first[m], get_mesh_instance_count(m)});
+            }
+        }
+    }
+
+    void InstanceField::get_draws(const uint32_t* indices, uint32_t count, std::pmr::vector<InstanceDraw>& draws) const
+    {
+        // The listed instances of each mesh are contiguous, so each mesh's draw starts where
+        // its first instance landed.
+        const uint32_t* end = indices + count;
+        const uint32_t* first = indices;
+        for (uint32_t m = 0; m < get_mesh_count(); m++)
+        {
+            const uint32_t* last = std::lower_bound(first, end, _mesh_first[m + 1]);
+            if (last != first)
+            {
+                draws.push_back({m, static_cast<uint32_t>(first - indices), static_cast<uint32_t>(last - first)});
+            }
+            first = last;
+        }
+    }
+
+    InstanceData InstanceField::_make_instance(float time, uint32_t index) const
+    {
+        // world = scale * rotate_y(spin) * rotate_x(tilt), then translate.
+        float spin = _spin_phase[index] + _spin_rate[index] * time;
+        float spin_cos = std::cos(spin);
+        float spin_sin = std::sin(spin);
+        float s = _scale[index];
+        float tilt_cos = _tilt_cos[index];
+        float tilt_sin = _tilt_sin[index];
+
+        // Assemble the whole instance first so the destination sees one sequential write.
+        InstanceData instance;
+        instance.world = {{
+            {s * spin_cos, s * spin_sin * tilt_sin, s * spin_sin * tilt_cos, _position_x[index]},
+            {0.0f, s * tilt_cos, -s * tilt_sin, _position_y[index]},
+            {-s * spin_sin, s * spin_cos * tilt_sin, s * spin_cos * tilt_cos, _position_z[index]},
+        }};
+        instance.color = _colors[index];
+        return instance;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "transform_hierarchy.h"
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    // Laid out like InstanceData in stress_instancing.hlsl, which reads it row major.
+    struct InstanceData
+    {
+        Float3x4 world;
+        // RGBA8 with red in the lowest byte.
+        uint32_t color;
+    };
+
+    // One instanced draw of a mesh, over instances [first, first + count) of what write()
+    // wrote.
+    struct InstanceDraw
+    {
+        uint32_t mesh;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // Instances spinning in place on a jittered grid filling a cube centred on the origin,
+    // the workload of the StressInstancing variant. Instances of one mesh are contiguous,
+    // so each mesh is a single instanced draw, but their grid cells are scattered so every
+    // mesh fills the whole cube. Positions, sizes, spin rates and colors are fixed at
+    // construction; write() animates the spin and streams every instance out each frame.
+    class InstanceField
+    {
+    public:
+        static constexpr uint32_t kGrainSize = 4096;
+        static constexpr float kSpacing = 0.1f;
+
+        InstanceField(uint32_t instance_count, uint32_t mesh_count);
+
+        uint32_t get_instance_count() const { return static_cast<uint32_t>(_colors.size()); }
+        uint32_t get_mesh_count() const { return static_cast<uint32_t>(_mesh_first.size() - 1); }
+        uint32_t get_first_instance(uint32_t mesh) const { return _mesh_first[mesh]; }
+        uint32_t get_mesh_instance_count(uint32_t mesh) const { return _mesh_first[mesh + 1] - _mesh_first[mesh]; }
+        // Half the edge length of the cube the instances fill.
+        float get_extent() const { return _extent; }
+        // Centre and scale of an instance; instances only ever spin about their centre.
+        void get_placement(uint32_t index, float center[3], float& scale) const;
+
+        // Writes every instance at `time` to destination[0, instance count) across `pool`.
+        // Each instance is written once, whole and in order within a chunk, so
+        // `destination` may be write-combined upload memory.
+        void write(float time, InstanceData* destination, TaskPool* pool = nullptr) const;
+        // Like write(), but only the `count` instances listed in `indices`, packed into
+        // destination[0, count).
+        void write(float time, const uint32_t* indices, uint32_t count, InstanceData* destination, TaskPool* pool = nullptr) const;
+
+        // Appends the draws of what write() wrote: one per mesh.
+        void get_draws(std::pmr::vector<InstanceDraw>& draws) const;
+        // Appends the draws of what the indexed write() wrote from `indices`, which must be
+        // sorted: one per mesh with at least one instance listed.
+        void get_draws(const uint32_t* indices, uint32_t count, std::pmr::vector<InstanceDraw>& draws) const;
+
+    private:
+        float _extent;
+        std::vector<uint32_t> _mesh_first;
+        // Per instance, structure of arrays.
+        std::vector<float> _position_x;
+        std::vector<float> _position_y;
+        std::vector<float> _position_z;
+        std::vector<float> _scale;
+        // Cosine and sine of the fixed tilt about x; the spin about y is animated.
+        std::vector<float> _tilt_cos;
+        std::vector<float> _tilt_sin;
+        std::vector<float> _spin_phase;
+        std::vector<float> _spin_rate;
+        std::vector<uint32_t> _colors;
+
+        InstanceData _make_instance(float time, uint32_t index) const;
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,355 @@
+#include "transform_hierarchy.h"
+#include "../simd/cpu_features.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        // Scale * rotation rows of the row-vector local matrix, as in XMMatrixAffineTransformation.
+        inline void local_rotation_scale(float qx, float qy, float qz, float qw, float sx, float sy, float sz, float rows[3][3])
+        {
+            const float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+            const float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+            const float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+            rows[0][0] = (1.0f - 2.0f * (yy + zz)) * sx;
+            rows[0][1] = 2.0f * (xy + wz) * sx;
+            rows[0][2] = 2.0f * (xz - wy) * sx;
+            rows[1][0] = 2.0f * (xy - wz) * sy;
+            rows[1][1] = (1.0f - 2.0f * (xx + zz)) * sy;
+            rows[1][2] = 2.0f * (yz + wx) * sy;
+            rows[2][0] = 2.0f * (xz + wy) * sz;
+            rows[2][1] = 2.0f * (yz - wx) * sz;
+            rows[2][2] = (1.0f - 2.0f * (xx + yy)) * sz;
+        }
+    }  // namespace
+
+    void TransformHierarchy::reserve(uint32_t count)
+    {
+        for (auto* stream : {&_translation_x, &_translation_y, &_translation_z, &_rotation_x, &_rotation_y, &_rotation_z, &_rotation_w, &_scale_x, &_scale_y, &_scale_z})
+        {
+            stream->reserve(count);
+        }
+        _parent_slots.reserve(count);
+        _dirty.reserve(count);
+        _changed_serials.reserve(count);
+        _world.reserve(count);
+        _slot_nodes.reserve(count);
+        _node_slots.reserve(count);
+        _node_parents.reserve(count);
+    }
+
+    uint32_t TransformHierarchy::add_node(uint32_t parent, const LocalTransform& local)
+    {
+        const uint32_t node = get_count();
+        if (parent != kInvalidNode && parent >= node)
+        {
+            throw std::invalid_argument("parent " + std::to_string(parent) + " of node " + std::to_string(node) + " does not exist");
+        }
+        // Appended for now; the next update moves the node to its level.
+        _translation_x.push_back(local.translation[0]);
+        _translation_y.push_back(local.translation[1]);
+        _translation_z.push_back(local.translation[2]);
+        _rotation_x.push_back(local.rotation[0]);
+        _rotation_y.push_back(local.rotation[1]);
+        _rotation_z.push_back(local.rotation[2]);
+        _rotation_w.push_back(local.rotation[3]);
+        _scale_x.push_back(local.scale[0]);
+        _scale_y.push_back(local.scale[1]);
+        _scale_z.push_back(local.scale[2]);
+        _parent_slots.push_back(kInvalidNode);
+        _dirty.push_back(1);
+        _changed_serials.push_back(0);
+        _world.push_back({});
+        _slot_nodes.push_back(node);
+        _node_slots.push_back(node);
+        _node_parents.push_back(parent);
+        _dirty_count++;
+        _needs_sort = true;
+        return node;
+    }
+
+    uint32_t TransformHierarchy::get_parent(uint32_t node) const
+    {
+        return _node_parents[node];
+    }
+
+    uint32_t TransformHierarchy::get_slot(uint32_t node) const
+    {
+        return _node_slots[node];
+    }
+
+    LocalTransform TransformHierarchy::get_local_transform(uint32_t node) const
+    {
+        const uint32_t slot = _node_slots[node];
+        LocalTransform local;
+        local.translation[0] = _translation_x[slot];
+        local.translation[1] = _translation_y[slot];
+        local.translation[2] = _translation_z[slot];
+        local.rotation[0] = _rotation_x[slot];
+        local.rotation[1] = _rotation_y[slot];
+        local.rotation[2] = _rotation_z[slot];
+        local.rotation[3] = _rotation_w[slot];
+        local.scale[0] = _scale_x[slot];
+        local.scale[1] = _scale_y[slot];
+        local.scale[2] = _scale_z[slot];
+        return local;
+    }
+
+    void TransformHierarchy::set_local_transform(uint32_t node, const LocalTransform& local)
+    {
+        const uint32_t slot = _node_slots[node];
+        _translation_x[slot] = local.translation[0];
+        _translation_y[slot] = local.translation[1];
+        _translation_z[slot] = local.translation[2];
+        _rotation_x[slot] = local.rotation[0];
+        _rotation_y[slot] = local.rotation[1];
+        _rotation_z[slot] = local.rotation[2];
+        _rotation_w[slot] = local.rotation[3];
+        _scale_x[slot] = local.scale[0];
+        _scale_y[slot] = local.scale[1];
+        _scale_z[slot] = local.scale[2];
+        if (!_dirty[slot])
+        {
+            _dirty[slot] = 1;
+            _dirty_count++;
+        }
+    }
+
+    void TransformHierarchy::set_translation(uint32_t node, float x, float y, float z)
+    {
+        const uint32_t slot = _node_slots[node];
+        _translation_x[slot] = x;
+        _translation_y[slot] = y;
+        _translation_z[slot] = z;
+        if (!_dirty[slot])
+        {
+            _dirty[slot] = 1;
+            _dirty_count++;
+        }
+    }
+
+    Float3x4 TransformHierarchy::get_world_matrix(uint32_t node) const
+    {
+        const WorldMatrix& world = _world[_node_slots[node]];
+        Float3x4 result;
+        for (uint32_t r = 0; r < 3; r++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                result.m[r][c] = world.m[c][r];
+            }
+        }
+        return result;
+    }
+
+    uint64_t TransformHierarchy::update(TaskPool* pool, Float3x4* destination, uint64_t destination_serial)
+    {
+        _serial++;
+        if (_needs_sort)
+        {
+            _sort_by_depth();
+            _layout_serial = _serial;
+        }
+        // Slots moved since the destination was written, so it needs every matrix again.
+        if (destination_serial < _layout_serial)
+        {
+            destination_serial = 0;
+        }
+        _recomputed_count = 0;
+        _written_count = 0;
+        // Nothing is out of date and the destination already has every change.
+        if (_dirty_count == 0 && (destination == nullptr || destination_serial >= _last_change_serial))
+        {
+            return _serial;
+        }
+
+        // Levels run one after another, since children read their parents' results.
+        std::atomic<uint32_t> recomputed_count {0};
+        std::atomic<uint32_t> written_count {0};
+        for (uint32_t level = 0; level + 1 < _level_begin.size(); level++)
+        {
+            const uint32_t begin = _level_begin[level];
+            const uint32_t count = _level_begin[level + 1] - begin;
+            if (pool == nullptr || count <= kGrainSize)
+            {
+                uint32_t recomputed = 0;
+                uint32_t written = 0;
+                _update_range(begin, begin + count, destination, destination_serial, recomputed, written);
+                recomputed_count.fetch_add(recomputed, std::memory_order_relaxed);
+                written_count.fetch_add(written, std::memory_order_relaxed);
+                continue;
+            }
+            pool->parallel_for(count, kGrainSize, [&](uint32_t chunk_begin, uint32_t chunk_end) {
+                uint32_t recomputed = 0;
+                uint32_t written = 0;
+                _update_range(begin + chunk_begin, begin + chunk_end, destination, destination_serial, recomputed, written);
+                recomputed_count.fetch_add(recomputed, std::memory_order_relaxed);
+                written_count.fetch_add(written, std::memory_order_relaxed);
+            });
+        }
+        _recomputed_count = recomputed_count.load(std::memory_order_relaxed);
+        _written_count = written_count.load(std::memory_order_relaxed);
+        if (_recomputed_count != 0)
+        {
+            _last_change_serial = _serial;
+        }
+        _dirty_count = 0;
+        return _serial;
+    }
+
+    void TransformHierarchy::_update_range(uint32_t begin, uint32_t end, Float3x4* destination, uint64_t destination_serial, uint32_t& recomputed, uint32_t& written)
+    {
+        const uint64_t serial = _serial;
+        for (uint32_t slot = begin; slot < end; slot++)
+        {
+            const uint32_t parent_slot = _parent_slots[slot];
+            const bool parent_changed = parent_slot != kInvalidNode && _changed_serials[parent_slot] == serial;
+            if (!_dirty[slot] && !parent_changed)
+            {
+                // Unchanged, but the destination may not have seen the last change yet.
+                if (destination != nullptr && _changed_serials[slot] > destination_serial)
+                {
+                    destination[slot] = get_world_matrix(_slot_nodes[slot]);
+                    written++;
+                }
+                continue;
+            }
+            _dirty[slot] = 0;
+            _changed_serials[slot] = serial;
+            recomputed++;
+
+            float rows[3][3];
+            local_rotation_scale(_rotation_x[slot], _rotation_y[slot], _rotation_z[slot], _rotation_w[slot], _scale_x[slot], _scale_y[slot], _scale_z[slot], rows);
+            WorldMatrix& world = _world[slot];
+#if LEARN_D3D12_X86
+            // world = local * parent; the rotation rows of a row-vector matrix have w = 0 and
+            // the translation row w = 1, so four multiply-adds per row cover everything.
+            __m128 row0 = _mm_setr_ps(rows[0][0], rows[0][1], rows[0][2], 0.0f);
+            __m128 row1 = _mm_setr_ps(rows[1][0], rows[1][1], rows[1][2], 0.0f);
+            __m128 row2 = _mm_setr_ps(rows[2][0], rows[2][1], rows[2][2], 0.0f);
+            __m128 row3 = _mm_setr_ps(_translation_x[slot], _translation_y[slot], _translation_z[slot], 1.0f);
+            if (parent_slot != kInvalidNode)
+            {
+                const WorldMatrix& parent = _world[parent_slot];
+                const __m128 parent0 = _mm_load_ps(parent.m[0]);
+                const __m128 parent1 = _mm_load_ps(parent.m[1]);
+                const __m128 parent2 = _mm_load_ps(parent.m[2]);
+                const __m128 parent3 = _mm_load_ps(parent.m[3]);
+                auto transform_row = [&](__m128 row) {
+                    __m128 result = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), parent0);
+                    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), parent1));
+                    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), parent2));
+                    return _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), parent3));
+                };
+                row0 = transform_row(row0);
+                row1 = transform_row(row1);
+                row2 = transform_row(row2);
+                row3 = transform_row(row3);
+            }
+            _mm_store_ps(world.m[0], row0);
+            _mm_store_ps(world.m[1], row1);
+            _mm_store_ps(world.m[2], row2);
+            _mm_store_ps(world.m[3], row3);
+            if (destination != nullptr)
+            {
+                // Upload heaps are write-combined: write the transposed rows once, in order.
+                _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+                Float3x4& target = destination[slot];
+                _mm_storeu_ps(target.m[0], row0);
+                _mm_storeu_ps(target.m[1], row1);
+                _mm_storeu_ps(target.m[2], row2);
+                written++;
+            }
+#else
+            const float local[4][4] = {
+                {rows[0][0], rows[0][1], rows[0][2], 0.0f},
+                {rows[1][0], rows[1][1], rows[1][2], 0.0f},
+                {rows[2][0], rows[2][1], rows[2][2], 0.0f},
+                {_translation_x[slot], _translation_y[slot], _translation_z[slot], 1.0f},
+            };
+            if (parent_slot != kInvalidNode)
+            {
+                const WorldMatrix& parent = _world[parent_slot];
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        world.m[r][c] = local[r][0] * parent.m[0][c] + local[r][1] * parent.m[1][c] + local[r][2] * parent.m[2][c] + local[r][3] * parent.m[3][c];
+                    }
+                }
+            }
+            else
+            {
+                std::copy(&local[0][0], &local[0][0] + 16, &world.m[0][0]);
+            }
+            if (destination != nullptr)
+            {
+                destination[slot] = get_world_matrix(_slot_nodes[slot]);
+                written++;
+            }
+#endif
+        }
+    }
+
+    void TransformHierarchy::_sort_by_depth()
+    {
+        // Parents always have smaller ids, so one pass in id order finds every depth.
+        const uint32_t count = get_count();
+        std::vector<uint32_t> depths(count);
+        uint32_t level_count = 0;
+        for (uint32_t node = 0; node < count; node++)
+        {
+            const uint32_t parent = _node_parents[node];
+            depths[node] = parent == kInvalidNode ? 0 : depths[parent] + 1;
+            level_count = std::max(level_count, depths[node] + 1);
+        }
+
+        // Counting sort by depth, keeping id order within a level.
+        _level_begin.assign(level_count + 1, 0);
+        for (uint32_t depth : depths)
+        {
+            _level_begin[depth + 1]++;
+        }
+        for (uint32_t level = 0; level < level_count; level++)
+        {
+            _level_begin[level + 1] += _level_begin[level];
+        }
+        std::vector<uint32_t> next_slot(_level_begin.begin(), _level_begin.end() - 1);
+        std::vector<uint32_t> new_slots(count);
+        for (uint32_t node = 0; node < count; node++)
+        {
+            new_slots[node] = next_slot[depths[node]]++;
+        }
+
+        // Move every per-slot stream into the new order.
+        auto permute = [&](auto& stream) {
+            std::remove_reference_t<decltype(stream)> sorted(count);
+            for (uint32_t node = 0; node < count; node++)
+            {
+                sorted[new_slots[node]] = stream[_node_slots[node]];
+            }
+            stream.swap(sorted);
+        };
+        for (auto* stream : {&_translation_x, &_translation_y, &_translation_z, &_rotation_x, &_rotation_y, &_rotation_z, &_rotation_w, &_scale_x, &_scale_y, &_scale_z})
+        {
+            permute(*stream);
+        }
+        permute(_dirty);
+        permute(_changed_serials);
+        permute(_world);
+        _node_slots.swap(new_slots);
+        for (uint32_t node = 0; node < count; node++)
+        {
+            const uint32_t slot = _node_slots[node];
+            _slot_nodes[slot] = node;
+            _parent_slots[slot] = _node_parents[node] == kInvalidNode ? kInvalidNode : _node_slots[_node_parents[node]];
+        }
+        _needs_sort = false;
+    }
+}  // namespace learn_d3d12
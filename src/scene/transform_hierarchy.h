@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    struct LocalTransform
+    {
+        float translation[3] = {0.0f, 0.0f, 0.0f};
+        // Unit quaternion, xyzw.
+        float rotation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        float scale[3] = {1.0f, 1.0f, 1.0f};
+    };
+
+    // A world matrix as per-instance constant data: the transpose of the row-vector matrix
+    // with the constant column dropped, so HLSL computes the world position with
+    // mul(world, float4(position, 1)) on a float3x4.
+    struct Float3x4
+    {
+        float m[3][4];
+    };
+
+    // Scene nodes stored as structure of arrays: local translation, rotation and scale
+    // streams, parent indices and world matrices, ordered by depth so that every parent
+    // comes before its children and each level of the hierarchy is one contiguous range.
+    // Nodes keep the id add_node returned; the storage slot of a node changes when nodes
+    // are added, and is also its index in the arrays update() writes.
+    //
+    // Changing a local transform marks the node dirty. update() walks the levels in order,
+    // spreading each level across a TaskPool, and only recomputes nodes that are dirty or
+    // whose parent changed in the same update, so untouched subtrees cost a flag check.
+    class TransformHierarchy
+    {
+    public:
+        static constexpr uint32_t kInvalidNode = UINT32_MAX;
+        static constexpr uint32_t kGrainSize = 4096;
+
+        void reserve(uint32_t count);
+        // `parent` must be kInvalidNode for a root or a node added before; throws
+        // std::invalid_argument otherwise.
+        uint32_t add_node(uint32_t parent, const LocalTransform& local = {});
+
+        uint32_t get_count() const { return static_cast<uint32_t>(_node_slots.size()); }
+        // Number of depth levels as of the last update.
+        uint32_t get_level_count() const { return static_cast<uint32_t>(_level_begin.empty() ? 0 : _level_begin.size() - 1); }
+        uint32_t get_parent(uint32_t node) const;
+        uint32_t get_slot(uint32_t node) const;
+
+        LocalTransform get_local_transform(uint32_t node) const;
+        void set_local_transform(uint32_t node, const LocalTransform& local);
+        void set_translation(uint32_t node, float x, float y, float z);
+        // World matrix of the last update.
+        Float3x4 get_world_matrix(uint32_t node) const;
+
+        // Recomputes world matrices that are out of date and returns the number of this
+        // update, starting at 1. When `destination` is given, every matrix that changed
+        // after update `destination_serial` is also written to destination[slot] while it is
+        // still in registers, so a ring of mapped upload buffers only receives what changed
+        // since each buffer was last written. Pass 0 to write all of them. Adding nodes moves
+        // slots, so the next update writes destinations from before it in full.
+        uint64_t update(TaskPool* pool = nullptr, Float3x4* destination = nullptr, uint64_t destination_serial = 0);
+
+        uint64_t get_serial() const { return _serial; }
+        // Statistics of the last update.
+        uint32_t get_recomputed_count() const { return _recomputed_count; }
+        uint32_t get_written_count() const { return _written_count; }
+
+    private:
+        // Row-vector world matrix in 16-byte rows, the layout the SSE kernel loads.
+        struct alignas(16) WorldMatrix
+        {
+            float m[4][4];
+        };
+
+        // Per slot.
+        std::vector<float> _translation_x;
+        std::vector<float> _translation_y;
+        std::vector<float> _translation_z;
+        std::vector<float> _rotation_x;
+        std::vector<float> _rotation_y;
+        std::vector<float> _rotation_z;
+        std::vector<float> _rotation_w;
+        std::vector<float> _scale_x;
+        std::vector<float> _scale_y;
+        std::vector<float> _scale_z;
+        std::vector<uint32_t> _parent_slots;
+        std::vector<uint8_t> _dirty;
+        // Update number in which each world matrix last changed.
+        std::vector<uint64_t> _changed_serials;
+        std::vector<WorldMatrix> _world;
+        std::vector<uint32_t> _slot_nodes;
+
+        // Per node id.
+        std::vector<uint32_t> _node_slots;
+        std::vector<uint32_t> _node_parents;
+
+        // Slot range of level i is [_level_begin[i], _level_begin[i + 1]).
+        std::vector<uint32_t> _level_begin;
+        bool _needs_sort = false;
+        uint32_t _dirty_count = 0;
+        uint64_t _serial = 0;
+        // Last update that changed any world matrix, and the last one that moved slots.
+        uint64_t _last_change_serial = 0;
+        uint64_t _layout_serial = 0;
+        uint32_t _recomputed_count = 0;
+        uint32_t _written_count = 0;
+
+        void _sort_by_depth();
+        // Adds the number of matrices recomputed and written in [begin, end) to the counts.
+        void _update_range(uint32_t begin, uint32_t end, Float3x4* destination, uint64_t destination_serial, uint32_t& recomputed, uint32_t& written);
+    };
+}  // namespace learn_d3d12
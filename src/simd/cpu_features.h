@@ -0,0 +1,43 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LEARN_D3D12_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define LEARN_D3D12_X86 0
+#endif
+
+// AVX2 kernels are compiled per function so the rest of the program keeps the baseline
+// instruction set; callers must check cpu_supports_avx2() before calling them.
+// MSVC allows the intrinsics without /arch:AVX2, GCC and Clang need the target attribute.
+#if LEARN_D3D12_X86 && (defined(__GNUC__) || defined(__clang__))
+#define LEARN_D3D12_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define LEARN_D3D12_TARGET_AVX2
+#endif
+
+namespace learn_d3d12
+{
+    inline bool cpu_supports_avx2()
+    {
+#if !LEARN_D3D12_X86
+        return false;
+#elif defined(_MSC_VER)
+        static const bool supported = [] {
+            int info[4] = {};
+            __cpuid(info, 1);
+            bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+            bool fma = info[2] & (1 << 12);
+            __cpuidex(info, 7, 0);
+            return os_saves_ymm && fma && (info[1] & (1 << 5));
+        }();
+        return supported;
+#else
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#endif
+    }
+}  // namespace learn_d3d12
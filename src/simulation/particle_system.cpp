@@ -0,0 +1,257 @@
+#include "particle_system.h"
+#include "../simd/cpu_features.h"
+#include "../threading/task_pool.h"
+#include <new>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        constexpr size_t kStreamAlignment = 32;
+        constexpr uint32_t kIndexSeedMultiplier = 0x9E3779B9u;
+        constexpr uint32_t kGenerationSeedMultiplier = 0x85EBCA6Bu;
+        constexpr float kUnitFloatScale = 1.0f / 16777216.0f;
+
+        inline uint32_t hash_u32(uint32_t x)
+        {
+            x ^= x >> 16;
+            x *= 0x7FEB352Du;
+            x ^= x >> 15;
+            x *= 0x846CA68Bu;
+            x ^= x >> 16;
+            return x;
+        }
+
+        inline float hash_to_unit_float(uint32_t hash)
+        {
+            return static_cast<float>(hash >> 8) * kUnitFloatScale;
+        }
+
+#if LEARN_D3D12_X86
+        // Like LEARN_D3D12_TARGET_AVX2 but without FMA, so GCC and Clang cannot contract the
+        // multiply-adds and the kernel rounds exactly like the scalar one. MSVC never
+        // contracts intrinsics.
+#if defined(__GNUC__) || defined(__clang__)
+#define LEARN_D3D12_TARGET_AVX2_NO_FMA __attribute__((target("avx2")))
+#else
+#define LEARN_D3D12_TARGET_AVX2_NO_FMA
+#endif
+
+        LEARN_D3D12_TARGET_AVX2_NO_FMA inline __m256i hash_u32_avx2(__m256i x)
+        {
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(0x7FEB352Du)));
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+            x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(0x846CA68Bu)));
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            return x;
+        }
+
+        LEARN_D3D12_TARGET_AVX2_NO_FMA inline __m256 hash_to_unit_float_avx2(__m256i hash)
+        {
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(hash, 8)), _mm256_set1_ps(kUnitFloatScale));
+        }
+#endif
+    }  // namespace
+
+    void ParticleSystem::AlignedDeleter::operator()(void* pointer) const
+    {
+        ::operator delete[](pointer, std::align_val_t(kStreamAlignment));
+    }
+
+    template<typename T>
+    ParticleSystem::Stream<T> ParticleSystem::_allocate_stream(uint32_t capacity)
+    {
+        void* memory = ::operator new[](sizeof(T) * capacity, std::align_val_t(kStreamAlignment));
+        return Stream<T>(static_cast<T*>(memory));
+    }
+
+    ParticleSystem::ParticleSystem(uint32_t count, const ParticleSettings& settings)
+        : _count(count)
+        , _capacity((count + kLaneCount - 1) / kLaneCount * kLaneCount)
+        , _settings(settings)
+        , _position_x(_allocate_stream<float>(_capacity))
+        , _position_y(_allocate_stream<float>(_capacity))
+        , _position_z(_allocate_stream<float>(_capacity))
+        , _velocity_x(_allocate_stream<float>(_capacity))
+        , _velocity_y(_allocate_stream<float>(_capacity))
+        , _velocity_z(_allocate_stream<float>(_capacity))
+        , _lifetime(_allocate_stream<float>(_capacity))
+        , _color(_allocate_stream<uint32_t>(_capacity))
+    {
+        reset(0);
+    }
+
+    void ParticleSystem::reset(uint32_t seed)
+    {
+        _generation = 0;
+        for (uint32_t i = 0; i < _capacity; i++)
+        {
+            _spawn(i, hash_u32(i * kIndexSeedMultiplier ^ seed));
+            // Stagger the first generation so particles do not all expire on the same frame.
+            _lifetime[i] *= hash_to_unit_float(hash_u32(i + seed));
+        }
+    }
+
+    void ParticleSystem::simulate(float delta_time, TaskPool* pool, bool allow_simd)
+    {
+        bool use_avx2 = allow_simd && is_avx2_available();
+        auto kernel = [&](uint32_t begin, uint32_t end) {
+            if (use_avx2)
+            {
+                simulate_range_avx2(delta_time, begin, end);
+            }
+            else
+            {
+                simulate_range_scalar(delta_time, begin, end);
+            }
+        };
+        if (pool)
+        {
+            pool->parallel_for(_capacity, kGrainSize, kernel);
+        }
+        else
+        {
+            kernel(0, _capacity);
+        }
+        _generation++;
+    }
+
+    void ParticleSystem::simulate_range_scalar(float delta_time, uint32_t begin, uint32_t end)
+    {
+        const float gravity_step = _settings.gravity * delta_time;
+        const uint32_t generation_seed = _generation * kGenerationSeedMultiplier;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            float velocity_y = _velocity_y[i] + gravity_step;
+            _position_x[i] += _velocity_x[i] * delta_time;
+            float position_y = _position_y[i] + velocity_y * delta_time;
+            _position_z[i] += _velocity_z[i] * delta_time;
+            if (position_y < _settings.floor_height)
+            {
+                position_y = _settings.floor_height;
+                velocity_y *= -_settings.restitution;
+            }
+            _position_y[i] = position_y;
+            _velocity_y[i] = velocity_y;
+            _lifetime[i] -= delta_time;
+            if (_lifetime[i] <= 0.0f)
+            {
+                _spawn(i, i * kIndexSeedMultiplier + generation_seed);
+            }
+        }
+    }
+
+    void ParticleSystem::simulate_range_avx2(float delta_time, uint32_t begin, uint32_t end)
+    {
+#if LEARN_D3D12_X86
+        // Kept in a lambda so only this body is compiled for AVX2.
+        auto kernel = [this, delta_time](uint32_t first, uint32_t last) LEARN_D3D12_TARGET_AVX2_NO_FMA {
+            const __m256 dt = _mm256_set1_ps(delta_time);
+            const __m256 gravity_step = _mm256_set1_ps(_settings.gravity * delta_time);
+            const __m256 floor_height = _mm256_set1_ps(_settings.floor_height);
+            const __m256 bounce = _mm256_set1_ps(-_settings.restitution);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256i index_multiplier = _mm256_set1_epi32(static_cast<int>(kIndexSeedMultiplier));
+            const __m256i generation_seed = _mm256_set1_epi32(static_cast<int>(_generation * kGenerationSeedMultiplier));
+            const __m256i opaque_alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+            for (uint32_t i = first; i < last; i += kLaneCount)
+            {
+                __m256 velocity_x = _mm256_load_ps(&_velocity_x[i]);
+                __m256 velocity_y = _mm256_add_ps(_mm256_load_ps(&_velocity_y[i]), gravity_step);
+                __m256 velocity_z = _mm256_load_ps(&_velocity_z[i]);
+                __m256 position_x = _mm256_add_ps(_mm256_load_ps(&_position_x[i]), _mm256_mul_ps(velocity_x, dt));
+                __m256 position_y = _mm256_add_ps(_mm256_load_ps(&_position_y[i]), _mm256_mul_ps(velocity_y, dt));
+                __m256 position_z = _mm256_add_ps(_mm256_load_ps(&_position_z[i]), _mm256_mul_ps(velocity_z, dt));
+
+                __m256 below_floor = _mm256_cmp_ps(position_y, floor_height, _CMP_LT_OQ);
+                position_y = _mm256_blendv_ps(position_y, floor_height, below_floor);
+                velocity_y = _mm256_blendv_ps(velocity_y, _mm256_mul_ps(velocity_y, bounce), below_floor);
+
+                __m256 lifetime = _mm256_sub_ps(_mm256_load_ps(&_lifetime[i]), dt);
+                __m256 dead = _mm256_cmp_ps(lifetime, zero, _CMP_LE_OQ);
+                if (_mm256_movemask_ps(dead))
+                {
+                    __m256i index = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), lane_offsets);
+                    __m256i seed = _mm256_add_epi32(_mm256_mullo_epi32(index, index_multiplier), generation_seed);
+                    __m256i hash_x = hash_u32_avx2(seed);
+                    __m256i hash_y = hash_u32_avx2(hash_x);
+                    __m256i hash_z = hash_u32_avx2(hash_y);
+                    __m256i hash_lifetime = hash_u32_avx2(hash_z);
+                    __m256i hash_color = hash_u32_avx2(hash_lifetime);
+
+                    const __m256 one = _mm256_set1_ps(1.0f);
+                    const __m256 two = _mm256_set1_ps(2.0f);
+                    const __m256 half = _mm256_set1_ps(0.5f);
+                    const __m256 spread = _mm256_set1_ps(_settings.spawn_spread);
+                    __m256 spawn_velocity_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(hash_to_unit_float_avx2(hash_x), two), one), spread);
+                    __m256 spawn_velocity_y = _mm256_mul_ps(_mm256_set1_ps(_settings.spawn_speed), _mm256_add_ps(half, _mm256_mul_ps(half, hash_to_unit_float_avx2(hash_y))));
+                    __m256 spawn_velocity_z = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(hash_to_unit_float_avx2(hash_z), two), one), spread);
+                    __m256 spawn_lifetime = _mm256_add_ps(
+                        _mm256_set1_ps(_settings.min_lifetime),
+                        _mm256_mul_ps(hash_to_unit_float_avx2(hash_lifetime), _mm256_set1_ps(_settings.max_lifetime - _settings.min_lifetime)));
+
+                    position_x = _mm256_blendv_ps(position_x, zero, dead);
+                    position_y = _mm256_blendv_ps(position_y, floor_height, dead);
+                    position_z = _mm256_blendv_ps(position_z, zero, dead);
+                    velocity_x = _mm256_blendv_ps(velocity_x, spawn_velocity_x, dead);
+                    velocity_y = _mm256_blendv_ps(velocity_y, spawn_velocity_y, dead);
+                    velocity_z = _mm256_blendv_ps(velocity_z, spawn_velocity_z, dead);
+                    lifetime = _mm256_blendv_ps(lifetime, spawn_lifetime, dead);
+                    _mm256_maskstore_epi32(
+                        reinterpret_cast<int*>(&_color[i]),
+                        _mm256_castps_si256(dead),
+                        _mm256_or_si256(hash_color, opaque_alpha));
+                }
+
+                _mm256_store_ps(&_position_x[i], position_x);
+                _mm256_store_ps(&_position_y[i], position_y);
+                _mm256_store_ps(&_position_z[i], position_z);
+                _mm256_store_ps(&_velocity_x[i], velocity_x);
+                _mm256_store_ps(&_velocity_y[i], velocity_y);
+                _mm256_store_ps(&_velocity_z[i], velocity_z);
+                _mm256_store_ps(&_lifetime[i], lifetime);
+            }
+        };
+
+        // Ranges produced by simulate() are lane aligned; anything else falls back to scalar at the edges.
+        uint32_t vector_begin = (begin + kLaneCount - 1) / kLaneCount * kLaneCount;
+        uint32_t vector_end = end / kLaneCount * kLaneCount;
+        if (vector_begin >= vector_end)
+        {
+            simulate_range_scalar(delta_time, begin, end);
+            return;
+        }
+        simulate_range_scalar(delta_time, begin, vector_begin);
+        kernel(vector_begin, vector_end);
+        simulate_range_scalar(delta_time, vector_end, end);
+#else
+        simulate_range_scalar(delta_time, begin, end);
+#endif
+    }
+
+    bool ParticleSystem::is_avx2_available()
+    {
+        return cpu_supports_avx2();
+    }
+
+    void ParticleSystem::_spawn(uint32_t index, uint32_t seed)
+    {
+        uint32_t hash_x = hash_u32(seed);
+        uint32_t hash_y = hash_u32(hash_x);
+        uint32_t hash_z = hash_u32(hash_y);
+        uint32_t hash_lifetime = hash_u32(hash_z);
+        uint32_t hash_color = hash_u32(hash_lifetime);
+
+        _position_x[index] = 0.0f;
+        _position_y[index] = _settings.floor_height;
+        _position_z[index] = 0.0f;
+        _velocity_x[index] = (hash_to_unit_float(hash_x) * 2.0f - 1.0f) * _settings.spawn_spread;
+        _velocity_y[index] = _settings.spawn_speed * (0.5f + 0.5f * hash_to_unit_float(hash_y));
+        _velocity_z[index] = (hash_to_unit_float(hash_z) * 2.0f - 1.0f) * _settings.spawn_spread;
+        _lifetime[index] = _settings.min_lifetime + hash_to_unit_float(hash_lifetime) * (_settings.max_lifetime - _settings.min_lifetime);
+        _color[index] = hash_color | 0xFF000000u;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    struct ParticleSettings
+    {
+        float gravity = -9.8f;
+        float floor_height = -1.0f;
+        float restitution = 0.6f;
+        float spawn_speed = 4.0f;
+        float spawn_spread = 1.5f;
+        float min_lifetime = 2.0f;
+        float max_lifetime = 6.0f;
+    };
+
+    // Particles stored as structure of arrays, one 32-byte aligned stream per component.
+    // The capacity is rounded up to a multiple of kLaneCount so the AVX2 kernel never
+    // needs a scalar tail. Dead particles respawn at the emitter with a velocity derived
+    // from an integer hash, so both kernels produce the same results for the same input.
+    class ParticleSystem
+    {
+    public:
+        static constexpr uint32_t kLaneCount = 8;
+        static constexpr uint32_t kGrainSize = 16 * 1024;
+
+        explicit ParticleSystem(uint32_t count, const ParticleSettings& settings = {});
+
+        uint32_t get_count() const { return _count; }
+        uint32_t get_capacity() const { return _capacity; }
+        const ParticleSettings& get_settings() const { return _settings; }
+
+        void reset(uint32_t seed);
+        // Advances every particle by `delta_time`, spread across `pool` when one is given.
+        void simulate(float delta_time, TaskPool* pool = nullptr, bool allow_simd = true);
+        void simulate_range_scalar(float delta_time, uint32_t begin, uint32_t end);
+        void simulate_range_avx2(float delta_time, uint32_t begin, uint32_t end);
+
+        static bool is_avx2_available();
+
+        const float* get_position_x() const { return _position_x.get(); }
+        const float* get_position_y() const { return _position_y.get(); }
+        const float* get_position_z() const { return _position_z.get(); }
+        const float* get_velocity_x() const { return _velocity_x.get(); }
+        const float* get_velocity_y() const { return _velocity_y.get(); }
+        const float* get_velocity_z() const { return _velocity_z.get(); }
+        const float* get_lifetime() const { return _lifetime.get(); }
+        const uint32_t* get_color() const { return _color.get(); }
+
+    private:
+        struct AlignedDeleter
+        {
+            void operator()(void* pointer) const;
+        };
+        template<typename T>
+        using Stream = std::unique_ptr<T[], AlignedDeleter>;
+
+        uint32_t _count;
+        uint32_t _capacity;
+        uint32_t _generation = 0;
+        ParticleSettings _settings;
+        Stream<float> _position_x;
+        Stream<float> _position_y;
+        Stream<float> _position_z;
+        Stream<float> _velocity_x;
+        Stream<float> _velocity_y;
+        Stream<float> _velocity_z;
+        Stream<float> _lifetime;
+        Stream<uint32_t> _color;
+
+        template<typename T>
+        static Stream<T> _allocate_stream(uint32_t capacity);
+        void _spawn(uint32_t index, uint32_t seed);
+    };
+}  // namespace learn_d3d12
@@ -0,0 +1,746 @@
+#include "bc_encoder.h"
+#include "../simd/cpu_features.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        constexpr uint32_t kBlockPixelCount = 16;
+        constexpr uint32_t kBc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        struct BlockPixels
+        {
+            alignas(32) float channels[4][kBlockPixelCount];
+        };
+
+        void load_block(const uint8_t* rgba, BlockPixels& block)
+        {
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    block.channels[c][i] = static_cast<float>(rgba[i * 4 + c]);
+                }
+            }
+        }
+
+        // Projects every pixel onto the segment start -> end and quantizes the position
+        // to one of `level_count` evenly spaced levels, 0 being `start`.
+        void project_to_levels_scalar(const float* const* channels, uint32_t channel_count, const float* start, const float* end, uint32_t level_count, uint8_t* levels)
+        {
+            float axis[4] = {};
+            float length_squared = 0.0f;
+            for (uint32_t c = 0; c < channel_count; c++)
+            {
+                axis[c] = end[c] - start[c];
+                length_squared += axis[c] * axis[c];
+            }
+            if (length_squared < 1e-8f)
+            {
+                std::fill(levels, levels + kBlockPixelCount, uint8_t(0));
+                return;
+            }
+            const float scale = static_cast<float>(level_count - 1) / length_squared;
+            const float max_level = static_cast<float>(level_count - 1);
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                float distance = 0.0f;
+                for (uint32_t c = 0; c < channel_count; c++)
+                {
+                    distance += (channels[c][i] - start[c]) * axis[c];
+                }
+                levels[i] = static_cast<uint8_t>(std::nearbyint(std::clamp(distance * scale, 0.0f, max_level)));
+            }
+        }
+
+#if LEARN_D3D12_X86
+        LEARN_D3D12_TARGET_AVX2 void project_to_levels_avx2(const float* const* channels, uint32_t channel_count, const float* start, const float* end, uint32_t level_count, uint8_t* levels)
+        {
+            float axis[4] = {};
+            float length_squared = 0.0f;
+            for (uint32_t c = 0; c < channel_count; c++)
+            {
+                axis[c] = end[c] - start[c];
+                length_squared += axis[c] * axis[c];
+            }
+            if (length_squared < 1e-8f)
+            {
+                std::fill(levels, levels + kBlockPixelCount, uint8_t(0));
+                return;
+            }
+            const __m256 scale = _mm256_set1_ps(static_cast<float>(level_count - 1) / length_squared);
+            const __m256 max_level = _mm256_set1_ps(static_cast<float>(level_count - 1));
+            const __m256 zero = _mm256_setzero_ps();
+            for (uint32_t half = 0; half < kBlockPixelCount; half += 8)
+            {
+                __m256 distance = zero;
+                for (uint32_t c = 0; c < channel_count; c++)
+                {
+                    __m256 offset = _mm256_sub_ps(_mm256_loadu_ps(&channels[c][half]), _mm256_set1_ps(start[c]));
+                    distance = _mm256_fmadd_ps(offset, _mm256_set1_ps(axis[c]), distance);
+                }
+                __m256 level = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(distance, scale), zero), max_level);
+                // Round to nearest, then narrow the eight 32-bit lanes to bytes.
+                __m256i level_int = _mm256_cvtps_epi32(level);
+                __m128i packed16 = _mm_packus_epi32(_mm256_castsi256_si128(level_int), _mm256_extracti128_si256(level_int, 1));
+                __m128i packed8 = _mm_packus_epi16(packed16, packed16);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(levels + half), packed8);
+            }
+        }
+#endif
+
+        void project_to_levels(const float* const* channels, uint32_t channel_count, const float* start, const float* end, uint32_t level_count, uint8_t* levels)
+        {
+#if LEARN_D3D12_X86
+            if (cpu_supports_avx2())
+            {
+                project_to_levels_avx2(channels, channel_count, start, end, level_count, levels);
+                return;
+            }
+#endif
+            project_to_levels_scalar(channels, channel_count, start, end, level_count, levels);
+        }
+
+        // Fits a line through the block with a few power iterations on the covariance
+        // matrix and returns the extent of the pixels along it.
+        void fit_principal_axis(const BlockPixels& block, uint32_t channel_count, float* start, float* end)
+        {
+            float mean[4] = {};
+            for (uint32_t c = 0; c < channel_count; c++)
+            {
+                for (uint32_t i = 0; i < kBlockPixelCount; i++)
+                {
+                    mean[c] += block.channels[c][i];
+                }
+                mean[c] /= kBlockPixelCount;
+            }
+
+            float covariance[4][4] = {};
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                for (uint32_t a = 0; a < channel_count; a++)
+                {
+                    for (uint32_t b = a; b < channel_count; b++)
+                    {
+                        covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+                    }
+                }
+            }
+            uint32_t dominant = 0;
+            for (uint32_t a = 0; a < channel_count; a++)
+            {
+                for (uint32_t b = 0; b < a; b++)
+                {
+                    covariance[a][b] = covariance[b][a];
+                }
+                if (covariance[a][a] > covariance[dominant][dominant])
+                {
+                    dominant = a;
+                }
+            }
+
+            float axis[4] = {};
+            for (uint32_t c = 0; c < channel_count; c++)
+            {
+                axis[c] = covariance[dominant][c];
+            }
+            for (uint32_t iteration = 0; iteration < 8; iteration++)
+            {
+                float next[4] = {};
+                float length = 0.0f;
+                for (uint32_t a = 0; a < channel_count; a++)
+                {
+                    for (uint32_t b = 0; b < channel_count; b++)
+                    {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                    length += next[a] * next[a];
+                }
+                if (length < 1e-12f)
+                {
+                    break;
+                }
+                float inverse_length = 1.0f / std::sqrt(length);
+                for (uint32_t c = 0; c < channel_count; c++)
+                {
+                    axis[c] = next[c] * inverse_length;
+                }
+            }
+
+            float min_t = 0.0f;
+            float max_t = 0.0f;
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                float t = 0.0f;
+                for (uint32_t c = 0; c < channel_count; c++)
+                {
+                    t += (block.channels[c][i] - mean[c]) * axis[c];
+                }
+                min_t = std::min(min_t, t);
+                max_t = std::max(max_t, t);
+            }
+            for (uint32_t c = 0; c < channel_count; c++)
+            {
+                start[c] = std::clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+                end[c] = std::clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+            }
+        }
+
+        // Least squares endpoints for fixed indices: minimizes
+        // sum |(1 - w_i) * start + w_i * end - p_i|^2 for every channel.
+        void refit_endpoints(const BlockPixels& block, uint32_t channel_count, const uint8_t* levels, const float* level_weights, float* start, float* end)
+        {
+            float aa = 0.0f;
+            float ab = 0.0f;
+            float bb = 0.0f;
+            float ax[4] = {};
+            float bx[4] = {};
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                float w = level_weights[levels[i]];
+                float a = 1.0f - w;
+                aa += a * a;
+                ab += a * w;
+                bb += w * w;
+                for (uint32_t c = 0; c < channel_count; c++)
+                {
+                    ax[c] += a * block.channels[c][i];
+                    bx[c] += w * block.channels[c][i];
+                }
+            }
+            float determinant = aa * bb - ab * ab;
+            if (std::fabs(determinant) < 1e-6f)
+            {
+                return;
+            }
+            float inverse = 1.0f / determinant;
+            for (uint32_t c = 0; c < channel_count; c++)
+            {
+                start[c] = std::clamp((bb * ax[c] - ab * bx[c]) * inverse, 0.0f, 255.0f);
+                end[c] = std::clamp((aa * bx[c] - ab * ax[c]) * inverse, 0.0f, 255.0f);
+            }
+        }
+
+        uint16_t pack_565(const float* color)
+        {
+            auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+            auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+            auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        void unpack_565(uint16_t packed, uint8_t* color)
+        {
+            uint8_t r = (packed >> 11) & 0x1F;
+            uint8_t g = (packed >> 5) & 0x3F;
+            uint8_t b = packed & 0x1F;
+            color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+            color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+            color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+        }
+
+        void encode_bc1(const uint8_t* rgba, uint8_t* out)
+        {
+            static constexpr float kLevelWeights[4] = {0.0f, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f};
+            BlockPixels block;
+            load_block(rgba, block);
+            const float* channels[3] = {block.channels[0], block.channels[1], block.channels[2]};
+
+            float start[4];
+            float end[4];
+            uint8_t levels[kBlockPixelCount];
+            fit_principal_axis(block, 3, start, end);
+            project_to_levels(channels, 3, start, end, 4, levels);
+            refit_endpoints(block, 3, levels, kLevelWeights, start, end);
+
+            uint16_t packed_start = pack_565(start);
+            uint16_t packed_end = pack_565(end);
+            uint32_t indices = 0;
+            if (packed_start != packed_end)
+            {
+                // Indices have to be chosen against the colors the decoder will actually see.
+                uint8_t quantized[2][3];
+                unpack_565(packed_start, quantized[0]);
+                unpack_565(packed_end, quantized[1]);
+                float start_q[3];
+                float end_q[3];
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    start_q[c] = static_cast<float>(quantized[0][c]);
+                    end_q[c] = static_cast<float>(quantized[1][c]);
+                }
+                project_to_levels(channels, 3, start_q, end_q, 4, levels);
+
+                // Four-color mode needs color0 > color1; palette order is c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1.
+                static constexpr uint8_t kEndIsColor0[4] = {1, 3, 2, 0};
+                static constexpr uint8_t kStartIsColor0[4] = {0, 2, 3, 1};
+                const uint8_t* remap = packed_end > packed_start ? kEndIsColor0 : kStartIsColor0;
+                for (uint32_t i = 0; i < kBlockPixelCount; i++)
+                {
+                    indices |= static_cast<uint32_t>(remap[levels[i]]) << (i * 2);
+                }
+            }
+            uint16_t color0 = std::max(packed_start, packed_end);
+            uint16_t color1 = std::min(packed_start, packed_end);
+            std::memcpy(out, &color0, 2);
+            std::memcpy(out + 2, &color1, 2);
+            std::memcpy(out + 4, &indices, 4);
+        }
+
+        void encode_bc4(const BlockPixels& block, uint32_t channel, uint8_t* out)
+        {
+            float min_value = 255.0f;
+            float max_value = 0.0f;
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                min_value = std::min(min_value, block.channels[channel][i]);
+                max_value = std::max(max_value, block.channels[channel][i]);
+            }
+            out[0] = static_cast<uint8_t>(max_value);
+            out[1] = static_cast<uint8_t>(min_value);
+
+            uint64_t indices = 0;
+            if (max_value > min_value)
+            {
+                // Eight-value mode: index 0 is the maximum, 1 the minimum and 2..7 step down from the maximum.
+                const float* channels[1] = {block.channels[channel]};
+                uint8_t levels[kBlockPixelCount];
+                project_to_levels(channels, 1, &min_value, &max_value, 8, levels);
+                for (uint32_t i = 0; i < kBlockPixelCount; i++)
+                {
+                    uint64_t index = levels[i] == 7 ? 0 : (levels[i] == 0 ? 1 : 8 - levels[i]);
+                    indices |= index << (i * 3);
+                }
+            }
+            for (uint32_t i = 0; i < 6; i++)
+            {
+                out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+            }
+        }
+
+        void encode_bc5(const uint8_t* rgba, uint8_t* out)
+        {
+            BlockPixels block;
+            load_block(rgba, block);
+            encode_bc4(block, 0, out);
+            encode_bc4(block, 1, out + 8);
+        }
+
+        class BitWriter
+        {
+        public:
+            void write(uint32_t value, uint32_t bit_count)
+            {
+                for (uint32_t i = 0; i < bit_count; i++, _position++)
+                {
+                    if (value & (1u << i))
+                    {
+                        _bytes[_position / 8] |= static_cast<uint8_t>(1u << (_position % 8));
+                    }
+                }
+            }
+            const uint8_t* get_bytes() const { return _bytes; }
+
+        private:
+            uint8_t _bytes[16] = {};
+            uint32_t _position = 0;
+        };
+
+        class BitReader
+        {
+        public:
+            explicit BitReader(const uint8_t* bytes)
+                : _bytes(bytes)
+            {
+            }
+            uint32_t read(uint32_t bit_count)
+            {
+                uint32_t value = 0;
+                for (uint32_t i = 0; i < bit_count; i++, _position++)
+                {
+                    value |= static_cast<uint32_t>((_bytes[_position / 8] >> (_position % 8)) & 1) << i;
+                }
+                return value;
+            }
+
+        private:
+            const uint8_t* _bytes;
+            uint32_t _position = 0;
+        };
+
+        // Mode 6 endpoints are 7 bits per channel plus one shared p-bit per endpoint.
+        void quantize_mode6_endpoint(const float* endpoint, uint8_t* quantized, uint8_t& p_bit)
+        {
+            float best_error = std::numeric_limits<float>::max();
+            for (uint8_t p = 0; p < 2; p++)
+            {
+                uint8_t candidate[4];
+                float error = 0.0f;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    candidate[c] = static_cast<uint8_t>(std::clamp(std::lround((endpoint[c] - p) * 0.5f), 0l, 127l));
+                    float value = static_cast<float>((candidate[c] << 1) | p);
+                    error += (value - endpoint[c]) * (value - endpoint[c]);
+                }
+                if (error < best_error)
+                {
+                    best_error = error;
+                    std::memcpy(quantized, candidate, 4);
+                    p_bit = p;
+                }
+            }
+        }
+
+        void encode_bc7(const uint8_t* rgba, uint8_t* out)
+        {
+            static const std::array<float, 16> kLevelWeights = [] {
+                std::array<float, 16> weights {};
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    weights[i] = static_cast<float>(kBc7Weights4[i]) / 64.0f;
+                }
+                return weights;
+            }();
+            // Maps a position quantized to 1/64 steps onto the closest 4-bit weight index.
+            static const std::array<uint8_t, 65> kNearestWeightIndex = [] {
+                std::array<uint8_t, 65> indices {};
+                for (uint32_t v = 0; v <= 64; v++)
+                {
+                    uint32_t best = 0;
+                    for (uint32_t k = 1; k < 16; k++)
+                    {
+                        if (std::abs(static_cast<int>(kBc7Weights4[k]) - static_cast<int>(v)) < std::abs(static_cast<int>(kBc7Weights4[best]) - static_cast<int>(v)))
+                        {
+                            best = k;
+                        }
+                    }
+                    indices[v] = static_cast<uint8_t>(best);
+                }
+                return indices;
+            }();
+
+            BlockPixels block;
+            load_block(rgba, block);
+            const float* channels[4] = {block.channels[0], block.channels[1], block.channels[2], block.channels[3]};
+
+            float start[4];
+            float end[4];
+            uint8_t levels[kBlockPixelCount];
+            fit_principal_axis(block, 4, start, end);
+            project_to_levels(channels, 4, start, end, 16, levels);
+            refit_endpoints(block, 4, levels, kLevelWeights.data(), start, end);
+
+            uint8_t quantized[2][4];
+            uint8_t p_bits[2];
+            quantize_mode6_endpoint(start, quantized[0], p_bits[0]);
+            quantize_mode6_endpoint(end, quantized[1], p_bits[1]);
+            float start_q[4];
+            float end_q[4];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                start_q[c] = static_cast<float>((quantized[0][c] << 1) | p_bits[0]);
+                end_q[c] = static_cast<float>((quantized[1][c] << 1) | p_bits[1]);
+            }
+            project_to_levels(channels, 4, start_q, end_q, 65, levels);
+            uint8_t indices[kBlockPixelCount];
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                indices[i] = kNearestWeightIndex[levels[i]];
+            }
+
+            // The anchor index is stored with its top bit implied to be zero.
+            if (indices[0] & 0x8)
+            {
+                std::swap(quantized[0], quantized[1]);
+                std::swap(p_bits[0], p_bits[1]);
+                for (auto& index : indices)
+                {
+                    index = static_cast<uint8_t>(15 - index);
+                }
+            }
+
+            BitWriter writer;
+            writer.write(1u << 6, 7);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                writer.write(quantized[0][c], 7);
+                writer.write(quantized[1][c], 7);
+            }
+            writer.write(p_bits[0], 1);
+            writer.write(p_bits[1], 1);
+            writer.write(indices[0], 3);
+            for (uint32_t i = 1; i < kBlockPixelCount; i++)
+            {
+                writer.write(indices[i], 4);
+            }
+            std::memcpy(out, writer.get_bytes(), 16);
+        }
+
+        void decode_bc1(const uint8_t* block, uint8_t* rgba)
+        {
+            uint16_t color0;
+            uint16_t color1;
+            uint32_t indices;
+            std::memcpy(&color0, block, 2);
+            std::memcpy(&color1, block + 2, 2);
+            std::memcpy(&indices, block + 4, 4);
+
+            uint8_t palette[4][4] = {};
+            unpack_565(color0, palette[0]);
+            unpack_565(color1, palette[1]);
+            palette[0][3] = 255;
+            palette[1][3] = 255;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                if (color0 > color1)
+                {
+                    palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+                    palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+                }
+                else
+                {
+                    palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c] + 1) / 2);
+                }
+            }
+            palette[2][3] = 255;
+            palette[3][3] = color0 > color1 ? 255 : 0;
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                std::memcpy(rgba + i * 4, palette[(indices >> (i * 2)) & 0x3], 4);
+            }
+        }
+
+        void decode_bc4(const uint8_t* block, uint8_t* rgba, uint32_t channel)
+        {
+            uint32_t value0 = block[0];
+            uint32_t value1 = block[1];
+            uint8_t palette[8];
+            palette[0] = static_cast<uint8_t>(value0);
+            palette[1] = static_cast<uint8_t>(value1);
+            if (value0 > value1)
+            {
+                for (uint32_t i = 2; i < 8; i++)
+                {
+                    palette[i] = static_cast<uint8_t>(((8 - i) * value0 + (i - 1) * value1 + 3) / 7);
+                }
+            }
+            else
+            {
+                for (uint32_t i = 2; i < 6; i++)
+                {
+                    palette[i] = static_cast<uint8_t>(((6 - i) * value0 + (i - 1) * value1 + 2) / 5);
+                }
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+            uint64_t indices = 0;
+            for (uint32_t i = 0; i < 6; i++)
+            {
+                indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+            }
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                rgba[i * 4 + channel] = palette[(indices >> (i * 3)) & 0x7];
+            }
+        }
+
+        void decode_bc7(const uint8_t* block, uint8_t* rgba)
+        {
+            if ((block[0] & 0x7F) != (1u << 6))
+            {
+                // Only mode 6 is produced by the encoder; flag anything else in magenta.
+                for (uint32_t i = 0; i < kBlockPixelCount; i++)
+                {
+                    const uint8_t magenta[4] = {255, 0, 255, 255};
+                    std::memcpy(rgba + i * 4, magenta, 4);
+                }
+                return;
+            }
+            BitReader reader(block);
+            reader.read(7);
+            uint8_t endpoints[2][4];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                endpoints[0][c] = static_cast<uint8_t>(reader.read(7) << 1);
+                endpoints[1][c] = static_cast<uint8_t>(reader.read(7) << 1);
+            }
+            uint32_t p0 = reader.read(1);
+            uint32_t p1 = reader.read(1);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                endpoints[0][c] |= p0;
+                endpoints[1][c] |= p1;
+            }
+            for (uint32_t i = 0; i < kBlockPixelCount; i++)
+            {
+                uint32_t weight = kBc7Weights4[reader.read(i == 0 ? 3 : 4)];
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    rgba[i * 4 + c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+                }
+            }
+        }
+    }  // namespace
+
+    uint32_t get_bc_block_size(BcFormat format)
+    {
+        return format == BcFormat::kBc1 ? 8 : 16;
+    }
+
+    uint32_t get_bc_dxgi_format(BcFormat format, bool srgb)
+    {
+        // Values of DXGI_FORMAT_BC1_UNORM(_SRGB), DXGI_FORMAT_BC5_UNORM and DXGI_FORMAT_BC7_UNORM(_SRGB).
+        switch (format)
+        {
+            case BcFormat::kBc1:
+                return srgb ? 72 : 71;
+            case BcFormat::kBc5:
+                return 83;
+            case BcFormat::kBc7:
+                return srgb ? 99 : 98;
+        }
+        return 0;
+    }
+
+    const char* get_bc_format_name(BcFormat format)
+    {
+        switch (format)
+        {
+            case BcFormat::kBc1:
+                return "BC1";
+            case BcFormat::kBc5:
+                return "BC5";
+            case BcFormat::kBc7:
+                return "BC7";
+        }
+        return "";
+    }
+
+    void encode_bc_block(BcFormat format, const uint8_t* rgba, uint8_t* block)
+    {
+        switch (format)
+        {
+            case BcFormat::kBc1:
+                encode_bc1(rgba, block);
+                break;
+            case BcFormat::kBc5:
+                encode_bc5(rgba, block);
+                break;
+            case BcFormat::kBc7:
+                encode_bc7(rgba, block);
+                break;
+        }
+    }
+
+    void decode_bc_block(BcFormat format, const uint8_t* block, uint8_t* rgba)
+    {
+        switch (format)
+        {
+            case BcFormat::kBc1:
+                decode_bc1(block, rgba);
+                break;
+            case BcFormat::kBc5:
+                for (uint32_t i = 0; i < kBlockPixelCount; i++)
+                {
+                    rgba[i * 4 + 2] = 0;
+                    rgba[i * 4 + 3] = 255;
+                }
+                decode_bc4(block, rgba, 0);
+                decode_bc4(block + 8, rgba, 1);
+                break;
+            case BcFormat::kBc7:
+                decode_bc7(block, rgba);
+                break;
+        }
+    }
+
+    std::vector<uint8_t> compress_image(const Image& image, BcFormat format, TaskPool* pool)
+    {
+        const uint32_t blocks_x = (image.width + 3) / 4;
+        const uint32_t blocks_y = (image.height + 3) / 4;
+        const uint32_t block_size = get_bc_block_size(format);
+        std::vector<uint8_t> blocks(static_cast<size_t>(blocks_x) * blocks_y * block_size);
+
+        auto compress_rows = [&](uint32_t begin, uint32_t end) {
+            uint8_t pixels[kBlockPixelCount * 4];
+            for (uint32_t block_y = begin; block_y < end; block_y++)
+            {
+                for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+                {
+                    for (uint32_t i = 0; i < kBlockPixelCount; i++)
+                    {
+                        uint32_t x = std::min(block_x * 4 + i % 4, image.width - 1);
+                        uint32_t y = std::min(block_y * 4 + i / 4, image.height - 1);
+                        std::memcpy(pixels + i * 4, image.get_pixel(x, y), 4);
+                    }
+                    encode_bc_block(format, pixels, &blocks[(static_cast<size_t>(block_y) * blocks_x + block_x) * block_size]);
+                }
+            }
+        };
+        if (pool)
+        {
+            pool->parallel_for(blocks_y, 1, compress_rows);
+        }
+        else
+        {
+            compress_rows(0, blocks_y);
+        }
+        return blocks;
+    }
+
+    Image decompress_image(const std::vector<uint8_t>& blocks, uint32_t width, uint32_t height, BcFormat format)
+    {
+        Image image;
+        image.width = width;
+        image.height = height;
+        image.rgba.resize(static_cast<size_t>(width) * height * 4);
+        const uint32_t blocks_x = (width + 3) / 4;
+        const uint32_t blocks_y = (height + 3) / 4;
+        const uint32_t block_size = get_bc_block_size(format);
+        uint8_t pixels[kBlockPixelCount * 4];
+        for (uint32_t block_y = 0; block_y < blocks_y; block_y++)
+        {
+            for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+            {
+                decode_bc_block(format, &blocks[(static_cast<size_t>(block_y) * blocks_x + block_x) * block_size], pixels);
+                for (uint32_t i = 0; i < kBlockPixelCount; i++)
+                {
+                    uint32_t x = block_x * 4 + i % 4;
+                    uint32_t y = block_y * 4 + i / 4;
+                    if (x < width && y < height)
+                    {
+                        std::memcpy(image.get_pixel(x, y), pixels + i * 4, 4);
+                    }
+                }
+            }
+        }
+        return image;
+    }
+
+    double compute_psnr(const Image& reference, const Image& decoded, BcFormat format)
+    {
+        const uint32_t channel_count = format == BcFormat::kBc1 ? 3 : (format == BcFormat::kBc5 ? 2 : 4);
+        double squared_error = 0.0;
+        const size_t pixel_count = static_cast<size_t>(reference.width) * reference.height;
+        for (size_t i = 0; i < pixel_count; i++)
+        {
+            for (uint32_t c = 0; c < channel_count; c++)
+            {
+                double difference = static_cast<double>(reference.rgba[i * 4 + c]) - static_cast<double>(decoded.rgba[i * 4 + c]);
+                squared_error += difference * difference;
+            }
+        }
+        double mean_squared_error = squared_error / static_cast<double>(pixel_count * channel_count);
+        if (mean_squared_error == 0.0)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        return 10.0 * std::log10(255.0 * 255.0 / mean_squared_error);
+    }
+}  // namespace learn_d3d12
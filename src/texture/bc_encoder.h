@@ -0,0 +1,38 @@
+#pragma once
+
+#include "image.h"
+#include <cstdint>
+#include <vector>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    enum class BcFormat
+    {
+        kBc1 = 0,
+        kBc5 = 1,
+        kBc7 = 2,
+    };
+
+    uint32_t get_bc_block_size(BcFormat format);
+    // DXGI_FORMAT value of the format, as written into the DDS header.
+    uint32_t get_bc_dxgi_format(BcFormat format, bool srgb);
+    const char* get_bc_format_name(BcFormat format);
+
+    // Encoders work on one 4x4 block of RGBA8 pixels, row major.
+    // BC1 is always opaque, BC5 stores red and green, BC7 uses mode 6 (single subset RGBA).
+    // The endpoint fit runs in scalar code; projecting the 16 pixels onto the endpoint
+    // axis to pick indices uses AVX2 when the CPU has it.
+    void encode_bc_block(BcFormat format, const uint8_t* rgba, uint8_t* block);
+    // Decodes the blocks produced by encode_bc_block, for quality measurements.
+    void decode_bc_block(BcFormat format, const uint8_t* block, uint8_t* rgba);
+
+    // Compresses `image` into tightly packed blocks, block rows top to bottom, spread
+    // across `pool` by block row when one is given. Edge blocks replicate border pixels.
+    std::vector<uint8_t> compress_image(const Image& image, BcFormat format, TaskPool* pool = nullptr);
+    Image decompress_image(const std::vector<uint8_t>& blocks, uint32_t width, uint32_t height, BcFormat format);
+
+    // Peak signal-to-noise ratio over the channels `format` stores.
+    double compute_psnr(const Image& reference, const Image& decoded, BcFormat format);
+}  // namespace learn_d3d12
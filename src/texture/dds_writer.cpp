@@ -0,0 +1,159 @@
+#include "dds_writer.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        constexpr uint32_t make_four_cc(char a, char b, char c, char d)
+        {
+            return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+        }
+
+        constexpr uint32_t kDdsMagic = make_four_cc('D', 'D', 'S', ' ');
+        constexpr uint32_t kLayoutTag = make_four_cc('L', 'D', '1', '2');
+        constexpr uint32_t kLayoutVersion = 1;
+
+        // Flags from the DDS_HEADER documentation.
+        constexpr uint32_t kDdsdCaps = 0x1;
+        constexpr uint32_t kDdsdHeight = 0x2;
+        constexpr uint32_t kDdsdWidth = 0x4;
+        constexpr uint32_t kDdsdPixelFormat = 0x1000;
+        constexpr uint32_t kDdsdMipMapCount = 0x20000;
+        constexpr uint32_t kDdsdLinearSize = 0x80000;
+        constexpr uint32_t kDdpfFourCc = 0x4;
+        constexpr uint32_t kDdsCapsComplex = 0x8;
+        constexpr uint32_t kDdsCapsTexture = 0x1000;
+        constexpr uint32_t kDdsCapsMipMap = 0x400000;
+        constexpr uint32_t kResourceDimensionTexture2d = 3;
+
+        struct DdsPixelFormat
+        {
+            uint32_t size;
+            uint32_t flags;
+            uint32_t four_cc;
+            uint32_t rgb_bit_count;
+            uint32_t r_bit_mask;
+            uint32_t g_bit_mask;
+            uint32_t b_bit_mask;
+            uint32_t a_bit_mask;
+        };
+
+        struct DdsHeader
+        {
+            uint32_t size;
+            uint32_t flags;
+            uint32_t height;
+            uint32_t width;
+            uint32_t pitch_or_linear_size;
+            uint32_t depth;
+            uint32_t mip_map_count;
+            uint32_t reserved1[11];
+            DdsPixelFormat pixel_format;
+            uint32_t caps;
+            uint32_t caps2;
+            uint32_t caps3;
+            uint32_t caps4;
+            uint32_t reserved2;
+        };
+
+        struct DdsHeaderDx10
+        {
+            uint32_t dxgi_format;
+            uint32_t resource_dimension;
+            uint32_t misc_flag;
+            uint32_t array_size;
+            uint32_t misc_flags2;
+        };
+
+        static_assert(sizeof(DdsHeader) == 124);
+        static_assert(sizeof(DdsHeaderDx10) == 20);
+        static_assert(sizeof(uint32_t) + sizeof(DdsHeader) + sizeof(DdsHeaderDx10) <= kDdsPayloadOffset);
+
+        uint64_t align_up(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+    }  // namespace
+
+    std::vector<SubresourceFootprint> get_subresource_footprints(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t block_size, uint64_t& total_size)
+    {
+        std::vector<SubresourceFootprint> footprints;
+        footprints.reserve(mip_count);
+        uint64_t offset = 0;
+        for (uint32_t level = 0; level < mip_count; level++)
+        {
+            SubresourceFootprint footprint;
+            footprint.width = std::max(width >> level, 1u);
+            footprint.height = std::max(height >> level, 1u);
+            uint32_t blocks_x = (footprint.width + 3) / 4;
+            footprint.row_count = (footprint.height + 3) / 4;
+            footprint.row_pitch = static_cast<uint32_t>(align_up(static_cast<uint64_t>(blocks_x) * block_size, kDdsRowPitchAlignment));
+            footprint.offset = align_up(offset, kDdsPlacementAlignment);
+            offset = footprint.offset + static_cast<uint64_t>(footprint.row_pitch) * footprint.row_count;
+            footprints.push_back(footprint);
+        }
+        total_size = offset;
+        return footprints;
+    }
+
+    bool write_dds(const std::string& path, const CookedTexture& texture, std::string& error)
+    {
+        const uint32_t mip_count = static_cast<uint32_t>(texture.mips.size());
+        uint64_t payload_size = 0;
+        auto footprints = get_subresource_footprints(texture.width, texture.height, mip_count, texture.block_size, payload_size);
+
+        DdsHeader header {};
+        header.size = sizeof(DdsHeader);
+        header.flags = kDdsdCaps | kDdsdHeight | kDdsdWidth | kDdsdPixelFormat | kDdsdMipMapCount | kDdsdLinearSize;
+        header.height = texture.height;
+        header.width = texture.width;
+        header.pitch_or_linear_size = mip_count > 0 ? static_cast<uint32_t>(texture.mips[0].size()) : 0;
+        header.mip_map_count = mip_count;
+        header.reserved1[0] = kLayoutTag;
+        header.reserved1[1] = kLayoutVersion;
+        header.reserved1[2] = kDdsRowPitchAlignment;
+        header.reserved1[3] = kDdsPlacementAlignment;
+        header.reserved1[4] = kDdsPayloadOffset;
+        header.pixel_format.size = sizeof(DdsPixelFormat);
+        header.pixel_format.flags = kDdpfFourCc;
+        header.pixel_format.four_cc = make_four_cc('D', 'X', '1', '0');
+        header.caps = kDdsCapsTexture | (mip_count > 1 ? kDdsCapsComplex | kDdsCapsMipMap : 0);
+
+        DdsHeaderDx10 header_dx10 {};
+        header_dx10.dxgi_format = texture.dxgi_format;
+        header_dx10.resource_dimension = kResourceDimensionTexture2d;
+        header_dx10.array_size = 1;
+
+        std::vector<uint8_t> file(kDdsPayloadOffset + payload_size, 0);
+        std::memcpy(file.data(), &kDdsMagic, sizeof(kDdsMagic));
+        std::memcpy(file.data() + sizeof(kDdsMagic), &header, sizeof(header));
+        std::memcpy(file.data() + sizeof(kDdsMagic) + sizeof(header), &header_dx10, sizeof(header_dx10));
+        for (uint32_t level = 0; level < mip_count; level++)
+        {
+            const auto& footprint = footprints[level];
+            const auto& blocks = texture.mips[level];
+            const size_t packed_row_size = blocks.size() / footprint.row_count;
+            for (uint32_t row = 0; row < footprint.row_count; row++)
+            {
+                std::memcpy(file.data() + kDdsPayloadOffset + footprint.offset + static_cast<uint64_t>(row) * footprint.row_pitch, blocks.data() + row * packed_row_size, packed_row_size);
+            }
+        }
+
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            error = "Failed to open " + path + " for writing.";
+            return false;
+        }
+        stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        if (!stream)
+        {
+            error = "Failed to write " + path + ".";
+            return false;
+        }
+        return true;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // Placement of one mip level inside the payload, following
+    // ID3D12Device::GetCopyableFootprints for a block compressed 2D texture.
+    struct SubresourceFootprint
+    {
+        uint64_t offset;
+        uint32_t width;
+        uint32_t height;
+        uint32_t row_pitch;
+        uint32_t row_count;
+    };
+
+    struct CookedTexture
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t dxgi_format = 0;
+        uint32_t block_size = 0;
+        // Tightly packed blocks of every mip level, level 0 first.
+        std::vector<std::vector<uint8_t>> mips;
+    };
+
+    // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT and D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.
+    constexpr uint32_t kDdsRowPitchAlignment = 256;
+    constexpr uint32_t kDdsPlacementAlignment = 512;
+    // The payload starts at this file offset, so an upload heap allocation aligned to it
+    // keeps every subresource offset valid for CopyTextureRegion.
+    constexpr uint32_t kDdsPayloadOffset = 512;
+
+    std::vector<SubresourceFootprint> get_subresource_footprints(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t block_size, uint64_t& total_size);
+
+    // Writes a DDS file with a DX10 header. Unlike a stock DDS, rows and mip levels are
+    // padded to the D3D12 copy alignments and the payload starts at kDdsPayloadOffset;
+    // the layout is flagged by the "LD12" tag in dwReserved1 so readers can tell.
+    bool write_dds(const std::string& path, const CookedTexture& texture, std::string& error);
+}  // namespace learn_d3d12
@@ -0,0 +1,189 @@
+#include "image.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        bool load_tga(const std::vector<uint8_t>& data, Image& image, std::string& error)
+        {
+            if (data.size() < 18)
+            {
+                error = "TGA header is truncated";
+                return false;
+            }
+            uint8_t id_length = data[0];
+            uint8_t color_map_type = data[1];
+            uint8_t image_type = data[2];
+            uint32_t width = data[12] | (data[13] << 8);
+            uint32_t height = data[14] | (data[15] << 8);
+            uint8_t bits_per_pixel = data[16];
+            uint8_t descriptor = data[17];
+            if (color_map_type != 0 || (image_type != 2 && image_type != 10) || (bits_per_pixel != 24 && bits_per_pixel != 32))
+            {
+                error = "only true-color 24 or 32 bit TGA files are supported";
+                return false;
+            }
+
+            uint32_t bytes_per_pixel = bits_per_pixel / 8;
+            size_t position = 18 + id_length;
+            image.width = width;
+            image.height = height;
+            image.rgba.assign(static_cast<size_t>(width) * height * 4, 255);
+
+            auto read_pixel = [&](uint8_t* out) {
+                if (position + bytes_per_pixel > data.size())
+                {
+                    return false;
+                }
+                out[0] = data[position + 2];
+                out[1] = data[position + 1];
+                out[2] = data[position + 0];
+                out[3] = bytes_per_pixel == 4 ? data[position + 3] : 255;
+                position += bytes_per_pixel;
+                return true;
+            };
+
+            // Pixels are decoded in file order, then flipped if the origin is bottom-left.
+            size_t pixel_count = static_cast<size_t>(width) * height;
+            size_t pixel = 0;
+            while (pixel < pixel_count)
+            {
+                uint32_t run_length = 1;
+                bool repeat = false;
+                if (image_type == 10)
+                {
+                    if (position >= data.size())
+                    {
+                        break;
+                    }
+                    uint8_t header = data[position++];
+                    run_length = (header & 0x7F) + 1;
+                    repeat = header & 0x80;
+                }
+                uint8_t value[4];
+                for (uint32_t i = 0; i < run_length && pixel < pixel_count; i++, pixel++)
+                {
+                    if ((!repeat || i == 0) && !read_pixel(value))
+                    {
+                        error = "TGA pixel data is truncated";
+                        return false;
+                    }
+                    std::copy(value, value + 4, &image.rgba[pixel * 4]);
+                }
+            }
+            if (pixel < pixel_count)
+            {
+                error = "TGA pixel data is truncated";
+                return false;
+            }
+
+            bool top_left_origin = descriptor & 0x20;
+            if (!top_left_origin)
+            {
+                size_t row_size = static_cast<size_t>(width) * 4;
+                for (uint32_t y = 0; y < height / 2; y++)
+                {
+                    std::swap_ranges(
+                        image.rgba.begin() + y * row_size,
+                        image.rgba.begin() + (y + 1) * row_size,
+                        image.rgba.begin() + (height - 1 - y) * row_size);
+                }
+            }
+            return true;
+        }
+
+        bool load_ppm(const std::vector<uint8_t>& data, Image& image, std::string& error)
+        {
+            size_t position = 2;
+            auto read_number = [&](uint32_t& value) {
+                while (position < data.size())
+                {
+                    if (data[position] == '#')
+                    {
+                        while (position < data.size() && data[position] != '\n')
+                        {
+                            position++;
+                        }
+                    }
+                    else if (std::isspace(data[position]))
+                    {
+                        position++;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+                if (position >= data.size() || !std::isdigit(data[position]))
+                {
+                    return false;
+                }
+                value = 0;
+                while (position < data.size() && std::isdigit(data[position]))
+                {
+                    value = value * 10 + (data[position++] - '0');
+                }
+                return true;
+            };
+
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t max_value = 0;
+            if (!read_number(width) || !read_number(height) || !read_number(max_value) || max_value != 255)
+            {
+                error = "only 8-bit binary PPM files are supported";
+                return false;
+            }
+            // Exactly one whitespace byte separates the header from the pixels.
+            position++;
+            size_t pixel_count = static_cast<size_t>(width) * height;
+            if (position + pixel_count * 3 > data.size())
+            {
+                error = "PPM pixel data is truncated";
+                return false;
+            }
+            image.width = width;
+            image.height = height;
+            image.rgba.resize(pixel_count * 4);
+            for (size_t i = 0; i < pixel_count; i++)
+            {
+                image.rgba[i * 4 + 0] = data[position + i * 3 + 0];
+                image.rgba[i * 4 + 1] = data[position + i * 3 + 1];
+                image.rgba[i * 4 + 2] = data[position + i * 3 + 2];
+                image.rgba[i * 4 + 3] = 255;
+            }
+            return true;
+        }
+    }  // namespace
+
+    bool load_image(const std::string& path, Image& image, std::string& error)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        bool loaded = false;
+        if (data.size() >= 2 && data[0] == 'P' && data[1] == '6')
+        {
+            loaded = load_ppm(data, image, error);
+        }
+        else
+        {
+            loaded = load_tga(data, image, error);
+        }
+        if (loaded && (image.width == 0 || image.height == 0))
+        {
+            error = "image is empty";
+            return false;
+        }
+        return loaded;
+    }
+}  // namespace learn_d3d12
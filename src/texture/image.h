@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // 8-bit RGBA image, rows stored top to bottom without padding.
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgba;
+
+        const uint8_t* get_pixel(uint32_t x, uint32_t y) const { return &rgba[(static_cast<size_t>(y) * width + x) * 4]; }
+        uint8_t* get_pixel(uint32_t x, uint32_t y) { return &rgba[(static_cast<size_t>(y) * width + x) * 4]; }
+    };
+
+    // Supports uncompressed or RLE TGA (24/32 bit) and binary PPM (P6, 8 bit).
+    bool load_image(const std::string& path, Image& image, std::string& error);
+}  // namespace learn_d3d12
@@ -0,0 +1,93 @@
+#include "mip_chain.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace learn_d3d12
+{
+    namespace
+    {
+        const std::array<float, 256>& get_srgb_to_linear_table()
+        {
+            static const std::array<float, 256> table = [] {
+                std::array<float, 256> values {};
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    float c = static_cast<float>(i) / 255.0f;
+                    values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return values;
+            }();
+            return table;
+        }
+
+        uint8_t linear_to_srgb(float linear)
+        {
+            linear = std::clamp(linear, 0.0f, 1.0f);
+            float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            return static_cast<uint8_t>(std::lround(c * 255.0f));
+        }
+
+        void downsample_rows(const Image& source, Image& target, bool srgb, uint32_t begin, uint32_t end)
+        {
+            const auto& to_linear = get_srgb_to_linear_table();
+            // Odd dimensions clamp the second tap, which keeps the filter a plain 2x2 box.
+            for (uint32_t y = begin; y < end; y++)
+            {
+                uint32_t y0 = std::min(y * 2, source.height - 1);
+                uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+                for (uint32_t x = 0; x < target.width; x++)
+                {
+                    uint32_t x0 = std::min(x * 2, source.width - 1);
+                    uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                    const uint8_t* taps[4] = {source.get_pixel(x0, y0), source.get_pixel(x1, y0), source.get_pixel(x0, y1), source.get_pixel(x1, y1)};
+                    uint8_t* out = target.get_pixel(x, y);
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        if (srgb && c < 3)
+                        {
+                            float sum = to_linear[taps[0][c]] + to_linear[taps[1][c]] + to_linear[taps[2][c]] + to_linear[taps[3][c]];
+                            out[c] = linear_to_srgb(sum * 0.25f);
+                        }
+                        else
+                        {
+                            uint32_t sum = taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c];
+                            out[c] = static_cast<uint8_t>((sum + 2) / 4);
+                        }
+                    }
+                }
+            }
+        }
+    }  // namespace
+
+    std::vector<Image> build_mip_chain(const Image& image, bool srgb, uint32_t max_levels, TaskPool* pool)
+    {
+        std::vector<Image> mips;
+        mips.push_back(image);
+        while (mips.back().width > 1 || mips.back().height > 1)
+        {
+            if (max_levels && mips.size() >= max_levels)
+            {
+                break;
+            }
+            const Image& source = mips.back();
+            Image target;
+            target.width = std::max(source.width / 2, 1u);
+            target.height = std::max(source.height / 2, 1u);
+            target.rgba.resize(static_cast<size_t>(target.width) * target.height * 4);
+            if (pool)
+            {
+                pool->parallel_for(target.height, 16, [&](uint32_t begin, uint32_t end) {
+                    downsample_rows(source, target, srgb, begin, end);
+                });
+            }
+            else
+            {
+                downsample_rows(source, target, srgb, 0, target.height);
+            }
+            mips.push_back(std::move(target));
+        }
+        return mips;
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "image.h"
+#include <vector>
+
+namespace learn_d3d12
+{
+    class TaskPool;
+
+    // Builds the full mip chain (level 0 is a copy of `image`) down to 1x1, or `max_levels`
+    // when non-zero. sRGB color is filtered in linear space so that downsampling does not
+    // darken the image; alpha and linear data are filtered as stored.
+    std::vector<Image> build_mip_chain(const Image& image, bool srgb, uint32_t max_levels = 0, TaskPool* pool = nullptr);
+}  // namespace learn_d3d12
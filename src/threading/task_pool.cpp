@@ -0,0 +1,102 @@
+#include "task_pool.h"
+#include <algorithm>
+
+namespace learn_d3d12
+{
+    TaskPool::TaskPool(uint32_t worker_count)
+    {
+        if (worker_count == UINT32_MAX)
+        {
+            uint32_t hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+            worker_count = hardware_threads - 1;
+        }
+        _workers.reserve(worker_count);
+        for (uint32_t i = 0; i < worker_count; i++)
+        {
+            _workers.emplace_back(&TaskPool::_worker_main, this);
+        }
+    }
+
+    TaskPool::~TaskPool()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stop_requested = true;
+        }
+        _work_ready.notify_all();
+        for (auto& worker : _workers)
+        {
+            worker.join();
+        }
+    }
+
+    void TaskPool::parallel_for(uint32_t count, uint32_t grain, const RangeFunction& function)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        grain = std::max(grain, 1u);
+        if (_workers.empty() || count <= grain)
+        {
+            function(0, count);
+            return;
+        }
+
+        std::lock_guard submit_lock(_submit_mutex);
+        {
+            std::lock_guard lock(_mutex);
+            _function = &function;
+            _count = count;
+            _grain = grain;
+            _next_index.store(0, std::memory_order_relaxed);
+            _active_workers = static_cast<uint32_t>(_workers.size());
+            _generation++;
+        }
+        _work_ready.notify_all();
+
+        _run_chunks();
+
+        std::unique_lock lock(_mutex);
+        _work_done.wait(lock, [this] { return _active_workers == 0; });
+        _function = nullptr;
+    }
+
+    void TaskPool::_run_chunks()
+    {
+        while (true)
+        {
+            uint32_t begin = _next_index.fetch_add(_grain, std::memory_order_relaxed);
+            if (begin >= _count)
+            {
+                break;
+            }
+            (*_function)(begin, std::min(begin + _grain, _count));
+        }
+    }
+
+    void TaskPool::_worker_main()
+    {
+        uint64_t seen_generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock lock(_mutex);
+                _work_ready.wait(lock, [&] { return _stop_requested || _generation != seen_generation; });
+                if (_stop_requested)
+                {
+                    return;
+                }
+                seen_generation = _generation;
+            }
+
+            _run_chunks();
+
+            {
+                std::lock_guard lock(_mutex);
+                _active_workers--;
+            }
+            _work_done.notify_one();
+        }
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace learn_d3d12
+{
+    // A fixed set of worker threads that split index ranges between them.
+    // The calling thread takes part in the work, so a pool created with zero workers
+    // simply runs everything inline. Only one parallel_for runs at a time; calling it
+    // again from inside a task would deadlock.
+    class TaskPool
+    {
+    public:
+        using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+        // `worker_count` of UINT32_MAX means one worker per hardware thread, minus the caller.
+        explicit TaskPool(uint32_t worker_count = UINT32_MAX);
+        ~TaskPool();
+        TaskPool(const TaskPool&) = delete;
+        TaskPool& operator=(const TaskPool&) = delete;
+
+        // Number of threads that execute tasks, including the caller.
+        uint32_t get_thread_count() const { return static_cast<uint32_t>(_workers.size()) + 1; }
+
+        // Calls `function` on consecutive chunks of [0, count) of at most `grain` items and
+        // returns once every chunk has finished.
+        void parallel_for(uint32_t count, uint32_t grain, const RangeFunction& function);
+
+    private:
+        std::vector<std::thread> _workers;
+        std::mutex _submit_mutex;
+        std::mutex _mutex;
+        std::condition_variable _work_ready;
+        std::condition_variable _work_done;
+        uint64_t _generation = 0;
+        uint32_t _active_workers = 0;
+        bool _stop_requested = false;
+
+        const RangeFunction* _function = nullptr;
+        uint32_t _count = 0;
+        uint32_t _grain = 1;
+        std::atomic<uint32_t> _next_index {0};
+
+        void _run_chunks();
+        void _worker_main();
+    };
+}  // namespace learn_d3d12
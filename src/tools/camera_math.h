@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Camera helpers shared by the benchmark tools.
+namespace learn_d3d12
+{
+    // Row-major, row-vector matrices in the DirectXMath convention.
+    inline void multiply(const float* a, const float* b, float* out)
+    {
+        for (uint32_t r = 0; r < 4; r++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                out[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] + a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+            }
+        }
+    }
+
+    inline void make_look_at_lh(const float* eye, const float* target, float* out)
+    {
+        float z[3] = {target[0] - eye[0], target[1] - eye[1], target[2] - eye[2]};
+        float z_length = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+        for (auto& v : z)
+        {
+            v /= z_length;
+        }
+        // x = up x z with up = +y, y = z x x.
+        float x[3] = {z[2], 0.0f, -z[0]};
+        float x_length = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+        x[0] /= x_length;
+        x[2] /= x_length;
+        float y[3] = {z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0]};
+        const float view[16] = {
+            x[0], y[0], z[0], 0.0f,
+            x[1], y[1], z[1], 0.0f,
+            x[2], y[2], z[2], 0.0f,
+            -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]), -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]), -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f,
+        };
+        std::copy(view, view + 16, out);
+    }
+
+    inline void make_perspective_lh(float fov_y, float aspect_ratio, float near_z, float far_z, float* out)
+    {
+        float y_scale = 1.0f / std::tan(fov_y * 0.5f);
+        float range = far_z / (far_z - near_z);
+        const float projection[16] = {
+            y_scale / aspect_ratio, 0.0f, 0.0f, 0.0f,
+            0.0f, y_scale, 0.0f, 0.0f,
+            0.0f, 0.0f, range, 1.0f,
+            0.0f, 0.0f, -range * near_z, 0.0f,
+        };
+        std::copy(projection, projection + 16, out);
+    }
+}  // namespace learn_d3d12
@@ -0,0 +1,264 @@
+#include "../capture/capture_reader.h"
+#include "../capture/capture_writer.h"
+#include "../capture/recording_replay_device.h"
+#ifdef _WIN32
+#include "../capture/d3d12_replay_device.h"
+#include "../renderer/d3d12_helper.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // D3D12 values used by the generated capture, so this file does not need d3d12.h.
+    constexpr uint32_t kHeapTypeDefault = 1;
+    constexpr uint32_t kHeapTypeUpload = 2;
+    constexpr uint32_t kStateCommon = 0;
+    constexpr uint32_t kStateRenderTarget = 0x4;
+    constexpr uint32_t kStateGenericRead = 0xac3;
+    constexpr uint32_t kStatePresent = 0;
+    constexpr uint32_t kFormatR8G8B8A8Unorm = 28;
+    constexpr uint32_t kFormatR32G32B32Float = 6;
+    constexpr uint32_t kFormatR32G32B32A32Float = 2;
+    constexpr uint32_t kTopologyTypeTriangle = 3;
+    constexpr uint32_t kTopologyTriangleList = 4;
+    constexpr uint32_t kCullModeNone = 1;
+
+    // Writes a capture shaped like what HelloTriangle records: the vertex buffer is
+    // uploaded on the copy queue during setup, then every frame draws the triangle into
+    // one of two swap chain buffers. The root signature and shaders are placeholder
+    // bytes, so the capture only replays on the recording device.
+    bool generate_capture(const std::string& path, uint32_t frame_count, std::string& error)
+    {
+        using namespace learn_d3d12;
+        constexpr uint32_t kWidth = 1280;
+        constexpr uint32_t kHeight = 720;
+        constexpr uint32_t kBufferCount = 2;
+
+        CaptureWriter writer;
+        if (!writer.open(path, kWidth, kHeight, error))
+        {
+            return false;
+        }
+
+        const uint8_t placeholder_bytecode[16] = {'D', 'X', 'B', 'C'};
+        uint32_t root_signature = writer.create_root_signature(placeholder_bytecode, sizeof(placeholder_bytecode));
+        CaptureInputElement input_elements[2] = {
+            {"POSITION", 0, kFormatR32G32B32Float, 0, 0},
+            {"COLOR", 0, kFormatR32G32B32A32Float, 0, 12},
+        };
+        CaptureGraphicsPipelineChunk pipeline_desc = {};
+        pipeline_desc.root_signature_id = root_signature;
+        pipeline_desc.primitive_topology_type = kTopologyTypeTriangle;
+        pipeline_desc.render_target_format = kFormatR8G8B8A8Unorm;
+        pipeline_desc.cull_mode = kCullModeNone;
+        pipeline_desc.input_element_count = 2;
+        pipeline_desc.vertex_shader_size = sizeof(placeholder_bytecode);
+        pipeline_desc.pixel_shader_size = sizeof(placeholder_bytecode);
+        uint32_t pipeline = writer.create_graphics_pipeline(pipeline_desc, input_elements, placeholder_bytecode, placeholder_bytecode);
+
+        const float vertices[3][7] = {
+            {0.0f, 0.25f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+            {0.25f, -0.25f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f},
+            {-0.25f, -0.25f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f},
+        };
+        uint32_t vertex_buffer = writer.create_buffer(kHeapTypeDefault, kStateCommon, 0, sizeof(vertices));
+        uint32_t staging_buffer = writer.create_buffer(kHeapTypeUpload, kStateGenericRead, 0, sizeof(vertices));
+        uint32_t render_targets[kBufferCount];
+        for (uint32_t i = 0; i < kBufferCount; i++)
+        {
+            render_targets[i] = writer.create_render_target(kWidth, kHeight, kFormatR8G8B8A8Unorm);
+        }
+
+        writer.upload_buffer(staging_buffer, 0, vertices, sizeof(vertices));
+        CaptureCommandStream commands;
+        commands.add(CaptureCommandType::kCopyBufferRegion, CaptureCopyBufferCommand {vertex_buffer, staging_buffer, 0, 0, sizeof(vertices)});
+        uint64_t copy_submission = writer.write_command_list(CaptureQueue::kCopy, commands);
+        writer.write_queue_wait(CaptureQueue::kDirect, CaptureQueue::kCopy, copy_submission);
+
+        const float clear_color[4] = {0.0f, 0.2f, 0.4f, 1.0f};
+        for (uint32_t frame = 0; frame < frame_count; frame++)
+        {
+            writer.begin_frame();
+            uint32_t render_target = render_targets[frame % kBufferCount];
+            commands.clear();
+            commands.add(CaptureCommandType::kSetPipelineState, CaptureObjectCommand {pipeline});
+            commands.add(CaptureCommandType::kSetGraphicsRootSignature, CaptureObjectCommand {root_signature});
+            commands.add(CaptureCommandType::kSetViewport, CaptureViewportCommand {0.0f, 0.0f, static_cast<float>(kWidth), static_cast<float>(kHeight), 0.0f, 1.0f});
+            commands.add(CaptureCommandType::kSetScissorRect, CaptureScissorRectCommand {0, 0, static_cast<int32_t>(kWidth), static_cast<int32_t>(kHeight)});
+            commands.add(CaptureCommandType::kResourceBarrier, CaptureBarrierCommand {render_target, kStatePresent, kStateRenderTarget});
+            commands.add(CaptureCommandType::kSetRenderTarget, CaptureObjectCommand {render_target});
+            commands.add(CaptureCommandType::kClearRenderTarget, CaptureClearCommand {render_target, {clear_color[0], clear_color[1], clear_color[2], clear_color[3]}});
+            commands.add(CaptureCommandType::kSetPrimitiveTopology, CaptureObjectCommand {kTopologyTriangleList});
+            commands.add(CaptureCommandType::kSetVertexBuffer, CaptureVertexBufferCommand {0, vertex_buffer, sizeof(vertices), sizeof(vertices[0]), 0});
+            commands.add(CaptureCommandType::kDrawInstanced, CaptureDrawCommand {3, 1, 0, 0});
+            commands.add(CaptureCommandType::kResourceBarrier, CaptureBarrierCommand {render_target, kStateRenderTarget, kStatePresent});
+            writer.write_command_list(CaptureQueue::kDirect, commands);
+            writer.end_frame();
+        }
+        return writer.close(error);
+    }
+
+    double to_ms(uint64_t ns)
+    {
+        return static_cast<double>(ns) / 1e6;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12Replay", "Replays a frame capture recorded with --capture.");
+    // clang-format off
+    options.add_options()
+        ("input", "Capture file to replay.", cxxopts::value<std::string>())
+        ("pacing", "fast replays frames back to back, recorded waits for the recorded frame start times.", cxxopts::value<std::string>()->default_value("fast"))
+        ("loops", "Times to replay the captured frames.", cxxopts::value<uint32_t>()->default_value("1"))
+        ("dump", "Print every replayed call instead of executing it on a GPU.", cxxopts::value<bool>()->default_value("false"))
+        ("generate", "Write a synthetic HelloTriangle-like capture to this path and exit.", cxxopts::value<std::string>())
+        ("frames", "Frames in the generated capture.", cxxopts::value<uint32_t>()->default_value("60"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12Replay: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string error;
+    if (result.count("generate"))
+    {
+        const auto path = result["generate"].as<std::string>();
+        if (!generate_capture(path, result["frames"].as<uint32_t>(), error))
+        {
+            std::cerr << "LearnD3d12Replay: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Wrote " << path << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (!result.count("input"))
+    {
+        std::cerr << "LearnD3d12Replay: --input is required" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto pacing = result["pacing"].as<std::string>();
+    if (pacing != "fast" && pacing != "recorded")
+    {
+        std::cerr << "LearnD3d12Replay: unknown pacing " << pacing << std::endl;
+        return EXIT_FAILURE;
+    }
+    const bool recorded_pacing = pacing == "recorded";
+    const auto loop_count = std::max(result["loops"].as<uint32_t>(), 1u);
+
+    learn_d3d12::CaptureReader reader;
+    if (!reader.open(result["input"].as<std::string>(), error))
+    {
+        std::cerr << "LearnD3d12Replay: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Without a GPU, or when dumping, the recording device stands in: it validates the
+    // capture and hashes the replayed calls, which must match on every run.
+    std::unique_ptr<learn_d3d12::RecordingReplayDevice> recording_device;
+    learn_d3d12::ReplayDevice* device = nullptr;
+#ifdef _WIN32
+    Microsoft::WRL::ComPtr<ID3D12Device> d3d12_device;
+    std::unique_ptr<learn_d3d12::D3d12ReplayDevice> d3d12_replay_device;
+    if (!result["dump"].as<bool>())
+    {
+        learn_d3d12::throw_if_failed(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&d3d12_device)));
+        d3d12_replay_device = std::make_unique<learn_d3d12::D3d12ReplayDevice>(d3d12_device.Get());
+        device = d3d12_replay_device.get();
+    }
+#endif
+    if (device == nullptr)
+    {
+        recording_device = std::make_unique<learn_d3d12::RecordingReplayDevice>(result["dump"].as<bool>() ? &std::cout : nullptr);
+        device = recording_device.get();
+    }
+
+    using Clock = std::chrono::steady_clock;
+    reader.replay_setup(*device);
+    const uint32_t frame_count = reader.get_frame_count();
+    std::vector<uint64_t> frame_cpu_ns;
+    frame_cpu_ns.reserve(static_cast<size_t>(frame_count) * loop_count);
+    uint64_t loop_start_offset_ns = 0;
+    const auto replay_start = Clock::now();
+    for (uint32_t loop = 0; loop < loop_count; loop++)
+    {
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            if (recorded_pacing)
+            {
+                std::this_thread::sleep_until(replay_start + std::chrono::nanoseconds(loop_start_offset_ns + reader.get_frame_start_ns(i)));
+            }
+            const auto frame_start = Clock::now();
+            reader.replay_frame(i, *device);
+            frame_cpu_ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame_start).count()));
+        }
+        if (frame_count != 0)
+        {
+            loop_start_offset_ns += reader.get_frame_start_ns(frame_count - 1) + reader.get_frame_duration_ns(frame_count - 1);
+        }
+    }
+#ifdef _WIN32
+    if (d3d12_replay_device)
+    {
+        d3d12_replay_device->wait_idle();
+    }
+#endif
+    const uint64_t replay_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - replay_start).count());
+
+    uint64_t recorded_cpu_ns = 0;
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        recorded_cpu_ns += reader.get_frame_duration_ns(i);
+    }
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << frame_count << " frames x " << loop_count << " loops, " << pacing << " pacing, " << to_ms(replay_ns) << " ms total" << std::endl;
+    if (!frame_cpu_ns.empty())
+    {
+        std::vector<uint64_t> sorted = frame_cpu_ns;
+        std::sort(sorted.begin(), sorted.end());
+        uint64_t total_ns = 0;
+        for (uint64_t ns : sorted)
+        {
+            total_ns += ns;
+        }
+        std::cout << "replay CPU per frame: avg " << to_ms(total_ns / sorted.size()) << " ms, p50 " << to_ms(sorted[sorted.size() / 2])
+                  << " ms, p99 " << to_ms(sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)]) << " ms, max " << to_ms(sorted.back()) << " ms" << std::endl;
+    }
+    if (frame_count != 0)
+    {
+        std::cout << "recorded CPU per frame: avg " << to_ms(recorded_cpu_ns / frame_count) << " ms" << std::endl;
+    }
+    if (recording_device)
+    {
+        const auto& counters = recording_device->get_counters();
+        std::cout << "command lists " << counters.command_lists[0] << " direct, " << counters.command_lists[1] << " compute, " << counters.command_lists[2] << " copy; "
+                  << counters.commands << " commands, " << counters.draws << " draws, " << counters.dispatches << " dispatches, " << counters.copies << " copies, "
+                  << counters.queue_waits << " queue waits, " << counters.uploaded_bytes << " bytes uploaded" << std::endl;
+        std::cout << "hash " << std::hex << std::setw(16) << std::setfill('0') << recording_device->get_hash() << std::dec << std::endl;
+        if (recording_device->get_error_count() != 0)
+        {
+            for (const auto& message : recording_device->get_errors())
+            {
+                std::cerr << "LearnD3d12Replay: " << message << std::endl;
+            }
+            std::cerr << "LearnD3d12Replay: " << recording_device->get_error_count() << " errors" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+#include "../renderer/fence_recycled_pool.h"
+#include <cxxopts.hpp>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char* const kQueueNames[] = {"direct", "compute", "copy"};
+    constexpr uint32_t kQueueCount = 3;
+    constexpr uint32_t kDirect = 0;
+    constexpr uint32_t kCompute = 1;
+    constexpr uint32_t kCopy = 2;
+
+    // Stand-in for ID3D12CommandQueue plus its ID3D12Fence. Submissions execute in order,
+    // one tick of work at a time, and may wait for another queue's fence like
+    // ID3D12CommandQueue::Wait.
+    struct SimulatedQueue
+    {
+        struct Submission
+        {
+            uint64_t fence_value;
+            uint32_t remaining_ticks;
+            uint32_t allocator;
+            uint32_t wait_queue;
+            uint64_t wait_fence_value;
+        };
+
+        uint64_t next_fence_value = 1;
+        uint64_t completed_fence_value = 0;
+        std::deque<Submission> pending;
+        learn_d3d12::FenceRecycledPool<uint32_t> allocator_pool;
+        uint32_t created_allocators = 0;
+        uint64_t busy_ticks = 0;
+    };
+
+    class SimulatedGpu
+    {
+    public:
+        explicit SimulatedGpu(uint32_t seed)
+            : _random(seed)
+        {
+        }
+
+        // Mirrors CommandContextManager::begin: recycle an allocator whose fence has
+        // completed, otherwise create one.
+        uint32_t begin(uint32_t queue_index)
+        {
+            auto& queue = _queues[queue_index];
+            uint32_t allocator;
+            if (queue.allocator_pool.try_acquire(queue.completed_fence_value, allocator))
+            {
+                // The GPU must be done with everything recorded into the allocator.
+                if (_allocator_fences[allocator] > queue.completed_fence_value)
+                {
+                    _report_error("allocator reused before its fence completed");
+                }
+            }
+            else
+            {
+                allocator = static_cast<uint32_t>(_allocator_fences.size());
+                _allocator_fences.push_back(0);
+                queue.created_allocators++;
+            }
+            return allocator;
+        }
+
+        // Mirrors CommandContextManager::submit, optionally preceded by a cross-queue wait.
+        uint64_t submit(uint32_t queue_index, uint32_t allocator, uint32_t work_ticks, uint32_t wait_queue = kQueueCount, uint64_t wait_fence_value = 0)
+        {
+            auto& queue = _queues[queue_index];
+            uint64_t fence_value = queue.next_fence_value++;
+            queue.pending.push_back({fence_value, work_ticks, allocator, wait_queue, wait_fence_value});
+            _allocator_fences[allocator] = fence_value;
+            queue.allocator_pool.release(fence_value, allocator);
+            return fence_value;
+        }
+
+        // Advances the GPU until `fence_value` has completed on the queue, like a CPU fence wait.
+        void wait_for_fence(uint32_t queue_index, uint64_t fence_value)
+        {
+            while (_queues[queue_index].completed_fence_value < fence_value)
+            {
+                if (!tick())
+                {
+                    _report_error("deadlock: waited for a fence value that is never signaled");
+                    return;
+                }
+            }
+        }
+
+        // Runs one tick of work on every queue that is not blocked. Returns false when no
+        // queue could make progress.
+        bool tick()
+        {
+            // Decide what runs this tick before completing anything, so a fence signaled
+            // in this tick only unblocks waiters in the next one, like on real hardware.
+            bool runnable[kQueueCount] = {};
+            uint32_t running = 0;
+            for (uint32_t i = 0; i < kQueueCount; i++)
+            {
+                const auto& queue = _queues[i];
+                if (queue.pending.empty())
+                {
+                    continue;
+                }
+                const auto& submission = queue.pending.front();
+                runnable[i] = submission.wait_queue == kQueueCount || _queues[submission.wait_queue].completed_fence_value >= submission.wait_fence_value;
+                running += runnable[i] ? 1 : 0;
+            }
+            if (running == 0)
+            {
+                return false;
+            }
+
+            _ticks++;
+            _overlapped_ticks += running > 1 ? 1 : 0;
+            for (uint32_t i = 0; i < kQueueCount; i++)
+            {
+                if (!runnable[i])
+                {
+                    continue;
+                }
+                auto& queue = _queues[i];
+                queue.busy_ticks++;
+                auto& submission = queue.pending.front();
+                if (--submission.remaining_ticks == 0)
+                {
+                    queue.completed_fence_value = submission.fence_value;
+                    queue.pending.pop_front();
+                }
+            }
+            return true;
+        }
+
+        uint32_t get_work_ticks(uint32_t min_ticks, uint32_t max_ticks) { return std::uniform_int_distribution<uint32_t>(min_ticks, max_ticks)(_random); }
+        const SimulatedQueue& get_queue(uint32_t queue_index) const { return _queues[queue_index]; }
+        uint64_t get_ticks() const { return _ticks; }
+        uint64_t get_overlapped_ticks() const { return _overlapped_ticks; }
+        uint32_t get_error_count() const { return _error_count; }
+
+    private:
+        SimulatedQueue _queues[kQueueCount];
+        // Fence value of the last submission recorded into each allocator.
+        std::vector<uint64_t> _allocator_fences;
+        std::mt19937 _random;
+        uint64_t _ticks = 0;
+        uint64_t _overlapped_ticks = 0;
+        uint32_t _error_count = 0;
+
+        void _report_error(const std::string& message)
+        {
+            if (_error_count++ < 8)
+            {
+                std::cerr << "LearnD3d12CommandPoolSim: " << message << std::endl;
+            }
+        }
+    };
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12CommandPoolSim", "Simulates direct, compute and copy queues to check command allocator recycling.");
+    // clang-format off
+    options.add_options()
+        ("frames", "Frames to simulate.", cxxopts::value<uint32_t>()->default_value("10000"))
+        ("frame-latency", "Frames the CPU may record ahead of the GPU.", cxxopts::value<uint32_t>()->default_value("2"))
+        ("seed", "Seed for the simulated work durations.", cxxopts::value<uint32_t>()->default_value("1"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12CommandPoolSim: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto frame_count = result["frames"].as<uint32_t>();
+    const auto frame_latency = std::max(result["frame-latency"].as<uint32_t>(), 1u);
+    SimulatedGpu gpu(result["seed"].as<uint32_t>());
+
+    // Every frame streams data on the copy queue, runs a compute pass that consumes it and
+    // a graphics pass that consumes the compute result. The compute pass of the next frame
+    // can overlap the graphics pass of this one.
+    std::vector<uint64_t> frame_fence_values(frame_latency, 0);
+    for (uint32_t frame = 0; frame < frame_count; frame++)
+    {
+        // Throttle like a swap chain: wait for the frame that used this slot.
+        gpu.wait_for_fence(kDirect, frame_fence_values[frame % frame_latency]);
+
+        uint32_t allocator = gpu.begin(kCopy);
+        uint64_t copy_fence_value = gpu.submit(kCopy, allocator, gpu.get_work_ticks(1, 4));
+        allocator = gpu.begin(kCompute);
+        uint64_t compute_fence_value = gpu.submit(kCompute, allocator, gpu.get_work_ticks(2, 6), kCopy, copy_fence_value);
+        allocator = gpu.begin(kDirect);
+        frame_fence_values[frame % frame_latency] = gpu.submit(kDirect, allocator, gpu.get_work_ticks(4, 10), kCompute, compute_fence_value);
+
+        // Let the GPU run a little while the CPU records the next frame.
+        gpu.tick();
+    }
+    for (uint32_t i = 0; i < kQueueCount; i++)
+    {
+        gpu.wait_for_fence(i, gpu.get_queue(i).next_fence_value - 1);
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << frame_count << " frames, frame latency " << frame_latency << ", " << gpu.get_ticks() << " GPU ticks, "
+              << (gpu.get_ticks() ? 100.0 * static_cast<double>(gpu.get_overlapped_ticks()) / static_cast<double>(gpu.get_ticks()) : 0.0)
+              << " % with queues overlapping" << std::endl;
+    for (uint32_t i = 0; i < kQueueCount; i++)
+    {
+        const auto& queue = gpu.get_queue(i);
+        std::cout << std::left << std::setw(8) << kQueueNames[i] << std::right << queue.next_fence_value - 1 << " submissions, "
+                  << queue.created_allocators << " allocators created, " << queue.busy_ticks << " busy ticks" << std::endl;
+    }
+    if (gpu.get_error_count() != 0)
+    {
+        std::cerr << "LearnD3d12CommandPoolSim: " << gpu.get_error_count() << " errors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include "../renderer/render_command_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct BenchmarkResult
+    {
+        double seconds;
+        uint64_t executed;
+        uint64_t full_retries;
+        uint32_t frames;
+        bool checksum_matches;
+    };
+
+    // Every producer pushes `commands_per_producer` commands as fast as it can while the
+    // calling thread plays the render thread and drains in a tight frame loop.
+    BenchmarkResult run_contention(uint32_t producer_count, uint32_t commands_per_producer, uint32_t frame_capacity)
+    {
+        learn_d3d12::RenderCommandQueue queue(frame_capacity);
+        std::atomic<uint64_t> checksum = 0;
+        std::atomic<uint32_t> ready_count = 0;
+        std::atomic<bool> start = false;
+        std::atomic<uint32_t> finished_count = 0;
+
+        std::vector<std::thread> producers;
+        for (uint32_t p = 0; p < producer_count; p++)
+        {
+            producers.emplace_back([&, p] {
+                ready_count.fetch_add(1);
+                while (!start.load(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+                for (uint32_t i = 0; i < commands_per_producer; i++)
+                {
+                    uint64_t value = (static_cast<uint64_t>(p) << 32) | i;
+                    while (!queue.enqueue([&checksum, value] { checksum.fetch_add(value, std::memory_order_relaxed); }))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                finished_count.fetch_add(1, std::memory_order_release);
+            });
+        }
+        while (ready_count.load() < producer_count)
+        {
+            std::this_thread::yield();
+        }
+
+        BenchmarkResult result = {};
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        uint64_t expected = static_cast<uint64_t>(producer_count) * commands_per_producer;
+        while (result.executed < expected)
+        {
+            bool producers_done = finished_count.load(std::memory_order_acquire) == producer_count;
+            result.executed += queue.execute_pending();
+            result.frames++;
+            if (producers_done && result.executed < expected)
+            {
+                // Everything has been enqueued; one more frame picks up the rest.
+                result.executed += queue.execute_pending();
+                result.frames++;
+                break;
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+        result.full_retries = queue.get_dropped_count();
+        uint64_t expected_checksum = 0;
+        for (uint32_t p = 0; p < producer_count; p++)
+        {
+            for (uint32_t i = 0; i < commands_per_producer; i++)
+            {
+                expected_checksum += (static_cast<uint64_t>(p) << 32) | i;
+            }
+        }
+        result.checksum_matches = checksum.load() == expected_checksum;
+        return result;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12CommandQueueBench", "Contention benchmark for the render command queue.");
+    // clang-format off
+    options.add_options()
+        ("commands", "Commands enqueued by each producer.", cxxopts::value<uint32_t>()->default_value("200000"))
+        ("frame-capacity", "Bytes of command memory per frame.", cxxopts::value<uint32_t>()->default_value(std::to_string(learn_d3d12::RenderCommandQueue::kDefaultFrameCapacity)))
+        ("max-producers", "Largest producer count; runs double from 1.", cxxopts::value<uint32_t>()->default_value("32"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12CommandQueueBench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto commands_per_producer = result["commands"].as<uint32_t>();
+    const auto frame_capacity = result["frame-capacity"].as<uint32_t>();
+    const auto max_producers = result["max-producers"].as<uint32_t>();
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << ", frame capacity: " << frame_capacity << " bytes" << std::endl;
+    std::cout << std::setw(10) << "producers" << std::setw(14) << "commands" << std::setw(12) << "ms" << std::setw(16) << "Mcommands/s"
+              << std::setw(12) << "ns/command" << std::setw(10) << "frames" << std::setw(14) << "full retries" << std::endl;
+    for (uint32_t producer_count = 1; producer_count <= max_producers; producer_count *= 2)
+    {
+        auto run = run_contention(producer_count, commands_per_producer, frame_capacity);
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << producer_count << std::setw(14) << run.executed << std::setw(12) << run.seconds * 1000.0
+                  << std::setw(16) << static_cast<double>(run.executed) / run.seconds / 1e6 << std::setw(12) << run.seconds * 1e9 / static_cast<double>(run.executed)
+                  << std::setw(10) << run.frames << std::setw(14) << run.full_retries << std::endl;
+        if (!run.checksum_matches)
+        {
+            std::cerr << "LearnD3d12CommandQueueBench: commands were lost or executed twice with " << producer_count << " producers." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
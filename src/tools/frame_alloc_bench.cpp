@@ -0,0 +1,248 @@
+#include "../animation/cpu_skinning.h"
+#include "../capture/capture_writer.h"
+#include "../culling/occlusion_culler.h"
+#include "../memory/allocation_counter.h"
+#include "../memory/frame_arena.h"
+#include "../scene/instance_field.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // The walls StressInstancing stands in its cube with --stress-occlusion: centre and half
+    // size, in units of the field's extent.
+    constexpr float kWalls[3][6] = {
+        {-0.585f, 0.0f, -0.35f, 0.465f, 1.05f, 0.02f},
+        {0.585f, 0.0f, -0.35f, 0.465f, 1.05f, 0.02f},
+        {0.0f, 0.0f, 0.3f, 0.5f, 0.6f, 0.02f},
+    };
+    // Radius of the sphere around a StressInstancing prism at any angle.
+    constexpr float kPrismBoundingRadius = 1.1662f;
+    constexpr float kAspectRatio = 16.0f / 9.0f;
+
+    struct Measurement
+    {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        double milliseconds = 0.0;
+    };
+
+    // The StressInstancing scene with occlusion culling, seen from its camera.
+    struct InstancingScene
+    {
+        InstancingScene(uint32_t instance_count, uint32_t mesh_count)
+            : field(instance_count, mesh_count)
+            , bounds(field.get_instance_count())
+            , instances(field.get_instance_count())
+        {
+            const float extent = field.get_extent();
+            for (const auto& wall : kWalls)
+            {
+                const auto first = static_cast<uint32_t>(wall_positions.size() / 3);
+                for (uint32_t corner = 0; corner < 8; corner++)
+                {
+                    for (uint32_t axis = 0; axis < 3; axis++)
+                    {
+                        const float side = (corner >> axis) & 1 ? 1.0f : -1.0f;
+                        wall_positions.push_back((wall[axis] + side * wall[3 + axis]) * extent);
+                    }
+                }
+                // Two triangles per face of the box, whose corners are numbered by their
+                // x, y and z bits.
+                const uint32_t faces[6][4] = {{0, 2, 6, 4}, {1, 5, 7, 3}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 6, 7, 5}};
+                for (const auto& face : faces)
+                {
+                    wall_indices.insert(wall_indices.end(), {first + face[0], first + face[1], first + face[2], first + face[0], first + face[2], first + face[3]});
+                }
+            }
+            for (uint32_t i = 0; i < field.get_instance_count(); i++)
+            {
+                float center[3];
+                float scale;
+                field.get_placement(i, center, scale);
+                const float radius = scale * kPrismBoundingRadius;
+                bounds[i] = {{center[0] - radius, center[1] - radius, center[2] - radius}, {center[0] + radius, center[1] + radius, center[2] + radius}};
+            }
+
+            // The projection of stress_instancing.hlsl.
+            const float focal_length = 1.5f;
+            const float near_plane = 0.05f;
+            const float far_plane = 100.0f;
+            const float camera_distance = 3.0f * extent;
+            const float depth_scale = far_plane / (far_plane - near_plane);
+            const float matrix[16] = {
+                focal_length / kAspectRatio, 0.0f, 0.0f, 0.0f,
+                0.0f, focal_length, 0.0f, 0.0f,
+                0.0f, 0.0f, depth_scale, 1.0f,
+                0.0f, 0.0f, (camera_distance - near_plane) * depth_scale, camera_distance,
+            };
+            std::copy(std::begin(matrix), std::end(matrix), view_projection);
+        }
+
+        learn_d3d12::InstanceField field;
+        std::vector<learn_d3d12::BoundingBox> bounds;
+        std::vector<float> wall_positions;
+        std::vector<uint32_t> wall_indices;
+        float view_projection[16];
+        // Stands in for the mapped instance upload buffer.
+        std::vector<learn_d3d12::InstanceData> instances;
+    };
+
+    // The CPU side of a frame of each renderer that allocates per frame, through the same
+    // calls: StressInstancing culls its instances, writes the visible ones and lists its
+    // draws; SkinnedMeshes skins its meshes; HelloTriangle encodes its commands while
+    // capturing, here with one root constants and draw pair per instancing draw. Every
+    // allocation comes from `frame_resource()`, which is either the heap or the frame arena.
+    template<typename ResourceFunction>
+    void build_frame(uint32_t frame, InstancingScene& scene, learn_d3d12::OcclusionCuller& culler, learn_d3d12::TaskPool& pool, const learn_d3d12::SkinningJob* jobs, uint32_t job_count, ResourceFunction frame_resource, uint64_t& checksum)
+    {
+        // StressInstancing::on_update
+        culler.begin_frame(scene.view_projection);
+        const learn_d3d12::OccluderMesh walls = {scene.wall_positions.data(), static_cast<uint32_t>(scene.wall_positions.size() / 3), scene.wall_indices.data(), static_cast<uint32_t>(scene.wall_indices.size())};
+        culler.render_occluders(&walls, 1, &pool);
+        std::pmr::vector<uint32_t> visible_instances(frame_resource());
+        culler.collect_visible(scene.bounds.data(), scene.field.get_instance_count(), visible_instances, &pool, frame_resource());
+        const auto visible_count = static_cast<uint32_t>(visible_instances.size());
+        scene.field.write(static_cast<float>(frame) / 60.0f, visible_instances.data(), visible_count, scene.instances.data(), &pool);
+        std::pmr::vector<learn_d3d12::InstanceDraw> draws(frame_resource());
+        scene.field.get_draws(visible_instances.data(), visible_count, draws);
+
+        // SkinnedMeshes::on_update
+        learn_d3d12::skin_meshes(jobs, job_count, &pool, true, frame_resource());
+
+        // HelloTriangle::_populate_command_list through CapturedCommandList
+        learn_d3d12::CaptureCommandStream commands(frame_resource());
+        commands.add(learn_d3d12::CaptureCommandType::kSetPipelineState, learn_d3d12::CaptureObjectCommand {1});
+        commands.add(learn_d3d12::CaptureCommandType::kSetGraphicsRootSignature, learn_d3d12::CaptureObjectCommand {2});
+        commands.add(learn_d3d12::CaptureCommandType::kSetViewport, learn_d3d12::CaptureViewportCommand {0.0f, 0.0f, 1600.0f, 900.0f, 0.0f, 1.0f});
+        commands.add(learn_d3d12::CaptureCommandType::kSetScissorRect, learn_d3d12::CaptureScissorRectCommand {0, 0, 1600, 900});
+        commands.add(learn_d3d12::CaptureCommandType::kResourceBarrier, learn_d3d12::CaptureBarrierCommand {3, 0, 4});
+        commands.add(learn_d3d12::CaptureCommandType::kSetRenderTarget, learn_d3d12::CaptureObjectCommand {3});
+        commands.add(learn_d3d12::CaptureCommandType::kClearRenderTarget, learn_d3d12::CaptureClearCommand {3, {0.0f, 0.2f, 0.4f, 1.0f}});
+        commands.add(learn_d3d12::CaptureCommandType::kSetPrimitiveTopology, learn_d3d12::CaptureObjectCommand {4});
+        commands.add(learn_d3d12::CaptureCommandType::kSetVertexBuffer, learn_d3d12::CaptureVertexBufferCommand {0, 5, 84, 28, 0});
+        for (const learn_d3d12::InstanceDraw& draw : draws)
+        {
+            const uint32_t constants[3] = {draw.first, 0, 0};
+            commands.add(learn_d3d12::CaptureCommandType::kSetGraphicsRoot32BitConstants, learn_d3d12::CaptureRootConstantsCommand {0, 0, 3}, constants, sizeof(constants));
+            commands.add(learn_d3d12::CaptureCommandType::kDrawInstanced, learn_d3d12::CaptureDrawCommand {3, draw.count, 0, 0});
+        }
+        commands.add(learn_d3d12::CaptureCommandType::kResourceBarrier, learn_d3d12::CaptureBarrierCommand {3, 4, 0});
+
+        checksum += visible_count + draws.size() + commands.get_size();
+    }
+
+    void print(const char* name, const Measurement& measurement, uint32_t frame_count)
+    {
+        std::cout << std::left << std::setw(7) << name << std::right << std::setw(10) << static_cast<double>(measurement.allocations) / frame_count << " allocations/frame, " << std::setw(10)
+                  << static_cast<double>(measurement.bytes) / frame_count / 1024.0 << " KiB/frame, " << std::setw(8) << measurement.milliseconds / frame_count << " ms/frame" << std::endl;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12FrameAllocBench", "Counts heap allocations per frame with and without the frame arena.");
+    // clang-format off
+    options.add_options()
+        ("frames", "Frames per run.", cxxopts::value<uint32_t>()->default_value("200"))
+        ("instances", "Instances of the StressInstancing scene.", cxxopts::value<uint32_t>()->default_value("100000"))
+        ("instance-meshes", "Unique meshes the instances share.", cxxopts::value<uint32_t>()->default_value("8"))
+        ("meshes", "Skinned meshes per frame.", cxxopts::value<uint32_t>()->default_value("16"))
+        ("threads", "Threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("frame-latency", "Frames in flight before a frame's fence completes.", cxxopts::value<uint32_t>()->default_value("2"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12FrameAllocBench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto frame_count = std::max(result["frames"].as<uint32_t>(), 1u);
+    const auto instance_count = std::max(result["instances"].as<uint32_t>(), 1u);
+    const auto instance_mesh_count = std::max(result["instance-meshes"].as<uint32_t>(), 1u);
+    const auto mesh_count = std::max(result["meshes"].as<uint32_t>(), 1u);
+    const auto latency = std::max(result["frame-latency"].as<uint32_t>(), 1u);
+    auto thread_count = result["threads"].as<uint32_t>();
+    learn_d3d12::TaskPool task_pool(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+    InstancingScene scene(instance_count, instance_mesh_count);
+    learn_d3d12::OcclusionCuller culler;
+
+    constexpr uint32_t kBoneCount = 16;
+    std::vector<learn_d3d12::SkinnedMesh> meshes;
+    std::vector<std::vector<learn_d3d12::Float3x4>> palettes(mesh_count, std::vector<learn_d3d12::Float3x4>(kBoneCount));
+    std::vector<std::vector<learn_d3d12::SkinnedVertex>> outputs;
+    std::vector<learn_d3d12::SkinningJob> jobs(mesh_count);
+    meshes.reserve(mesh_count);
+    for (uint32_t m = 0; m < mesh_count; m++)
+    {
+        meshes.push_back(learn_d3d12::make_skinned_tube(64, 32, kBoneCount, 1.0f, 0.05f));
+        outputs.emplace_back(meshes.back().get_vertex_count());
+        learn_d3d12::animate_tube_palette(0.0f, static_cast<float>(m), kBoneCount, 1.0f, palettes[m].data());
+        jobs[m] = {&meshes[m], palettes[m].data(), outputs[m].data()};
+    }
+
+    uint64_t checksum = 0;
+    auto run = [&](auto&& frame_resource, auto&& begin_frame, auto&& end_frame) {
+        // Leave out the warm-up: every slot grows to its high water mark on first use and
+        // merges its blocks on the second.
+        const uint32_t warm_up_count = 2 * (latency + 1);
+        for (uint32_t frame = 0; frame < warm_up_count; frame++)
+        {
+            begin_frame(frame);
+            build_frame(frame, scene, culler, task_pool, jobs.data(), mesh_count, frame_resource, checksum);
+            end_frame(frame);
+        }
+        Measurement measurement;
+        uint64_t allocations = learn_d3d12::get_allocation_count();
+        uint64_t bytes = learn_d3d12::get_allocated_bytes();
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = warm_up_count; frame < warm_up_count + frame_count; frame++)
+        {
+            begin_frame(frame);
+            build_frame(frame, scene, culler, task_pool, jobs.data(), mesh_count, frame_resource, checksum);
+            end_frame(frame);
+        }
+        measurement.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        measurement.allocations = learn_d3d12::get_allocation_count() - allocations;
+        measurement.bytes = learn_d3d12::get_allocated_bytes() - bytes;
+        return measurement;
+    };
+
+    Measurement heap = run([] { return std::pmr::new_delete_resource(); }, [](uint32_t) {}, [](uint32_t) {});
+
+    // Frame n signals fence value n + 1, which completes `latency` frames later, so frame n
+    // starts with the fence at n - latency.
+    learn_d3d12::FrameArena frame_arena(latency + 1);
+    Measurement arena = run([&] { return frame_arena.get_resource(); },
+                            [&](uint32_t frame) {
+                                uint64_t completed = frame >= latency ? frame - latency : 0;
+                                if (!frame_arena.begin_frame(completed))
+                                {
+                                    std::cerr << "LearnD3d12FrameAllocBench: frame " << frame << " needs fence " << frame_arena.get_required_fence_value() << std::endl;
+                                    std::exit(EXIT_FAILURE);
+                                }
+                            },
+                            [&](uint32_t frame) { frame_arena.end_frame(frame + 1); });
+
+    learn_d3d12::FrameArenaStats stats = frame_arena.get_stats();
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << frame_count << " frames, " << scene.field.get_instance_count() << " instances, " << mesh_count << " skinned meshes, " << task_pool.get_thread_count() << " threads, " << latency << " frames in flight" << std::endl;
+    print("heap", heap, frame_count);
+    print("arena", arena, frame_count);
+    std::cout << "arena " << stats.used_bytes / 1024.0 << " KiB used of " << stats.capacity / 1024.0 << " KiB per slot, " << stats.thread_arena_count << " thread arenas (checksum " << checksum
+              << ")" << std::endl;
+    return EXIT_SUCCESS;
+}
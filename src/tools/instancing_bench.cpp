@@ -0,0 +1,128 @@
+#include "../scene/instance_field.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    struct Measurement
+    {
+        double milliseconds = 0.0;
+        uint64_t bytes = 0;
+    };
+
+    // Streams the field out `frames` times, like StressInstancing does into its upload buffer.
+    // With `visible`, only those instances are written, packed, as after occlusion culling.
+    Measurement measure(const learn_d3d12::InstanceField& field, const std::vector<uint32_t>* visible, std::vector<learn_d3d12::InstanceData>& destination, uint32_t frames, learn_d3d12::TaskPool* pool)
+    {
+        auto write = [&](float time) {
+            if (visible)
+            {
+                field.write(time, visible->data(), static_cast<uint32_t>(visible->size()), destination.data(), pool);
+            }
+            else
+            {
+                field.write(time, destination.data(), pool);
+            }
+        };
+        const uint64_t written = visible ? visible->size() : field.get_instance_count();
+
+        // The first frame faults the destination pages in; leave it out.
+        write(0.0f);
+        Measurement measurement;
+        for (uint32_t frame = 1; frame <= frames; frame++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            write(static_cast<float>(frame) / 60.0f);
+            measurement.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            measurement.bytes += sizeof(learn_d3d12::InstanceData) * written;
+        }
+        return measurement;
+    }
+
+    // An even spread of `fraction` of the instances, in ascending order like the list
+    // OcclusionCuller::collect_visible returns.
+    std::vector<uint32_t> make_visible_list(uint32_t instance_count, double fraction)
+    {
+        std::vector<uint32_t> visible;
+        for (uint32_t i = 0; i < instance_count; i++)
+        {
+            if (std::floor((i + 1) * fraction) > std::floor(i * fraction))
+            {
+                visible.push_back(i);
+            }
+        }
+        return visible;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12InstancingBench", "Benchmark for generating and streaming the StressInstancing instance buffer on the CPU.");
+    // clang-format off
+    options.add_options()
+        ("instances", "Number of instances.", cxxopts::value<uint32_t>()->default_value("100000"))
+        ("meshes", "Number of unique meshes.", cxxopts::value<uint32_t>()->default_value("8"))
+        ("frames", "Frames per measurement.", cxxopts::value<uint32_t>()->default_value("60"))
+        ("visible", "Fraction of the instances written, through the indexed path StressInstancing takes with --stress-occlusion; 1 writes all of them.", cxxopts::value<double>()->default_value("1"))
+        ("threads", "Threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("sweep", "Measure 1k, 10k, 100k and 1M instances instead of --instances.", cxxopts::value<bool>()->default_value("false"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12InstancingBench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto mesh_count = std::max(result["meshes"].as<uint32_t>(), 1u);
+    const auto frames = std::max(result["frames"].as<uint32_t>(), 1u);
+    const auto visible_fraction = std::clamp(result["visible"].as<double>(), 0.0, 1.0);
+    auto thread_count = result["threads"].as<uint32_t>();
+    learn_d3d12::TaskPool task_pool(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+
+    std::vector<uint32_t> instance_counts = {std::max(result["instances"].as<uint32_t>(), 1u)};
+    if (result["sweep"].as<bool>())
+    {
+        instance_counts = {1000, 10000, 100000, 1000000};
+    }
+
+    // The renderer writes to write-combined upload memory, which is usually slower to
+    // write than the cached memory used here; treat these numbers as an upper bound.
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << mesh_count << " meshes, " << sizeof(learn_d3d12::InstanceData) << " bytes per instance, " << frames << " frames, " << task_pool.get_thread_count() << " threads";
+    if (visible_fraction < 1.0)
+    {
+        std::cout << ", " << visible_fraction * 100.0 << "% visible";
+    }
+    std::cout << std::endl;
+    std::cout << std::setw(10) << "instances" << std::setw(12) << "serial ms" << std::setw(12) << "GB/s" << std::setw(14) << "parallel ms" << std::setw(12) << "GB/s" << std::setw(16) << "M instances/s" << std::endl;
+    for (uint32_t instance_count : instance_counts)
+    {
+        learn_d3d12::InstanceField field(instance_count, mesh_count);
+        std::vector<uint32_t> visible;
+        if (visible_fraction < 1.0)
+        {
+            visible = make_visible_list(field.get_instance_count(), visible_fraction);
+        }
+        const std::vector<uint32_t>* visible_list = visible_fraction < 1.0 ? &visible : nullptr;
+        std::vector<learn_d3d12::InstanceData> destination(field.get_instance_count());
+        Measurement serial = measure(field, visible_list, destination, frames, nullptr);
+        Measurement parallel = measure(field, visible_list, destination, frames, &task_pool);
+        auto gigabytes_per_second = [](const Measurement& measurement) { return measurement.milliseconds > 0.0 ? static_cast<double>(measurement.bytes) / measurement.milliseconds / 1e6 : 0.0; };
+        double parallel_ms = parallel.milliseconds / frames;
+        const double written_count = static_cast<double>(visible_list ? visible.size() : instance_count);
+        std::cout << std::setw(10) << instance_count << std::setw(12) << serial.milliseconds / frames << std::setw(12) << gigabytes_per_second(serial) << std::setw(14) << parallel_ms << std::setw(12)
+                  << gigabytes_per_second(parallel) << std::setw(16) << (parallel_ms > 0.0 ? written_count / parallel_ms / 1e3 : 0.0) << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+#include "../geometry/meshlet_builder.h"
+#include "../geometry/obj_loader.h"
+#include "../threading/task_pool.h"
+#include "camera_math.h"
+#include <chrono>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct SampleModel
+    {
+        std::string name;
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // Grid of (columns + 1) x (rows + 1) vertices mapped through `position(u, v, out)`,
+    // wound so that cross(p1 - p0, p2 - p0) points along d/du x d/dv: clockwise, which
+    // D3D12 treats as front facing, seen from that side.
+    template<typename PositionFunction>
+    SampleModel make_parametric(const std::string& name, uint32_t columns, uint32_t rows, PositionFunction position)
+    {
+        SampleModel model;
+        model.name = name;
+        for (uint32_t r = 0; r <= rows; r++)
+        {
+            for (uint32_t c = 0; c <= columns; c++)
+            {
+                float point[3];
+                position(static_cast<float>(c) / columns, static_cast<float>(r) / rows, point);
+                model.positions.insert(model.positions.end(), point, point + 3);
+            }
+        }
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            for (uint32_t c = 0; c < columns; c++)
+            {
+                uint32_t i0 = r * (columns + 1) + c;
+                uint32_t i1 = i0 + 1;
+                uint32_t i2 = i0 + columns + 1;
+                uint32_t i3 = i2 + 1;
+                model.indices.insert(model.indices.end(), {i0, i1, i2, i1, i3, i2});
+            }
+        }
+        return model;
+    }
+
+    std::vector<SampleModel> make_sample_models()
+    {
+        const float pi = 3.14159265f;
+        std::vector<SampleModel> models;
+        models.push_back(make_parametric("sphere", 512, 256, [pi](float u, float v, float* out) {
+            float theta = u * 2.0f * pi;
+            float phi = v * pi;
+            out[0] = std::sin(phi) * std::cos(theta);
+            out[1] = std::cos(phi);
+            out[2] = std::sin(phi) * std::sin(theta);
+        }));
+        models.push_back(make_parametric("torus", 512, 128, [pi](float u, float v, float* out) {
+            float theta = u * 2.0f * pi;
+            float phi = v * 2.0f * pi;
+            float ring = 0.7f + 0.3f * std::cos(phi);
+            out[0] = ring * std::cos(theta);
+            out[1] = 0.3f * std::sin(phi);
+            out[2] = ring * std::sin(theta);
+        }));
+        models.push_back(make_parametric("terrain", 384, 384, [](float u, float v, float* out) {
+            out[0] = u * 2.0f - 1.0f;
+            out[1] = 0.08f * std::sin(u * 23.0f) * std::cos(v * 17.0f) + 0.05f * std::sin((u + v) * 41.0f);
+            out[2] = 1.0f - v * 2.0f;
+        }));
+        return models;
+    }
+
+    // Front-facing triangles in the meshlets the normal cone rejected: the meshlets that
+    // are not drawn although their bounding sphere is inside the frustum. A triangle is
+    // front facing the way D3D12 decides it, clockwise on screen, independent of the
+    // normals the cones are built from. Cone culling is conservative, so any such
+    // triangle is a culling or winding bug.
+    uint64_t count_wrongly_rejected(const SampleModel& model,
+                                    const learn_d3d12::MeshletMesh& mesh,
+                                    const learn_d3d12::ClusterCullingView& view,
+                                    const float view_projection[16],
+                                    const std::vector<learn_d3d12::DrawIndexedArguments>& draws)
+    {
+        uint64_t wrongly_rejected = 0;
+        size_t draw = 0;
+        for (size_t m = 0; m < mesh.meshlets.size(); m++)
+        {
+            // Draws are in meshlet order and cover whole meshlets.
+            const learn_d3d12::Meshlet& meshlet = mesh.meshlets[m];
+            const uint32_t start_index = meshlet.triangle_offset * 3;
+            while (draw < draws.size() && draws[draw].start_index_location + draws[draw].index_count_per_instance <= start_index)
+            {
+                draw++;
+            }
+            if (draw < draws.size() && draws[draw].start_index_location <= start_index)
+            {
+                continue;
+            }
+            const learn_d3d12::MeshletBounds& bounds = mesh.bounds[m];
+            bool outside_frustum = false;
+            for (const auto& plane : view.planes)
+            {
+                outside_frustum |= plane[0] * bounds.center[0] + plane[1] * bounds.center[1] + plane[2] * bounds.center[2] + plane[3] < -bounds.radius;
+            }
+            if (outside_frustum)
+            {
+                continue;
+            }
+            for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+            {
+                float screen[3][2];
+                bool behind_camera = false;
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    uint8_t local = mesh.primitive_indices[(meshlet.triangle_offset + t) * 3 + corner];
+                    const float* p = &model.positions[mesh.vertex_indices[meshlet.vertex_offset + local] * 3];
+                    float clip[4];
+                    for (uint32_t j = 0; j < 4; j++)
+                    {
+                        clip[j] = p[0] * view_projection[j] + p[1] * view_projection[4 + j] + p[2] * view_projection[8 + j] + view_projection[12 + j];
+                    }
+                    behind_camera |= clip[3] <= 0.0f;
+                    screen[corner][0] = clip[0] / clip[3];
+                    screen[corner][1] = clip[1] / clip[3];
+                }
+                // Twice the signed area with y up: negative is clockwise.
+                float area = (screen[1][0] - screen[0][0]) * (screen[2][1] - screen[0][1]) - (screen[2][0] - screen[0][0]) * (screen[1][1] - screen[0][1]);
+                wrongly_rejected += !behind_camera && area < 0.0f ? 1 : 0;
+            }
+        }
+        return wrongly_rejected;
+    }
+
+    // Returns false when cone culling rejected a front-facing triangle.
+    bool report(const SampleModel& model, uint32_t view_count, learn_d3d12::TaskPool& task_pool)
+    {
+        const auto vertex_count = static_cast<uint32_t>(model.positions.size() / 3);
+        const auto index_count = static_cast<uint32_t>(model.indices.size());
+        auto build_start = std::chrono::steady_clock::now();
+        auto mesh = learn_d3d12::build_meshlets(model.positions.data(), vertex_count, model.indices.data(), index_count);
+        double build_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+
+        uint64_t meshlet_vertices = 0;
+        uint64_t meshlet_triangles = 0;
+        for (const auto& meshlet : mesh.meshlets)
+        {
+            meshlet_vertices += meshlet.vertex_count;
+            meshlet_triangles += meshlet.triangle_count;
+        }
+        const double meshlet_count = static_cast<double>(mesh.meshlets.size());
+        double vertex_fill = 100.0 * static_cast<double>(meshlet_vertices) / (meshlet_count * learn_d3d12::kMeshletMaxVertices);
+        double triangle_fill = 100.0 * static_cast<double>(meshlet_triangles) / (meshlet_count * learn_d3d12::kMeshletMaxTriangles);
+
+        // Orbit the model, which is centered at the origin, from slightly above.
+        float projection[16];
+        learn_d3d12::make_perspective_lh(1.0f, 16.0f / 9.0f, 0.05f, 100.0f, projection);
+        learn_d3d12::ClusterCullingStats stats;
+        std::vector<learn_d3d12::DrawIndexedArguments> draws;
+        uint64_t draw_count = 0;
+        uint64_t wrongly_rejected = 0;
+        double cull_milliseconds = 0.0;
+        for (uint32_t view_index = 0; view_index < view_count; view_index++)
+        {
+            float angle = 6.2831853f * static_cast<float>(view_index) / static_cast<float>(view_count);
+            const float eye[3] = {2.2f * std::cos(angle), 1.2f, 2.2f * std::sin(angle)};
+            const float target[3] = {0.0f, 0.0f, 0.0f};
+            float view[16];
+            float view_projection[16];
+            learn_d3d12::make_look_at_lh(eye, target, view);
+            learn_d3d12::multiply(view, projection, view_projection);
+            auto culling_view = learn_d3d12::make_cluster_culling_view(view_projection, eye);
+
+            draws.clear();
+            auto cull_start = std::chrono::steady_clock::now();
+            learn_d3d12::cull_meshlets(mesh, culling_view, draws, stats, &task_pool);
+            cull_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cull_start).count();
+            draw_count += draws.size();
+            wrongly_rejected += count_wrongly_rejected(model, mesh, culling_view, view_projection, draws);
+        }
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << model.name << ": " << index_count / 3 << " triangles, " << mesh.meshlets.size() << " meshlets, built in " << build_milliseconds << " ms" << std::endl;
+        std::cout << "  fill: " << vertex_fill << " % vertices, " << triangle_fill << " % triangles" << std::endl;
+        std::cout << "  culling over " << view_count << " views: " << 100.0 * stats.get_rejection_rate() << " % rejected ("
+                  << 100.0 * stats.frustum_rejected / std::max(stats.meshlet_count, 1u) << " % frustum, "
+                  << 100.0 * stats.cone_rejected / std::max(stats.meshlet_count, 1u) << " % cone), "
+                  << static_cast<double>(draw_count) / view_count << " indirect draws, " << cull_milliseconds / view_count << " ms/view" << std::endl;
+        if (wrongly_rejected > 0)
+        {
+            std::cerr << "LearnD3d12MeshletTool: " << model.name << ": cone culling rejected " << wrongly_rejected << " front-facing triangles" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12MeshletTool", "Builds meshlets and measures cluster culling.");
+    // clang-format off
+    options.add_options()
+        ("i,input", "OBJ model to process instead of the built-in samples.", cxxopts::value<std::string>()->default_value(""))
+        ("views", "Camera positions around the model used for the culling statistics.", cxxopts::value<uint32_t>()->default_value("16"))
+        ("threads", "Threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12MeshletTool: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<SampleModel> models;
+    if (auto input = result["input"].as<std::string>(); !input.empty())
+    {
+        SampleModel model;
+        model.name = input;
+        std::string error;
+        if (!learn_d3d12::load_obj(input, model.positions, model.indices, error))
+        {
+            std::cerr << "LearnD3d12MeshletTool: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        // Center the model and scale it to the unit sphere the sample cameras expect.
+        float min[3] = {model.positions[0], model.positions[1], model.positions[2]};
+        float max[3] = {min[0], min[1], min[2]};
+        for (size_t i = 0; i < model.positions.size(); i++)
+        {
+            min[i % 3] = std::min(min[i % 3], model.positions[i]);
+            max[i % 3] = std::max(max[i % 3], model.positions[i]);
+        }
+        float extent = std::max({max[0] - min[0], max[1] - min[1], max[2] - min[2], 1e-6f}) * 0.5f;
+        for (size_t i = 0; i < model.positions.size(); i++)
+        {
+            model.positions[i] = (model.positions[i] - (min[i % 3] + max[i % 3]) * 0.5f) / extent;
+        }
+        models.push_back(std::move(model));
+    }
+    else
+    {
+        models = make_sample_models();
+    }
+
+    auto thread_count = result["threads"].as<uint32_t>();
+    learn_d3d12::TaskPool task_pool(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+    bool culling_correct = true;
+    for (const auto& model : models)
+    {
+        culling_correct &= report(model, std::max(result["views"].as<uint32_t>(), 1u), task_pool);
+    }
+    return culling_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,162 @@
+#include "../application/frame_loop.h"
+#include "../logging/log_macros.h"
+#include "../renderer/render_command_queue.h"
+#include <benchmark/benchmark.h>
+#include <spdlog/sinks/null_sink.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include "../application/application.h"
+#endif
+
+// Microbenchmarks for the hot paths every frame goes through. Results are written as
+// JSON (LearnD3d12Bench.json unless --benchmark_out says otherwise), so two runs can be
+// compared with tools/compare.py from the benchmark repository:
+//   compare.py benchmarks baseline.json LearnD3d12Bench.json
+namespace
+{
+    using learn_d3d12::LogManager;
+
+    // The loggers log to a null sink: the benchmarks measure LogManager and spdlog, not
+    // the console.
+    void register_null_logger(const std::string& logger_name)
+    {
+        LogManager::get_instance().register_logger(logger_name, false);
+        auto logger = spdlog::get(logger_name);
+        logger->sinks().clear();
+        logger->sinks().push_back(std::make_shared<spdlog::sinks::null_sink_mt>());
+        logger->set_level(spdlog::level::info);
+    }
+
+    void bm_log_enabled(benchmark::State& state)
+    {
+        int frame = 0;
+        for (auto _ : state)
+        {
+            LOG_INFO(Bench, "frame {} took {} ms", frame++, 16.6);
+        }
+    }
+    BENCHMARK(bm_log_enabled);
+    // Several threads logging through the same logger and sink, like workers reporting.
+    BENCHMARK(bm_log_enabled)->Threads(2)->Threads(4)->Threads(8)->UseRealTime();
+
+    // Below the logger level nothing is formatted, but the logger is still looked up by name.
+    void bm_log_disabled(benchmark::State& state)
+    {
+        int frame = 0;
+        for (auto _ : state)
+        {
+            LOG_DEBUG(Bench, "frame {} took {} ms", frame++, 16.6);
+        }
+    }
+    BENCHMARK(bm_log_disabled);
+    BENCHMARK(bm_log_disabled)->Threads(2)->Threads(4)->Threads(8)->UseRealTime();
+
+    // REGISTER_LOGGER at a call site for a logger that already exists.
+    void bm_register_logger_existing(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            REGISTER_LOGGER(Bench);
+        }
+    }
+    BENCHMARK(bm_register_logger_existing);
+
+    void bm_register_logger_new(benchmark::State& state)
+    {
+        const std::string logger_name = "BenchRegister";
+        for (auto _ : state)
+        {
+            LogManager::get_instance().register_logger(logger_name, false);
+            state.PauseTiming();
+            LogManager::get_instance().unregister_logger(logger_name);
+            state.ResumeTiming();
+        }
+    }
+    BENCHMARK(bm_register_logger_new);
+
+#ifdef _WIN32
+    // The backends that Application::create dispatches to need Win32, so this one only
+    // runs on Windows.
+    void bm_application_create(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            auto app = learn_d3d12::Application::create("glfw");
+            benchmark::DoNotOptimize(app.get());
+        }
+    }
+    BENCHMARK(bm_application_create);
+#endif
+
+    // Has the interface run_frame() expects but no device, so the benchmark measures what
+    // the frame loop itself costs: the frame timer, draining the render commands other
+    // threads queued and the frame counter.
+    class HeadlessRenderer
+    {
+    public:
+        learn_d3d12::RenderCommandQueue& get_render_commands() { return _render_commands; }
+        void on_update() { benchmark::DoNotOptimize(_frame++); }
+        void on_render() { benchmark::ClobberMemory(); }
+
+        uint64_t get_command_total() const { return _command_total; }
+        void add_command(uint64_t value) { _command_total += value; }
+
+    private:
+        learn_d3d12::RenderCommandQueue _render_commands;
+        uint64_t _frame = 0;
+        uint64_t _command_total = 0;
+    };
+
+    void bm_headless_frame(benchmark::State& state)
+    {
+        HeadlessRenderer renderer;
+        const auto commands_per_frame = static_cast<uint32_t>(state.range(0));
+        for (auto _ : state)
+        {
+            for (uint32_t i = 0; i < commands_per_frame; i++)
+            {
+                renderer.get_render_commands().enqueue([&renderer, i] { renderer.add_command(i); });
+            }
+            learn_d3d12::run_frame(renderer);
+        }
+        benchmark::DoNotOptimize(renderer.get_command_total());
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    }
+    BENCHMARK(bm_headless_frame)->Arg(0)->Arg(64)->Arg(1024);
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    // Write JSON next to the console report unless the caller chose an output.
+    std::vector<char*> args(argv, argv + argc);
+    bool has_output = false;
+    for (int i = 1; i < argc; i++)
+    {
+        has_output = has_output || std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+    }
+    std::string output_arg = "--benchmark_out=LearnD3d12Bench.json";
+    std::string format_arg = "--benchmark_out_format=json";
+    if (!has_output)
+    {
+        args.push_back(output_arg.data());
+        args.push_back(format_arg.data());
+    }
+    int arg_count = static_cast<int>(args.size());
+    benchmark::Initialize(&arg_count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(arg_count, args.data()))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Deferred, so runs only leave a log file behind if something is logged.
+    LogManager::get_instance().initialize(true);
+    register_null_logger("Bench");
+    // Keep the startup report of the first frame out of the headless frame benchmark.
+    learn_d3d12::StartupTracer::get_instance().mark_first_frame();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    LogManager::get_instance().finalize();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "../culling/occlusion_culler.h"
+#include "../threading/task_pool.h"
+#include "camera_math.h"
+#include <cmath>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <vector>
+
+namespace
+{
+    // A city block layout: long walls act as occluders, boxes on a grid are the occludees.
+    struct Scene
+    {
+        std::vector<float> wall_positions;
+        std::vector<uint32_t> wall_indices;
+        std::vector<learn_d3d12::BoundingBox> boxes;
+    };
+
+    void add_wall(Scene& scene, float x0, float z0, float x1, float z1, float height)
+    {
+        auto base = static_cast<uint32_t>(scene.wall_positions.size() / 3);
+        const float corners[12] = {x0, 0.0f, z0, x1, 0.0f, z1, x1, height, z1, x0, height, z0};
+        scene.wall_positions.insert(scene.wall_positions.end(), corners, corners + 12);
+        const uint32_t indices[6] = {base, base + 1, base + 2, base, base + 2, base + 3};
+        scene.wall_indices.insert(scene.wall_indices.end(), indices, indices + 6);
+    }
+
+    Scene build_scene(uint32_t boxes_per_side, uint32_t wall_count)
+    {
+        Scene scene;
+        const float extent = 200.0f;
+        const float spacing = 2.0f * extent / static_cast<float>(boxes_per_side);
+        for (uint32_t z = 0; z < boxes_per_side; z++)
+        {
+            for (uint32_t x = 0; x < boxes_per_side; x++)
+            {
+                float center_x = -extent + (static_cast<float>(x) + 0.5f) * spacing;
+                float center_z = -extent + (static_cast<float>(z) + 0.5f) * spacing;
+                float size = 0.3f * spacing;
+                scene.boxes.push_back({{center_x - size, 0.0f, center_z - size}, {center_x + size, 2.0f * size, center_z + size}});
+            }
+        }
+        for (uint32_t i = 0; i < wall_count; i++)
+        {
+            float offset = -extent + (static_cast<float>(i) + 0.5f) * 2.0f * extent / static_cast<float>(wall_count);
+            add_wall(scene, -extent, offset, extent, offset, 12.0f);
+            add_wall(scene, offset, -extent, offset, extent, 12.0f);
+        }
+        return scene;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12OcclusionBench", "Benchmark for the software occlusion culler.");
+    // clang-format off
+    options.add_options()
+        ("boxes-per-side", "Occludees are laid out on a square grid of this size.", cxxopts::value<uint32_t>()->default_value("200"))
+        ("walls", "Walls per axis acting as occluders.", cxxopts::value<uint32_t>()->default_value("16"))
+        ("frames", "Frames to simulate while the camera circles the scene.", cxxopts::value<uint32_t>()->default_value("120"))
+        ("threads", "Threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("scalar", "Disable the AVX2 paths.", cxxopts::value<bool>()->default_value("false"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12OcclusionBench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto scene = build_scene(result["boxes-per-side"].as<uint32_t>(), result["walls"].as<uint32_t>());
+    auto thread_count = result["threads"].as<uint32_t>();
+    learn_d3d12::TaskPool task_pool(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+    learn_d3d12::OcclusionCuller culler;
+    culler.set_simd_enabled(!result["scalar"].as<bool>());
+
+    learn_d3d12::OccluderMesh walls = {
+        scene.wall_positions.data(),
+        static_cast<uint32_t>(scene.wall_positions.size() / 3),
+        scene.wall_indices.data(),
+        static_cast<uint32_t>(scene.wall_indices.size()),
+    };
+    float projection[16];
+    learn_d3d12::make_perspective_lh(1.0f, static_cast<float>(culler.get_width()) / static_cast<float>(culler.get_height()), 0.1f, 1000.0f, projection);
+
+    const auto frame_count = result["frames"].as<uint32_t>();
+    std::pmr::vector<uint32_t> visible;
+    double raster_milliseconds = 0.0;
+    double test_milliseconds = 0.0;
+    uint64_t tested = 0;
+    uint64_t occluded = 0;
+    for (uint32_t frame = 0; frame < frame_count; frame++)
+    {
+        float angle = 6.2831853f * static_cast<float>(frame) / static_cast<float>(std::max(frame_count, 1u));
+        const float eye[3] = {150.0f * std::cos(angle), 4.0f, 150.0f * std::sin(angle)};
+        const float target[3] = {0.0f, 2.0f, 0.0f};
+        float view[16];
+        float view_projection[16];
+        learn_d3d12::make_look_at_lh(eye, target, view);
+        learn_d3d12::multiply(view, projection, view_projection);
+
+        culler.begin_frame(view_projection);
+        culler.render_occluders(&walls, 1, &task_pool);
+        culler.collect_visible(scene.boxes.data(), static_cast<uint32_t>(scene.boxes.size()), visible, &task_pool);
+        const auto& stats = culler.get_stats();
+        raster_milliseconds += stats.raster_milliseconds;
+        test_milliseconds += stats.test_milliseconds;
+        tested += stats.tested_count;
+        occluded += stats.occluded_count;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << culler.get_width() << "x" << culler.get_height() << " depth buffer, " << walls.index_count / 3 << " occluder triangles, " << scene.boxes.size()
+              << " occludees, " << task_pool.get_thread_count() << " threads, " << (result["scalar"].as<bool>() ? "scalar" : "AVX2 when available") << std::endl;
+    std::cout << "raster:   " << raster_milliseconds / frame_count << " ms/frame" << std::endl;
+    std::cout << "test:     " << test_milliseconds / frame_count << " ms/frame" << std::endl;
+    std::cout << "occluded: " << (tested ? 100.0 * static_cast<double>(occluded) / static_cast<double>(tested) : 0.0) << " %" << std::endl;
+    return EXIT_SUCCESS;
+}
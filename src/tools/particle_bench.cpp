@@ -0,0 +1,147 @@
+#include "../simulation/particle_system.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr float kDeltaTime = 1.0f / 60.0f;
+
+    // Milliseconds per frame of simulating `frames` frames from the same start state.
+    double measure(learn_d3d12::ParticleSystem& system, uint32_t frames, learn_d3d12::TaskPool* pool, bool allow_simd)
+    {
+        system.reset(1);
+        // The first frame faults the streams in; leave it out.
+        system.simulate(kDeltaTime, pool, allow_simd);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            system.simulate(kDeltaTime, pool, allow_simd);
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    }
+
+    // Particles whose state differs between the two systems. The kernels round the same
+    // way, so any difference is a bug; a tolerance would hide it until a particle crossed
+    // the floor or expired one frame apart and diverged completely.
+    uint32_t count_mismatches(const learn_d3d12::ParticleSystem& a, const learn_d3d12::ParticleSystem& b, float& max_difference)
+    {
+        const float* streams_a[] = {a.get_position_x(), a.get_position_y(), a.get_position_z(), a.get_velocity_x(), a.get_velocity_y(), a.get_velocity_z(), a.get_lifetime()};
+        const float* streams_b[] = {b.get_position_x(), b.get_position_y(), b.get_position_z(), b.get_velocity_x(), b.get_velocity_y(), b.get_velocity_z(), b.get_lifetime()};
+        uint32_t mismatches = 0;
+        for (uint32_t i = 0; i < a.get_count(); i++)
+        {
+            bool mismatch = a.get_color()[i] != b.get_color()[i];
+            for (size_t s = 0; s < std::size(streams_a); s++)
+            {
+                float difference = std::fabs(streams_a[s][i] - streams_b[s][i]);
+                max_difference = std::max(max_difference, difference);
+                mismatch |= streams_a[s][i] != streams_b[s][i];
+            }
+            mismatches += mismatch ? 1 : 0;
+        }
+        return mismatches;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12ParticleBench", "Benchmark for the scalar and AVX2 particle simulation kernels.");
+    // clang-format off
+    options.add_options()
+        ("particles", "Number of particles.", cxxopts::value<uint32_t>()->default_value("1000000"))
+        ("frames", "Frames per measurement.", cxxopts::value<uint32_t>()->default_value("60"))
+        ("threads", "Most threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("sweep", "Measure 10k, 100k, 1M and 4M particles instead of --particles.", cxxopts::value<bool>()->default_value("false"))
+        ("scalar", "Only run the scalar kernel.", cxxopts::value<bool>()->default_value("false"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12ParticleBench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto frames = std::max(result["frames"].as<uint32_t>(), 1u);
+    auto thread_count = result["threads"].as<uint32_t>();
+    std::vector<uint32_t> particle_counts = {std::max(result["particles"].as<uint32_t>(), 1u)};
+    if (result["sweep"].as<bool>())
+    {
+        particle_counts = {10000, 100000, 1000000, 4000000};
+    }
+
+    // One pool per thread count: 1, 2, 4, ... and the most threads.
+    auto widest_pool = std::make_unique<learn_d3d12::TaskPool>(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+    const uint32_t max_threads = widest_pool->get_thread_count();
+    std::vector<std::unique_ptr<learn_d3d12::TaskPool>> pools;
+    for (uint32_t threads = 1; threads < max_threads; threads *= 2)
+    {
+        pools.push_back(std::make_unique<learn_d3d12::TaskPool>(threads - 1));
+    }
+    pools.push_back(std::move(widest_pool));
+
+    const bool run_avx2 = !result["scalar"].as<bool>() && learn_d3d12::ParticleSystem::is_avx2_available();
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << frames << " frames, up to " << max_threads << " threads, AVX2 " << (learn_d3d12::ParticleSystem::is_avx2_available() ? "available" : "unavailable") << std::endl;
+    std::cout << std::setw(10) << "particles" << std::setw(9) << "threads" << std::setw(12) << "scalar ms" << std::setw(12) << "avx2 ms" << std::setw(10) << "speedup" << std::setw(16) << "M particles/s"
+              << std::endl;
+
+    bool kernels_agree = true;
+    for (uint32_t particle_count : particle_counts)
+    {
+        learn_d3d12::ParticleSystem system(particle_count);
+        for (const auto& pool : pools)
+        {
+            double scalar_ms = measure(system, frames, pool.get(), false);
+            double avx2_ms = run_avx2 ? measure(system, frames, pool.get(), true) : 0.0;
+            double best_ms = run_avx2 ? avx2_ms : scalar_ms;
+            std::cout << std::setw(10) << particle_count << std::setw(9) << pool->get_thread_count() << std::setw(12) << scalar_ms << std::setw(12);
+            if (run_avx2)
+            {
+                std::cout << avx2_ms << std::setw(10) << (avx2_ms > 0.0 ? scalar_ms / avx2_ms : 0.0);
+            }
+            else
+            {
+                std::cout << "-" << std::setw(10) << "-";
+            }
+            std::cout << std::setw(16) << (best_ms > 0.0 ? particle_count / best_ms / 1e3 : 0.0) << std::endl;
+        }
+
+        if (run_avx2)
+        {
+            // The serial scalar kernel is the reference for the parallel AVX2 one, after the
+            // same number of frames from the same seed.
+            learn_d3d12::ParticleSystem reference(particle_count);
+            learn_d3d12::ParticleSystem vectorized(particle_count);
+            reference.reset(1);
+            vectorized.reset(1);
+            for (uint32_t frame = 0; frame < frames; frame++)
+            {
+                reference.simulate(kDeltaTime, nullptr, false);
+                vectorized.simulate(kDeltaTime, pools.back().get(), true);
+            }
+            float max_difference = 0.0f;
+            uint32_t mismatches = count_mismatches(reference, vectorized, max_difference);
+            std::cout << std::setw(10) << particle_count << " particles: max difference between kernels " << std::scientific << max_difference << std::fixed << ", " << mismatches << " mismatches"
+                      << std::endl;
+            kernels_agree &= mismatches == 0;
+        }
+    }
+
+    if (!kernels_agree)
+    {
+        std::cerr << "LearnD3d12ParticleBench: scalar and AVX2 kernels disagree" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+#include "../renderer/residency_manager.h"
+#include <algorithm>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t kMiB = 1024 * 1024;
+    constexpr uint32_t kDirect = 0;
+
+    // Stand-in for the device, the adapter and the direct queue. Heaps are indices cast to
+    // handles; the reported usage is what is resident plus memory other processes use, and
+    // a submission completes `frame_latency` frames after it was made.
+    class FakeResidencyBackend : public learn_d3d12::ResidencyBackend
+    {
+    public:
+        FakeResidencyBackend(const std::vector<uint64_t>& heap_sizes, uint64_t budget, bool report_memory_info, uint32_t frame_latency)
+            : _heap_sizes(heap_sizes)
+            , _resident(heap_sizes.size(), true)
+            , _last_use(heap_sizes.size(), 0)
+            , _budget(budget)
+            , _report_memory_info(report_memory_info)
+            , _frame_latency(frame_latency)
+        {
+            for (uint64_t size : heap_sizes)
+            {
+                _resident_bytes += size;
+            }
+        }
+
+        bool query_video_memory(learn_d3d12::VideoMemoryInfo& info) override
+        {
+            if (!_report_memory_info)
+            {
+                return false;
+            }
+            info = {_budget, _resident_bytes + _external_usage};
+            return true;
+        }
+
+        void make_resident(void* const* handles, uint32_t count) override
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                size_t heap = _to_heap(handles[i]);
+                if (_resident[heap])
+                {
+                    _report_error("heap made resident twice");
+                }
+                _resident[heap] = true;
+                _resident_bytes += _heap_sizes[heap];
+                _paged_in_bytes += _heap_sizes[heap];
+            }
+        }
+
+        void evict(void* const* handles, uint32_t count) override
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                size_t heap = _to_heap(handles[i]);
+                if (!_resident[heap])
+                {
+                    _report_error("heap evicted twice");
+                }
+                if (_last_use[heap] > _completed_fence_value)
+                {
+                    _report_error("heap evicted while the GPU still uses it");
+                }
+                _resident[heap] = false;
+                _resident_bytes -= _heap_sizes[heap];
+            }
+        }
+
+        uint64_t get_completed_fence_value(uint32_t) override { return _completed_fence_value; }
+
+        void wait_for_fence(uint32_t, uint64_t fence_value) override
+        {
+            _completed_fence_value = std::max(_completed_fence_value, fence_value);
+            _wait_count++;
+        }
+
+        // Executes one frame's command list that references `heaps`.
+        uint64_t submit(const std::vector<uint32_t>& heaps)
+        {
+            uint64_t fence_value = _next_fence_value++;
+            for (uint32_t heap : heaps)
+            {
+                if (!_resident[heap])
+                {
+                    _report_error("command list references an evicted heap");
+                }
+                _last_use[heap] = fence_value;
+            }
+            // The GPU lags `frame_latency` submissions behind.
+            if (fence_value > _frame_latency)
+            {
+                _completed_fence_value = std::max(_completed_fence_value, fence_value - _frame_latency);
+            }
+            return fence_value;
+        }
+
+        void set_budget(uint64_t budget) { _budget = budget; }
+        void set_external_usage(uint64_t external_usage) { _external_usage = external_usage; }
+        uint64_t get_usage() const { return _resident_bytes + _external_usage; }
+        uint64_t get_paged_in_bytes() const { return _paged_in_bytes; }
+        uint64_t get_wait_count() const { return _wait_count; }
+        uint64_t get_error_count() const { return _error_count; }
+
+    private:
+        const std::vector<uint64_t>& _heap_sizes;
+        std::vector<bool> _resident;
+        std::vector<uint64_t> _last_use;
+        uint64_t _budget;
+        bool _report_memory_info;
+        uint32_t _frame_latency;
+        uint64_t _resident_bytes = 0;
+        uint64_t _external_usage = 0;
+        uint64_t _paged_in_bytes = 0;
+        uint64_t _next_fence_value = 1;
+        uint64_t _completed_fence_value = 0;
+        uint64_t _wait_count = 0;
+        uint64_t _error_count = 0;
+
+        static size_t _to_heap(void* handle) { return reinterpret_cast<size_t>(handle) - 1; }
+
+        void _report_error(const char* message)
+        {
+            if (_error_count++ < 10)
+            {
+                std::cerr << "error: " << message << std::endl;
+            }
+        }
+    };
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12ResidencySim", "Simulates a streaming scene against a video memory budget to check the residency manager.");
+    // clang-format off
+    options.add_options()
+        ("heaps", "Number of heaps in the scene.", cxxopts::value<uint32_t>()->default_value("512"))
+        ("max-heap-mb", "Heaps are between 1 MiB and this size.", cxxopts::value<uint32_t>()->default_value("64"))
+        ("working-set", "Heaps each frame references.", cxxopts::value<uint32_t>()->default_value("64"))
+        ("budget-mb", "Video memory budget.", cxxopts::value<uint64_t>()->default_value("4096"))
+        ("pressure-frame", "Frame at which other processes take a third of the budget, 0 for never.", cxxopts::value<uint32_t>()->default_value("500"))
+        ("no-memory-info", "Do not report a budget, so the manager uses --budget-mb itself.", cxxopts::value<bool>()->default_value("false"))
+        ("frames", "Frames to simulate.", cxxopts::value<uint32_t>()->default_value("1000"))
+        ("frame-latency", "Frames the GPU runs behind the CPU.", cxxopts::value<uint32_t>()->default_value("2"))
+        ("seed", "Seed for heap sizes and camera jitter.", cxxopts::value<uint32_t>()->default_value("1"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12ResidencySim: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto heap_count = std::max(result["heaps"].as<uint32_t>(), 1u);
+    const auto working_set = std::clamp(result["working-set"].as<uint32_t>(), 1u, heap_count);
+    const auto budget = result["budget-mb"].as<uint64_t>() * kMiB;
+    const auto pressure_frame = result["pressure-frame"].as<uint32_t>();
+    const auto frame_count = result["frames"].as<uint32_t>();
+    std::mt19937 random(result["seed"].as<uint32_t>());
+    std::uniform_int_distribution<uint64_t> heap_size(1, std::max<uint64_t>(result["max-heap-mb"].as<uint32_t>(), 1));
+    std::vector<uint64_t> heap_sizes(heap_count);
+    uint64_t scene_bytes = 0;
+    for (auto& size : heap_sizes)
+    {
+        size = heap_size(random) * kMiB;
+        scene_bytes += size;
+    }
+
+    // Like a renderer at startup, every heap is created, and therefore resident, up front.
+    FakeResidencyBackend backend(heap_sizes, budget, !result["no-memory-info"].as<bool>(), std::max(result["frame-latency"].as<uint32_t>(), 1u));
+    learn_d3d12::ResidencyManager residency(backend, budget);
+    std::vector<uint32_t> objects(heap_count);
+    for (uint32_t heap = 0; heap < heap_count; heap++)
+    {
+        objects[heap] = residency.add_object(reinterpret_cast<void*>(static_cast<size_t>(heap) + 1), heap_sizes[heap]);
+    }
+
+    // The camera moves through the scene: each frame references a window of heaps that
+    // slides forward, plus a few random ones.
+    learn_d3d12::ResidencySet set;
+    std::vector<uint32_t> heaps;
+    std::uniform_int_distribution<uint32_t> any_heap(0, heap_count - 1);
+    uint64_t over_budget_frames = 0;
+    for (uint32_t frame = 0; frame < frame_count; frame++)
+    {
+        if (pressure_frame != 0 && frame == pressure_frame)
+        {
+            backend.set_external_usage(budget / 3);
+        }
+        set.clear();
+        heaps.clear();
+        uint32_t window_start = frame / 2;
+        for (uint32_t i = 0; i < working_set; i++)
+        {
+            uint32_t heap = i < working_set - working_set / 8 ? (window_start + i) % heap_count : any_heap(random);
+            heaps.push_back(heap);
+            set.add(objects[heap]);
+        }
+
+        residency.prepare(set);
+        uint64_t fence_value = backend.submit(heaps);
+        residency.mark_submitted(set, kDirect, fence_value);
+        if (backend.get_usage() > residency.get_budget())
+        {
+            over_budget_frames++;
+        }
+    }
+
+    const auto& stats = residency.get_stats();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << heap_count << " heaps, " << static_cast<double>(scene_bytes) / kMiB << " MiB scene, " << static_cast<double>(budget) / kMiB << " MiB budget"
+              << (result["no-memory-info"].as<bool>() ? " (configured)" : " (reported)") << ", " << frame_count << " frames" << std::endl;
+    std::cout << "resident " << stats.resident_count << " heaps, " << static_cast<double>(stats.resident_bytes) / kMiB << " MiB" << std::endl;
+    std::cout << "evicted  " << stats.eviction_count << " heaps, " << static_cast<double>(stats.evicted_bytes) / kMiB << " MiB" << std::endl;
+    std::cout << "paged in " << static_cast<double>(backend.get_paged_in_bytes()) / kMiB << " MiB, " << static_cast<double>(backend.get_paged_in_bytes()) / kMiB / std::max(frame_count, 1u) << " MiB/frame" << std::endl;
+    std::cout << "GPU waits before eviction " << stats.wait_count << ", frames over budget " << over_budget_frames << ", sets larger than the budget " << stats.over_budget_count << std::endl;
+    if (backend.get_error_count() != 0)
+    {
+        std::cerr << "LearnD3d12ResidencySim: " << backend.get_error_count() << " errors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+#include "../renderer/resolution_controller.h"
+#include <algorithm>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Frames that must stay inside the band before the controller counts as settled.
+    constexpr uint32_t kSettleFrames = 30;
+    constexpr float kSettleBand = 0.1f;
+
+    // Reads a trace of "frame_ms [scale]" lines, as written by the renderer's
+    // --resolution-trace, and converts it to the cost of each frame at scale 1. Lines
+    // starting with '#' are comments.
+    bool read_trace(const std::string& path, float fixed_ms, std::vector<float>& costs, std::string& error)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::string line;
+        uint32_t line_number = 0;
+        while (std::getline(file, line))
+        {
+            line_number++;
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+            std::istringstream stream(line);
+            float frame_ms = 0.0f;
+            float scale = 1.0f;
+            if (!(stream >> frame_ms) || frame_ms <= 0.0f)
+            {
+                error = path + ":" + std::to_string(line_number) + ": expected a frame time in milliseconds";
+                return false;
+            }
+            if (!(stream >> scale) || scale <= 0.0f)
+            {
+                scale = 1.0f;
+            }
+            costs.push_back(std::max(frame_ms - fixed_ms, 0.01f) / (scale * scale));
+        }
+        if (costs.empty())
+        {
+            error = path + " holds no frames";
+            return false;
+        }
+        return true;
+    }
+
+    // A scene that gets heavy, then light, with slow drift on top. Costs are at scale 1.
+    std::vector<float> generate_trace(uint32_t frame_count, float target_ms)
+    {
+        std::vector<float> costs(frame_count);
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            float load = i < frame_count / 3 ? 0.8f : (i < frame_count * 2 / 3 ? 1.6f : 0.45f);
+            costs[i] = target_ms * load * (1.0f + 0.05f * std::sin(static_cast<float>(i) * 0.05f));
+        }
+        return costs;
+    }
+
+    float percentile(std::vector<float> values, float fraction)
+    {
+        std::sort(values.begin(), values.end());
+        return values[std::min(static_cast<size_t>(fraction * static_cast<float>(values.size())), values.size() - 1)];
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12ResolutionSim", "Replays a frame time trace through the dynamic resolution controller.");
+    // clang-format off
+    options.add_options()
+        ("trace", "Trace of \"frame_ms [scale]\" lines. A synthetic trace with load steps is used when empty.", cxxopts::value<std::string>()->default_value(""))
+        ("frames", "Length of the synthetic trace.", cxxopts::value<uint32_t>()->default_value("900"))
+        ("target-ms", "Target frame time.", cxxopts::value<float>()->default_value("14"))
+        ("min-scale", "Smallest render scale.", cxxopts::value<float>()->default_value("0.5"))
+        ("max-scale", "Largest render scale.", cxxopts::value<float>()->default_value("1.5"))
+        ("kp", "Proportional gain.", cxxopts::value<float>()->default_value("0.1"))
+        ("ki", "Integral gain.", cxxopts::value<float>()->default_value("0.15"))
+        ("kd", "Derivative gain.", cxxopts::value<float>()->default_value("0"))
+        ("deadband", "Relative error treated as on target.", cxxopts::value<float>()->default_value("0.05"))
+        ("max-step", "Largest relative change of the pixel count per frame.", cxxopts::value<float>()->default_value("0.1"))
+        ("latency", "Frames before a frame's GPU time reaches the controller.", cxxopts::value<uint32_t>()->default_value("2"))
+        ("fixed-ms", "Part of the frame time that does not scale with resolution.", cxxopts::value<float>()->default_value("0.5"))
+        ("noise", "Relative standard deviation of frame time noise.", cxxopts::value<float>()->default_value("0.03"))
+        ("seed", "Seed for the noise.", cxxopts::value<uint32_t>()->default_value("1"))
+        ("output", "Write frame, cost_ms, frame_ms and scale per frame as CSV.", cxxopts::value<std::string>()->default_value(""));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12ResolutionSim: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    learn_d3d12::ResolutionControllerSettings settings;
+    settings.target_frame_ms = result["target-ms"].as<float>();
+    settings.min_scale = result["min-scale"].as<float>();
+    settings.max_scale = result["max-scale"].as<float>();
+    settings.proportional_gain = result["kp"].as<float>();
+    settings.integral_gain = result["ki"].as<float>();
+    settings.derivative_gain = result["kd"].as<float>();
+    settings.deadband = result["deadband"].as<float>();
+    settings.max_step = result["max-step"].as<float>();
+    const auto latency = result["latency"].as<uint32_t>();
+    const auto fixed_ms = std::max(result["fixed-ms"].as<float>(), 0.0f);
+    const auto target_ms = settings.target_frame_ms;
+
+    std::vector<float> costs;
+    const auto trace_path = result["trace"].as<std::string>();
+    if (trace_path.empty())
+    {
+        costs = generate_trace(std::max(result["frames"].as<uint32_t>(), 1u), target_ms);
+    }
+    else
+    {
+        std::string error;
+        if (!read_trace(trace_path, fixed_ms, costs, error))
+        {
+            std::cerr << "LearnD3d12ResolutionSim: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Each frame renders at the current scale; its time reaches the controller `latency`
+    // frames later, like a GPU timestamp read back once the frame's fence has completed.
+    learn_d3d12::ResolutionController controller(settings);
+    std::mt19937 random(result["seed"].as<uint32_t>());
+    std::normal_distribution<float> noise(0.0f, std::max(result["noise"].as<float>(), 0.0f));
+    std::deque<float> pending;
+    const auto frame_count = static_cast<uint32_t>(costs.size());
+    std::vector<float> frame_times(frame_count);
+    std::vector<float> scales(frame_count);
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        float scale = controller.get_scale();
+        scales[i] = scale;
+        frame_times[i] = std::max(fixed_ms + costs[i] * scale * scale * (1.0f + noise(random)), 0.01f);
+        pending.push_back(frame_times[i]);
+        if (pending.size() > latency)
+        {
+            controller.update(pending.front());
+            pending.pop_front();
+        }
+    }
+
+    uint32_t over_target = 0;
+    uint32_t reversals = 0;
+    uint32_t settle_frame = frame_count;
+    uint32_t in_band_run = 0;
+    uint32_t out_of_band_run = 0;
+    uint32_t longest_excursion = 0;
+    double absolute_error = 0.0;
+    float previous_step = 0.0f;
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        float relative_error = (frame_times[i] - target_ms) / target_ms;
+        over_target += relative_error > 0.0f ? 1 : 0;
+        absolute_error += std::fabs(relative_error);
+
+        // Oscillation shows as the scale changing direction.
+        float step = i > 0 ? scales[i] - scales[i - 1] : 0.0f;
+        if (step != 0.0f)
+        {
+            reversals += previous_step * step < 0.0f ? 1 : 0;
+            previous_step = step;
+        }
+
+        // Settled means inside the band for kSettleFrames frames in a row.
+        bool in_band = std::fabs(relative_error) <= kSettleBand;
+        in_band_run = in_band ? in_band_run + 1 : 0;
+        out_of_band_run = in_band ? 0 : out_of_band_run + 1;
+        longest_excursion = std::max(longest_excursion, out_of_band_run);
+        if (settle_frame == frame_count && in_band_run == kSettleFrames)
+        {
+            settle_frame = i + 1 - kSettleFrames;
+        }
+    }
+
+    double mean_scale = 0.0;
+    for (float scale : scales)
+    {
+        mean_scale += scale;
+    }
+    mean_scale /= frame_count;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << frame_count << " frames " << (trace_path.empty() ? "(synthetic)" : "from " + trace_path) << ", target " << target_ms << " ms, latency " << latency << " frames" << std::endl;
+    std::cout << "gains kp " << settings.proportional_gain << " ki " << settings.integral_gain << " kd " << settings.derivative_gain << ", scale " << settings.min_scale << "-" << settings.max_scale << std::endl;
+    std::cout << "settled after " << settle_frame << " frames, longest excursion outside +-" << kSettleBand * 100.0f << "% " << longest_excursion << " frames" << std::endl;
+    std::cout << "over target " << 100.0 * over_target / frame_count << "% of frames, mean error " << 100.0 * absolute_error / frame_count << "%, p95 " << percentile(frame_times, 0.95f) << " ms" << std::endl;
+    std::cout << "scale mean " << mean_scale << ", " << 100.0 * reversals / frame_count << " direction changes per 100 frames" << std::endl;
+
+    if (auto output_path = result["output"].as<std::string>(); !output_path.empty())
+    {
+        std::ofstream output(output_path);
+        if (!output)
+        {
+            std::cerr << "LearnD3d12ResolutionSim: cannot write " << output_path << std::endl;
+            return EXIT_FAILURE;
+        }
+        output << "frame,cost_ms,frame_ms,scale\n"
+               << std::setprecision(4);
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            output << i << "," << costs[i] << "," << frame_times[i] << "," << scales[i] << "\n";
+        }
+    }
+    return EXIT_SUCCESS;
+}
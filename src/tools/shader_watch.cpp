@@ -0,0 +1,110 @@
+#include "../renderer/shader_reloader.h"
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Runs the watcher and recompile scheduling of hot shader reloading without a renderer:
+// edit a shader while it runs and it prints which permutations were recompiled. Without
+// --dxc it only reports what it would compile, which works on any machine.
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12ShaderWatch", "Watches the shader directory and recompiles edited shaders like --hot-reload does.");
+    // clang-format off
+    options.add_options()
+        ("shader-dir", "Shader source directory.", cxxopts::value<std::string>()->default_value("shader"))
+        ("dxc", "DXC executable. When empty, edits are only reported.", cxxopts::value<std::string>()->default_value(""))
+        ("shader-model", "Shader model of graphics and compute stages.", cxxopts::value<std::string>()->default_value("6_0"))
+        ("quiet-ms", "Milliseconds without changes before a batch is compiled.", cxxopts::value<uint32_t>()->default_value("100"))
+        ("seconds", "Stop after this many seconds, 0 to run until interrupted.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("list", "Print the shader permutations and their dependencies, then exit.", cxxopts::value<bool>()->default_value("false"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12ShaderWatch: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path shader_dir = result["shader-dir"].as<std::string>();
+    const auto shader_model = result["shader-model"].as<std::string>();
+    if (!std::filesystem::is_directory(shader_dir))
+    {
+        std::cerr << "LearnD3d12ShaderWatch: " << shader_dir.string() << " is not a directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (result["list"].as<bool>())
+    {
+        learn_d3d12::ShaderDependencyGraph graph;
+        graph.scan(shader_dir, shader_model);
+        for (const auto& permutation : graph.get_permutations())
+        {
+            std::cout << permutation.path << ":" << permutation.entry_point << " (" << permutation.profile << ")";
+            for (const auto& dependency : graph.get_dependencies(permutation.path))
+            {
+                std::cout << " " << dependency;
+            }
+            std::cout << std::endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    std::mutex output_mutex;
+    learn_d3d12::ShaderReloader::Settings settings;
+    settings.shader_root = shader_dir;
+    settings.shader_model = shader_model;
+    settings.quiet_period = std::chrono::milliseconds(result["quiet-ms"].as<uint32_t>());
+    const auto dxc = result["dxc"].as<std::string>();
+    if (dxc.empty())
+    {
+        settings.compile = [](const std::filesystem::path&, const learn_d3d12::ShaderPermutation&, std::vector<uint8_t>&, std::string& log) {
+            log = "dry run";
+            return true;
+        };
+    }
+    else
+    {
+        settings.compile = learn_d3d12::make_dxc_compile_function(dxc);
+    }
+    settings.on_batch = [&](std::vector<learn_d3d12::ShaderReloadResult>& results) {
+        std::lock_guard lock(output_mutex);
+        std::cout << std::fixed << std::setprecision(3);
+        for (const auto& reload : results)
+        {
+            std::cout << (reload.succeeded ? "compiled " : "failed   ") << reload.permutation.path << ":" << reload.permutation.entry_point << " (" << reload.permutation.profile << ") in "
+                      << reload.compile_ms << " ms, " << reload.bytecode.size() << " bytes";
+            if (!reload.log.empty())
+            {
+                std::cout << "\n" << reload.log;
+            }
+            std::cout << std::endl;
+        }
+    };
+
+    learn_d3d12::ShaderReloader reloader(std::move(settings));
+    std::string error;
+    if (!reloader.start(error))
+    {
+        std::cerr << "LearnD3d12ShaderWatch: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Watching " << shader_dir.string() << (dxc.empty() ? " (dry run)" : "") << std::endl;
+
+    const auto seconds = result["seconds"].as<uint32_t>();
+    if (seconds == 0)
+    {
+        for (;;)
+        {
+            std::this_thread::sleep_for(std::chrono::hours(1));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    reloader.stop();
+    return EXIT_SUCCESS;
+}
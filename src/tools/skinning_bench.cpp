@@ -0,0 +1,141 @@
+#include "../animation/cpu_skinning.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Measurement
+    {
+        double milliseconds = 0.0;
+        uint64_t vertices = 0;
+    };
+
+    // Animates and skins every mesh `iterations` times, like a renderer would each frame.
+    Measurement measure(const std::vector<learn_d3d12::SkinnedMesh>& meshes, std::vector<std::vector<learn_d3d12::Float3x4>>& palettes, std::vector<std::vector<learn_d3d12::SkinnedVertex>>& outputs,
+                        uint32_t bone_count, uint32_t iterations, learn_d3d12::TaskPool* pool, bool allow_simd)
+    {
+        std::vector<learn_d3d12::SkinningJob> jobs(meshes.size());
+        for (size_t m = 0; m < meshes.size(); m++)
+        {
+            jobs[m] = {&meshes[m], palettes[m].data(), outputs[m].data()};
+        }
+
+        Measurement measurement;
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            for (size_t m = 0; m < meshes.size(); m++)
+            {
+                learn_d3d12::animate_tube_palette(0.1f * static_cast<float>(i), static_cast<float>(m), bone_count, 1.0f, palettes[m].data());
+            }
+            auto start = std::chrono::steady_clock::now();
+            learn_d3d12::skin_meshes(jobs.data(), static_cast<uint32_t>(jobs.size()), pool, allow_simd);
+            measurement.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            for (const auto& mesh : meshes)
+            {
+                measurement.vertices += mesh.get_vertex_count();
+            }
+        }
+        return measurement;
+    }
+
+    void print(const char* name, const Measurement& measurement, uint32_t iterations, uint32_t thread_count)
+    {
+        double vertices_per_second = measurement.milliseconds > 0.0 ? static_cast<double>(measurement.vertices) / measurement.milliseconds * 1000.0 : 0.0;
+        std::cout << std::left << std::setw(8) << name << std::right << std::setw(9) << measurement.milliseconds / iterations << " ms/frame, " << std::setw(9) << vertices_per_second / 1e6
+                  << " M vertices/s, " << std::setw(9) << vertices_per_second / 1e6 / thread_count << " M vertices/s/core" << std::endl;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12SkinningBench", "Benchmark for CPU skinning of many meshes into an upload buffer.");
+    // clang-format off
+    options.add_options()
+        ("meshes", "Number of skinned meshes.", cxxopts::value<uint32_t>()->default_value("64"))
+        ("rings", "Rings of vertices along each tube.", cxxopts::value<uint32_t>()->default_value("128"))
+        ("ring-vertices", "Vertices around each ring.", cxxopts::value<uint32_t>()->default_value("64"))
+        ("bones", "Bones per mesh.", cxxopts::value<uint32_t>()->default_value("32"))
+        ("iterations", "Frames per run.", cxxopts::value<uint32_t>()->default_value("50"))
+        ("threads", "Threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("scalar", "Only run the scalar kernel.", cxxopts::value<bool>()->default_value("false"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12SkinningBench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto mesh_count = std::max(result["meshes"].as<uint32_t>(), 1u);
+    const auto ring_count = std::max(result["rings"].as<uint32_t>(), 2u);
+    const auto ring_vertex_count = std::max(result["ring-vertices"].as<uint32_t>(), 3u);
+    const auto bone_count = std::clamp(result["bones"].as<uint32_t>(), 1u, learn_d3d12::SkinnedMesh::kMaxBones);
+    const auto iterations = std::max(result["iterations"].as<uint32_t>(), 1u);
+    auto thread_count = result["threads"].as<uint32_t>();
+    learn_d3d12::TaskPool task_pool(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+
+    std::vector<learn_d3d12::SkinnedMesh> meshes;
+    std::vector<std::vector<learn_d3d12::Float3x4>> palettes(mesh_count, std::vector<learn_d3d12::Float3x4>(bone_count));
+    std::vector<std::vector<learn_d3d12::SkinnedVertex>> outputs[2];
+    meshes.reserve(mesh_count);
+    for (uint32_t m = 0; m < mesh_count; m++)
+    {
+        meshes.push_back(learn_d3d12::make_skinned_tube(ring_count, ring_vertex_count, bone_count, 1.0f, 0.05f));
+        for (auto& output : outputs)
+        {
+            output.emplace_back(meshes.back().get_vertex_count());
+        }
+    }
+
+    const bool run_avx2 = !result["scalar"].as<bool>() && learn_d3d12::is_skinning_avx2_available();
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << mesh_count << " meshes of " << meshes[0].get_vertex_count() << " vertices, " << bone_count << " bones, " << task_pool.get_thread_count() << " threads, AVX2 "
+              << (learn_d3d12::is_skinning_avx2_available() ? "available" : "unavailable") << std::endl;
+
+    // Single threaded first for the per-core rate, then across the pool.
+    const char* const kKernelNames[] = {"scalar", "avx2"};
+    for (uint32_t k = 0; k < (run_avx2 ? 2u : 1u); k++)
+    {
+        std::cout << kKernelNames[k] << ":" << std::endl;
+        std::cout << "  ";
+        print("serial", measure(meshes, palettes, outputs[k], bone_count, iterations, nullptr, k == 1), iterations, 1);
+        std::cout << "  ";
+        print("parallel", measure(meshes, palettes, outputs[k], bone_count, iterations, &task_pool, k == 1), iterations, task_pool.get_thread_count());
+    }
+
+    if (run_avx2)
+    {
+        // Both kernels skinned the same last frame; FMA contraction is the only difference.
+        float max_difference = 0.0f;
+        for (uint32_t m = 0; m < mesh_count; m++)
+        {
+            for (uint32_t v = 0; v < meshes[m].get_vertex_count(); v++)
+            {
+                const auto& a = outputs[0][m][v];
+                const auto& b = outputs[1][m][v];
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    max_difference = std::max({max_difference, std::fabs(a.position[c] - b.position[c]), std::fabs(a.normal[c] - b.normal[c])});
+                }
+            }
+        }
+        std::cout << "max difference between kernels " << std::scientific << max_difference << std::endl;
+        if (!(max_difference < 1e-4f))
+        {
+            std::cerr << "LearnD3d12SkinningBench: scalar and AVX2 kernels disagree" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
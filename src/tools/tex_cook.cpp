@@ -0,0 +1,114 @@
+#include "../texture/bc_encoder.h"
+#include "../texture/dds_writer.h"
+#include "../texture/image.h"
+#include "../texture/mip_chain.h"
+#include "../threading/task_pool.h"
+#include <chrono>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12TexCook", "Cooks images into block compressed DDS textures.");
+    // clang-format off
+    options.add_options()
+        ("i,input", "Source image, TGA or binary PPM.", cxxopts::value<std::string>())
+        ("o,output", "Destination DDS file.", cxxopts::value<std::string>())
+        ("f,format", "Block format, bc1, bc5 or bc7.", cxxopts::value<std::string>()->default_value("bc7"))
+        ("linear", "Treat color as linear data instead of sRGB.", cxxopts::value<bool>()->default_value("false"))
+        ("mips", "Number of mip levels, 0 for the full chain.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("threads", "Encoding threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12TexCook: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!result.count("input") || !result.count("output"))
+    {
+        std::cerr << options.help() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    learn_d3d12::BcFormat format;
+    auto format_name = result["format"].as<std::string>();
+    if (format_name == "bc1")
+    {
+        format = learn_d3d12::BcFormat::kBc1;
+    }
+    else if (format_name == "bc5")
+    {
+        format = learn_d3d12::BcFormat::kBc5;
+    }
+    else if (format_name == "bc7")
+    {
+        format = learn_d3d12::BcFormat::kBc7;
+    }
+    else
+    {
+        std::cerr << "LearnD3d12TexCook: unknown format " << format_name << std::endl;
+        return EXIT_FAILURE;
+    }
+    // BC5 holds two-channel data such as normals, which is never gamma encoded.
+    const bool srgb = !result["linear"].as<bool>() && format != learn_d3d12::BcFormat::kBc5;
+
+    learn_d3d12::Image image;
+    std::string error;
+    if (!learn_d3d12::load_image(result["input"].as<std::string>(), image, error))
+    {
+        std::cerr << "LearnD3d12TexCook: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    // D3D12 only creates block compressed textures whose top level is whole blocks.
+    if (image.width % 4 != 0 || image.height % 4 != 0)
+    {
+        std::cerr << "LearnD3d12TexCook: " << image.width << "x" << image.height << " is not a multiple of 4, which block compressed textures require" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto thread_count = result["threads"].as<uint32_t>();
+    learn_d3d12::TaskPool task_pool(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+    using Clock = std::chrono::steady_clock;
+
+    auto mip_start = Clock::now();
+    auto mips = learn_d3d12::build_mip_chain(image, srgb, result["mips"].as<uint32_t>(), &task_pool);
+    auto mip_end = Clock::now();
+
+    learn_d3d12::CookedTexture texture;
+    texture.width = image.width;
+    texture.height = image.height;
+    texture.dxgi_format = learn_d3d12::get_bc_dxgi_format(format, srgb);
+    texture.block_size = learn_d3d12::get_bc_block_size(format);
+    uint64_t pixel_count = 0;
+    for (const auto& mip : mips)
+    {
+        texture.mips.push_back(learn_d3d12::compress_image(mip, format, &task_pool));
+        pixel_count += static_cast<uint64_t>(mip.width) * mip.height;
+    }
+    auto encode_end = Clock::now();
+
+    if (!learn_d3d12::write_dds(result["output"].as<std::string>(), texture, error))
+    {
+        std::cerr << "LearnD3d12TexCook: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto mip_seconds = std::chrono::duration<double>(mip_end - mip_start).count();
+    auto encode_seconds = std::chrono::duration<double>(encode_end - mip_end).count();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << image.width << "x" << image.height << " " << learn_d3d12::get_bc_format_name(format) << (srgb ? " sRGB" : "") << ", " << mips.size() << " mips, "
+              << task_pool.get_thread_count() << " threads" << std::endl;
+    std::cout << "mip chain: " << mip_seconds * 1000.0 << " ms" << std::endl;
+    std::cout << "encode:    " << encode_seconds * 1000.0 << " ms, " << static_cast<double>(pixel_count) / encode_seconds / 1e6 << " MPixels/s" << std::endl;
+
+    // Quality is measured on the top level, which dominates what ends up on screen.
+    auto decoded = learn_d3d12::decompress_image(texture.mips[0], image.width, image.height, format);
+    std::cout << "PSNR:      " << learn_d3d12::compute_psnr(image, decoded, format) << " dB" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,439 @@
+#include "../profiling/gpu_timestamp_tracker.h"
+#include <algorithm>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Scope 0 encloses the others, like "Frame" encloses the passes in HelloTriangle.
+    const char* const kScopeNames[] = {"Frame", "Shadow", "Geometry", "Lighting", "Post"};
+    constexpr uint32_t kMaxPasses = 4;
+
+    // One command of a simulated command list.
+    struct Command
+    {
+        enum class Type
+        {
+            kTimestamp,
+            kWork,
+        };
+        Type type;
+        // Query index of a timestamp, ticks of work.
+        uint64_t value;
+    };
+
+    struct Submission
+    {
+        uint32_t frame;
+        uint64_t fence_value;
+        std::vector<Command> commands;
+        learn_d3d12::GpuTimestampTracker::QueryRange resolve;
+    };
+
+    // A profiled frame that has not been read back yet.
+    struct InFlightFrame
+    {
+        uint32_t frame;
+        uint64_t fence_value;
+        uint32_t slot;
+        learn_d3d12::GpuTimestampTracker::QueryRange range;
+        // Indexed like kScopeNames, negative for scopes that got no queries.
+        double expected_ms[kMaxPasses + 1];
+    };
+
+    // Stand-in for a direct queue with a timestamp query heap, a readback buffer and a
+    // fence. Submissions execute in order on a GPU clock that keeps running between them.
+    class SimulatedGpu
+    {
+    public:
+        SimulatedGpu(uint32_t query_count, uint64_t start_ticks)
+            : _query_heap(query_count, 0)
+            , _readback(query_count, 0)
+            , _clock(start_ticks)
+        {
+        }
+
+        void submit(Submission submission) { _pending.push_back(std::move(submission)); }
+
+        // Runs the oldest submission to completion: writes its timestamps, resolves its
+        // queries into the readback buffer and signals its fence value.
+        void execute_next(uint32_t idle_ticks)
+        {
+            const Submission& submission = _pending.front();
+            _clock += idle_ticks;
+            for (const auto& command : submission.commands)
+            {
+                if (command.type == Command::Type::kTimestamp)
+                {
+                    _query_heap[command.value] = _clock;
+                }
+                else
+                {
+                    _clock += command.value;
+                }
+            }
+            std::copy_n(_query_heap.begin() + submission.resolve.first_query, submission.resolve.query_count, _readback.begin() + submission.resolve.first_query);
+            _completed_fence_value = submission.fence_value;
+            _pending.pop_front();
+        }
+
+        size_t get_pending_count() const { return _pending.size(); }
+        uint64_t get_completed_fence_value() const { return _completed_fence_value; }
+        const uint64_t* get_readback() const { return _readback.data(); }
+
+    private:
+        std::vector<uint64_t> _query_heap;
+        std::vector<uint64_t> _readback;
+        std::deque<Submission> _pending;
+        uint64_t _clock;
+        uint64_t _completed_fence_value = 0;
+    };
+
+    class Checker
+    {
+    public:
+        void report_error(uint32_t frame, const std::string& message)
+        {
+            if (_error_count++ < 8)
+            {
+                std::cerr << "LearnD3d12TimestampSim: frame " << frame << ": " << message << std::endl;
+            }
+        }
+
+        uint32_t get_error_count() const { return _error_count; }
+
+    private:
+        uint32_t _error_count = 0;
+    };
+
+    bool is_close(double value, double expected)
+    {
+        return std::fabs(value - expected) <= 1e-9 * std::max(1.0, std::fabs(expected));
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12TimestampSim", "Drives GpuTimestampTracker with synthetic timestamps and fence values and checks its results.");
+    // clang-format off
+    options.add_options()
+        ("frames", "Frames to simulate.", cxxopts::value<uint32_t>()->default_value("10000"))
+        ("frame-latency", "Readback slots of the tracker.", cxxopts::value<uint32_t>()->default_value("3"))
+        ("gpu-latency", "Frames the CPU may record ahead of the GPU.", cxxopts::value<uint32_t>()->default_value("3"))
+        ("passes", "Scopes nested inside the frame scope, at most 4.", cxxopts::value<uint32_t>()->default_value("4"))
+        ("max-scopes", "Scopes per frame the tracker has queries for, 0 for one per scope.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("frequency", "Timestamp ticks per second.", cxxopts::value<uint64_t>()->default_value("10000000"))
+        ("seed", "Seed for the work durations and the GPU progress.", cxxopts::value<uint32_t>()->default_value("1"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12TimestampSim: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto frame_count = result["frames"].as<uint32_t>();
+    const auto frame_latency = std::max(result["frame-latency"].as<uint32_t>(), 1u);
+    const auto gpu_latency = std::max(result["gpu-latency"].as<uint32_t>(), 1u);
+    const auto pass_count = std::min(result["passes"].as<uint32_t>(), kMaxPasses);
+    const auto scope_count = pass_count + 1;
+    const auto max_scopes = result["max-scopes"].as<uint32_t>() ? result["max-scopes"].as<uint32_t>() : scope_count;
+    const auto frequency = std::max<uint64_t>(result["frequency"].as<uint64_t>(), 1);
+    std::mt19937 random(result["seed"].as<uint32_t>());
+    // Between 0.05 and 4 ms of work per pass, and up to 0.5 ms of gaps around them.
+    std::uniform_int_distribution<uint64_t> work_ticks(std::max<uint64_t>(frequency / 20000, 1), std::max<uint64_t>(frequency / 250, 1));
+    std::uniform_int_distribution<uint64_t> gap_ticks(0, frequency / 2000);
+    std::uniform_int_distribution<uint32_t> idle_ticks(0, static_cast<uint32_t>(std::min<uint64_t>(frequency / 1000, UINT32_MAX)));
+
+    learn_d3d12::GpuTimestampTracker tracker(max_scopes, frame_latency);
+    tracker.set_timestamp_frequency(frequency);
+    const uint32_t queries_per_slot = max_scopes * 2;
+    // A GPU clock that has been running for a while, so the tick values are large.
+    SimulatedGpu gpu(tracker.get_query_count(), uint64_t(1) << 40);
+    Checker checker;
+
+    std::deque<InFlightFrame> in_flight;
+    std::vector<uint32_t> completed_frames;
+    double expected_total_ms[kMaxPasses + 1] = {};
+    double expected_min_ms[kMaxPasses + 1] = {};
+    double expected_max_ms[kMaxPasses + 1] = {};
+    uint64_t expected_samples[kMaxPasses + 1] = {};
+    uint64_t next_fence_value = 1;
+    uint64_t expected_drops = 0;
+    uint64_t collected = 0;
+    uint64_t latency_total = 0;
+    uint32_t latency_max = 0;
+
+    // Reads back every frame whose fence value has completed, like GpuProfiler::begin_frame.
+    auto collect = [&](uint32_t frame) {
+        const uint64_t completed_fence_value = gpu.get_completed_fence_value();
+        learn_d3d12::GpuTimestampTracker::QueryRange range;
+        uint32_t slot;
+        while ((slot = tracker.pop_completed_frame(completed_fence_value, range)) != learn_d3d12::GpuTimestampTracker::kInvalidSlot)
+        {
+            if (in_flight.empty())
+            {
+                checker.report_error(frame, "read back a frame that was never submitted");
+                break;
+            }
+            const InFlightFrame expected = in_flight.front();
+            in_flight.pop_front();
+            if (expected.fence_value > completed_fence_value)
+            {
+                checker.report_error(frame, "frame " + std::to_string(expected.frame) + " read back before its fence value completed");
+            }
+            if (slot != expected.slot || range.first_query != expected.range.first_query || range.query_count != expected.range.query_count)
+            {
+                checker.report_error(frame, "frame " + std::to_string(expected.frame) + " read back from the wrong queries");
+            }
+
+            std::vector<uint64_t> samples_before(scope_count, 0);
+            for (uint32_t i = 0; i < scope_count; i++)
+            {
+                for (const auto& stats : tracker.get_scope_stats())
+                {
+                    samples_before[i] = stats.name == kScopeNames[i] ? stats.sample_count : samples_before[i];
+                }
+            }
+            tracker.accumulate(slot, range.query_count ? gpu.get_readback() + range.first_query : nullptr);
+            for (uint32_t i = 0; i < scope_count; i++)
+            {
+                const learn_d3d12::GpuScopeStats* scope_stats = nullptr;
+                for (const auto& stats : tracker.get_scope_stats())
+                {
+                    scope_stats = stats.name == kScopeNames[i] ? &stats : scope_stats;
+                }
+                uint64_t samples_after = scope_stats ? scope_stats->sample_count : 0;
+                if (expected.expected_ms[i] < 0.0)
+                {
+                    if (samples_after != samples_before[i])
+                    {
+                        checker.report_error(frame, std::string(kScopeNames[i]) + " has a sample although it did not get both queries");
+                    }
+                    continue;
+                }
+                if (samples_after != samples_before[i] + 1)
+                {
+                    checker.report_error(frame, std::string(kScopeNames[i]) + " of frame " + std::to_string(expected.frame) + " was not accumulated");
+                }
+                else if (!is_close(scope_stats->last_ms, expected.expected_ms[i]))
+                {
+                    checker.report_error(frame,
+                                         std::string(kScopeNames[i]) + " of frame " + std::to_string(expected.frame) + " took " + std::to_string(scope_stats->last_ms) + " ms, expected " +
+                                             std::to_string(expected.expected_ms[i]) + " ms");
+                }
+            }
+
+            // The frame must be read back by the first begin_frame after its fence completed.
+            uint32_t completed_frame = completed_frames[expected.frame];
+            if (frame != completed_frame)
+            {
+                checker.report_error(frame, "frame " + std::to_string(expected.frame) + " read back " + std::to_string(frame - completed_frame) + " frames after its fence value completed");
+            }
+            uint32_t latency = frame - expected.frame;
+            latency_total += latency;
+            latency_max = std::max(latency_max, latency);
+            collected++;
+        }
+        if (!in_flight.empty() && in_flight.front().fence_value <= completed_fence_value)
+        {
+            checker.report_error(frame, "frame " + std::to_string(in_flight.front().frame) + " completed but was not read back");
+        }
+    };
+
+    completed_frames.resize(frame_count, UINT32_MAX);
+    std::vector<uint32_t> submitted_frames;
+    auto execute_next = [&](uint32_t frame) {
+        completed_frames[submitted_frames.front()] = frame;
+        submitted_frames.erase(submitted_frames.begin());
+        gpu.execute_next(idle_ticks(random));
+    };
+
+    for (uint32_t frame = 0; frame < frame_count; frame++)
+    {
+        // The GPU got through some of the work while the CPU recorded the previous frame.
+        for (uint32_t n = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(gpu.get_pending_count()))(random); n > 0; n--)
+        {
+            execute_next(frame);
+        }
+        // Throttle like a swap chain with `gpu_latency` buffers.
+        while (gpu.get_pending_count() >= gpu_latency)
+        {
+            execute_next(frame);
+        }
+        collect(frame);
+
+        // Every slot is in flight exactly when all `frame_latency` profiled frames are unread.
+        const bool slot_free = in_flight.size() < frame_latency;
+        const bool began = tracker.begin_frame();
+        if (began && !slot_free)
+        {
+            checker.report_error(frame, "began a frame in a slot that is still in flight");
+        }
+        else if (!began && slot_free)
+        {
+            checker.report_error(frame, "skipped a frame although a slot was free");
+        }
+        expected_drops += slot_free ? 0 : 1;
+
+        // Record "Frame" around the passes, with gaps between them.
+        Submission submission {frame, next_fence_value++, {}, {}};
+        InFlightFrame profiled {frame, submission.fence_value, learn_d3d12::GpuTimestampTracker::kInvalidSlot, {}, {}};
+        std::vector<uint32_t> queries;
+        uint64_t ticks = 0;
+        uint64_t begin_ticks[kMaxPasses + 1] = {};
+        auto write_timestamp = [&](uint32_t scope, uint32_t query, bool begin) {
+            if (query == learn_d3d12::GpuTimestampTracker::kInvalidQuery)
+            {
+                profiled.expected_ms[scope] = -1.0;
+                return;
+            }
+            if (!began)
+            {
+                checker.report_error(frame, "got a query while the frame is not profiled");
+                return;
+            }
+            if (query >= tracker.get_query_count() || std::find(queries.begin(), queries.end(), query) != queries.end())
+            {
+                checker.report_error(frame, "got query " + std::to_string(query) + " twice or out of range");
+                return;
+            }
+            uint32_t slot = query / queries_per_slot;
+            if (profiled.slot == learn_d3d12::GpuTimestampTracker::kInvalidSlot)
+            {
+                profiled.slot = slot;
+                for (const auto& other : in_flight)
+                {
+                    if (other.slot == slot)
+                    {
+                        checker.report_error(frame, "writes queries of frame " + std::to_string(other.frame) + ", which was not read back yet");
+                    }
+                }
+            }
+            else if (slot != profiled.slot)
+            {
+                checker.report_error(frame, "uses queries of two slots");
+            }
+            queries.push_back(query);
+            submission.commands.push_back({Command::Type::kTimestamp, query});
+            if (begin)
+            {
+                begin_ticks[scope] = ticks;
+            }
+            else if (profiled.expected_ms[scope] >= 0.0)
+            {
+                profiled.expected_ms[scope] = static_cast<double>(ticks - begin_ticks[scope]) * 1000.0 / static_cast<double>(frequency);
+            }
+        };
+        auto add_work = [&](uint64_t work) {
+            submission.commands.push_back({Command::Type::kWork, work});
+            ticks += work;
+        };
+
+        write_timestamp(0, tracker.begin_scope(kScopeNames[0]), true);
+        for (uint32_t pass = 1; pass <= pass_count; pass++)
+        {
+            add_work(gap_ticks(random));
+            write_timestamp(pass, tracker.begin_scope(kScopeNames[pass]), true);
+            add_work(work_ticks(random));
+            write_timestamp(pass, tracker.end_scope(), false);
+        }
+        add_work(gap_ticks(random));
+        write_timestamp(0, tracker.end_scope(), false);
+
+        submission.resolve = tracker.end_frame(submission.fence_value);
+        if (began && profiled.slot == learn_d3d12::GpuTimestampTracker::kInvalidSlot)
+        {
+            checker.report_error(frame, "the frame scope got no queries");
+        }
+        else if (began)
+        {
+            const uint32_t first_query = profiled.slot * queries_per_slot;
+            if (submission.resolve.query_count != queries.size() || (!queries.empty() && submission.resolve.first_query != first_query))
+            {
+                checker.report_error(frame, "end_frame resolves the wrong queries");
+            }
+            profiled.range = submission.resolve;
+            for (uint32_t i = 0; i < scope_count; i++)
+            {
+                if (profiled.expected_ms[i] < 0.0)
+                {
+                    continue;
+                }
+                expected_total_ms[i] += profiled.expected_ms[i];
+                expected_min_ms[i] = expected_samples[i] ? std::min(expected_min_ms[i], profiled.expected_ms[i]) : profiled.expected_ms[i];
+                expected_max_ms[i] = expected_samples[i] ? std::max(expected_max_ms[i], profiled.expected_ms[i]) : profiled.expected_ms[i];
+                expected_samples[i]++;
+            }
+            in_flight.push_back(profiled);
+        }
+        else if (submission.resolve.query_count != 0)
+        {
+            checker.report_error(frame, "end_frame resolves queries of a frame that is not profiled");
+        }
+        submitted_frames.push_back(frame);
+        gpu.submit(std::move(submission));
+    }
+
+    // Let the GPU finish and read back the rest, like the renderer's shutdown.
+    while (gpu.get_pending_count() > 0)
+    {
+        execute_next(frame_count);
+    }
+    collect(frame_count);
+    if (!in_flight.empty())
+    {
+        checker.report_error(frame_count, std::to_string(in_flight.size()) + " frames were never read back");
+    }
+    if (tracker.get_dropped_frame_count() != expected_drops)
+    {
+        checker.report_error(frame_count, "counted " + std::to_string(tracker.get_dropped_frame_count()) + " skipped frames, expected " + std::to_string(expected_drops));
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << frame_count << " frames, " << frame_latency << " readback slots, GPU up to " << gpu_latency << " frames behind, " << frequency << " ticks per second" << std::endl;
+    std::cout << collected << " frames read back, " << tracker.get_dropped_frame_count() << " skipped, latency avg " << (collected ? static_cast<double>(latency_total) / static_cast<double>(collected) : 0.0)
+              << " max " << latency_max << " frames" << std::endl;
+    for (uint32_t i = 0; i < scope_count; i++)
+    {
+        const learn_d3d12::GpuScopeStats* scope_stats = nullptr;
+        for (const auto& stats : tracker.get_scope_stats())
+        {
+            scope_stats = stats.name == kScopeNames[i] ? &stats : scope_stats;
+        }
+        uint64_t samples = scope_stats ? scope_stats->sample_count : 0;
+        if (samples != expected_samples[i])
+        {
+            checker.report_error(frame_count, std::string(kScopeNames[i]) + " has " + std::to_string(samples) + " samples, expected " + std::to_string(expected_samples[i]));
+            continue;
+        }
+        if (samples == 0)
+        {
+            std::cout << std::left << std::setw(10) << kScopeNames[i] << std::right << "no queries" << std::endl;
+            continue;
+        }
+        if (!is_close(scope_stats->total_ms, expected_total_ms[i]) || !is_close(scope_stats->min_ms, expected_min_ms[i]) || !is_close(scope_stats->max_ms, expected_max_ms[i]))
+        {
+            checker.report_error(frame_count, std::string(kScopeNames[i]) + " aggregates do not match the synthetic timestamps");
+        }
+        std::cout << std::left << std::setw(10) << kScopeNames[i] << std::right << "avg " << scope_stats->average_ms() << " ms, min " << scope_stats->min_ms << " ms, max " << scope_stats->max_ms << " ms over " << samples
+                  << " frames" << std::endl;
+    }
+
+    if (checker.get_error_count() != 0)
+    {
+        std::cerr << "LearnD3d12TimestampSim: " << checker.get_error_count() << " errors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+#include "../scene/transform_hierarchy.h"
+#include "../threading/task_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cxxopts.hpp>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t kUploadBufferCount = 2;
+
+    // A tree where node i hangs below node (i - 1) / branching, with random local transforms.
+    void build_tree(learn_d3d12::TransformHierarchy& hierarchy, uint32_t node_count, uint32_t branching, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+        std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+        hierarchy.reserve(node_count);
+        for (uint32_t i = 0; i < node_count; i++)
+        {
+            learn_d3d12::LocalTransform local;
+            local.translation[0] = offset(random);
+            local.translation[1] = offset(random);
+            local.translation[2] = offset(random);
+            float half_angle = 0.5f * angle(random);
+            local.rotation[1] = std::sin(half_angle);
+            local.rotation[3] = std::cos(half_angle);
+            local.scale[0] = local.scale[1] = local.scale[2] = scale(random);
+            hierarchy.add_node(i == 0 ? learn_d3d12::TransformHierarchy::kInvalidNode : (i - 1) / branching, local);
+        }
+    }
+
+    struct Measurement
+    {
+        double milliseconds = 0.0;
+        uint64_t recomputed = 0;
+        uint64_t written = 0;
+    };
+
+    // Runs `iterations` frames that each call `touch` and then update into the next buffer
+    // of a ring of upload buffers.
+    template<typename Touch>
+    Measurement measure(learn_d3d12::TransformHierarchy& hierarchy, learn_d3d12::TaskPool* pool, std::vector<learn_d3d12::Float3x4>* upload_buffers, uint64_t* upload_serials, uint32_t iterations, Touch touch)
+    {
+        Measurement measurement;
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            touch(i);
+            uint32_t buffer = i % kUploadBufferCount;
+            auto start = std::chrono::steady_clock::now();
+            upload_serials[buffer] = hierarchy.update(pool, upload_buffers[buffer].data(), upload_serials[buffer]);
+            measurement.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            measurement.recomputed += hierarchy.get_recomputed_count();
+            measurement.written += hierarchy.get_written_count();
+        }
+        return measurement;
+    }
+
+    void print(const char* name, const Measurement& measurement, uint32_t iterations)
+    {
+        double milliseconds = measurement.milliseconds / iterations;
+        double recomputed = static_cast<double>(measurement.recomputed) / iterations;
+        double written_mb = static_cast<double>(measurement.written) * sizeof(learn_d3d12::Float3x4) / iterations / (1024.0 * 1024.0);
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(9) << milliseconds << " ms/update, " << std::setw(9) << static_cast<uint64_t>(recomputed)
+                  << " recomputed, " << std::setw(8) << written_mb << " MB written, "
+                  << (milliseconds > 0.0 ? recomputed / milliseconds / 1000.0 : 0.0) << " M nodes/s" << std::endl;
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("LearnD3d12TransformBench", "Benchmark for world matrix updates of the transform hierarchy.");
+    // clang-format off
+    options.add_options()
+        ("nodes", "Number of nodes in the hierarchy.", cxxopts::value<uint32_t>()->default_value("1000000"))
+        ("branching", "Children per node.", cxxopts::value<uint32_t>()->default_value("4"))
+        ("dirty-percent", "Percentage of nodes moved per frame in the partial run.", cxxopts::value<float>()->default_value("5"))
+        ("iterations", "Updates per run.", cxxopts::value<uint32_t>()->default_value("20"))
+        ("threads", "Threads including the main thread, 0 for one per hardware thread.", cxxopts::value<uint32_t>()->default_value("0"))
+        ("seed", "Seed for the tree and the moved nodes.", cxxopts::value<uint32_t>()->default_value("1"));
+    // clang-format on
+    cxxopts::ParseResult result;
+    try
+    {
+        result = options.parse(argc, argv);
+    }
+    catch (const cxxopts::exceptions::parsing& e)
+    {
+        std::cerr << "LearnD3d12TransformBench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto node_count = std::max(result["nodes"].as<uint32_t>(), 1u);
+    const auto branching = std::max(result["branching"].as<uint32_t>(), 1u);
+    const auto iterations = std::max(result["iterations"].as<uint32_t>(), 1u);
+    const auto seed = result["seed"].as<uint32_t>();
+    const auto dirty_count = static_cast<uint32_t>(std::clamp(result["dirty-percent"].as<float>(), 0.0f, 100.0f) / 100.0f * static_cast<float>(node_count));
+    auto thread_count = result["threads"].as<uint32_t>();
+    learn_d3d12::TaskPool task_pool(thread_count == 0 ? UINT32_MAX : thread_count - 1);
+
+    learn_d3d12::TransformHierarchy hierarchies[2];
+    std::vector<learn_d3d12::Float3x4> upload_buffers[2][kUploadBufferCount];
+    uint64_t upload_serials[2][kUploadBufferCount] = {};
+    for (uint32_t h = 0; h < 2; h++)
+    {
+        build_tree(hierarchies[h], node_count, branching, seed);
+        for (auto& buffer : upload_buffers[h])
+        {
+            buffer.resize(node_count);
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << node_count << " nodes, branching " << branching << ", " << task_pool.get_thread_count() << " threads, " << dirty_count << " nodes moved per partial update" << std::endl;
+
+    // Both hierarchies see the same changes; the first updates on one thread, the second
+    // across the pool, and their results must be identical.
+    const char* const kModeNames[] = {"serial", "parallel"};
+    for (uint32_t h = 0; h < 2; h++)
+    {
+        auto& hierarchy = hierarchies[h];
+        learn_d3d12::TaskPool* pool = h == 0 ? nullptr : &task_pool;
+        std::cout << kModeNames[h] << ":" << std::endl;
+
+        // The first update sorts the nodes into levels and writes everything.
+        auto start = std::chrono::steady_clock::now();
+        hierarchy.update(pool);
+        std::cout << "  build     " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms, " << hierarchy.get_level_count() << " levels" << std::endl;
+
+        std::cout << "  ";
+        print("full", measure(hierarchy, pool, upload_buffers[h], upload_serials[h], iterations, [&](uint32_t i) {
+                  hierarchy.set_translation(0, static_cast<float>(i), 0.0f, 0.0f);
+              }),
+              iterations);
+
+        std::mt19937 random(seed + 1);
+        std::uniform_int_distribution<uint32_t> node_distribution(0, node_count - 1);
+        std::cout << "  ";
+        print("partial", measure(hierarchy, pool, upload_buffers[h], upload_serials[h], iterations, [&](uint32_t i) {
+                  for (uint32_t n = 0; n < dirty_count; n++)
+                  {
+                      hierarchy.set_translation(node_distribution(random), static_cast<float>(i), 1.0f, 0.0f);
+                  }
+              }),
+              iterations);
+
+        std::cout << "  ";
+        print("unchanged", measure(hierarchy, pool, upload_buffers[h], upload_serials[h], iterations, [](uint32_t) {}), iterations);
+    }
+
+    for (uint32_t b = 0; b < kUploadBufferCount; b++)
+    {
+        if (std::memcmp(upload_buffers[0][b].data(), upload_buffers[1][b].data(), sizeof(learn_d3d12::Float3x4) * node_count) != 0)
+        {
+            std::cerr << "LearnD3d12TransformBench: serial and parallel updates wrote different matrices" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    for (uint32_t node = 0; node < node_count; node++)
+    {
+        auto world = hierarchies[0].get_world_matrix(node);
+        if (std::memcmp(&world, &upload_buffers[0][(iterations - 1) % kUploadBufferCount][hierarchies[0].get_slot(node)], sizeof(world)) != 0)
+        {
+            std::cerr << "LearnD3d12TransformBench: upload buffer is missing a change of node " << node << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}